@@ -0,0 +1,107 @@
+// Parse and destroy times of a json on the heap against a json_document,
+// whose values live in an arena that is released at once.
+//
+// The document is generated in memory (see bench_data.h). Every round
+// parses into a new json or json_document and destroys it again, the two
+// are timed separately. The first round also pays for growing the heap and
+// is not timed. The peak memory is that of the process, so run one document
+// and type per process.
+//
+//   g++ -std=c++11 -O2 -DNDEBUG -I.. arena_bench.cpp -o arena_bench
+//   ./arena_bench compact|strings|metrics json|document [items] [rounds]
+
+#include "json.hpp"
+
+#include "bench_data.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+using namespace configor;
+
+namespace
+{
+
+struct times
+{
+    double parse_ms   = 1e300;
+    double destroy_ms = 1e300;
+};
+
+template <typename _DocTy, typename _SizeFn>
+times measure(const std::string& text, int rounds, std::size_t items, bool& ok, _SizeFn size_of)
+{
+    using clock = std::chrono::steady_clock;
+
+    times best;
+    for (int r = 0; r <= rounds; ++r)
+    {
+        const auto             start = clock::now();
+        std::unique_ptr<_DocTy> doc(new _DocTy);
+        parse_config(*doc, text);
+        const auto parsed = clock::now();
+
+        ok = ok && size_of(*doc) == items;
+        doc.reset();
+        const auto destroyed = clock::now();
+
+        if (r == 0)
+            continue;
+        best.parse_ms   = (std::min)(best.parse_ms, std::chrono::duration<double, std::milli>(parsed - start).count());
+        best.destroy_ms = (std::min)(best.destroy_ms, std::chrono::duration<double, std::milli>(destroyed - parsed).count());
+    }
+    return best;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        std::fprintf(stderr, "usage: %s compact|strings|metrics json|document [items] [rounds]\n", argv[0]);
+        return 2;
+    }
+    const std::string name   = argv[1];
+    const std::string type   = argv[2];
+    const std::size_t items  = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 200000;
+    const int         rounds = argc > 4 ? std::atoi(argv[4]) : 5;
+
+    std::string text;
+    if (name == "compact")
+        text = bench::make_compact(items);
+    else if (name == "strings")
+        text = bench::make_strings(items);
+    else if (name == "metrics")
+        text = bench::make_metrics(items);
+
+    bool  ok = true;
+    times best;
+    if (text.empty())
+    {
+        std::fprintf(stderr, "unknown document %s\n", name.c_str());
+        return 2;
+    }
+    else if (type == "json")
+    {
+        best = measure<json>(text, rounds, items, ok, [](const json& j) { return j.size(); });
+    }
+    else if (type == "document")
+    {
+        best = measure<json_document>(text, rounds, items, ok, [](const json_document& d) { return d.root().size(); });
+    }
+    else
+    {
+        std::fprintf(stderr, "unknown type %s\n", type.c_str());
+        return 2;
+    }
+
+    std::printf("%-8s %-9s %zu items, best of %d: parse %7.1f ms, destroy %6.2f ms, max rss %ld MiB%s\n", name.c_str(),
+                type.c_str(), items, rounds, best.parse_ms, best.destroy_ms, bench::max_rss_mib(),
+                ok ? "" : " (parsed wrong)");
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+// Generated documents and timing helpers for the benchmarks. The documents
+// are built as text, without configor, so that the same bytes are parsed by
+// every version of the library a benchmark is built against.
+
+#include <sys/resource.h>
+
+#include <algorithm>  // std::min
+#include <chrono>     // std::chrono::steady_clock
+#include <cstddef>    // std::size_t
+#include <cstdio>     // std::snprintf
+#include <string>     // std::string, std::to_string
+
+namespace configor
+{
+namespace bench
+{
+
+// the i-th small record, without whitespace
+inline std::string make_record(std::size_t i)
+{
+    return "{\"id\":" + std::to_string(i) + ",\"name\":\"user" + std::to_string(i % 5000) + "\",\"active\":"
+           + (i % 3 ? "true" : "false") + ",\"score\":" + std::to_string(i * 7 % 1000)
+           + ",\"tags\":[\"red\",\"green\",\"blue\"],\"parent\":null,\"pos\":{\"x\":" + std::to_string(i % 640)
+           + ",\"y\":" + std::to_string(i % 480) + "}}";
+}
+
+// an array of records, without whitespace
+inline std::string make_compact(std::size_t items)
+{
+    std::string out = "[";
+    for (std::size_t i = 0; i < items; ++i)
+    {
+        if (i)
+            out += ",";
+        out += make_record(i);
+    }
+    out += "]";
+    return out;
+}
+
+// the records of make_compact, indented by four spaces per level
+inline std::string make_pretty(std::size_t items)
+{
+    std::string out = "[\n";
+    for (std::size_t i = 0; i < items; ++i)
+    {
+        if (i)
+            out += ",\n";
+        out += "    {\n        \"id\": " + std::to_string(i) + ",\n        \"name\": \"user" + std::to_string(i % 5000)
+               + "\",\n        \"active\": " + (i % 3 ? "true" : "false") + ",\n        \"score\": "
+               + std::to_string(i * 7 % 1000)
+               + ",\n        \"tags\": [\n            \"red\",\n            \"green\",\n            \"blue\"\n        ],\n"
+                 "        \"parent\": null,\n        \"pos\": {\n            \"x\": "
+               + std::to_string(i % 640) + ",\n            \"y\": " + std::to_string(i % 480) + "\n        }\n    }";
+    }
+    out += "\n]\n";
+    return out;
+}
+
+// an array of long strings, a few of them with escapes and \u sequences
+inline std::string make_strings(std::size_t items)
+{
+    static const char text[] = "The quick brown fox jumps over the lazy dog while the band plays on. ";
+
+    std::string out = "[";
+    for (std::size_t i = 0; i < items; ++i)
+    {
+        if (i)
+            out += ",";
+        out += "\"";
+        for (int j = 0; j < 4; ++j)
+            out += text;
+        if (i % 8 == 0)
+            out += "line\\nbreak \\\"quoted\\\" \\u00e9\\u4e2d";
+        out += std::to_string(i) + "\"";
+    }
+    out += "]";
+    return out;
+}
+
+// an array of records whose values are mostly floating point numbers
+inline std::string make_metrics(std::size_t items)
+{
+    std::string out = "[";
+    char        buf[128];
+    for (std::size_t i = 0; i < items; ++i)
+    {
+        const double t = static_cast<double>(i);
+        std::snprintf(buf, sizeof(buf), "{\"t\":%.3f,\"cpu\":%.17g,\"mem\":%.6g,\"lat\":[%.4f,%.9g,%.2e]}", 1.6e9 + t * 0.25,
+                      (static_cast<double>(i * 2654435761u % 1000003) / 1000003.0), 512.0 + t / 7.0, t / 1000.0,
+                      1.0 / (t + 3.0), t * 1.5e-7);
+        if (i)
+            out += ",";
+        out += buf;
+    }
+    out += "]";
+    return out;
+}
+
+// the shortest time of `rounds` calls of f, in seconds
+// the value f returns is destroyed after the clock has stopped
+template <typename _Fn>
+double best_seconds(int rounds, _Fn f)
+{
+    double best = 1e300;
+    for (int r = 0; r < rounds; ++r)
+    {
+        const auto start  = std::chrono::steady_clock::now();
+        const auto result = f();
+        best = (std::min)(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        (void)result;
+    }
+    return best;
+}
+
+// the peak resident set size of the process, in MiB
+inline long max_rss_mib()
+{
+    rusage ru{};
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_maxrss / 1024;
+}
+
+}  // namespace bench
+}  // namespace configor
@@ -0,0 +1,44 @@
+// Parse and dump throughput of a document made mostly of floating point
+// numbers, and whether dumping and parsing again gives the same document.
+//
+// The document is generated in memory (see bench_data.h) and written with
+// printf precisions from 3 to 17 digits. Building the same file with -I
+// pointed at an older Configor compares versions.
+//
+//   g++ -std=c++11 -O2 -DNDEBUG -I.. number_bench.cpp -o number_bench
+//   ./number_bench [items] [rounds]
+
+#include "json.hpp"
+
+#include "bench_data.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+using namespace configor;
+
+int main(int argc, char** argv)
+{
+    const std::size_t items  = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+    const int         rounds = argc > 2 ? std::atoi(argv[2]) : 5;
+
+    const std::string text = bench::make_metrics(items);
+
+    // the first parse also pays for growing the heap, it is not timed
+    const json   j             = json::parse(text);
+    const double parse_seconds = bench::best_seconds(rounds, [&]() { return json::parse(text); });
+
+    const std::string dumped       = j.dump();
+    const double      dump_seconds = bench::best_seconds(rounds, [&]() { return j.dump(); });
+
+    const bool round_trip = json::parse(dumped) == j;
+
+    std::printf("%zu records, %.1f MB, best of %d\n", items, static_cast<double>(text.size()) / 1e6, rounds);
+    std::printf("parse %8.1f MB/s\n", static_cast<double>(text.size()) / 1e6 / parse_seconds);
+    std::printf("dump  %8.1f MB/s (%.1f MB)\n", static_cast<double>(dumped.size()) / 1e6 / dump_seconds,
+                static_cast<double>(dumped.size()) / 1e6);
+    std::printf("parse(dump()) == parse(text): %s\n", round_trip ? "yes" : "no");
+
+    return (j.size() == items && round_trip) ? 0 : 1;
+}
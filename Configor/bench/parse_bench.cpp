@@ -0,0 +1,69 @@
+// Parse throughput of json::parse for documents of different shapes.
+//
+// The documents are generated in memory (see bench_data.h): small records
+// without whitespace, the same records indented, and long strings. Parsing
+// from a std::string takes the contiguous-buffer lexer, parsing from a
+// std::istream the per-character one. Building the same file with -I
+// pointed at an older Configor compares versions.
+//
+//   g++ -std=c++11 -O2 -DNDEBUG -I.. parse_bench.cpp -o parse_bench
+//   ./parse_bench [items] [rounds]
+
+#include "json.hpp"
+
+#include "bench_data.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+
+using namespace configor;
+
+int main(int argc, char** argv)
+{
+    const std::size_t items  = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+    const int         rounds = argc > 2 ? std::atoi(argv[2]) : 5;
+
+    struct document
+    {
+        const char* name;
+        std::string text;
+        std::size_t size;
+    };
+    const document documents[] = {
+        { "compact", bench::make_compact(items), items },
+        { "pretty", bench::make_pretty(items), items },
+        { "strings", bench::make_strings(items), items },
+    };
+
+    std::printf("%zu items, best of %d\n", items, rounds);
+    std::printf("%-10s %8s %14s %14s\n", "document", "MB", "string MB/s", "istream MB/s");
+
+    bool ok = true;
+    for (const auto& doc : documents)
+    {
+        const double mb = static_cast<double>(doc.text.size()) / 1e6;
+
+        // the first parse also pays for growing the heap, it is not timed
+        const json   from_string    = json::parse(doc.text);
+        const double string_seconds = bench::best_seconds(rounds, [&]() { return json::parse(doc.text); });
+
+        std::istringstream first(doc.text);
+        const json         from_stream    = json::parse(first);
+        const double       stream_seconds = bench::best_seconds(rounds, [&]() {
+            std::istringstream is(doc.text);
+            return json::parse(is);
+        });
+
+        ok = ok && from_string.size() == doc.size && from_string == from_stream;
+        std::printf("%-10s %8.1f %14.1f %14.1f\n", doc.name, mb, mb / string_seconds, mb / stream_seconds);
+    }
+
+    if (!ok)
+    {
+        std::fprintf(stderr, "a document was parsed wrong\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,200 @@
+// Time and peak memory of reading every record of a large file, with the
+// whole tree against json_reader and a SAX handler.
+//
+// The file is generated in a temporary directory (see bench_data.h) and
+// holds `records` records, either as one top-level array or one record per
+// line. Every mode sums the "score" of all records:
+//   array  tree     parse_config of the whole file into one json
+//   array  reader   json_reader with reader_format::array
+//   array  sax      sax_parse_config of the whole file
+//   lines  getline  std::getline and json::parse for each line
+//   lines  reader   json_reader with reader_format::lines
+//   lines  sax      std::getline and sax_parse_config for each line
+// The peak memory is that of the process, so run one mode per process.
+//
+//   g++ -std=c++11 -O2 -DNDEBUG -I.. reader_bench.cpp -o reader_bench
+//   ./reader_bench array|lines tree|reader|sax|getline [records]
+
+#include "json.hpp"
+
+#include "bench_data.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+using namespace configor;
+
+namespace
+{
+
+// sums the "score" of the objects at the top level of the array or lines
+class score_handler : public basic_sax_handler<json>
+{
+public:
+    score_handler(int record_depth)
+        : record_depth_(record_depth)
+    {
+    }
+
+    bool start_object() override
+    {
+        ++depth_;
+        return true;
+    }
+
+    bool end_object() override
+    {
+        if (depth_-- == record_depth_)
+            ++records;
+        return true;
+    }
+
+    bool start_array() override
+    {
+        ++depth_;
+        return true;
+    }
+
+    bool end_array() override
+    {
+        --depth_;
+        return true;
+    }
+
+    bool key(std::string& k) override
+    {
+        score_ = depth_ == record_depth_ && k == "score";
+        return true;
+    }
+
+    bool number_integer(int64_t i) override
+    {
+        if (score_)
+            sum += i;
+        score_ = false;
+        return true;
+    }
+
+    long long records = 0;
+    long long sum     = 0;
+
+private:
+    int  record_depth_;
+    int  depth_ = 0;
+    bool score_ = false;
+};
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        std::fprintf(stderr, "usage: %s array|lines tree|reader|sax|getline [records]\n", argv[0]);
+        return 2;
+    }
+    const bool        lines   = std::strcmp(argv[1], "lines") == 0;
+    const std::string mode    = argv[2];
+    const std::size_t records = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 1000000;
+
+    char dir[] = "/tmp/configor_bench_XXXXXX";
+    if (mkdtemp(dir) == nullptr)
+    {
+        std::perror("mkdtemp");
+        return 1;
+    }
+    const std::string path = std::string(dir) + "/records.json";
+
+    long long expected = 0;
+    {
+        std::ofstream ofs(path, std::ios::binary);
+        if (!lines)
+            ofs << "[";
+        for (std::size_t i = 0; i < records; ++i)
+        {
+            if (i && !lines)
+                ofs << ",";
+            ofs << bench::make_record(i);
+            if (lines)
+                ofs << "\n";
+            expected += static_cast<long long>(i * 7 % 1000);
+        }
+        if (!lines)
+            ofs << "]";
+    }
+
+    long long  count = 0;
+    long long  sum   = 0;
+    const auto start = std::chrono::steady_clock::now();
+    {
+        std::ifstream ifs(path, std::ios::binary);
+        if (!lines && mode == "tree")
+        {
+            json all;
+            parse_config(all, ifs);
+            for (const auto& record : all)
+            {
+                ++count;
+                sum += record["score"].get<int64_t>();
+            }
+        }
+        else if (mode == "reader")
+        {
+            for (const auto& record : json_reader<>(ifs, lines ? reader_format::lines : reader_format::array))
+            {
+                ++count;
+                sum += record["score"].get<int64_t>();
+            }
+        }
+        else if (!lines && mode == "sax")
+        {
+            score_handler handler(2);
+            sax_parse_config(handler, ifs);
+            count = handler.records;
+            sum   = handler.sum;
+        }
+        else if (lines && mode == "sax")
+        {
+            // a sax handler sees one document, so each line is handed over on its own
+            score_handler handler(1);
+            std::string   line;
+            while (std::getline(ifs, line))
+                sax_parse_config(handler, line);
+            count = handler.records;
+            sum   = handler.sum;
+        }
+        else if (lines && mode == "getline")
+        {
+            std::string line;
+            while (std::getline(ifs, line))
+            {
+                const json record = json::parse(line);
+                ++count;
+                sum += record["score"].get<int64_t>();
+            }
+        }
+        else
+        {
+            std::fprintf(stderr, "unknown mode %s %s\n", argv[1], mode.c_str());
+            count = -1;
+        }
+    }
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::ifstream size_of(path, std::ios::binary | std::ios::ate);
+    const double  mb = static_cast<double>(size_of.tellg()) / 1e6;
+    ::unlink(path.c_str());
+    ::rmdir(dir);
+
+    const bool ok = count == static_cast<long long>(records) && sum == expected;
+    std::printf("%-6s %-8s %zu records, %.1f MB: %6.2f s, %6.1f MB/s, max rss %ld MiB%s\n", argv[1], mode.c_str(), records,
+                mb, seconds, mb / seconds, bench::max_rss_mib(), ok ? "" : " (wrong result)");
+    return ok ? 0 : 1;
+}
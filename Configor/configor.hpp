@@ -19,7 +19,10 @@
 // THE SOFTWARE.
 
 #pragma once
+#include "configor_arena.hpp"
 #include "configor_basic.hpp"
+#include "configor_flat_map.hpp"
+#include "configor_sax.hpp"
 
 namespace configor
 {
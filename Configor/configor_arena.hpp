@@ -0,0 +1,355 @@
+// Copyright (c) 2018-2021 configor - Nomango
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+#include "configor_exception.hpp"
+
+#include <algorithm>    // std::max
+#include <cstddef>      // std::size_t, std::max_align_t
+#include <cstdint>      // std::uintptr_t
+#include <memory>       // std::unique_ptr
+#include <new>          // std::bad_alloc, ::operator new
+#include <type_traits>  // std::true_type, std::false_type
+#include <utility>      // std::forward
+
+namespace configor
+{
+
+//
+// monotonic_arena
+//
+
+// hands out memory from large blocks and frees it all at once
+// it is not thread-safe, a parsed document should stay on one thread while it is being modified
+class monotonic_arena
+{
+public:
+    static const std::size_t default_block_size = 64 * 1024;
+    static const std::size_t max_block_size     = 4 * 1024 * 1024;
+
+    explicit monotonic_arena(std::size_t block_size = default_block_size)
+        : head_(nullptr)
+        , cursor_(nullptr)
+        , end_(nullptr)
+        , initial_block_size_(std::max<std::size_t>(block_size, sizeof(block) * 2))
+        , next_block_size_(initial_block_size_)
+        , reserved_(0)
+    {
+    }
+
+    monotonic_arena(const monotonic_arena&)            = delete;
+    monotonic_arena& operator=(const monotonic_arena&) = delete;
+
+    ~monotonic_arena()
+    {
+        release();
+    }
+
+    inline void* allocate(std::size_t size, std::size_t alignment)
+    {
+        CONFIGOR_ASSERT(alignment != 0 && (alignment & (alignment - 1)) == 0);
+
+        std::uintptr_t pos = (reinterpret_cast<std::uintptr_t>(cursor_) + alignment - 1) & ~static_cast<std::uintptr_t>(alignment - 1);
+        if (cursor_ == nullptr || pos > reinterpret_cast<std::uintptr_t>(end_) || size > static_cast<std::size_t>(reinterpret_cast<std::uintptr_t>(end_) - pos))
+        {
+            add_block(size + alignment);
+            pos = (reinterpret_cast<std::uintptr_t>(cursor_) + alignment - 1) & ~static_cast<std::uintptr_t>(alignment - 1);
+        }
+        cursor_ = reinterpret_cast<char*>(pos + size);
+        return reinterpret_cast<void*>(pos);
+    }
+
+    // frees all blocks, memory handed out before must not be used any more
+    inline void release()
+    {
+        while (head_)
+        {
+            block* next = head_->next;
+            ::operator delete(head_);
+            head_ = next;
+        }
+        cursor_          = nullptr;
+        end_             = nullptr;
+        next_block_size_ = initial_block_size_;
+        reserved_        = 0;
+    }
+
+    // bytes of all blocks allocated from the system
+    inline std::size_t reserved() const
+    {
+        return reserved_;
+    }
+
+    // the arena that default constructed arena_allocators use on this thread, see arena_scope
+    static inline monotonic_arena*& current()
+    {
+        static thread_local monotonic_arena* arena = nullptr;
+        return arena;
+    }
+
+private:
+    struct alignas(std::max_align_t) block
+    {
+        block* next;
+    };
+
+    void add_block(std::size_t min_size)
+    {
+        const std::size_t size = std::max(next_block_size_, min_size + sizeof(block));
+        if (size < min_size)
+            throw std::bad_alloc();
+
+        block* b = static_cast<block*>(::operator new(size));
+        b->next  = head_;
+        head_    = b;
+        cursor_  = reinterpret_cast<char*>(b + 1);
+        end_     = reinterpret_cast<char*>(b) + size;
+
+        reserved_ += size;
+        // blocks grow geometrically, so that a large document needs few of them
+        if (next_block_size_ < max_block_size)
+            next_block_size_ *= 2;
+    }
+
+private:
+    block*      head_;
+    char*       cursor_;
+    char*       end_;
+    std::size_t initial_block_size_;
+    std::size_t next_block_size_;
+    std::size_t reserved_;
+};
+
+//
+// arena_scope
+//
+
+// makes an arena the current one of this thread until the scope ends
+class arena_scope
+{
+public:
+    explicit arena_scope(monotonic_arena& arena)
+        : previous_(monotonic_arena::current())
+        , active_(true)
+    {
+        monotonic_arena::current() = &arena;
+    }
+
+    arena_scope(arena_scope&& other)
+        : previous_(other.previous_)
+        , active_(other.active_)
+    {
+        other.active_ = false;
+    }
+
+    arena_scope(const arena_scope&)            = delete;
+    arena_scope& operator=(const arena_scope&) = delete;
+
+    ~arena_scope()
+    {
+        if (active_)
+            monotonic_arena::current() = previous_;
+    }
+
+private:
+    monotonic_arena* previous_;
+    bool             active_;
+};
+
+//
+// arena_allocator
+//
+
+// allocates from the arena that is current when the allocator is constructed, deallocation does nothing
+// without a current arena it falls back to operator new and operator delete
+template <typename _Ty>
+class arena_allocator
+{
+public:
+    using value_type = _Ty;
+
+    using propagate_on_container_copy_assignment = std::false_type;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap            = std::true_type;
+
+    arena_allocator() noexcept
+        : arena_(monotonic_arena::current())
+    {
+    }
+
+    explicit arena_allocator(monotonic_arena* arena) noexcept
+        : arena_(arena)
+    {
+    }
+
+    template <typename _UTy>
+    arena_allocator(const arena_allocator<_UTy>& other) noexcept
+        : arena_(other.arena())
+    {
+    }
+
+    inline _Ty* allocate(std::size_t n)
+    {
+        if (n > static_cast<std::size_t>(-1) / sizeof(_Ty))
+            throw std::bad_alloc();
+
+        if (arena_)
+            return static_cast<_Ty*>(arena_->allocate(n * sizeof(_Ty), alignof(_Ty)));
+        return static_cast<_Ty*>(::operator new(n * sizeof(_Ty)));
+    }
+
+    inline void deallocate(_Ty* ptr, std::size_t) noexcept
+    {
+        if (!arena_)
+            ::operator delete(ptr);
+    }
+
+    // the arena is current while the object is constructed,
+    // so that the values and strings inside a container are allocated where the container is
+    template <typename _UTy, typename... _Args>
+    inline void construct(_UTy* ptr, _Args&&... args)
+    {
+        monotonic_arena*& current = monotonic_arena::current();
+        if (current == arena_)
+        {
+            ::new (static_cast<void*>(ptr)) _UTy(std::forward<_Args>(args)...);
+            return;
+        }
+
+        monotonic_arena* previous = current;
+        current                   = arena_;
+        try
+        {
+            ::new (static_cast<void*>(ptr)) _UTy(std::forward<_Args>(args)...);
+        }
+        catch (...)
+        {
+            current = previous;
+            throw;
+        }
+        current = previous;
+    }
+
+    // copies are placed in the current arena, not in the arena of the source
+    inline arena_allocator select_on_container_copy_construction() const
+    {
+        return arena_allocator();
+    }
+
+    inline monotonic_arena* arena() const noexcept
+    {
+        return arena_;
+    }
+
+    template <typename _UTy>
+    friend inline bool operator==(const arena_allocator& lhs, const arena_allocator<_UTy>& rhs) noexcept
+    {
+        return lhs.arena() == rhs.arena();
+    }
+
+    template <typename _UTy>
+    friend inline bool operator!=(const arena_allocator& lhs, const arena_allocator<_UTy>& rhs) noexcept
+    {
+        return lhs.arena() != rhs.arena();
+    }
+
+private:
+    monotonic_arena* arena_;
+};
+
+//
+// config_document
+//
+
+// owns a config and the arena that all of its values are allocated in, _ConfTy must use arena_allocator
+// destroying or clearing the document releases the arena without visiting the values,
+// values assigned to root() later are copied into the arena unless they were created while scope() is alive
+template <typename _ConfTy>
+class config_document
+{
+public:
+    using config_type = _ConfTy;
+
+    explicit config_document(std::size_t block_size = monotonic_arena::default_block_size)
+        : arena_(new monotonic_arena(block_size))
+        , root_(nullptr)
+    {
+        clear();
+    }
+
+    config_document(config_document&& other) noexcept
+        : arena_(std::move(other.arena_))
+        , root_(other.root_)
+    {
+        other.root_ = nullptr;
+    }
+
+    config_document& operator=(config_document&& other) noexcept
+    {
+        arena_      = std::move(other.arena_);
+        root_       = other.root_;
+        other.root_ = nullptr;
+        return *this;
+    }
+
+    config_document(const config_document&)            = delete;
+    config_document& operator=(const config_document&) = delete;
+
+    // releases all values and resets the root to null
+    inline void clear()
+    {
+        CONFIGOR_ASSERT(arena_);
+
+        arena_->release();
+
+        arena_scope scope{ *arena_ };
+        root_ = new (arena_->allocate(sizeof(config_type), alignof(config_type))) config_type();
+    }
+
+    inline config_type& root()
+    {
+        CONFIGOR_ASSERT(root_);
+        return *root_;
+    }
+
+    inline const config_type& root() const
+    {
+        CONFIGOR_ASSERT(root_);
+        return *root_;
+    }
+
+    inline monotonic_arena& arena()
+    {
+        CONFIGOR_ASSERT(arena_);
+        return *arena_;
+    }
+
+    // values created while the returned scope is alive are allocated in the document
+    inline arena_scope scope()
+    {
+        return arena_scope{ arena() };
+    }
+
+private:
+    std::unique_ptr<monotonic_arena> arena_;
+    config_type*                     root_;
+};
+
+}  // namespace configor
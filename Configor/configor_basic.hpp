@@ -82,9 +82,6 @@ public:
     basic_config(basic_config&& other) noexcept
         : value_(std::move(other.value_))
     {
-        // invalidate payload
-        other.value_.type        = config_value_type::null;
-        other.value_.data.object = nullptr;
     }
 
     basic_config(const std::initializer_list<basic_config>& init_list, config_value_type exact_type = config_value_type::null)
@@ -582,7 +579,8 @@ public:
 
     inline basic_config& operator=(basic_config rhs)
     {
-        swap(rhs);
+        // not a swap, the value keeps its allocator
+        value_ = std::move(rhs.value_);
         return (*this);
     }
 
@@ -658,7 +656,8 @@ public:
         {
             throw configor_invalid_key("operator[] called on a non-object object");
         }
-        return (*value_.data.object)[key];
+        // the key is moved into the object, so it must be allocated like the object
+        return (*value_.data.object)[string_type(key, value_.template get_allocator<char_type>())];
     }
 
     template <typename _CharTy>
@@ -0,0 +1,436 @@
+// Copyright (c) 2018-2021 configor - Nomango
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+#include <algorithm>         // std::max, std::sort, std::lexicographical_compare
+#include <cstdint>           // uint32_t, uint64_t
+#include <functional>        // std::less
+#include <initializer_list>  // std::initializer_list
+#include <memory>            // std::allocator, std::allocator_traits, std::addressof
+#include <new>               // placement new
+#include <stdexcept>         // std::out_of_range
+#include <tuple>             // std::forward_as_tuple
+#include <type_traits>       // std::make_unsigned
+#include <utility>           // std::pair, std::piecewise_construct, std::move, std::forward
+#include <vector>            // std::vector
+
+namespace configor
+{
+
+namespace detail
+{
+// FNV-1a over the characters of a string key
+template <typename _StrTy>
+inline uint64_t hash_flat_map_key(const _StrTy& key)
+{
+    using unsigned_char_type = typename std::make_unsigned<typename _StrTy::value_type>::type;
+
+    uint64_t h = 14695981039346656037ULL;
+    for (const auto ch : key)
+    {
+        h ^= static_cast<uint64_t>(static_cast<unsigned_char_type>(ch));
+        h *= 1099511628211ULL;
+    }
+    return h ^ (h >> 32);
+}
+}  // namespace detail
+
+//
+// basic_flat_map
+//
+
+// an object type that keeps its members in a vector, in the order they were inserted
+// keys are searched linearly, objects with more than index_threshold members also build a hash index
+// when _KeepOrder is false, erasing moves the last member into the gap instead of shifting the rest
+// _Compare is only used to order objects in operator<
+template <bool _KeepOrder, typename _Kty, typename _Ty, typename _Compare = std::less<_Kty>,
+          typename _Alloc = std::allocator<std::pair<const _Kty, _Ty>>>
+class basic_flat_map
+{
+public:
+    using key_type        = _Kty;
+    using mapped_type     = _Ty;
+    using value_type      = std::pair<const _Kty, _Ty>;
+    using key_compare     = _Compare;
+    using allocator_type  = _Alloc;
+    using reference       = value_type&;
+    using const_reference = const value_type&;
+
+private:
+    using storage_type = std::vector<value_type, allocator_type>;
+    using index_type   = std::vector<uint32_t, typename std::allocator_traits<allocator_type>::template rebind_alloc<uint32_t>>;
+
+public:
+    using size_type              = typename storage_type::size_type;
+    using difference_type        = typename storage_type::difference_type;
+    using iterator               = typename storage_type::iterator;
+    using const_iterator         = typename storage_type::const_iterator;
+    using reverse_iterator       = typename storage_type::reverse_iterator;
+    using const_reverse_iterator = typename storage_type::const_reverse_iterator;
+
+    static const size_type index_threshold = 16;
+
+    basic_flat_map()
+        : members_()
+        , index_()
+    {
+    }
+
+    explicit basic_flat_map(const allocator_type& allocator)
+        : members_(allocator)
+        , index_(allocator)
+    {
+    }
+
+    basic_flat_map(std::initializer_list<value_type> init_list)
+        : basic_flat_map()
+    {
+        insert(init_list.begin(), init_list.end());
+    }
+
+    inline iterator begin() noexcept
+    {
+        return members_.begin();
+    }
+    inline const_iterator begin() const noexcept
+    {
+        return members_.begin();
+    }
+    inline const_iterator cbegin() const noexcept
+    {
+        return members_.cbegin();
+    }
+    inline iterator end() noexcept
+    {
+        return members_.end();
+    }
+    inline const_iterator end() const noexcept
+    {
+        return members_.end();
+    }
+    inline const_iterator cend() const noexcept
+    {
+        return members_.cend();
+    }
+    inline reverse_iterator rbegin() noexcept
+    {
+        return members_.rbegin();
+    }
+    inline const_reverse_iterator rbegin() const noexcept
+    {
+        return members_.rbegin();
+    }
+    inline reverse_iterator rend() noexcept
+    {
+        return members_.rend();
+    }
+    inline const_reverse_iterator rend() const noexcept
+    {
+        return members_.rend();
+    }
+
+    inline size_type size() const noexcept
+    {
+        return members_.size();
+    }
+
+    inline bool empty() const noexcept
+    {
+        return members_.empty();
+    }
+
+    inline size_type max_size() const noexcept
+    {
+        return members_.max_size();
+    }
+
+    inline void reserve(size_type count)
+    {
+        members_.reserve(count);
+    }
+
+    inline allocator_type get_allocator() const
+    {
+        return members_.get_allocator();
+    }
+
+    inline void clear() noexcept
+    {
+        members_.clear();
+        index_.clear();
+    }
+
+    inline iterator find(const key_type& key)
+    {
+        return members_.begin() + static_cast<difference_type>(find_position(key));
+    }
+
+    inline const_iterator find(const key_type& key) const
+    {
+        return members_.begin() + static_cast<difference_type>(find_position(key));
+    }
+
+    inline size_type count(const key_type& key) const
+    {
+        return find_position(key) != members_.size() ? 1 : 0;
+    }
+
+    inline mapped_type& at(const key_type& key)
+    {
+        const size_type pos = find_position(key);
+        if (pos == members_.size())
+            throw std::out_of_range("basic_flat_map::at");
+        return members_[pos].second;
+    }
+
+    inline const mapped_type& at(const key_type& key) const
+    {
+        const size_type pos = find_position(key);
+        if (pos == members_.size())
+            throw std::out_of_range("basic_flat_map::at");
+        return members_[pos].second;
+    }
+
+    inline mapped_type& operator[](const key_type& key)
+    {
+        return emplace(key).first->second;
+    }
+
+    inline mapped_type& operator[](key_type&& key)
+    {
+        return emplace(std::move(key)).first->second;
+    }
+
+    // does nothing if the key exists, like std::map::emplace
+    template <typename _KeyTy, typename... _Args>
+    std::pair<iterator, bool> emplace(_KeyTy&& key, _Args&&... args)
+    {
+        const size_type pos = find_position(key);
+        if (pos != members_.size())
+            return std::make_pair(members_.begin() + static_cast<difference_type>(pos), false);
+
+        // skip the smallest reallocations, which copy the const keys
+        if (members_.empty())
+            members_.reserve(4);
+        members_.emplace_back(std::piecewise_construct, std::forward_as_tuple(std::forward<_KeyTy>(key)), std::forward_as_tuple(std::forward<_Args>(args)...));
+        index_last();
+        return std::make_pair(members_.end() - 1, true);
+    }
+
+    inline std::pair<iterator, bool> insert(const value_type& value)
+    {
+        return emplace(value.first, value.second);
+    }
+
+    inline std::pair<iterator, bool> insert(value_type&& value)
+    {
+        // the key of a pair is const, so it can only be copied
+        return emplace(value.first, std::move(value.second));
+    }
+
+    template <typename _InputIt>
+    void insert(_InputIt first, _InputIt last)
+    {
+        for (; first != last; ++first)
+            emplace(first->first, first->second);
+    }
+
+    inline size_type erase(const key_type& key)
+    {
+        const size_type pos = find_position(key);
+        if (pos == members_.size())
+            return 0;
+
+        erase(members_.cbegin() + static_cast<difference_type>(pos));
+        return 1;
+    }
+
+    iterator erase(const_iterator pos)
+    {
+        return erase(pos, pos + 1);
+    }
+
+    iterator erase(const_iterator first, const_iterator last)
+    {
+        const size_type from  = static_cast<size_type>(first - members_.cbegin());
+        const size_type count = static_cast<size_type>(last - first);
+        if (count == 0)
+            return members_.begin() + static_cast<difference_type>(from);
+
+        const size_type size = members_.size();
+        if (_KeepOrder || from + count == size)
+        {
+            // the keys are const, so members are moved by constructing them again
+            for (size_type i = from; i + count < size; ++i)
+                relocate(members_[i], members_[i + count]);
+        }
+        else
+        {
+            // fill the gap with the members from the end
+            const size_type tail = std::max(from + count, size - count);
+            for (size_type i = 0; i < count && tail + i < size; ++i)
+                relocate(members_[from + i], members_[tail + i]);
+        }
+
+        for (size_type i = 0; i < count; ++i)
+            members_.pop_back();
+
+        rebuild_index();
+        return members_.begin() + static_cast<difference_type>(from);
+    }
+
+    inline void swap(basic_flat_map& other)
+    {
+        members_.swap(other.members_);
+        index_.swap(other.index_);
+    }
+
+    // objects are equal if they have the same members, regardless of the order
+    friend bool operator==(const basic_flat_map& lhs, const basic_flat_map& rhs)
+    {
+        if (lhs.size() != rhs.size())
+            return false;
+
+        for (const auto& member : lhs.members_)
+        {
+            const size_type pos = rhs.find_position(member.first);
+            if (pos == rhs.size() || !(rhs.members_[pos].second == member.second))
+                return false;
+        }
+        return true;
+    }
+
+    friend inline bool operator!=(const basic_flat_map& lhs, const basic_flat_map& rhs)
+    {
+        return !(lhs == rhs);
+    }
+
+    // compares the members sorted by key, as std::map does
+    friend bool operator<(const basic_flat_map& lhs, const basic_flat_map& rhs)
+    {
+        const std::vector<const value_type*> lhs_sorted = lhs.sorted_members();
+        const std::vector<const value_type*> rhs_sorted = rhs.sorted_members();
+        return std::lexicographical_compare(lhs_sorted.begin(), lhs_sorted.end(), rhs_sorted.begin(), rhs_sorted.end(),
+                                            [](const value_type* a, const value_type* b) { return *a < *b; });
+    }
+
+private:
+    size_type find_position(const key_type& key) const
+    {
+        const size_type size = members_.size();
+        if (index_.empty())
+        {
+            for (size_type i = 0; i < size; ++i)
+            {
+                if (members_[i].first == key)
+                    return i;
+            }
+            return size;
+        }
+
+        const size_type mask = index_.size() - 1;
+        for (size_type slot = static_cast<size_type>(detail::hash_flat_map_key(key)) & mask; index_[slot] != 0; slot = (slot + 1) & mask)
+        {
+            const size_type pos = index_[slot] - 1;
+            if (members_[pos].first == key)
+                return pos;
+        }
+        return size;
+    }
+
+    // adds the last member to the index, the index is built once the object is large enough
+    inline void index_last()
+    {
+        const size_type size = members_.size();
+        if (size <= index_threshold)
+            return;
+
+        // keep the load factor under 1/2
+        if (index_.size() < size * 2)
+        {
+            rebuild_index();
+            return;
+        }
+        insert_index(size - 1);
+    }
+
+    void rebuild_index()
+    {
+        const size_type size = members_.size();
+        if (size <= index_threshold)
+        {
+            index_.clear();
+            return;
+        }
+
+        size_type capacity = 64;
+        while (capacity < size * 4)
+            capacity *= 2;
+
+        index_.assign(capacity, 0);
+        for (size_type i = 0; i < size; ++i)
+            insert_index(i);
+    }
+
+    inline void insert_index(size_type pos)
+    {
+        const size_type mask = index_.size() - 1;
+
+        size_type slot = static_cast<size_type>(detail::hash_flat_map_key(members_[pos].first)) & mask;
+        while (index_[slot] != 0)
+            slot = (slot + 1) & mask;
+        index_[slot] = static_cast<uint32_t>(pos + 1);
+    }
+
+    static inline void relocate(value_type& dest, value_type& src)
+    {
+        dest.~value_type();
+        ::new (static_cast<void*>(std::addressof(dest))) value_type(std::move(src));
+    }
+
+    std::vector<const value_type*> sorted_members() const
+    {
+        std::vector<const value_type*> sorted;
+        sorted.reserve(members_.size());
+        for (const auto& member : members_)
+            sorted.push_back(std::addressof(member));
+
+        key_compare compare;
+        std::sort(sorted.begin(), sorted.end(), [&compare](const value_type* a, const value_type* b) { return compare(a->first, b->first); });
+        return sorted;
+    }
+
+private:
+    storage_type members_;
+    index_type   index_;  // slots hold member positions + 1, 0 for empty slots
+};
+
+template <bool _KeepOrder, typename _Kty, typename _Ty, typename _Compare, typename _Alloc>
+const typename basic_flat_map<_KeepOrder, _Kty, _Ty, _Compare, _Alloc>::size_type basic_flat_map<_KeepOrder, _Kty, _Ty, _Compare, _Alloc>::index_threshold;
+
+// erasing does not keep the order of the remaining members
+template <typename _Kty, typename _Ty, typename... _Args>
+using flat_map = basic_flat_map<false, _Kty, _Ty, _Args...>;
+
+// members stay in insertion order, so that a parsed object is written back in the same order
+template <typename _Kty, typename _Ty, typename... _Args>
+using ordered_flat_map = basic_flat_map<true, _Kty, _Ty, _Args...>;
+
+}  // namespace configor
@@ -29,6 +29,7 @@
 #include <istream>           // std::basic_istream
 #include <streambuf>         // std::basic_streambuf
 #include <type_traits>       // std::char_traits
+#include <utility>           // std::move
 
 namespace configor
 {
@@ -57,8 +58,8 @@ public:
 
 namespace detail
 {
-template <typename _ConfTy>
-void do_parse_config(_ConfTy& config, basic_lexer<_ConfTy>& lexer, token_type last_token, bool read_next = true);
+template <typename _ConfTy, typename _LexerTy>
+void do_parse_config(_ConfTy& config, _LexerTy& lexer, token_type last_token, bool read_next = true);
 
 inline void parse_fail(token_type actual_token, const std::string& msg = "unexpected token")
 {
@@ -71,14 +72,12 @@ inline void parse_fail(token_type actual_token, token_type expected_token, const
 {
     parse_fail(actual_token, msg + ", expect '" + to_string(expected_token) + "', but got");
 }
-}  // namespace detail
 
-template <typename _ConfTy, typename = typename std::enable_if<is_config<_ConfTy>::value>::type>
-void parse_config(_ConfTy& c, std::basic_istream<typename _ConfTy::char_type>& is, basic_lexer<_ConfTy>& lexer, error_handler* eh)
+// the lexer must already have its source
+// _LexerTy is the most derived lexer type, so that a final lexer is called without virtual dispatch
+template <typename _ConfTy, typename _LexerTy>
+void parse_config_with_lexer(_ConfTy& c, _LexerTy& lexer, error_handler* eh)
 {
-    using char_type = typename _ConfTy::char_type;
-
-    lexer.source(is);
     try
     {
         detail::do_parse_config(c, lexer, token_type::uninitialized);
@@ -93,12 +92,20 @@ void parse_config(_ConfTy& c, std::basic_istream<typename _ConfTy::char_type>& i
             throw;
     }
 }
+}  // namespace detail
+
+template <typename _ConfTy, typename = typename std::enable_if<is_config<_ConfTy>::value>::type>
+void parse_config(_ConfTy& c, std::basic_istream<typename _ConfTy::char_type>& is, basic_lexer<_ConfTy>& lexer, error_handler* eh)
+{
+    lexer.source(is);
+    detail::parse_config_with_lexer(c, lexer, eh);
+}
 
 namespace detail
 {
 
-template <typename _ConfTy>
-void do_parse_config(_ConfTy& config, basic_lexer<_ConfTy>& lexer, token_type last_token, bool read_next)
+template <typename _ConfTy, typename _LexerTy>
+void do_parse_config(_ConfTy& config, _LexerTy& lexer, token_type last_token, bool read_next)
 {
     using string_type = typename _ConfTy::string_type;
 
@@ -191,7 +198,7 @@ void do_parse_config(_ConfTy& config, basic_lexer<_ConfTy>& lexer, token_type la
 
             _ConfTy object;
             do_parse_config(object, lexer, token);
-            config.raw_value().data.object->emplace(key, object);
+            config.raw_value().data.object->emplace(std::move(key), std::move(object));
 
             // read ','
             token = lexer.scan();
@@ -0,0 +1,441 @@
+// Copyright (c) 2018-2021 configor - Nomango
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+
+#pragma once
+#include "configor_exception.hpp"
+#include "configor_parser.hpp"
+#include "configor_token.hpp"
+
+#include <cstddef>   // std::ptrdiff_t
+#include <istream>   // std::basic_istream
+#include <iterator>  // std::input_iterator_tag
+#include <memory>    // std::addressof
+#include <vector>    // std::vector
+
+namespace configor
+{
+
+//
+// basic_sax_handler
+//
+
+// receives the values of a document while it is parsed, without building a config
+// every function returns false to stop parsing, the strings may be moved from
+template <typename _ConfTy>
+class basic_sax_handler
+{
+public:
+    using boolean_type = typename _ConfTy::boolean_type;
+    using integer_type = typename _ConfTy::integer_type;
+    using float_type   = typename _ConfTy::float_type;
+    using string_type  = typename _ConfTy::string_type;
+
+    virtual ~basic_sax_handler() {}
+
+    virtual bool null()
+    {
+        return true;
+    }
+
+    virtual bool boolean(boolean_type)
+    {
+        return true;
+    }
+
+    virtual bool number_integer(integer_type)
+    {
+        return true;
+    }
+
+    virtual bool number_float(float_type)
+    {
+        return true;
+    }
+
+    virtual bool string(string_type&)
+    {
+        return true;
+    }
+
+    virtual bool start_object()
+    {
+        return true;
+    }
+
+    virtual bool key(string_type&)
+    {
+        return true;
+    }
+
+    virtual bool end_object()
+    {
+        return true;
+    }
+
+    virtual bool start_array()
+    {
+        return true;
+    }
+
+    virtual bool end_array()
+    {
+        return true;
+    }
+};
+
+namespace detail
+{
+
+// reads one value, starting with token, and passes it to the handler
+// containers are tracked on a stack instead of by recursion, so that deep documents do not overflow the call stack
+template <typename _ConfTy, typename _LexerTy>
+bool do_sax_parse(basic_sax_handler<_ConfTy>& handler, _LexerTy& lexer, token_type token)
+{
+    using boolean_type = typename _ConfTy::boolean_type;
+    using integer_type = typename _ConfTy::integer_type;
+    using float_type   = typename _ConfTy::float_type;
+    using string_type  = typename _ConfTy::string_type;
+
+    // true for objects, false for arrays
+    std::vector<bool> containers;
+    string_type       str;
+
+    // token must be the key of an object member, reads it and the ':' after it
+    const auto read_key = [&]() -> bool
+    {
+        if (token != token_type::value_string)
+            detail::parse_fail(token, token_type::value_string);
+
+        str.clear();
+        lexer.get_string(str);
+        if (!handler.key(str))
+            return false;
+
+        token = lexer.scan();
+        if (token != token_type::name_separator)
+            detail::parse_fail(token, token_type::name_separator);
+        return true;
+    };
+
+    while (true)
+    {
+        switch (token)
+        {
+        case token_type::literal_true:
+        case token_type::literal_false:
+            if (!handler.boolean(boolean_type(token == token_type::literal_true)))
+                return false;
+            break;
+
+        case token_type::literal_null:
+            if (!handler.null())
+                return false;
+            break;
+
+        case token_type::value_string:
+            str.clear();
+            lexer.get_string(str);
+            if (!handler.string(str))
+                return false;
+            break;
+
+        case token_type::value_integer:
+        {
+            integer_type i = 0;
+            lexer.get_integer(i);
+            if (!handler.number_integer(i))
+                return false;
+            break;
+        }
+
+        case token_type::value_float:
+        {
+            float_type f = 0;
+            lexer.get_float(f);
+            if (!handler.number_float(f))
+                return false;
+            break;
+        }
+
+        case token_type::begin_array:
+            if (!handler.start_array())
+                return false;
+
+            token = lexer.scan();
+            if (token == token_type::end_array)
+            {
+                if (!handler.end_array())
+                    return false;
+                break;
+            }
+            containers.push_back(false);
+            // token is the first element
+            continue;
+
+        case token_type::begin_object:
+            if (!handler.start_object())
+                return false;
+
+            // an object may be empty
+            token = lexer.scan();
+            if (token == token_type::end_object)
+            {
+                if (!handler.end_object())
+                    return false;
+                break;
+            }
+            if (!read_key())
+                return false;
+
+            containers.push_back(true);
+            token = lexer.scan();
+            continue;
+
+        default:
+            detail::parse_fail(token);
+            break;
+        }
+
+        // a value is complete, close the containers that end after it
+        while (true)
+        {
+            if (containers.empty())
+                return true;
+
+            const bool is_object = containers.back();
+
+            token = lexer.scan();
+            if (token == token_type::value_separator)
+            {
+                token = lexer.scan();
+                if (is_object)
+                {
+                    if (!read_key())
+                        return false;
+                    token = lexer.scan();
+                }
+                break;
+            }
+
+            if (token != (is_object ? token_type::end_object : token_type::end_array))
+                detail::parse_fail(token, is_object ? token_type::end_object : token_type::end_array);
+
+            if (!(is_object ? handler.end_object() : handler.end_array()))
+                return false;
+            containers.pop_back();
+        }
+    }
+}
+
+// the lexer must already have its source
+template <typename _ConfTy, typename _LexerTy>
+bool sax_parse_with_lexer(basic_sax_handler<_ConfTy>& handler, _LexerTy& lexer, error_handler* eh)
+{
+    try
+    {
+        if (!detail::do_sax_parse(handler, lexer, lexer.scan()))
+            return false;
+
+        if (lexer.scan() != token_type::end_of_input)
+            detail::parse_fail(token_type::end_of_input);
+    }
+    catch (...)
+    {
+        if (eh)
+            eh->handle(std::current_exception());
+        else
+            throw;
+    }
+    return true;
+}
+
+}  // namespace detail
+
+// returns false if the handler stopped parsing
+template <typename _ConfTy, typename = typename std::enable_if<is_config<_ConfTy>::value>::type>
+bool sax_parse_config(basic_sax_handler<_ConfTy>& handler, std::basic_istream<typename _ConfTy::char_type>& is, basic_lexer<_ConfTy>& lexer, error_handler* eh)
+{
+    lexer.source(is);
+    return detail::sax_parse_with_lexer(handler, lexer, eh);
+}
+
+//
+// basic_config_reader
+//
+
+enum class reader_format
+{
+    array,  // the elements of a top-level array
+    lines,  // a sequence of values, e.g. newline-delimited json
+};
+
+// reads the elements of a large document one by one, only the current element is kept in memory
+//
+//     std::ifstream ifs("records.ndjson");
+//     json_reader<> reader(ifs, reader_format::lines);
+//     for (const auto& record : reader)
+//         std::cout << record["id"] << std::endl;
+template <typename _ConfTy, typename _LexerTy = typename _ConfTy::lexer_type>
+class basic_config_reader
+{
+public:
+    using config_type = _ConfTy;
+    using char_type   = typename _ConfTy::char_type;
+    using parse_args  = typename _ConfTy::parse_args;
+
+    class iterator
+    {
+    public:
+        using value_type        = _ConfTy;
+        using difference_type   = std::ptrdiff_t;
+        using iterator_category = std::input_iterator_tag;
+        using pointer           = const value_type*;
+        using reference         = const value_type&;
+
+        explicit iterator(basic_config_reader* reader = nullptr)
+            : reader_(reader)
+        {
+        }
+
+        inline reference operator*() const
+        {
+            return reader_->current_;
+        }
+
+        inline pointer operator->() const
+        {
+            return std::addressof(reader_->current_);
+        }
+
+        inline iterator& operator++()
+        {
+            if (!reader_->next(reader_->current_))
+                reader_ = nullptr;
+            return *this;
+        }
+
+        inline bool operator==(const iterator& other) const
+        {
+            return reader_ == other.reader_;
+        }
+
+        inline bool operator!=(const iterator& other) const
+        {
+            return reader_ != other.reader_;
+        }
+
+    private:
+        basic_config_reader* reader_;
+    };
+
+    basic_config_reader(std::basic_istream<char_type>& is, reader_format format, const parse_args& args = {})
+        : format_(format)
+        , state_(state::start)
+        , args_(args)
+        , lexer_(args_)
+        , current_()
+    {
+        lexer_.source(is);
+    }
+
+    // parses the next element into out, returns false at the end of the input
+    bool next(_ConfTy& out)
+    {
+        token_type token = lexer_.scan();
+        switch (state_)
+        {
+        case state::start:
+            if (format_ == reader_format::array)
+            {
+                if (token != token_type::begin_array)
+                    detail::parse_fail(token, token_type::begin_array);
+
+                token = lexer_.scan();
+                if (token == token_type::end_array)
+                    return finish();
+            }
+            break;
+
+        case state::element:
+            if (format_ == reader_format::array)
+            {
+                if (token == token_type::end_array)
+                    return finish();
+                if (token != token_type::value_separator)
+                    detail::parse_fail(token, token_type::end_array);
+                token = lexer_.scan();
+            }
+            break;
+
+        case state::end:
+            return false;
+        }
+
+        if (format_ == reader_format::lines && token == token_type::end_of_input)
+        {
+            state_ = state::end;
+            return false;
+        }
+
+        detail::do_parse_config(out, lexer_, token, false);
+        state_ = state::element;
+        return true;
+    }
+
+    inline iterator begin()
+    {
+        iterator iter(this);
+        ++iter;
+        return iter;
+    }
+
+    inline iterator end()
+    {
+        return iterator();
+    }
+
+private:
+    // the array must be the whole document
+    bool finish()
+    {
+        state_ = state::end;
+
+        const token_type token = lexer_.scan();
+        if (token != token_type::end_of_input)
+            detail::parse_fail(token, token_type::end_of_input);
+        return false;
+    }
+
+private:
+    enum class state
+    {
+        start,
+        element,
+        end,
+    };
+
+    reader_format format_;
+    state         state_;
+    parse_args    args_;  // the lexer keeps a reference to it
+    _LexerTy      lexer_;
+    _ConfTy       current_;
+};
+
+}  // namespace configor
@@ -22,10 +22,11 @@
 #include "configor_exception.hpp"
 #include "configor_stream.hpp"
 
-#include <cmath>    // std::fabs
-#include <limits>   // std::numeric_limits
-#include <memory>   // std::allocator_traits
-#include <utility>  // std::swap
+#include <cmath>        // std::fabs
+#include <limits>       // std::numeric_limits
+#include <memory>       // std::allocator_traits
+#include <type_traits>  // std::is_empty
+#include <utility>      // std::swap
 
 namespace configor
 {
@@ -74,12 +75,41 @@ inline const char* to_string(config_value_type t) noexcept
 namespace detail
 {
 
+//
+// config_value_allocator
+//
+
+// stateless allocators are constructed whenever they are needed
+template <typename _ConfTy, typename _AllocTy = typename _ConfTy::template allocator_type<char>, bool = std::is_empty<_AllocTy>::value>
+struct config_value_allocator
+{
+    template <typename _Ty>
+    inline typename _ConfTy::template allocator_type<_Ty> get_allocator() const
+    {
+        return typename _ConfTy::template allocator_type<_Ty>();
+    }
+};
+
+// a stateful allocator (e.g. arena_allocator) is kept by the value that owns the memory,
+// so that the memory is always freed by the allocator that allocated it
+template <typename _ConfTy, typename _AllocTy>
+struct config_value_allocator<_ConfTy, _AllocTy, false>
+{
+    template <typename _Ty>
+    inline typename _ConfTy::template allocator_type<_Ty> get_allocator() const
+    {
+        return typename _ConfTy::template allocator_type<_Ty>(allocator_);
+    }
+
+    _AllocTy allocator_;
+};
+
 //
 // config_value
 //
 
 template <typename _ConfTy>
-struct config_value
+struct config_value : config_value_allocator<_ConfTy>
 {
     using string_type  = typename _ConfTy::string_type;
     using char_type    = typename _ConfTy::char_type;
@@ -134,7 +164,49 @@ struct config_value
         }
     }
 
+    // an empty value that allocates with the given allocator
+    explicit config_value(const config_value_allocator<_ConfTy>& allocator)
+        : config_value_allocator<_ConfTy>(allocator)
+        , type(config_value_type::null)
+        , data{}
+    {
+    }
+
     config_value(config_value const& other)
+    {
+        copy_payload(other);
+    }
+
+    // like a copy, the value allocates with the current allocator,
+    // the memory of other is adopted only if it was allocated by the same one
+    config_value(config_value&& other)
+    {
+        if (this->template get_allocator<char>() != other.template get_allocator<char>())
+        {
+            copy_payload(other);
+            return;
+        }
+
+        type              = other.type;
+        data              = other.data;
+        other.type        = config_value_type::null;
+        other.data.object = nullptr;
+    }
+
+    ~config_value()
+    {
+        clear();
+    }
+
+    void swap(config_value& other)
+    {
+        std::swap(static_cast<config_value_allocator<_ConfTy>&>(*this), static_cast<config_value_allocator<_ConfTy>&>(other));
+        std::swap(type, other.type);
+        std::swap(data, other.data);
+    }
+
+    // copies the payload of other with the allocator of this value, the previous payload is not freed
+    void copy_payload(config_value const& other)
     {
         type = other.type;
 
@@ -164,25 +236,6 @@ struct config_value
         }
     }
 
-    config_value(config_value&& other)
-    {
-        type              = other.type;
-        data              = other.data;
-        other.type        = config_value_type::null;
-        other.data.object = nullptr;
-    }
-
-    ~config_value()
-    {
-        clear();
-    }
-
-    void swap(config_value& other)
-    {
-        std::swap(type, other.type);
-        std::swap(data, other.data);
-    }
-
     void clear()
     {
         switch (type)
@@ -207,7 +260,7 @@ struct config_value
         using allocator_type   = typename _ConfTy::template allocator_type<_Ty>;
         using allocator_traits = std::allocator_traits<allocator_type>;
 
-        allocator_type allocator;
+        allocator_type allocator = this->template get_allocator<_Ty>();
 
         _Ty* ptr = allocator_traits::allocate(allocator, 1);
         allocator_traits::construct(allocator, ptr, std::forward<_Args>(args)...);
@@ -220,20 +273,28 @@ struct config_value
         using allocator_type   = typename _ConfTy::template allocator_type<_Ty>;
         using allocator_traits = std::allocator_traits<allocator_type>;
 
-        allocator_type allocator;
+        allocator_type allocator = this->template get_allocator<_Ty>();
         allocator_traits::destroy(allocator, ptr);
         allocator_traits::deallocate(allocator, ptr, 1);
     }
 
     inline config_value& operator=(config_value const& other)
     {
-        config_value{ other }.swap(*this);
+        // the copy is made with the allocator of this value, not with the one of the current arena
+        config_value copy{ static_cast<const config_value_allocator<_ConfTy>&>(*this) };
+        copy.copy_payload(other);
+        copy.swap(*this);
         return (*this);
     }
 
     inline config_value& operator=(config_value&& other)
     {
+        // memory of another allocator can not be adopted, e.g. a temporary assigned into a config_document
+        if (this->template get_allocator<char>() != other.template get_allocator<char>())
+            return (*this = static_cast<config_value const&>(other));
+
         clear();
+        config_value_allocator<_ConfTy>::operator=(other);
         type = other.type;
         data = std::move(other.data);
         // invalidate payload
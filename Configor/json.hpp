@@ -21,7 +21,29 @@
 #pragma once
 #include "configor.hpp"
 
-#include <iomanip>  // std::setprecision, std::right, std::noshowbase
+#include <iomanip>      // std::setprecision, std::right, std::noshowbase
+#include <iterator>     // std::istreambuf_iterator
+#include <type_traits>  // std::make_unsigned
+
+// define CONFIGOR_DISABLE_SIMD to use the scalar json lexer only
+#if !defined(CONFIGOR_DISABLE_SIMD)
+#if defined(__AVX2__)
+#define CONFIGOR_SIMD_AVX2
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CONFIGOR_SIMD_SSE2
+#endif
+#endif
+
+#if defined(CONFIGOR_SIMD_AVX2)
+#include <immintrin.h>  // _mm256_loadu_si256, _mm256_cmpeq_epi8, _mm256_movemask_epi8
+#elif defined(CONFIGOR_SIMD_SSE2)
+#include <emmintrin.h>  // _mm_loadu_si128, _mm_cmpeq_epi8, _mm_movemask_epi8
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>  // _BitScanForward
+#endif
 
 namespace configor
 {
@@ -31,6 +53,9 @@ namespace detail
 template <typename _ConfTy>
 class json_lexer;
 
+template <typename _ConfTy>
+class json_buffer_lexer;
+
 template <typename _ConfTy>
 class json_serializer;
 }  // namespace detail
@@ -49,9 +74,42 @@ struct wjson_template_args : json_template_args
     using char_type = wchar_t;
 };
 
+// json whose values are allocated in the current arena, see config_document
+struct arena_json_template_args : json_template_args
+{
+    template <class _Ty>
+    using allocator_type = arena_allocator<_Ty>;
+};
+
+struct arena_wjson_template_args : arena_json_template_args
+{
+    using char_type = wchar_t;
+};
+
+// json whose objects keep their members in insertion order, see basic_flat_map
+struct ordered_json_template_args : json_template_args
+{
+    template <class _Kty, class _Ty, class... _Args>
+    using object_type = ordered_flat_map<_Kty, _Ty, _Args...>;
+};
+
+struct ordered_wjson_template_args : ordered_json_template_args
+{
+    using char_type = wchar_t;
+};
+
 using json  = basic_config<json_template_args>;
 using wjson = basic_config<wjson_template_args>;
 
+using ordered_json  = basic_config<ordered_json_template_args>;
+using ordered_wjson = basic_config<ordered_wjson_template_args>;
+
+using arena_json  = basic_config<arena_json_template_args>;
+using arena_wjson = basic_config<arena_wjson_template_args>;
+
+using json_document  = config_document<arena_json>;
+using wjson_document = config_document<arena_wjson>;
+
 // type traits
 
 template <typename _JsonTy>
@@ -86,9 +144,9 @@ typename _JsonTy::string_type dump_config(const _JsonTy& j, const typename _Json
     using char_type   = typename _JsonTy::char_type;
     using string_type = typename _JsonTy::string_type;
 
-    string_type                               result;
-    detail::fast_string_ostreambuf<char_type> buf{ result };
-    std::basic_ostream<char_type>             os{ &buf };
+    string_type                                            result;
+    detail::fast_string_ostreambuf<char_type, string_type> buf{ result };
+    std::basic_ostream<char_type>                          os{ &buf };
     dump_config(j, os, args, eh);
     return result;
 }
@@ -123,12 +181,11 @@ std::basic_ostream<typename _JsonTy::char_type>& operator<<(std::basic_ostream<t
 
 // parse functions
 
-template <typename _JsonTy, typename = typename std::enable_if<is_json<_JsonTy>::value>::type>
-void parse_config(_JsonTy& j, std::basic_istream<typename _JsonTy::char_type>& is, const typename _JsonTy::parse_args& args = {}, error_handler* eh = nullptr)
+namespace detail
+{
+template <typename _JsonTy>
+void check_json_document(const _JsonTy& j, const typename _JsonTy::parse_args& args, error_handler* eh)
 {
-    typename _JsonTy::lexer_type lexer{ args };
-    parse_config(j, is, lexer, eh);
-
     if (args.check_document && !j.is_array() && !j.is_object())
     {
         // must be object or array
@@ -146,25 +203,38 @@ void parse_config(_JsonTy& j, std::basic_istream<typename _JsonTy::char_type>& i
         }
     }
 }
+}  // namespace detail
 
 template <typename _JsonTy, typename = typename std::enable_if<is_json<_JsonTy>::value>::type>
-void parse_config(_JsonTy& j, const typename _JsonTy::string_type& str, const typename _JsonTy::parse_args& args = {}, error_handler* eh = nullptr)
+void parse_config(_JsonTy& j, std::basic_istream<typename _JsonTy::char_type>& is, const typename _JsonTy::parse_args& args = {}, error_handler* eh = nullptr)
 {
-    using char_type = typename _JsonTy::char_type;
+    typename _JsonTy::lexer_type lexer{ args };
+    parse_config(j, is, lexer, eh);
+    detail::check_json_document(j, args, eh);
+}
 
-    detail::fast_string_istreambuf<char_type> buf{ str };
-    std::basic_istream<char_type>             is{ &buf };
-    parse_config(j, is, args, eh);
+// parses a buffer in memory (e.g. a mapped file), which does not need to be null-terminated
+template <typename _JsonTy, typename = typename std::enable_if<is_json<_JsonTy>::value>::type>
+void parse_config(_JsonTy& j, const typename _JsonTy::char_type* data, std::size_t size, const typename _JsonTy::parse_args& args = {}, error_handler* eh = nullptr)
+{
+    detail::json_buffer_lexer<_JsonTy> lexer{ args };
+    lexer.source(data, size);
+    detail::parse_config_with_lexer(j, lexer, eh);
+    detail::check_json_document(j, args, eh);
+}
+
+template <typename _JsonTy, typename = typename std::enable_if<is_json<_JsonTy>::value>::type>
+void parse_config(_JsonTy& j, const typename _JsonTy::string_type& str, const typename _JsonTy::parse_args& args = {}, error_handler* eh = nullptr)
+{
+    parse_config(j, str.data(), str.size(), args, eh);
 }
 
 template <typename _JsonTy, typename = typename std::enable_if<is_json<_JsonTy>::value>::type>
 void parse_config(_JsonTy& j, const typename _JsonTy::char_type* str, const typename _JsonTy::parse_args& args = {}, error_handler* eh = nullptr)
 {
-    using char_type = typename _JsonTy::char_type;
+    using char_traits = std::char_traits<typename _JsonTy::char_type>;
 
-    detail::fast_buffer_istreambuf<char_type> buf{ str };
-    std::basic_istream<char_type>             is{ &buf };
-    parse_config(j, is, args, eh);
+    parse_config(j, str, char_traits::length(str), args, eh);
 }
 
 template <typename _JsonTy, typename = typename std::enable_if<is_json<_JsonTy>::value>::type>
@@ -177,6 +247,34 @@ void parse_config(_JsonTy& j, std::FILE* file, const typename _JsonTy::parse_arg
     parse_config(j, is, args, eh);
 }
 
+// parses into a document, the previous content of the document is released
+template <typename _JsonTy, typename = typename std::enable_if<is_json<_JsonTy>::value>::type>
+void parse_config(config_document<_JsonTy>& doc, const typename _JsonTy::char_type* data, std::size_t size, const typename _JsonTy::parse_args& args = {},
+                  error_handler* eh = nullptr)
+{
+    doc.clear();
+
+    arena_scope scope{ doc.arena() };
+    parse_config(doc.root(), data, size, args, eh);
+}
+
+template <typename _JsonTy, typename = typename std::enable_if<is_json<_JsonTy>::value>::type>
+void parse_config(config_document<_JsonTy>& doc, const std::basic_string<typename _JsonTy::char_type>& str, const typename _JsonTy::parse_args& args = {},
+                  error_handler* eh = nullptr)
+{
+    parse_config(doc, str.data(), str.size(), args, eh);
+}
+
+template <typename _JsonTy, typename = typename std::enable_if<is_json<_JsonTy>::value>::type>
+void parse_config(config_document<_JsonTy>& doc, std::basic_istream<typename _JsonTy::char_type>& is, const typename _JsonTy::parse_args& args = {},
+                  error_handler* eh = nullptr)
+{
+    doc.clear();
+
+    arena_scope scope{ doc.arena() };
+    parse_config(doc.root(), is, args, eh);
+}
+
 template <typename _JsonTy, typename = typename std::enable_if<is_json<_JsonTy>::value>::type>
 std::basic_istream<typename _JsonTy::char_type>& operator>>(std::basic_istream<typename _JsonTy::char_type>& is, _JsonTy& j)
 {
@@ -184,6 +282,36 @@ std::basic_istream<typename _JsonTy::char_type>& operator>>(std::basic_istream<t
     return is;
 }
 
+// sax parse functions
+
+template <typename _JsonTy, typename = typename std::enable_if<is_json<_JsonTy>::value>::type>
+bool sax_parse_config(basic_sax_handler<_JsonTy>& handler, std::basic_istream<typename _JsonTy::char_type>& is, const typename _JsonTy::parse_args& args = {},
+                      error_handler* eh = nullptr)
+{
+    typename _JsonTy::lexer_type lexer{ args };
+    return sax_parse_config(handler, is, lexer, eh);
+}
+
+template <typename _JsonTy, typename = typename std::enable_if<is_json<_JsonTy>::value>::type>
+bool sax_parse_config(basic_sax_handler<_JsonTy>& handler, const typename _JsonTy::char_type* data, std::size_t size, const typename _JsonTy::parse_args& args = {},
+                      error_handler* eh = nullptr)
+{
+    detail::json_buffer_lexer<_JsonTy> lexer{ args };
+    lexer.source(data, size);
+    return detail::sax_parse_with_lexer(handler, lexer, eh);
+}
+
+template <typename _JsonTy, typename = typename std::enable_if<is_json<_JsonTy>::value>::type>
+bool sax_parse_config(basic_sax_handler<_JsonTy>& handler, const typename _JsonTy::string_type& str, const typename _JsonTy::parse_args& args = {},
+                      error_handler* eh = nullptr)
+{
+    return sax_parse_config(handler, str.data(), str.size(), args, eh);
+}
+
+// reads the elements of a top-level array or the lines of newline-delimited json from a stream
+template <typename _JsonTy = json, typename = typename std::enable_if<is_json<_JsonTy>::value>::type>
+using json_reader = basic_config_reader<_JsonTy, typename _JsonTy::lexer_type>;
+
 //
 // json_wrap
 //
@@ -203,12 +331,245 @@ inline detail::read_configor_wrapper<_Ty, _ConfTy> json_wrap(const _Ty& v)
 namespace detail
 {
 
+//
+// json lexer input
+//
+
+inline unsigned int count_trailing_zeros(uint32_t mask)
+{
+    CONFIGOR_ASSERT(mask != 0);
+#if defined(_MSC_VER)
+    unsigned long index = 0;
+    _BitScanForward(&index, mask);
+    return static_cast<unsigned int>(index);
+#else
+    return static_cast<unsigned int>(__builtin_ctz(mask));
+#endif
+}
+
+template <typename _CharTy>
+inline bool is_json_space(_CharTy ch)
+{
+    return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r';
+}
+
+template <typename _CharTy>
+inline bool is_json_string_special(_CharTy ch)
+{
+    return ch == '\"' || ch == '\\' || static_cast<typename std::make_unsigned<_CharTy>::type>(ch) < 0x20;
+}
+
+// returns the first character in [first, last) that is not a whitespace
+template <typename _CharTy>
+inline const _CharTy* find_json_non_space(const _CharTy* first, const _CharTy* last)
+{
+    while (first != last && is_json_space(*first))
+        ++first;
+    return first;
+}
+
+inline const char* find_json_non_space(const char* first, const char* last)
+{
+    // most values are separated by a single space or none at all
+    if (first == last || !is_json_space(*first))
+        return first;
+
+#if defined(CONFIGOR_SIMD_AVX2)
+    {
+        const __m256i space = _mm256_set1_epi8(' ');
+        const __m256i tab   = _mm256_set1_epi8('\t');
+        const __m256i lf    = _mm256_set1_epi8('\n');
+        const __m256i cr    = _mm256_set1_epi8('\r');
+        for (; last - first >= 32; first += 32)
+        {
+            const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+            const __m256i match = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, space), _mm256_cmpeq_epi8(chunk, tab)),
+                                                  _mm256_or_si256(_mm256_cmpeq_epi8(chunk, lf), _mm256_cmpeq_epi8(chunk, cr)));
+            const uint32_t mask = ~static_cast<uint32_t>(_mm256_movemask_epi8(match));
+            if (mask)
+                return first + count_trailing_zeros(mask);
+        }
+    }
+#endif
+#if defined(CONFIGOR_SIMD_SSE2)
+    {
+        const __m128i space = _mm_set1_epi8(' ');
+        const __m128i tab   = _mm_set1_epi8('\t');
+        const __m128i lf    = _mm_set1_epi8('\n');
+        const __m128i cr    = _mm_set1_epi8('\r');
+        for (; last - first >= 16; first += 16)
+        {
+            const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+            const __m128i match =
+                _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, space), _mm_cmpeq_epi8(chunk, tab)), _mm_or_si128(_mm_cmpeq_epi8(chunk, lf), _mm_cmpeq_epi8(chunk, cr)));
+            const uint32_t mask = ~static_cast<uint32_t>(_mm_movemask_epi8(match)) & 0xFFFF;
+            if (mask)
+                return first + count_trailing_zeros(mask);
+        }
+    }
+#endif
+    return find_json_non_space<char>(first, last);
+}
+
+// returns the first character in [first, last) that ends a run of plain string characters,
+// i.e. a quotation mark, a reverse solidus or a control character
+template <typename _CharTy>
+inline const _CharTy* find_json_string_special(const _CharTy* first, const _CharTy* last)
+{
+    while (first != last && !is_json_string_special(*first))
+        ++first;
+    return first;
+}
+
+inline const char* find_json_string_special(const char* first, const char* last)
+{
+#if defined(CONFIGOR_SIMD_AVX2)
+    {
+        const __m256i quote     = _mm256_set1_epi8('\"');
+        const __m256i backslash = _mm256_set1_epi8('\\');
+        const __m256i control   = _mm256_set1_epi8(0x1F);
+        const __m256i zero      = _mm256_setzero_si256();
+        for (; last - first >= 32; first += 32)
+        {
+            const __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(first));
+            // unsigned saturated subtraction yields zero for characters below 0x20
+            const __m256i match = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, quote), _mm256_cmpeq_epi8(chunk, backslash)),
+                                                  _mm256_cmpeq_epi8(_mm256_subs_epu8(chunk, control), zero));
+            const uint32_t mask = static_cast<uint32_t>(_mm256_movemask_epi8(match));
+            if (mask)
+                return first + count_trailing_zeros(mask);
+        }
+    }
+#endif
+#if defined(CONFIGOR_SIMD_SSE2)
+    {
+        const __m128i quote     = _mm_set1_epi8('\"');
+        const __m128i backslash = _mm_set1_epi8('\\');
+        const __m128i control   = _mm_set1_epi8(0x1F);
+        const __m128i zero      = _mm_setzero_si128();
+        for (; last - first >= 16; first += 16)
+        {
+            const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+            const __m128i match = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+                                               _mm_cmpeq_epi8(_mm_subs_epu8(chunk, control), zero));
+            const uint32_t mask = static_cast<uint32_t>(_mm_movemask_epi8(match));
+            if (mask)
+                return first + count_trailing_zeros(mask);
+        }
+    }
+#endif
+    return find_json_string_special<char>(first, last);
+}
+
+// reads characters one by one from a stream
+template <typename _CharTy>
+class json_istream_input
+{
+public:
+    using char_type     = _CharTy;
+    using char_traits   = std::char_traits<char_type>;
+    using char_int_type = typename char_traits::int_type;
+
+    json_istream_input()
+        : buf_(nullptr)
+    {
+    }
+
+    void source(std::basic_istream<char_type>& is)
+    {
+        buf_ = is.rdbuf();
+    }
+
+    // reads the streambuf directly, istream::get would construct a sentry for every character
+    inline char_int_type get()
+    {
+        return buf_ ? buf_->sbumpc() : char_traits::eof();
+    }
+
+    // whitespaces are read character by character
+    inline void skip_spaces() {}
+
+    // copies characters up to the first one that needs attention, without a stream for the string
+    template <typename _StrTy>
+    inline void read_plain(_StrTy& out)
+    {
+        if (!buf_)
+            return;
+
+        for (char_int_type ch = buf_->sgetc(); ch != char_traits::eof(); ch = buf_->snextc())
+        {
+            const char_type c = char_traits::to_char_type(ch);
+            if (is_json_string_special(c))
+                break;
+            out.push_back(c);
+        }
+    }
+
+private:
+    std::basic_streambuf<char_type>* buf_;
+};
+
+// reads from a contiguous buffer, skipping whitespaces and copying strings in bulk
+template <typename _CharTy>
+class json_buffer_input
+{
+public:
+    using char_type     = _CharTy;
+    using char_traits   = std::char_traits<char_type>;
+    using char_int_type = typename char_traits::int_type;
+
+    json_buffer_input()
+        : pos_(nullptr)
+        , end_(nullptr)
+    {
+    }
+
+    void source(const char_type* data, size_t size)
+    {
+        pos_ = data;
+        end_ = data + size;
+    }
+
+    inline char_int_type get()
+    {
+        if (pos_ == end_)
+            return char_traits::eof();
+        return char_traits::to_int_type(*pos_++);
+    }
+
+    inline void skip_spaces()
+    {
+        pos_ = find_json_non_space(pos_, end_);
+    }
+
+    template <typename _StrTy>
+    inline void read_plain(_StrTy& out)
+    {
+        const char_type* last = find_json_string_special(pos_, end_);
+        if (last != pos_)
+        {
+            out.append(pos_, static_cast<size_t>(last - pos_));
+            pos_ = last;
+        }
+    }
+
+private:
+    const char_type* pos_;
+    const char_type* end_;
+};
+
 //
 // json lexer
 //
 
-template <typename _ConfTy>
-class json_lexer : public basic_lexer<_ConfTy>
+struct json_lexer_args
+{
+    bool allow_comments = false;  // allow comments
+    bool check_document = false;  // only allow object or array type
+};
+
+template <typename _ConfTy, typename _InputTy>
+class basic_json_lexer : public basic_lexer<_ConfTy>
 {
 public:
     using char_type     = typename _ConfTy::char_type;
@@ -219,33 +580,26 @@ public:
     using float_type    = typename _ConfTy::float_type;
     using encoding_type = typename _ConfTy::encoding_type;
 
-    struct args
-    {
-        bool allow_comments = false;  // allow comments
-        bool check_document = false;  // only allow object or array type
-    };
+    using args = json_lexer_args;
 
-    json_lexer(const args& args)
-        : is_(nullptr)
-        , is_negative_(false)
+    basic_json_lexer(const args& args)
+        : is_negative_(false)
         , number_integer_(0)
         , number_float_(0)
         , args_(args)
+        , number_significand_(0)
+        , number_digits_(0)
+        , number_exponent_(0)
+        , number_buffer_()
         , current_(0)
+        , input_()
     {
-        is_ >> std::noskipws;
-    }
-
-    virtual void source(std::basic_istream<char_type>& is) override
-    {
-        is_.rdbuf(is.rdbuf());
-        // read first char
-        read_next();
     }
 
     virtual void get_integer(integer_type& out) override
     {
-        out = is_negative_ ? -number_integer_ : number_integer_;
+        // the negation is done in unsigned arithmetic, so that the minimum integer does not overflow
+        out = is_negative_ ? static_cast<integer_type>(0 - static_cast<uint64_t>(number_integer_)) : number_integer_;
     }
 
     virtual void get_float(float_type& out) override
@@ -327,14 +681,17 @@ public:
 
     char_int_type read_next()
     {
-        current_ = is_.get();
+        current_ = input_.get();
         return current_;
     }
 
     void skip_spaces()
     {
         while (current_ == ' ' || current_ == '\t' || current_ == '\n' || current_ == '\r')
+        {
+            input_.skip_spaces();
             read_next();
+        }
 
         // skip comments
         if (args_.allow_comments && current_ == '/')
@@ -414,11 +771,20 @@ public:
     {
         CONFIGOR_ASSERT(current_ == '\"');
 
-        detail::fast_string_ostreambuf<char_type> buf{ out };
-        std::basic_ostream<char_type>             oss{ &buf };
+        // strings without escapes are done before a stream is needed
+        input_.read_plain(out);
+        if (read_next() == '\"')
+        {
+            // skip last `\"`
+            read_next();
+            return;
+        }
+
+        detail::fast_string_ostreambuf<char_type, string_type> buf{ out };
+        std::basic_ostream<char_type>                          oss{ &buf };
         while (true)
         {
-            const auto ch = read_next();
+            const auto ch = current_;
             switch (ch)
             {
             case char_traits::eof():
@@ -540,13 +906,20 @@ public:
                 oss << char_traits::to_char_type(ch);
             }
             }
+
+            input_.read_plain(out);
+            read_next();
         }
     }
 
     token_type scan_number()
     {
-        is_negative_    = false;
-        number_integer_ = 0;
+        is_negative_        = false;
+        number_integer_     = 0;
+        number_significand_ = 0;
+        number_digits_      = 0;
+        number_exponent_    = 0;
+        number_buffer_.clear();
 
         if (current_ == '-' || current_ == '+')
         {
@@ -573,7 +946,7 @@ public:
     {
         CONFIGOR_ASSERT(is_digit(current_));
 
-        number_integer_ = static_cast<integer_type>(current_ - '0');
+        push_digit(current_);
         while (true)
         {
             const auto ch = read_next();
@@ -581,17 +954,22 @@ public:
                 return scan_float();
 
             if (is_digit(ch))
-                number_integer_ = number_integer_ * 10 + static_cast<integer_type>(ch - '0');
+                push_digit(ch);
             else
                 break;
         }
+
+        // integers out of the range of integer_type are read as floats
+        const uint64_t max_integer = static_cast<uint64_t>(std::numeric_limits<integer_type>::max()) + (is_negative_ ? 1 : 0);
+        if (!number_buffer_.empty() || number_significand_ > max_integer)
+            return to_float();
+
+        number_integer_ = static_cast<integer_type>(number_significand_);
         return token_type::value_integer;
     }
 
     token_type scan_float()
     {
-        number_float_ = static_cast<float_type>(number_integer_);
-
         if (current_ == 'e' || current_ == 'E')
             return scan_exponent();
 
@@ -600,8 +978,8 @@ public:
         if (!is_digit(read_next()))
             fail("invalid float number, got", current_);
 
-        float_type fraction = static_cast<float_type>(0.1);
-        number_float_ += static_cast<float_type>(static_cast<uint32_t>(current_ - '0')) * fraction;
+        push_digit(current_);
+        number_exponent_--;
 
         while (true)
         {
@@ -611,13 +989,13 @@ public:
 
             if (is_digit(ch))
             {
-                fraction *= static_cast<float_type>(0.1);
-                number_float_ += static_cast<float_type>(static_cast<uint32_t>(current_ - '0')) * fraction;
+                push_digit(ch);
+                number_exponent_--;
             }
             else
                 break;
         }
-        return token_type::value_float;
+        return to_float();
     }
 
     token_type scan_exponent()
@@ -626,33 +1004,48 @@ public:
 
         read_next();
 
-        const bool invalid = (is_digit(current_) && current_ != '0') || (current_ == '-') || (current_ == '+');
-        if (!invalid)
+        const bool valid = is_digit(current_) || (current_ == '-') || (current_ == '+');
+        if (!valid)
             fail("invalid exponent number, got", current_);
 
-        float_type base = 10;
-        if (current_ == '+')
+        const bool negative = (current_ == '-');
+        if (current_ == '+' || current_ == '-')
         {
-            read_next();
+            if (!is_digit(read_next()))
+                fail("invalid exponent number, got", current_);
         }
-        else if (current_ == '-')
+
+        int exponent = 0;
+        do
         {
-            base = static_cast<float_type>(0.1);
-            read_next();
-        }
+            // large enough to be zero or infinity anyway
+            if (exponent < 100000)
+                exponent = exponent * 10 + static_cast<int>(current_ - '0');
+        } while (is_digit(read_next()));
+
+        number_exponent_ += negative ? -exponent : exponent;
+        return to_float();
+    }
 
-        uint32_t exponent = static_cast<uint32_t>(current_ - '0');
-        while (is_digit(read_next()))
+    // adds a digit to the significand, digits after the 19th are kept as text
+    inline void push_digit(char_int_type ch)
+    {
+        if (number_digits_ < 19)
         {
-            exponent = (exponent * 10) + static_cast<uint32_t>(current_ - '0');
+            number_significand_ = number_significand_ * 10 + static_cast<uint64_t>(ch - '0');
+            // leading zeros are not significant
+            if (number_significand_ != 0)
+                number_digits_++;
         }
+        else
+        {
+            number_buffer_.push_back(static_cast<char>(ch));
+        }
+    }
 
-        float_type power = 1;
-        for (; exponent; exponent >>= 1, base *= base)
-            if (exponent & 1)
-                power *= base;
-
-        number_float_ *= power;
+    token_type to_float()
+    {
+        number_float_ = detail::decimal_to_float<float_type>(number_significand_, number_exponent_, number_buffer_);
         return token_type::value_float;
     }
 
@@ -700,15 +1093,76 @@ public:
         fail(ss.str());
     }
 
-private:
+protected:
     bool         is_negative_;
     integer_type number_integer_;
     float_type   number_float_;
 
     const args& args_;
 
-    char_int_type                 current_;
-    std::basic_istream<char_type> is_;
+    uint64_t    number_significand_;  // the first 19 significant digits of the current number
+    int         number_digits_;
+    int         number_exponent_;
+    std::string number_buffer_;  // digits after the 19th, reused to avoid allocations
+
+    char_int_type current_;
+    _InputTy      input_;
+};
+
+template <typename _ConfTy>
+class json_lexer : public basic_json_lexer<_ConfTy, json_istream_input<typename _ConfTy::char_type>>
+{
+public:
+    using base_type = basic_json_lexer<_ConfTy, json_istream_input<typename _ConfTy::char_type>>;
+    using char_type = typename base_type::char_type;
+    using args      = typename base_type::args;
+
+    json_lexer(const args& args)
+        : base_type(args)
+    {
+    }
+
+    virtual void source(std::basic_istream<char_type>& is) override
+    {
+        this->input_.source(is);
+        // read first char
+        this->read_next();
+    }
+};
+
+// lexer for input that is contiguous in memory, used when parsing strings and buffers
+// it is final, so that the parser calls it without virtual dispatch
+template <typename _ConfTy>
+class json_buffer_lexer final : public basic_json_lexer<_ConfTy, json_buffer_input<typename _ConfTy::char_type>>
+{
+public:
+    using base_type = basic_json_lexer<_ConfTy, json_buffer_input<typename _ConfTy::char_type>>;
+    using char_type = typename base_type::char_type;
+    using args      = typename base_type::args;
+
+    json_buffer_lexer(const args& args)
+        : base_type(args)
+        , buffer_()
+    {
+    }
+
+    // the buffer must outlive the parsing
+    void source(const char_type* data, size_t size)
+    {
+        this->input_.source(data, size);
+        // read first char
+        this->read_next();
+    }
+
+    // reads the whole stream into memory first
+    virtual void source(std::basic_istream<char_type>& is) override
+    {
+        buffer_.assign(std::istreambuf_iterator<char_type>(is), std::istreambuf_iterator<char_type>());
+        source(buffer_.data(), buffer_.size());
+    }
+
+private:
+    std::basic_string<char_type> buffer_;
 };
 
 //
@@ -732,7 +1186,7 @@ public:
         unsigned int indent         = 0;
         char_type    indent_char    = ' ';
         bool         escape_unicode = false;
-        int          precision      = std::numeric_limits<float_type>::digits10 + 1;
+        int          precision      = 0;  // significant digits of floats, 0 for the shortest text that reads back to the same value
     };
 
     json_serializer(const args& args)
@@ -893,8 +1347,8 @@ public:
     {
         output('\"');
 
-        fast_string_istreambuf<char_type> buf{ s };
-        std::basic_istream<char_type>     iss{ &buf };
+        fast_string_istreambuf<char_type, string_type> buf{ s };
+        std::basic_istream<char_type>                  iss{ &buf };
 
         uint32_t codepoint = 0;
         while (encoding_type::decode(iss, codepoint))
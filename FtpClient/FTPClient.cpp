@@ -5,11 +5,24 @@
  */
 
 #include "FTPClient.h"
+#include <chrono>
 #include <iterator>
 #include <stdexcept>
 
 namespace embeddedmz {
 
+namespace {
+// Smaller segments are not worth an additional connection
+constexpr curl_off_t SEGMENT_MIN_SIZE = 1024 * 1024;
+// How often a failed segment is restarted where it stopped
+constexpr unsigned SEGMENT_MAX_RETRIES = 3;
+// The progress of a segmented download is saved at most that often
+constexpr std::chrono::seconds SEGMENT_STATE_SAVE_INTERVAL(1);
+// The state file of a segmented download is kept next to the local file
+const char *const SEGMENT_STATE_FILE_SUFFIX = ".segments";
+const char *const SEGMENT_STATE_FILE_MAGIC  = "FTPCLIENT_SEGMENTS_1";
+}  // namespace
+
 // Static members initialization
 
 #ifdef DEBUG_CURL
@@ -474,6 +487,10 @@ const bool CFTPClient::Info(const std::string &strRemoteFile, struct FileInfo &o
    curl_easy_setopt(m_pCurlSession, CURLOPT_HEADERFUNCTION, ThrowAwayCallback);
    curl_easy_setopt(m_pCurlSession, CURLOPT_HEADER, 0L);
 
+   /* libcurl passes the http-style headers it makes up for ftp to the write
+    * function, which would print them to stdout */
+   curl_easy_setopt(m_pCurlSession, CURLOPT_WRITEFUNCTION, ThrowAwayCallback);
+
    CURLcode res = Perform();
 
    if (CURLE_OK == res) {
@@ -636,6 +653,206 @@ const bool CFTPClient::DownloadFile(const std::string &strRemoteFile, std::vecto
       return true;
 }
 
+/**
+ * @brief downloads a remote file through several connections at once
+ *
+ * The file is split into up to uSegments byte ranges. Each range is fetched by
+ * its own connection, starting at the range's offset (REST), and is written at
+ * that offset into the preallocated local file. This fills long-latency links
+ * that a single TCP stream cannot fill.
+ *
+ * The progress of the segments is kept in a state file next to the local file
+ * (strLocalFile + ".segments"). If a download is interrupted, the next call
+ * resumes every segment where it stopped, as long as the remote file's size
+ * and mtime did not change. The state file is removed once the download is
+ * complete.
+ *
+ * Files smaller than two segments and servers that don't report the file size
+ * or don't support REST are downloaded with DownloadFile(). The progress
+ * function callback is not called for the segments.
+ *
+ * @param [in] strLocalFile complete path of the downloaded file.
+ * @param [in] strRemoteFile URL of the remote file.
+ * @param [in] uSegments maximum number of parallel connections.
+ *
+ * @retval true   Successfully downloaded the file.
+ * @retval false  The file couldn't be downloaded. The local file and its state
+ * file are kept, so that a later call can resume the download.
+ *
+ * Example Usage:
+ * @code
+ *    m_pFTPClient->DownloadFileSegmented("C:\\Downloads\\image.iso",
+ * "isos/image.iso", 8);
+ * @endcode
+ */
+const bool CFTPClient::DownloadFileSegmented(const std::string &strLocalFile, const std::string &strRemoteFile,
+                                             const unsigned &uSegments /* = 4 */) const {
+   if (strLocalFile.empty() || strRemoteFile.empty()) return false;
+
+   if (!m_pCurlSession) {
+      if (m_eSettingsFlags & ENABLE_LOG) m_oLog(LOG_ERROR_CURL_NOT_INIT_MSG);
+
+      return false;
+   }
+
+   // The byte ranges can only be computed if the server reports the file size
+   FileInfo oFileInfo;
+   if (!Info(strRemoteFile, oFileInfo) || oFileInfo.dFileSize < 1.0) return DownloadFile(strLocalFile, strRemoteFile);
+
+   const curl_off_t llFileSize    = static_cast<curl_off_t>(oFileInfo.dFileSize);
+   const std::string strStateFile = strLocalFile + SEGMENT_STATE_FILE_SUFFIX;
+   const std::string strFile      = ParseURL(strRemoteFile);
+
+   std::vector<DownloadSegment> vecSegments;
+
+   struct stat file_info;
+   const bool bResume = LoadSegmentState(strStateFile, llFileSize, oFileInfo.tFileMTime, vecSegments) &&
+                        stat(strLocalFile.c_str(), &file_info) == 0 && static_cast<curl_off_t>(file_info.st_size) == llFileSize;
+
+   if (!bResume) {
+      const curl_off_t llSegmentCount = std::min<curl_off_t>(uSegments, llFileSize / SEGMENT_MIN_SIZE);
+      if (llSegmentCount < 2) {
+         remove(strStateFile.c_str());
+         return DownloadFile(strLocalFile, strRemoteFile);
+      }
+
+      vecSegments.clear();
+      for (curl_off_t i = 0; i < llSegmentCount; ++i) {
+         const curl_off_t llBegin = llFileSize / llSegmentCount * i;
+         const curl_off_t llEnd   = (i + 1 == llSegmentCount) ? llFileSize : llFileSize / llSegmentCount * (i + 1);
+         vecSegments.push_back(DownloadSegment{llBegin, llEnd, 0});
+      }
+
+      // Preallocate the local file, so that every segment can be written at its offset
+      std::ofstream ofsOutput(strLocalFile, std::ofstream::out | std::ofstream::binary | std::ofstream::trunc);
+      if (ofsOutput) {
+         ofsOutput.seekp(llFileSize - 1);
+         ofsOutput.put('\0');
+         ofsOutput.close();
+      }
+      if (!ofsOutput || !SaveSegmentState(strStateFile, llFileSize, oFileInfo.tFileMTime, vecSegments)) {
+         if (m_eSettingsFlags & ENABLE_LOG) m_oLog(StringFormat(LOG_ERROR_FILE_GETSEGMENTED_FORMAT, strLocalFile.c_str()));
+
+         return false;
+      }
+   }
+
+   bool bRet         = true;
+   bool bRestRefused = false;
+
+   CURLM *pMultiSession = curl_multi_init();
+   std::vector<std::unique_ptr<SegmentTransfer>> vecTransfers;
+
+   for (auto &oSegment : vecSegments) {
+      if (oSegment.llDone >= oSegment.llEnd - oSegment.llBegin) continue;
+
+      std::unique_ptr<SegmentTransfer> pTransfer(new SegmentTransfer());
+      pTransfer->pSegment  = &oSegment;
+      pTransfer->pCurl     = nullptr;
+      pTransfer->uAttempts = 0;
+      pTransfer->fsOutput.open(strLocalFile, std::fstream::in | std::fstream::out | std::fstream::binary);
+
+      if (!pTransfer->fsOutput || !StartSegmentTransfer(*pTransfer, strFile)) {
+         curl_easy_cleanup(pTransfer->pCurl);
+         if (m_eSettingsFlags & ENABLE_LOG) m_oLog(StringFormat(LOG_ERROR_FILE_GETSEGMENTED_FORMAT, strLocalFile.c_str()));
+
+         bRet = false;
+         break;
+      }
+
+      curl_multi_add_handle(pMultiSession, pTransfer->pCurl);
+      vecTransfers.push_back(std::move(pTransfer));
+   }
+
+   const auto SaveState = [&]() {
+      // The state must never claim more than what is in the local file
+      for (auto &pTransfer : vecTransfers) pTransfer->fsOutput.flush();
+      SaveSegmentState(strStateFile, llFileSize, oFileInfo.tFileMTime, vecSegments);
+   };
+
+   auto tLastSave = std::chrono::steady_clock::now();
+   int iRunning   = bRet ? 1 : 0;
+
+   while (iRunning > 0) {
+      CURLMcode eMultiCode = curl_multi_perform(pMultiSession, &iRunning);
+      if (eMultiCode == CURLM_OK && iRunning > 0) eMultiCode = curl_multi_wait(pMultiSession, nullptr, 0, 1000, nullptr);
+
+      if (eMultiCode != CURLM_OK) {
+         bRet = false;
+         break;
+      }
+
+      CURLMsg *pMsg  = nullptr;
+      int iMsgsInQueue = 0;
+      while ((pMsg = curl_multi_info_read(pMultiSession, &iMsgsInQueue)) != nullptr) {
+         if (pMsg->msg != CURLMSG_DONE) continue;
+
+         auto itTransfer = std::find_if(vecTransfers.begin(), vecTransfers.end(),
+                                        [pMsg](const std::unique_ptr<SegmentTransfer> &pTransfer) { return pTransfer->pCurl == pMsg->easy_handle; });
+         if (itTransfer == vecTransfers.end()) continue;
+
+         SegmentTransfer &oTransfer       = **itTransfer;
+         const DownloadSegment &oSegment = *oTransfer.pSegment;
+         curl_multi_remove_handle(pMultiSession, oTransfer.pCurl);
+
+         // All but the last segment are stopped by the write callback as soon as
+         // they are complete, which libcurl reports as a write error
+         if (oSegment.llDone >= oSegment.llEnd - oSegment.llBegin) continue;
+
+         // The server closed the data connection too early
+         CURLcode res = (pMsg->data.result == CURLE_OK) ? CURLE_PARTIAL_FILE : pMsg->data.result;
+
+         if (m_eSettingsFlags & ENABLE_LOG)
+            m_oLog(StringFormat(LOG_ERROR_CURL_GETSEGMENT_FORMAT, static_cast<long long>(oSegment.llBegin + oSegment.llDone),
+                                static_cast<long long>(oSegment.llEnd - 1), m_strServer.c_str(), strRemoteFile.c_str(), res,
+                                curl_easy_strerror(res)));
+
+         if (res == CURLE_FTP_COULDNT_USE_REST) {
+            bRestRefused = true;
+            bRet         = false;
+         } else if (oTransfer.uAttempts <= SEGMENT_MAX_RETRIES && StartSegmentTransfer(oTransfer, strFile)) {
+            curl_multi_add_handle(pMultiSession, oTransfer.pCurl);
+            iRunning = 1;
+         } else
+            bRet = false;
+      }
+
+      if (bRestRefused) break;
+
+      const auto tNow = std::chrono::steady_clock::now();
+      if (tNow - tLastSave >= SEGMENT_STATE_SAVE_INTERVAL) {
+         SaveState();
+         tLastSave = tNow;
+      }
+   }
+
+   for (auto &pTransfer : vecTransfers) {
+      curl_multi_remove_handle(pMultiSession, pTransfer->pCurl);
+      pTransfer->fsOutput.close();
+      curl_easy_cleanup(pTransfer->pCurl);
+      pTransfer->pCurl = nullptr;
+   }
+   curl_multi_cleanup(pMultiSession);
+
+   for (const auto &oSegment : vecSegments) {
+      if (oSegment.llDone < oSegment.llEnd - oSegment.llBegin) bRet = false;
+   }
+
+   if (bRet) {
+      remove(strStateFile.c_str());
+      return true;
+   }
+
+   // Byte ranges are not possible, so the file has to be downloaded in one go
+   if (bRestRefused) {
+      remove(strStateFile.c_str());
+      return DownloadFile(strLocalFile, strRemoteFile);
+   }
+
+   SaveState();
+   return false;
+}
+
 /**
  * @brief downloads all elements according that match the wildcarded URL
  *
@@ -828,65 +1045,189 @@ const bool CFTPClient::UploadFile(const std::string &strLocalFile, const std::st
 const CURLcode CFTPClient::Perform() const {
    CURLcode res = CURLE_OK;
 
-   curl_easy_setopt(m_pCurlSession, CURLOPT_USERPWD, (m_strUserName + ":" + m_strPassword).c_str());
+   SetCommonOptions(m_pCurlSession);
+
+   if (m_bProgressCallbackSet) {
+      curl_easy_setopt(m_pCurlSession, CURLOPT_PROGRESSFUNCTION, *GetProgressFnCallback());
+      curl_easy_setopt(m_pCurlSession, CURLOPT_PROGRESSDATA, &m_ProgressStruct);
+      curl_easy_setopt(m_pCurlSession, CURLOPT_NOPROGRESS, 0L);
+   }
+
+#ifdef DEBUG_CURL
+   StartCurlDebug();
+#endif
 
-   if (m_bActive) curl_easy_setopt(m_pCurlSession, CURLOPT_FTPPORT, m_uPort);
+   // Perform the requested operation
+   res = curl_easy_perform(m_pCurlSession);
+
+#ifdef DEBUG_CURL
+   EndCurlDebug();
+#endif
+
+   return res;
+}
+
+/**
+ * @brief sets up the settings shared by all requests (Timeout, proxy,...)
+ *
+ * @param [in] pCurl the curl handle of the request.
+ *
+ */
+void CFTPClient::SetCommonOptions(CURL *pCurl) const {
+   curl_easy_setopt(pCurl, CURLOPT_USERPWD, (m_strUserName + ":" + m_strPassword).c_str());
+
+   if (m_bActive) curl_easy_setopt(pCurl, CURLOPT_FTPPORT, m_uPort);
 
    if (m_iCurlTimeout > 0) {
-      curl_easy_setopt(m_pCurlSession, CURLOPT_TIMEOUT, m_iCurlTimeout);
+      curl_easy_setopt(pCurl, CURLOPT_TIMEOUT, m_iCurlTimeout);
       // don't want to get a sig alarm on timeout
-      curl_easy_setopt(m_pCurlSession, CURLOPT_NOSIGNAL, 1);
+      curl_easy_setopt(pCurl, CURLOPT_NOSIGNAL, 1);
    }
 
    if (!m_strProxy.empty()) {
-      curl_easy_setopt(m_pCurlSession, CURLOPT_PROXY, m_strProxy.c_str());
-      curl_easy_setopt(m_pCurlSession, CURLOPT_HTTPPROXYTUNNEL, 1L);
+      curl_easy_setopt(pCurl, CURLOPT_PROXY, m_strProxy.c_str());
+      curl_easy_setopt(pCurl, CURLOPT_HTTPPROXYTUNNEL, 1L);
 
       // use only plain PASV
       if (!m_bActive) {
-         curl_easy_setopt(m_pCurlSession, CURLOPT_FTP_USE_EPSV, 1L);
+         curl_easy_setopt(pCurl, CURLOPT_FTP_USE_EPSV, 1L);
       }
    }
 
    if (m_bNoSignal) {
-      curl_easy_setopt(m_pCurlSession, CURLOPT_NOSIGNAL, 1L);
-   }
-
-   if (m_bProgressCallbackSet) {
-      curl_easy_setopt(m_pCurlSession, CURLOPT_PROGRESSFUNCTION, *GetProgressFnCallback());
-      curl_easy_setopt(m_pCurlSession, CURLOPT_PROGRESSDATA, &m_ProgressStruct);
-      curl_easy_setopt(m_pCurlSession, CURLOPT_NOPROGRESS, 0L);
+      curl_easy_setopt(pCurl, CURLOPT_NOSIGNAL, 1L);
    }
 
    if (m_eFtpProtocol == FTP_PROTOCOL::FTPS || m_eFtpProtocol == FTP_PROTOCOL::FTPES)
       /* We activate SSL and we require it for both control and data */
-      curl_easy_setopt(m_pCurlSession, CURLOPT_USE_SSL, CURLUSESSL_ALL);
+      curl_easy_setopt(pCurl, CURLOPT_USE_SSL, CURLUSESSL_ALL);
 
    if (m_eFtpProtocol == FTP_PROTOCOL::SFTP && m_eSettingsFlags & ENABLE_SSH)
       /* We activate ssh agent. For this to work you need
       to have ssh-agent running (type set | grep SSH_AGENT to check) or
       pageant on Windows (there is an icon in systray if so) */
-      curl_easy_setopt(m_pCurlSession, CURLOPT_SSH_AUTH_TYPES, CURLSSH_AUTH_AGENT);
+      curl_easy_setopt(pCurl, CURLOPT_SSH_AUTH_TYPES, CURLSSH_AUTH_AGENT);
 
    // SSL
-   if (!m_strSSLCertFile.empty()) curl_easy_setopt(m_pCurlSession, CURLOPT_SSLCERT, m_strSSLCertFile.c_str());
+   if (!m_strSSLCertFile.empty()) curl_easy_setopt(pCurl, CURLOPT_SSLCERT, m_strSSLCertFile.c_str());
 
-   if (!m_strSSLKeyFile.empty()) curl_easy_setopt(m_pCurlSession, CURLOPT_SSLKEY, m_strSSLKeyFile.c_str());
+   if (!m_strSSLKeyFile.empty()) curl_easy_setopt(pCurl, CURLOPT_SSLKEY, m_strSSLKeyFile.c_str());
 
-   if (!m_strSSLKeyPwd.empty()) curl_easy_setopt(m_pCurlSession, CURLOPT_KEYPASSWD, m_strSSLKeyPwd.c_str());
+   if (!m_strSSLKeyPwd.empty()) curl_easy_setopt(pCurl, CURLOPT_KEYPASSWD, m_strSSLKeyPwd.c_str());
+}
 
-#ifdef DEBUG_CURL
-   StartCurlDebug();
-#endif
+/**
+ * @brief (re)starts the transfer of a segment where it stopped
+ * used by DownloadFileSegmented()
+ *
+ * @param [in] oTransfer the segment's transfer, its easy handle is created on
+ * the first call.
+ * @param [in] strURL complete URL of the remote file.
+ *
+ * @retval true   The transfer can be added to the multi handle.
+ * @retval false  The easy handle couldn't be created or the local file couldn't
+ * be seeked.
+ */
+const bool CFTPClient::StartSegmentTransfer(SegmentTransfer &oTransfer, const std::string &strURL) const {
+   if (oTransfer.pCurl == nullptr)
+      oTransfer.pCurl = curl_easy_init();
+   else
+      curl_easy_reset(oTransfer.pCurl);
 
-   // Perform the requested operation
-   res = curl_easy_perform(m_pCurlSession);
+   if (oTransfer.pCurl == nullptr) return false;
 
-#ifdef DEBUG_CURL
-   EndCurlDebug();
-#endif
+   const curl_off_t llOffset = oTransfer.pSegment->llBegin + oTransfer.pSegment->llDone;
 
-   return res;
+   oTransfer.fsOutput.clear();
+   oTransfer.fsOutput.seekp(llOffset);
+   if (!oTransfer.fsOutput) return false;
+
+   curl_easy_setopt(oTransfer.pCurl, CURLOPT_URL, strURL.c_str());
+   curl_easy_setopt(oTransfer.pCurl, CURLOPT_WRITEFUNCTION, WriteSegmentCallback);
+   curl_easy_setopt(oTransfer.pCurl, CURLOPT_WRITEDATA, &oTransfer);
+
+   /* the server starts sending at the segment's offset (REST) */
+   curl_easy_setopt(oTransfer.pCurl, CURLOPT_RESUME_FROM_LARGE, llOffset);
+
+   SetCommonOptions(oTransfer.pCurl);
+
+   ++oTransfer.uAttempts;
+
+   return true;
+}
+
+/**
+ * @brief reads the state file of an interrupted segmented download
+ *
+ * @param [in] strStateFile path of the state file.
+ * @param [in] llFileSize current size of the remote file.
+ * @param [in] tFileMTime current mtime of the remote file.
+ * @param [out] vecSegments the segments and their progress.
+ *
+ * @retval true   The download can be resumed.
+ * @retval false  There is no state file, it is damaged or the remote file has
+ * changed since.
+ */
+bool CFTPClient::LoadSegmentState(const std::string &strStateFile, const curl_off_t &llFileSize, const time_t &tFileMTime,
+                                  std::vector<DownloadSegment> &vecSegments) {
+   std::ifstream ifsState(strStateFile);
+   if (!ifsState) return false;
+
+   std::string strMagic;
+   long long llStateFileSize  = 0;
+   long long llStateFileMTime = 0;
+   size_t uSegmentCount       = 0;
+
+   ifsState >> strMagic >> llStateFileSize >> llStateFileMTime >> uSegmentCount;
+   if (!ifsState || strMagic != SEGMENT_STATE_FILE_MAGIC || llStateFileSize != llFileSize ||
+       llStateFileMTime != static_cast<long long>(tFileMTime) || uSegmentCount == 0)
+      return false;
+
+   vecSegments.clear();
+
+   // The segments have to cover the file without gaps
+   curl_off_t llExpectedBegin = 0;
+   for (size_t i = 0; i < uSegmentCount; ++i) {
+      long long llBegin = 0;
+      long long llEnd   = 0;
+      long long llDone  = 0;
+
+      ifsState >> llBegin >> llEnd >> llDone;
+      if (!ifsState || llBegin != llExpectedBegin || llEnd <= llBegin || llDone < 0 || llDone > llEnd - llBegin) return false;
+
+      vecSegments.push_back(DownloadSegment{llBegin, llEnd, llDone});
+      llExpectedBegin = llEnd;
+   }
+
+   return (llExpectedBegin == llFileSize);
+}
+
+/**
+ * @brief writes the state file of a segmented download
+ *
+ * @param [in] strStateFile path of the state file.
+ * @param [in] llFileSize size of the remote file.
+ * @param [in] tFileMTime mtime of the remote file.
+ * @param [in] vecSegments the segments and their progress.
+ *
+ * @retval true   Successfully written the state file.
+ * @retval false  The state file couldn't be written.
+ */
+bool CFTPClient::SaveSegmentState(const std::string &strStateFile, const curl_off_t &llFileSize, const time_t &tFileMTime,
+                                  const std::vector<DownloadSegment> &vecSegments) {
+   std::ofstream ofsState(strStateFile, std::ofstream::out | std::ofstream::trunc);
+   if (!ofsState) return false;
+
+   ofsState << SEGMENT_STATE_FILE_MAGIC << '\n'
+            << static_cast<long long>(llFileSize) << ' ' << static_cast<long long>(tFileMTime) << ' ' << vecSegments.size() << '\n';
+
+   for (const auto &oSegment : vecSegments)
+      ofsState << static_cast<long long>(oSegment.llBegin) << ' ' << static_cast<long long>(oSegment.llEnd) << ' '
+               << static_cast<long long>(oSegment.llDone) << '\n';
+
+   ofsState.close();
+
+   return !ofsState.fail();
 }
 
 // STRING HELPERS
@@ -1011,6 +1352,33 @@ size_t CFTPClient::WriteToMemory(void *buff, size_t size, size_t nmemb, void *da
 
    return ssize;
 }
+/**
+ * @brief writes the server response at the current offset of a segment
+ * used by DownloadFileSegmented()
+ *
+ * @param buff pointer of max size (size*nmemb) to read data from it
+ * @param size size parameter
+ * @param nmemb memblock parameter
+ * @param data pointer to user data (segment transfer)
+ *
+ * @return number of written bytes, less than (size * nmemb) stops the transfer
+ * once the segment is complete
+ */
+size_t CFTPClient::WriteSegmentCallback(void *buff, size_t size, size_t nmemb, void *data) {
+   if ((size == 0) || (nmemb == 0) || ((size * nmemb) < 1) || (data == nullptr)) return 0;
+
+   auto *pTransfer             = reinterpret_cast<SegmentTransfer *>(data);
+   DownloadSegment &oSegment   = *pTransfer->pSegment;
+   const curl_off_t llRemaining = oSegment.llEnd - oSegment.llBegin - oSegment.llDone;
+   const size_t ssize          = static_cast<size_t>(std::min<curl_off_t>(llRemaining, size * nmemb));
+
+   pTransfer->fsOutput.write(reinterpret_cast<char *>(buff), ssize);
+   if (!pTransfer->fsOutput) return 0;
+
+   oSegment.llDone += ssize;
+
+   return ssize;
+}
 /**
  * @brief reads the content of an already opened file stream
  * used by UploadFile()
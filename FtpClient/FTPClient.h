@@ -160,6 +160,11 @@ class CFTPClient {
 
    const bool DownloadFile(const std::string &strRemoteFile, std::vector<char> &data) const;
 
+   /* Downloads a file through several connections at once, each of them fetching
+    * one byte range of it. Interrupted downloads are resumed on the next call. */
+   const bool DownloadFileSegmented(const std::string &strLocalFile, const std::string &strRemoteFile,
+                                    const unsigned &uSegments = 4) const;
+
    const bool DownloadWildcard(const std::string &strLocalDir, const std::string &strRemoteWildcard) const;
 
    const bool UploadFile(const std::string &strLocalFile, const std::string &strRemoteFile, const bool &bCreateDir = false) const;
@@ -179,16 +184,39 @@ class CFTPClient {
 #endif
 
   private:
+   // One byte range of a segmented download, see DownloadFileSegmented()
+   struct DownloadSegment {
+      curl_off_t llBegin;
+      curl_off_t llEnd;   // exclusive
+      curl_off_t llDone;  // bytes already written to the local file
+   };
+
+   struct SegmentTransfer {
+      DownloadSegment *pSegment;
+      std::fstream fsOutput;
+      CURL *pCurl;
+      unsigned uAttempts;  // starts of the transfer, the first one included
+   };
+
    /* common operations are performed here */
    inline const CURLcode Perform() const;
+   void SetCommonOptions(CURL *pCurl) const;
    inline std::string ParseURL(const std::string &strURL) const;
 
+   // Segmented downloads
+   const bool StartSegmentTransfer(SegmentTransfer &oTransfer, const std::string &strURL) const;
+   static bool LoadSegmentState(const std::string &strStateFile, const curl_off_t &llFileSize, const time_t &tFileMTime,
+                                std::vector<DownloadSegment> &vecSegments);
+   static bool SaveSegmentState(const std::string &strStateFile, const curl_off_t &llFileSize, const time_t &tFileMTime,
+                                const std::vector<DownloadSegment> &vecSegments);
+
    // Curl callbacks
    static size_t WriteInStringCallback(void *ptr, size_t size, size_t nmemb, void *data);
    static size_t WriteToFileCallback(void *ptr, size_t size, size_t nmemb, void *data);
    static size_t ReadFromFileCallback(void *ptr, size_t size, size_t nmemb, void *stream);
    static size_t ThrowAwayCallback(void *ptr, size_t size, size_t nmemb, void *data);
    static size_t WriteToMemory(void *ptr, size_t size, size_t nmemb, void *data);
+   static size_t WriteSegmentCallback(void *ptr, size_t size, size_t nmemb, void *data);
 
    // Wildcard transfers callbacks
    static long FileIsComingCallback(struct curl_fileinfo *finfo, WildcardTransfersCallbackData *data, int remains);
@@ -266,6 +294,8 @@ class CFTPClient {
 #define LOG_ERROR_CURL_FILELIST_FORMAT                                       \
    "[FTPClient][Error] Unable to connect to remote folder %s (Error = %d | " \
    "%s)."
+#define LOG_ERROR_CURL_GETSEGMENT_FORMAT \
+   "[FTPClient][Error] Unable to import bytes %lld-%lld of remote File %s/%s (Error = %d | %s)."
 #define LOG_ERROR_CURL_GETWILD_FORMAT "[FTPClient][Error] Unable to import elements %s/%s (Error = %d | %s)."
 #define LOG_ERROR_CURL_GETWILD_REC_FORMAT "[FTPClient][Error] Encountered a problem while importing %s to %s."
 #define LOG_ERROR_CURL_MKDIR_FORMAT "[FTPClient][Error] Unable to create directory %s (Error = %d | %s)."
@@ -277,6 +307,9 @@ class CFTPClient {
 #define LOG_ERROR_FILE_GETFILE_FORMAT                    \
    "[FTPClient][Error] Unable to open local file %s in " \
    "CFTPClient::DownloadFile()."
+#define LOG_ERROR_FILE_GETSEGMENTED_FORMAT               \
+   "[FTPClient][Error] Unable to open local file %s in " \
+   "CFTPClient::DownloadFileSegmented()."
 #define LOG_ERROR_DIR_GETWILD_FORMAT                               \
    "[FTPClient][Error] %s is not a directory or it doesn't exist " \
    "in CFTPClient::DownloadWildcard()."
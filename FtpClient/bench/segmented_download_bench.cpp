@@ -0,0 +1,126 @@
+// Throughput of CFTPClient::DownloadFileSegmented() against
+// CFTPClient::DownloadFile() from a local fineftp-server.
+//
+// The server runs in the same process and serves one file from the page
+// cache over loopback. A single TCP stream on loopback is not limited by
+// latency, so the per-stream bottleneck of a long-latency link is emulated
+// with fineftp's per-session download rate limit: every connection gets at
+// most that rate, like a stream that can't fill the pipe. A rate of 0 runs
+// without a limit and shows the overhead of segmenting.
+//
+//   g++ -std=c++14 -O2 -DNDEBUG -DLINUX -I.. -I../../fineftp-server/include
+//       -I<asio>/include segmented_download_bench.cpp ../FTPClient.cpp
+//       ../CurlHandle.cpp ../../fineftp-server/src/*.cpp -lcurl -lpthread
+//       -o segmented_download_bench
+//   ./segmented_download_bench [file_mib] [mib_per_second_per_connection]
+
+#include "FTPClient.h"
+
+#include <fineftp/server.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <stdlib.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using embeddedmz::CFTPClient;
+
+namespace {
+
+long long FileSize(const std::string &strPath) {
+   struct stat file_info;
+   return stat(strPath.c_str(), &file_info) == 0 ? static_cast<long long>(file_info.st_size) : -1;
+}
+
+bool SameContent(const std::string &strPath1, const std::string &strPath2) {
+   std::ifstream ifs1(strPath1, std::ifstream::binary);
+   std::ifstream ifs2(strPath2, std::ifstream::binary);
+   std::vector<char> vecBuffer1(1024 * 1024), vecBuffer2(1024 * 1024);
+   while (ifs1 && ifs2) {
+      ifs1.read(vecBuffer1.data(), static_cast<std::streamsize>(vecBuffer1.size()));
+      ifs2.read(vecBuffer2.data(), static_cast<std::streamsize>(vecBuffer2.size()));
+      if (ifs1.gcount() != ifs2.gcount() || !std::equal(vecBuffer1.begin(), vecBuffer1.begin() + ifs1.gcount(), vecBuffer2.begin()))
+         return false;
+   }
+   return !ifs1 && !ifs2;
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+   const unsigned long ulFileMiB = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 64;
+   const double dRateMiB         = argc > 2 ? std::atof(argv[2]) : 16.0;
+
+   char szDir[] = "/tmp/ftpclient_bench_XXXXXX";
+   if (mkdtemp(szDir) == nullptr) {
+      std::perror("mkdtemp");
+      return 1;
+   }
+   const std::string strDir        = szDir;
+   const std::string strRemoteFile = strDir + "/remote.bin";
+   const std::string strLocalFile  = strDir + "/local.bin";
+   const long long llFileSize      = static_cast<long long>(ulFileMiB) * 1024 * 1024;
+   {
+      // Every MiB differs, so that a segment written at a wrong offset is noticed
+      std::ofstream ofsFile(strRemoteFile, std::ofstream::binary);
+      std::string strChunk(1024 * 1024, '\0');
+      for (unsigned long i = 0; i < ulFileMiB; ++i) {
+         for (size_t j = 0; j < strChunk.size(); ++j) strChunk[j] = static_cast<char>((i * 131 + j * 7) & 0xFF);
+         ofsFile.write(strChunk.data(), static_cast<std::streamsize>(strChunk.size()));
+      }
+   }
+
+   fineftp::FtpServer oServer("127.0.0.1", 0);
+   oServer.addUserAnonymous(strDir, fineftp::Permission::All);
+   fineftp::RateLimit oRateLimit;
+   oRateLimit.download_bytes_per_second = static_cast<uint64_t>(dRateMiB * 1024 * 1024);
+   oServer.setSessionRateLimit(oRateLimit);
+   oServer.start(2);
+
+   curl_global_init(CURL_GLOBAL_ALL);
+
+   CFTPClient oClient([](const std::string &strMsg) { std::fprintf(stderr, "%s\n", strMsg.c_str()); });
+   oClient.InitSession("127.0.0.1:" + std::to_string(oServer.getPort()), 0, "anonymous", "bench");
+
+   std::printf("%lu MiB file, ", ulFileMiB);
+   if (dRateMiB > 0)
+      std::printf("at most %.1f MiB/s per connection\n", dRateMiB);
+   else
+      std::printf("no rate limit\n");
+   std::printf("%-12s %10s %10s\n", "connections", "seconds", "MiB/s");
+
+   bool bOk = true;
+   for (unsigned uSegments : {1u, 2u, 4u, 8u}) {
+      remove(strLocalFile.c_str());
+
+      const auto tStart = std::chrono::steady_clock::now();
+      const bool bRes   = (uSegments == 1) ? oClient.DownloadFile(strLocalFile, "remote.bin")
+                                           : oClient.DownloadFileSegmented(strLocalFile, "remote.bin", uSegments);
+      const double dSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - tStart).count();
+
+      if (!bRes || FileSize(strLocalFile) != llFileSize || FileSize(strLocalFile + ".segments") != -1 ||
+          !SameContent(strLocalFile, strRemoteFile)) {
+         std::fprintf(stderr, "download with %u connections failed\n", uSegments);
+         bOk = false;
+         continue;
+      }
+      std::printf("%-12u %10.2f %10.1f\n", uSegments, dSeconds, static_cast<double>(ulFileMiB) / dSeconds);
+   }
+
+   oClient.CleanupSession();
+   curl_global_cleanup();
+   oServer.stop();
+
+   remove(strLocalFile.c_str());
+   remove(strRemoteFile.c_str());
+   rmdir(szDir);
+
+   return bOk ? 0 : 1;
+}
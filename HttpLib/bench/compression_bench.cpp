@@ -0,0 +1,144 @@
+// Latency and CPU cost of gzip-compressed JSON responses from httplib::Server.
+//
+// Client threads send keep-alive GET requests with `Accept-Encoding: gzip` to
+// a server in the same process and record the latency of every request. CPU
+// time is that of the whole process, so it includes the client side, which is
+// the same in both builds. Building with CPPHTTPLIB_COMPRESSION_POOL_SIZE=0
+// turns off the reuse of zlib streams and gives the per-response
+// deflateInit2 of the old compressor.
+//
+//   g++ -std=c++11 -O2 -DNDEBUG -DCPPHTTPLIB_ZLIB_SUPPORT -I..
+//       compression_bench.cpp -pthread -lz -o compression_bench
+//   g++ -std=c++11 -O2 -DNDEBUG -DCPPHTTPLIB_ZLIB_SUPPORT -I..
+//       -DCPPHTTPLIB_COMPRESSION_POOL_SIZE=0
+//       compression_bench.cpp -pthread -lz -o compression_bench_nopool
+//   ./compression_bench [body_bytes] [clients] [requests_per_client]
+//                       [compression_min_length]
+
+#include <httplib.h>
+
+#include <sys/resource.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+std::string make_json(size_t size) {
+  std::string body = "[";
+  for (auto i = 0; body.size() < size; i++) {
+    if (i) { body += ","; }
+    body += "{\"id\":" + std::to_string(i) +
+            ",\"name\":\"item-" + std::to_string(i * 7919 % 1000) +
+            "\",\"active\":" + (i % 3 ? "true" : "false") + "}";
+  }
+  body += "]";
+  return body;
+}
+
+double cpu_seconds() {
+  rusage ru;
+  getrusage(RUSAGE_SELF, &ru);
+  return static_cast<double>(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) +
+         static_cast<double>(ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  auto body_size = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2048;
+  auto clients = argc > 2 ? std::atoi(argv[2]) : 4;
+  auto requests = argc > 3 ? std::atoi(argv[3]) : 5000;
+  auto min_length = argc > 4 ? std::strtoul(argv[4], nullptr, 10) : 0;
+
+  auto body = make_json(body_size);
+
+  httplib::Server svr;
+  svr.set_tcp_nodelay(true);
+  svr.set_compression_min_length(min_length);
+  svr.Get("/items", [&](const httplib::Request &, httplib::Response &res) {
+    res.set_content(body, "application/json");
+  });
+
+  auto port = svr.bind_to_any_port("127.0.0.1");
+  std::thread server([&] { svr.listen_after_bind(); });
+  while (!svr.is_running()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  std::vector<std::vector<double>> latencies(static_cast<size_t>(clients));
+  std::atomic<size_t> compressed(0);
+  std::atomic<size_t> failed(0);
+
+  auto cpu_start = cpu_seconds();
+  auto start = std::chrono::steady_clock::now();
+
+  std::vector<std::thread> threads;
+  for (auto c = 0; c < clients; c++) {
+    threads.emplace_back([&, c] {
+      httplib::Client cli("127.0.0.1", port);
+      cli.set_keep_alive(true);
+      cli.set_tcp_nodelay(true);
+      cli.set_decompress(false);
+      httplib::Headers headers = {{"Accept-Encoding", "gzip"}};
+
+      auto &lat = latencies[static_cast<size_t>(c)];
+      lat.reserve(static_cast<size_t>(requests));
+      for (auto i = 0; i < requests; i++) {
+        auto t0 = std::chrono::steady_clock::now();
+        auto res = cli.Get("/items", headers);
+        auto t1 = std::chrono::steady_clock::now();
+        if (!res || res->status != 200) {
+          failed++;
+          continue;
+        }
+        if (res->get_header_value("Content-Encoding") == "gzip") {
+          compressed++;
+        }
+        lat.push_back(std::chrono::duration<double, std::micro>(t1 - t0).count());
+      }
+    });
+  }
+  for (auto &t : threads) { t.join(); }
+
+  auto wall = std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                            start)
+                  .count();
+  auto cpu = cpu_seconds() - cpu_start;
+
+  svr.stop();
+  server.join();
+
+  std::vector<double> all;
+  for (const auto &lat : latencies) {
+    all.insert(all.end(), lat.begin(), lat.end());
+  }
+  if (all.empty()) {
+    std::fprintf(stderr, "no request succeeded\n");
+    return 1;
+  }
+  std::sort(all.begin(), all.end());
+  auto percentile = [&](double p) {
+    return all[static_cast<size_t>(p * static_cast<double>(all.size() - 1))];
+  };
+
+  auto mb = static_cast<double>(body.size()) *
+            static_cast<double>(all.size()) / (1024.0 * 1024.0);
+  std::printf("body %zu B, pool size %d, %d clients x %d requests\n",
+              body.size(), static_cast<int>(CPPHTTPLIB_COMPRESSION_POOL_SIZE),
+              clients, requests);
+  std::printf("  %.0f req/s, compressed %zu, failed %zu\n",
+              static_cast<double>(all.size()) / wall, compressed.load(),
+              failed.load());
+  std::printf("  latency us: p50 %.1f  p90 %.1f  p99 %.1f  max %.1f\n",
+              percentile(0.50), percentile(0.90), percentile(0.99),
+              all.back());
+  std::printf("  cpu %.3f s, %.1f ms per MB of body\n", cpu, cpu * 1000 / mb);
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,119 @@
+// Behavior of httplib::Server when more requests arrive than it can serve.
+//
+// The server runs a BoundedThreadPool with few workers and a short queue, and
+// its handler sleeps to stand in for real work. Client threads send POST
+// requests with a body the server never reads when it rejects them, so a
+// rejected client either gets the 503 or, if the server closes the connection
+// with the body still unread, a reset connection. Latencies are reported per
+// outcome; a 503 should come back right away and nothing should fail.
+//
+//   g++ -std=c++11 -O2 -DNDEBUG -I.. overload_bench.cpp -pthread
+//       -o overload_bench
+//   ./overload_bench [clients] [requests_per_client] [workers] [max_queued]
+//                    [handler_ms] [body_bytes] [reactor]
+
+#include <httplib.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct Outcome {
+  const char *name;
+  std::vector<double> latencies;
+};
+
+void print(Outcome &o) {
+  auto &lat = o.latencies;
+  if (lat.empty()) {
+    std::printf("  %-6s %6d\n", o.name, 0);
+    return;
+  }
+  std::sort(lat.begin(), lat.end());
+  auto percentile = [&](double p) {
+    return lat[static_cast<size_t>(p * static_cast<double>(lat.size() - 1))];
+  };
+  std::printf("  %-6s %6zu   p50 %8.2f ms  p99 %8.2f ms  max %8.2f ms\n",
+              o.name, lat.size(), percentile(0.50), percentile(0.99),
+              lat.back());
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  auto clients = argc > 1 ? std::atoi(argv[1]) : 32;
+  auto requests = argc > 2 ? std::atoi(argv[2]) : 50;
+  auto workers = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 2;
+  auto max_queued = argc > 4 ? std::strtoul(argv[4], nullptr, 10) : 4;
+  auto handler_ms = argc > 5 ? std::atoi(argv[5]) : 5;
+  auto body_size = argc > 6 ? std::strtoul(argv[6], nullptr, 10) : 16384;
+  auto reactor = argc > 7 && std::atoi(argv[7]) != 0;
+
+  httplib::Server svr;
+  svr.set_reactor_mode(reactor);
+  svr.new_task_queue = [&] {
+    return new httplib::BoundedThreadPool(workers, max_queued);
+  };
+  svr.Post("/work", [&](const httplib::Request &, httplib::Response &res) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(handler_ms));
+    res.set_content("done", "text/plain");
+  });
+
+  auto port = svr.bind_to_any_port("127.0.0.1");
+  std::thread server([&] { svr.listen_after_bind(); });
+  while (!svr.is_running()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  std::string body(body_size, 'x');
+  Outcome ok{"200", {}}, rejected{"503", {}}, failed{"failed", {}};
+  std::mutex mutex;
+
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (auto c = 0; c < clients; c++) {
+    threads.emplace_back([&] {
+      for (auto i = 0; i < requests; i++) {
+        // A new connection every time, as a rejected one is closed.
+        httplib::Client cli("127.0.0.1", port);
+        auto t0 = std::chrono::steady_clock::now();
+        auto res = cli.Post("/work", body, "application/octet-stream");
+        auto t1 = std::chrono::steady_clock::now();
+        auto ms = std::chrono::duration<double, std::milli>(t1 - t0).count();
+
+        std::lock_guard<std::mutex> guard(mutex);
+        if (res && res->status == 200) {
+          ok.latencies.push_back(ms);
+        } else if (res && res->status == 503) {
+          rejected.latencies.push_back(ms);
+        } else {
+          failed.latencies.push_back(ms);
+        }
+      }
+    });
+  }
+  for (auto &t : threads) { t.join(); }
+  auto wall = std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                            start)
+                  .count();
+
+  svr.stop();
+  server.join();
+
+  std::printf("%s, %d clients x %d requests, %zu workers, queue %zu, "
+              "handler %d ms, body %zu B\n",
+              reactor ? "reactor" : "thread per connection", clients,
+              requests, workers, max_queued, handler_ms, body.size());
+  std::printf("  %.0f req/s\n", clients * requests / wall);
+  print(ok);
+  print(rejected);
+  print(failed);
+  return failed.latencies.empty() ? 0 : 1;
+}
@@ -0,0 +1,119 @@
+// Dispatch cost of httplib::Server routes against the number of routes.
+//
+// Compares the compiled detail::RouteTable with the linear std::regex scan the
+// server used before. The route set mixes literal paths, literal prefixes,
+// `/:name` segments (registered as with Server::set_path_params(true)) and
+// capture groups, and every path that is looked up matches one of them.
+//
+//   g++ -std=c++11 -O2 -DNDEBUG -I.. route_dispatch_bench.cpp -pthread
+//       -o route_bench
+//   ./route_bench [lookups]
+
+#include <httplib.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+using Handler = httplib::Server::Handler;
+
+namespace {
+
+struct Route {
+  std::string pattern;
+  std::string regex; // what the pattern had to be for the regex router
+  std::string path;  // a path that the pattern matches
+};
+
+std::vector<Route> make_routes(size_t count) {
+  std::vector<Route> routes;
+  for (size_t i = 0; i < count; i++) {
+    auto base = "/api/v1/resource" + std::to_string(i);
+    switch (i % 10) {
+    case 7:
+      routes.push_back({base + "/:id/items/:item",
+                        base + "/([^/]+)/items/([^/]+)", base + "/42/items/7"});
+      break;
+    case 8:
+      routes.push_back(
+          {base + "/static/.*", base + "/static/.*", base + "/static/app.js"});
+      break;
+    case 9:
+      routes.push_back({base + R"(/(\d+)/history)", base + R"(/(\d+)/history)",
+                        base + "/1234/history"});
+      break;
+    default: routes.push_back({base, base, base}); break;
+    }
+  }
+  return routes;
+}
+
+template <typename F> double ns_per_lookup(size_t lookups, F lookup) {
+  auto start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < lookups; i++) { lookup(i); }
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  return std::chrono::duration<double, std::nano>(elapsed).count() /
+         static_cast<double>(lookups);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  size_t lookups = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+
+  std::printf("%8s %14s %14s %9s\n", "routes", "regex ns/op", "table ns/op",
+              "speedup");
+
+  for (size_t count : {10, 50, 150, 500}) {
+    auto routes = make_routes(count);
+
+    std::vector<std::pair<std::regex, Handler>> regex_routes;
+    httplib::detail::RouteTable<Handler> table;
+    size_t hits = 0;
+    for (const auto &r : routes) {
+      Handler handler = [&hits](const httplib::Request &, httplib::Response &) {
+        hits++;
+      };
+      regex_routes.emplace_back(std::regex(r.regex), handler);
+      table.add(r.pattern.data(), r.pattern.size(), handler, true);
+    }
+
+    // The same random sequence of paths for both matchers.
+    std::mt19937 rng(1);
+    std::vector<httplib::Request> requests(1024);
+    for (auto &req : requests) {
+      req.path = routes[rng() % routes.size()].path;
+    }
+
+    httplib::Response res;
+    auto regex_ns = ns_per_lookup(lookups, [&](size_t i) {
+      auto &req = requests[i % requests.size()];
+      for (const auto &x : regex_routes) {
+        if (std::regex_match(req.path, req.matches, x.first)) {
+          x.second(req, res);
+          break;
+        }
+      }
+    });
+
+    auto table_ns = ns_per_lookup(lookups, [&](size_t i) {
+      auto &req = requests[i % requests.size()];
+      auto handler = table.find(req);
+      if (handler) { (*handler)(req, res); }
+    });
+
+    if (hits != 2 * lookups) {
+      std::fprintf(stderr, "%zu routes: %zu of %zu lookups missed\n", count,
+                   2 * lookups - hits, 2 * lookups);
+      return 1;
+    }
+
+    std::printf("%8zu %14.0f %14.0f %8.1fx\n", count, regex_ns, table_ns,
+                regex_ns / table_ns);
+  }
+  return 0;
+}
@@ -68,6 +68,26 @@
 #define CPPHTTPLIB_PAYLOAD_MAX_LENGTH ((std::numeric_limits<size_t>::max)())
 #endif
 
+#ifndef CPPHTTPLIB_HEADER_MAX_LENGTH
+#define CPPHTTPLIB_HEADER_MAX_LENGTH 8192
+#endif
+
+#ifndef CPPHTTPLIB_HEADER_RESERVE_COUNT
+#define CPPHTTPLIB_HEADER_RESERVE_COUNT 16
+#endif
+
+#ifndef CPPHTTPLIB_LISTEN_BACKLOG
+#define CPPHTTPLIB_LISTEN_BACKLOG 5
+#endif
+
+#ifndef CPPHTTPLIB_LINGERING_CLOSE_MSECOND
+#define CPPHTTPLIB_LINGERING_CLOSE_MSECOND 1000
+#endif
+
+#ifndef CPPHTTPLIB_LINGERING_CLOSE_MAX_COUNT
+#define CPPHTTPLIB_LINGERING_CLOSE_MAX_COUNT 256
+#endif
+
 #ifndef CPPHTTPLIB_TCP_NODELAY
 #define CPPHTTPLIB_TCP_NODELAY false
 #endif
@@ -76,10 +96,26 @@
 #define CPPHTTPLIB_RECV_BUFSIZ size_t(4096u)
 #endif
 
+#ifndef CPPHTTPLIB_SEND_FILE_BUFSIZ
+#define CPPHTTPLIB_SEND_FILE_BUFSIZ size_t(1024u * 1024u)
+#endif
+
+#ifndef CPPHTTPLIB_CLIENT_PIPELINE_DEPTH
+#define CPPHTTPLIB_CLIENT_PIPELINE_DEPTH 16
+#endif
+
 #ifndef CPPHTTPLIB_COMPRESSION_BUFSIZ
 #define CPPHTTPLIB_COMPRESSION_BUFSIZ size_t(16384u)
 #endif
 
+#ifndef CPPHTTPLIB_COMPRESSION_MIN_LENGTH
+#define CPPHTTPLIB_COMPRESSION_MIN_LENGTH size_t(0u)
+#endif
+
+#ifndef CPPHTTPLIB_COMPRESSION_POOL_SIZE
+#define CPPHTTPLIB_COMPRESSION_POOL_SIZE 4
+#endif
+
 #ifndef CPPHTTPLIB_THREAD_POOL_COUNT
 #define CPPHTTPLIB_THREAD_POOL_COUNT                                           \
   ((std::max)(8u, std::thread::hardware_concurrency() > 0                      \
@@ -173,6 +209,10 @@ using socket_t = SOCKET;
 #endif
 #include <csignal>
 #include <pthread.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/sendfile.h>
+#endif
 #include <sys/select.h>
 #include <sys/socket.h>
 #include <unistd.h>
@@ -205,6 +245,7 @@ using socket_t = int;
 #include <string>
 #include <sys/stat.h>
 #include <thread>
+#include <unordered_map>
 
 #ifdef CPPHTTPLIB_OPENSSL_SUPPORT
 #include <openssl/err.h>
@@ -278,9 +319,128 @@ struct ci {
   }
 };
 
+// Header names are ASCII, so the C locale must not affect their comparison.
+inline unsigned char ascii_lower(unsigned char c) {
+  return ('A' <= c && c <= 'Z') ? static_cast<unsigned char>(c + 32) : c;
+}
+
+inline uint32_t ci_hash(const char *s, size_t n) {
+  // FNV-1a over the ASCII-lowercased bytes.
+  uint32_t h = 2166136261u;
+  for (size_t i = 0; i < n; i++) {
+    h = (h ^ ascii_lower(static_cast<unsigned char>(s[i]))) * 16777619u;
+  }
+  return h;
+}
+
+inline bool ci_equal(const char *a, size_t an, const char *b, size_t bn) {
+  if (an != bn) { return false; }
+  for (size_t i = 0; i < an; i++) {
+    if (ascii_lower(static_cast<unsigned char>(a[i])) !=
+        ascii_lower(static_cast<unsigned char>(b[i]))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+class static_file;
+
+#ifdef __linux__
+class EpollReactor;
+struct ReactorConnection;
+#endif
+
 } // namespace detail
 
-using Headers = std::multimap<std::string, std::string, detail::ci>;
+// NOTE: Header fields live in a flat vector in the order they were added,
+// with fields of the same name kept adjacent so that equal_range() works as
+// it did with std::multimap. Each field carries a precomputed hash of its
+// lowercased name, and lookups by `const char *` don't build a temporary key.
+// Keys must not be modified through iterators.
+class Headers {
+public:
+  using key_type = std::string;
+  using mapped_type = std::string;
+  using value_type = std::pair<std::string, std::string>;
+  using size_type = size_t;
+  using iterator = std::vector<value_type>::iterator;
+  using const_iterator = std::vector<value_type>::const_iterator;
+
+  Headers() = default;
+
+  Headers(std::initializer_list<value_type> fields) {
+    insert(fields.begin(), fields.end());
+  }
+
+  template <typename InputIt> Headers(InputIt first, InputIt last) {
+    insert(first, last);
+  }
+
+  iterator begin() { return fields_.begin(); }
+  iterator end() { return fields_.end(); }
+  const_iterator begin() const { return fields_.begin(); }
+  const_iterator end() const { return fields_.end(); }
+  const_iterator cbegin() const { return fields_.cbegin(); }
+  const_iterator cend() const { return fields_.cend(); }
+
+  bool empty() const { return fields_.empty(); }
+  size_type size() const { return fields_.size(); }
+
+  void clear() {
+    fields_.clear();
+    hashes_.clear();
+  }
+
+  void reserve(size_type n) {
+    fields_.reserve(n);
+    hashes_.reserve(n);
+  }
+
+  template <typename K, typename V> iterator emplace(K &&key, V &&val) {
+    return insert(value_type(std::forward<K>(key), std::forward<V>(val)));
+  }
+
+  iterator insert(const value_type &field) { return insert(value_type(field)); }
+  iterator insert(value_type &&field);
+
+  template <typename InputIt> void insert(InputIt first, InputIt last) {
+    for (; first != last; ++first) {
+      insert(value_type(first->first, first->second));
+    }
+  }
+
+  iterator find(const char *key);
+  iterator find(const std::string &key);
+  const_iterator find(const char *key) const;
+  const_iterator find(const std::string &key) const;
+
+  size_type count(const char *key) const;
+  size_type count(const std::string &key) const;
+
+  std::pair<iterator, iterator> equal_range(const char *key);
+  std::pair<iterator, iterator> equal_range(const std::string &key);
+  std::pair<const_iterator, const_iterator>
+  equal_range(const char *key) const;
+  std::pair<const_iterator, const_iterator>
+  equal_range(const std::string &key) const;
+
+  iterator erase(const_iterator pos);
+  iterator erase(const_iterator first, const_iterator last);
+  size_type erase(const char *key);
+  size_type erase(const std::string &key);
+
+private:
+  static const size_type npos = static_cast<size_type>(-1);
+
+  size_type find_first(const char *key, size_type len) const;
+  size_type range_end(size_type first) const;
+  std::pair<size_type, size_type> index_range(const char *key,
+                                              size_type len) const;
+
+  std::vector<value_type> fields_;
+  std::vector<uint32_t> hashes_;
+};
 
 using Params = std::multimap<std::string, std::string>;
 using Match = std::smatch;
@@ -391,6 +551,8 @@ struct Request {
   MultipartFormDataMap files;
   Ranges ranges;
   Match matches;
+  // `/:name` segments of the route, see Server::set_path_params.
+  std::unordered_map<std::string, std::string> path_params;
 
   // for client
   ResponseHandler response_handler;
@@ -475,6 +637,7 @@ struct Response {
   ContentProviderResourceReleaser content_provider_resource_releaser_;
   bool is_chunked_content_provider_ = false;
   bool content_provider_success_ = false;
+  std::shared_ptr<detail::static_file> content_file_;
 };
 
 class Stream {
@@ -489,6 +652,17 @@ public:
   virtual void get_remote_ip_and_port(std::string &ip, int &port) const = 0;
   virtual socket_t socket() const = 0;
 
+  // Sends `size` bytes of the file `fd` starting at `offset` without copying
+  // them through user space. Streams that can't do that return -1 and the
+  // caller falls back to `write`.
+  virtual ssize_t send_file(int fd, size_t offset, size_t size);
+
+  // Returns the bytes that have already been received but not read yet, so
+  // that parsers can scan them in place. `consume` drops `size` of them.
+  // Streams that don't buffer input return nullptr with `size` set to 0.
+  virtual const char *peek(size_t &size) const;
+  virtual void consume(size_t size);
+
   template <typename... Args>
   ssize_t write_format(const char *fmt, const Args &...args);
   ssize_t write(const char *ptr);
@@ -503,6 +677,14 @@ public:
   virtual void enqueue(std::function<void()> fn) = 0;
   virtual void shutdown() = 0;
 
+  // Like enqueue(), but an overloaded queue may call `reject` instead of
+  // queueing `fn` (or call the `reject` of a task it drops to make room).
+  // The server uses this to answer such connections with 503.
+  virtual void enqueue_or_reject(std::function<void()> fn,
+                                 std::function<void()> /*reject*/) {
+    enqueue(std::move(fn));
+  }
+
   virtual void on_idle(){};
 };
 
@@ -576,6 +758,187 @@ private:
   std::mutex mutex_;
 };
 
+enum class OverloadPolicy {
+  Reject,     // answer the new connection with 503
+  Block,      // stop accepting until a queue slot frees up
+  ShedOldest, // answer the oldest queued connection with 503 instead
+};
+
+struct TaskQueueStats {
+  // Bucket i counts tasks that waited less than 100us * 10^i before a worker
+  // picked them up; the last bucket counts everything slower than 10s.
+  static const size_t wait_buckets = 7;
+
+  size_t workers = 0;
+  size_t active_workers = 0;
+  size_t queue_depth = 0;
+  size_t max_queue_depth = 0;
+  uint64_t enqueued = 0;
+  uint64_t rejected = 0;
+  uint64_t shed = 0;
+  uint64_t blocked = 0;
+  std::array<uint64_t, wait_buckets> wait_usec_histogram{};
+};
+
+class BoundedThreadPool : public TaskQueue {
+public:
+  BoundedThreadPool(size_t n, size_t max_queued,
+                    OverloadPolicy policy = OverloadPolicy::Reject)
+      : jobs_(max_queued ? max_queued : 1), policy_(policy) {
+    stats_.workers = n;
+    stats_.max_queue_depth = jobs_.size();
+    while (n) {
+      threads_.emplace_back(worker(*this));
+      n--;
+    }
+  }
+
+  BoundedThreadPool(const BoundedThreadPool &) = delete;
+  ~BoundedThreadPool() override = default;
+
+  // Tasks without a reject handler always wait for a free slot.
+  void enqueue(std::function<void()> fn) override {
+    enqueue_or_reject(std::move(fn), nullptr);
+  }
+
+  void enqueue_or_reject(std::function<void()> fn,
+                         std::function<void()> reject) override {
+    std::function<void()> overflow;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+
+      auto queue = true;
+      if (count_ == jobs_.size()) {
+        auto &oldest = jobs_[head_];
+        if (policy_ == OverloadPolicy::Reject && reject) {
+          stats_.rejected++;
+          overflow = std::move(reject);
+          queue = false;
+        } else if (policy_ == OverloadPolicy::ShedOldest && oldest.reject) {
+          stats_.shed++;
+          overflow = std::move(oldest.reject);
+          oldest = job();
+          head_ = (head_ + 1) % jobs_.size();
+          count_--;
+        } else {
+          stats_.blocked++;
+          not_full_.wait(lock,
+                         [&] { return count_ < jobs_.size() || shutdown_; });
+          if (count_ == jobs_.size()) {
+            overflow = std::move(reject);
+            queue = false;
+          }
+        }
+      }
+
+      if (queue) {
+        auto &slot = jobs_[(head_ + count_) % jobs_.size()];
+        slot.fn = std::move(fn);
+        slot.reject = std::move(reject);
+        slot.queued_at = std::chrono::steady_clock::now();
+        count_++;
+        stats_.enqueued++;
+        not_empty_.notify_one();
+      }
+    }
+
+    // NOTE: The reject handler writes to a socket, so run it unlocked.
+    if (overflow) { overflow(); }
+  }
+
+  void shutdown() override {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      shutdown_ = true;
+    }
+
+    not_empty_.notify_all();
+    not_full_.notify_all();
+
+    for (auto &t : threads_) {
+      t.join();
+    }
+  }
+
+  TaskQueueStats stats() const {
+    std::unique_lock<std::mutex> lock(mutex_);
+    auto stats = stats_;
+    stats.queue_depth = count_;
+    stats.active_workers = active_workers_;
+    return stats;
+  }
+
+private:
+  struct job {
+    std::function<void()> fn;
+    std::function<void()> reject;
+    std::chrono::steady_clock::time_point queued_at;
+  };
+
+  struct worker {
+    explicit worker(BoundedThreadPool &pool) : pool_(pool) {}
+
+    void operator()() {
+      for (;;) {
+        job j;
+        {
+          std::unique_lock<std::mutex> lock(pool_.mutex_);
+
+          pool_.not_empty_.wait(
+              lock, [&] { return pool_.count_ > 0 || pool_.shutdown_; });
+
+          if (pool_.shutdown_ && pool_.count_ == 0) { break; }
+
+          j = std::move(pool_.jobs_[pool_.head_]);
+          pool_.jobs_[pool_.head_] = job();
+          pool_.head_ = (pool_.head_ + 1) % pool_.jobs_.size();
+          pool_.count_--;
+          pool_.active_workers_++;
+          pool_.record_wait(j.queued_at);
+        }
+        pool_.not_full_.notify_one();
+
+        assert(true == static_cast<bool>(j.fn));
+        j.fn();
+
+        std::unique_lock<std::mutex> lock(pool_.mutex_);
+        pool_.active_workers_--;
+      }
+    }
+
+    BoundedThreadPool &pool_;
+  };
+  friend struct worker;
+
+  void record_wait(std::chrono::steady_clock::time_point queued_at) {
+    auto usec = std::chrono::duration_cast<std::chrono::microseconds>(
+                    std::chrono::steady_clock::now() - queued_at)
+                    .count();
+    size_t i = 0;
+    for (int64_t limit = 100;
+         i + 1 < TaskQueueStats::wait_buckets && usec >= limit; limit *= 10) {
+      i++;
+    }
+    stats_.wait_usec_histogram[i]++;
+  }
+
+  std::vector<std::thread> threads_;
+
+  // Ring buffer of queued tasks; the slot count is the queue bound.
+  std::vector<job> jobs_;
+  size_t head_ = 0;
+  size_t count_ = 0;
+
+  const OverloadPolicy policy_;
+  bool shutdown_ = false;
+  size_t active_workers_ = 0;
+  TaskQueueStats stats_;
+
+  std::condition_variable not_empty_;
+  std::condition_variable not_full_;
+  mutable std::mutex mutex_;
+};
+
 using Logger = std::function<void(const Request &, const Response &)>;
 
 using SocketOptions = std::function<void(socket_t sock)>;
@@ -598,6 +961,100 @@ inline void default_socket_options(socket_t sock) {
 #endif
 }
 
+namespace detail {
+
+// NOTE: Route patterns are compiled when they are registered. Literal paths
+// and literal prefixes followed by `.*` or `.+` live in a radix tree.
+// Patterns made of literals and capture groups such as `(\d+)` or `([^/]+)`
+// are checked by a segment matcher before their std::regex runs, and with
+// Server::set_path_params(true) `/:name` segments are such groups too, which
+// also fill `path_params`. Any other pattern is matched with std::regex only.
+// The regex of the winning route still runs once to fill `matches`, so those
+// are what the regex router filled, and as before the first registered route
+// that matches wins.
+template <typename T> class RouteTable {
+public:
+  void add(const char *pattern, size_t pattern_len, T handler,
+           bool path_params = false);
+  const T *find(Request &req) const;
+
+private:
+  static const size_t npos = static_cast<size_t>(-1);
+
+  struct Node {
+    std::string label;
+    std::vector<std::unique_ptr<Node>> children;
+    size_t exact = npos;            // pattern == prefix
+    size_t any_suffix = npos;       // pattern == prefix + ".*"
+    size_t non_empty_suffix = npos; // pattern == prefix + ".+"
+  };
+
+  // The characters a capture group repeats: `\d`, `[^/]` or `.`.
+  enum class CharClass { Digit, NotSlash, Any };
+
+  struct Group {
+    CharClass chars;
+    bool may_be_empty; // `*` rather than `+`
+  };
+
+  struct PatternRoute {
+    size_t index;
+    // Literals around the capture groups, one more than `groups`. Both are
+    // empty when only the regex can tell whether a path matches.
+    std::vector<std::string> fragments;
+    std::vector<Group> groups;
+    // The names of `/:name` groups, if the route was registered with them.
+    std::vector<std::string> param_names;
+
+    bool match(const std::string &path) const;
+  };
+
+  static bool to_literal(const char *b, const char *e, std::string &literal);
+  static bool to_groups(const std::string &s, PatternRoute &route);
+  static bool to_segments(const std::string &s, PatternRoute &route,
+                          std::string &regex);
+  static bool in_class(CharClass chars, char c);
+  void insert(const std::string &key, size_t index, size_t Node::*slot);
+  size_t find_in_tree(const std::string &path) const;
+
+  Node root_;
+  std::vector<PatternRoute> pattern_routes_; // in registration order
+  std::vector<std::regex> regexes_;          // by handler index
+  std::vector<T> handlers_;
+};
+
+// NOTE: A connection that is refused with 503 still has the unread request in
+// its receive buffer, and closing it then makes the kernel send an RST, which
+// may reach the client before it has read the response. Such sockets are shut
+// down for writing and kept here until the peer closes its side too, or until
+// CPPHTTPLIB_LINGERING_CLOSE_MSECOND has passed.
+class LingeringSockets {
+public:
+  LingeringSockets() = default;
+  ~LingeringSockets();
+
+  LingeringSockets(const LingeringSockets &) = delete;
+  LingeringSockets &operator=(const LingeringSockets &) = delete;
+
+  // Takes over a socket whose response has been written.
+  void add(socket_t sock);
+  // Discards what the peers have sent without blocking and closes the sockets
+  // that are done with. Returns whether any socket is left.
+  bool poll();
+  void close_all();
+
+private:
+  struct Entry {
+    socket_t sock;
+    std::chrono::steady_clock::time_point deadline;
+  };
+
+  std::mutex mutex_;
+  std::vector<Entry> entries_;
+};
+
+} // namespace detail
+
 class Server {
 public:
   using Handler = std::function<void(const Request &, Response &)>;
@@ -689,6 +1146,22 @@ public:
 
   Server &set_payload_max_length(size_t length);
 
+  // Bodies shorter than `length` are sent uncompressed.
+  Server &set_compression_min_length(size_t length);
+
+  // Serves `file.br` or `file.gz` from a mount point in place of `file` when
+  // the client accepts that encoding and the sibling exists.
+  Server &set_serve_precompressed_files(bool on);
+
+  // Parks idle keep-alive connections in an epoll set (Linux only) and hands
+  // a connection to the task queue only once a full request header has
+  // arrived, so idle clients no longer pin worker threads.
+  Server &set_reactor_mode(bool on);
+
+  // Patterns registered after this call read `/:name` as a segment whose
+  // text is stored in `req.path_params["name"]`, rather than as a literal.
+  Server &set_path_params(bool on);
+
   bool bind_to_port(const char *host, int port, int socket_flags = 0);
   int bind_to_any_port(const char *host, int socket_flags = 0);
   bool listen_after_bind();
@@ -715,16 +1188,27 @@ protected:
   time_t idle_interval_sec_ = CPPHTTPLIB_IDLE_INTERVAL_SECOND;
   time_t idle_interval_usec_ = CPPHTTPLIB_IDLE_INTERVAL_USECOND;
   size_t payload_max_length_ = CPPHTTPLIB_PAYLOAD_MAX_LENGTH;
+  size_t compression_min_length_ = CPPHTTPLIB_COMPRESSION_MIN_LENGTH;
+  bool serve_precompressed_files_ = false;
+  bool reactor_mode_ = false;
+  bool path_params_ = false;
 
 private:
-  using Handlers = std::vector<std::pair<std::regex, Handler>>;
-  using HandlersForContentReader =
-      std::vector<std::pair<std::regex, HandlerWithContentReader>>;
+  using Handlers = detail::RouteTable<Handler>;
+  using HandlersForContentReader = detail::RouteTable<HandlerWithContentReader>;
 
   socket_t create_server_socket(const char *host, int port, int socket_flags,
                                 SocketOptions socket_options) const;
   int bind_internal(const char *host, int port, int socket_flags);
   bool listen_internal();
+#ifdef __linux__
+  bool listen_internal_with_reactor();
+  void process_reactor_connection(
+      detail::EpollReactor &reactor,
+      const std::shared_ptr<detail::ReactorConnection> &conn);
+#endif
+  virtual bool is_reactor_supported() const;
+  void set_socket_timeouts(socket_t sock) const;
 
   bool routing(Request &req, Response &res, Stream &strm);
   bool handle_file_request(const Request &req, Response &res,
@@ -760,6 +1244,10 @@ private:
                          ContentReceiver multipart_receiver);
 
   virtual bool process_and_close_socket(socket_t sock);
+  virtual void reject_and_close_socket(socket_t sock);
+  void write_service_unavailable(socket_t sock) const;
+
+  detail::LingeringSockets lingering_sockets_;
 
   struct MountPointEntry {
     std::string mount_point;
@@ -849,6 +1337,16 @@ private:
   Headers request_headers_;
 };
 
+struct ConnectionPoolStats {
+  size_t hits = 0;         // requests sent on an idle pooled connection
+  size_t connects = 0;     // connections opened
+  size_t stale_closes = 0; // idle connections found closed by the server
+  size_t waits = 0;        // requests that had to wait for a connection
+  uint64_t wait_usec = 0;  // total time spent waiting
+  size_t open = 0;         // connections currently open
+  size_t idle = 0;         // open connections not in use
+};
+
 class ClientImpl {
 public:
   explicit ClientImpl(const std::string &host);
@@ -979,6 +1477,12 @@ public:
   bool send(Request &req, Response &res, Error &error);
   Result send(const Request &req);
 
+  // Sends GET and HEAD requests back to back over one pooled connection and
+  // reads the responses in order. Redirects and digest auth are not
+  // followed. Other methods, or a disabled pool, fall back to one send() per
+  // request.
+  std::vector<Result> send_pipelined(const std::vector<Request> &requests);
+
   size_t is_socket_open() const;
 
   void stop();
@@ -1011,9 +1515,16 @@ public:
   void set_keep_alive(bool on);
   void set_follow_location(bool on);
 
+  // Keeps up to `max_connections` keep-alive connections so that threads
+  // sharing this client can send requests concurrently. 0 (the default)
+  // keeps the single connection guarded by set_keep_alive().
+  void set_connection_pool_size(size_t max_connections);
+  ConnectionPoolStats get_connection_pool_stats() const;
+
   void set_url_encode(bool on);
 
   void set_compress(bool on);
+  void set_compression_min_length(size_t length);
 
   void set_decompress(bool on);
 
@@ -1059,6 +1570,8 @@ protected:
 
   bool process_request(Stream &strm, Request &req, Response &res,
                        bool close_connection, Error &error);
+  bool read_response(Stream &strm, Request &req, Response &res,
+                     Error &error);
 
   bool write_content_with_provider(Stream &strm, const Request &req,
                                    Error &error);
@@ -1080,6 +1593,19 @@ protected:
   std::thread::id socket_requests_are_from_thread_ = std::thread::id();
   bool socket_should_be_closed_when_request_is_done_ = false;
 
+  // Connection pool, used instead of socket_ when pool_max_size_ > 0.
+  // Everything but pool_max_size_ is protected under pool_mutex_.
+  size_t pool_max_size_ = 0;
+  std::vector<Socket> pool_idle_;
+  std::set<socket_t> pool_in_use_;
+  std::set<socket_t> pool_closing_; // close instead of reusing when released
+  std::map<std::thread::id, size_t> pool_holders_;
+  ConnectionPoolStats pool_stats_;
+  mutable std::mutex pool_mutex_;
+  std::condition_variable pool_cond_;
+
+  void close_idle_pooled_sockets();
+
   // Default headers
   Headers default_headers_;
 
@@ -1112,6 +1638,7 @@ protected:
   SocketOptions socket_options_ = nullptr;
 
   bool compress_ = false;
+  size_t compression_min_length_ = CPPHTTPLIB_COMPRESSION_MIN_LENGTH;
   bool decompress_ = true;
 
   std::string interface_;
@@ -1153,6 +1680,13 @@ private:
       ContentProviderWithoutLength content_provider_without_length,
       const char *content_type);
 
+  bool connect_socket(Socket &socket, Response &res, Error &error,
+                      bool &ret);
+  bool send_with_pool(Request &req, Response &res, Error &error);
+  bool acquire_pooled_socket(Socket &socket, bool &reused, Response &res,
+                             Error &error, bool &ret);
+  void release_pooled_socket(Socket &socket, bool reuse);
+
   virtual bool process_socket(const Socket &socket,
                               std::function<bool(Stream &strm)> callback);
   virtual bool is_ssl() const;
@@ -1292,6 +1826,8 @@ public:
   bool send(Request &req, Response &res, Error &error);
   Result send(const Request &req);
 
+  std::vector<Result> send_pipelined(const std::vector<Request> &requests);
+
   size_t is_socket_open() const;
 
   void stop();
@@ -1324,9 +1860,13 @@ public:
   void set_keep_alive(bool on);
   void set_follow_location(bool on);
 
+  void set_connection_pool_size(size_t max_connections);
+  ConnectionPoolStats get_connection_pool_stats() const;
+
   void set_url_encode(bool on);
 
   void set_compress(bool on);
+  void set_compression_min_length(size_t length);
 
   void set_decompress(bool on);
 
@@ -1381,6 +1921,8 @@ public:
 
 private:
   bool process_and_close_socket(socket_t sock) override;
+  void reject_and_close_socket(socket_t sock) override;
+  bool is_reactor_supported() const override;
 
   SSL_CTX *ctx_;
   std::mutex ctx_mutex_;
@@ -1703,6 +2245,141 @@ inline void read_file(const std::string &path, std::string &out) {
   fs.read(&out[0], static_cast<std::streamsize>(size));
 }
 
+// A file served from a mount point. Reads go through pread(2), so a file that
+// is truncated while it is being served fails the read instead of raising
+// SIGBUS the way a memory map would. Windows doesn't allow truncating a mapped
+// file, so there the file is read through a view.
+class static_file {
+public:
+  explicit static_file(const char *path);
+  ~static_file();
+
+  static_file(const static_file &) = delete;
+  static_file &operator=(const static_file &) = delete;
+
+  bool open(const char *path);
+  void close();
+
+  bool is_open() const;
+  size_t size() const;
+  // Copies `n` bytes at `offset` into `buf`. Fails if the file has shrunk.
+  bool read(size_t offset, char *buf, size_t n) const;
+#ifndef _WIN32
+  int fd() const;
+#endif
+
+private:
+#ifdef _WIN32
+  HANDLE hFile_ = INVALID_HANDLE_VALUE;
+  HANDLE hMapping_ = NULL;
+  void *addr_ = nullptr;
+#else
+  int fd_ = -1;
+#endif
+  size_t size_ = 0;
+  bool is_open_ = false;
+};
+
+inline static_file::static_file(const char *path) { open(path); }
+
+inline static_file::~static_file() { close(); }
+
+inline bool static_file::open(const char *path) {
+  close();
+
+#ifdef _WIN32
+  hFile_ = ::CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL,
+                         OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (hFile_ == INVALID_HANDLE_VALUE) { return false; }
+
+  LARGE_INTEGER size{};
+  if (!::GetFileSizeEx(hFile_, &size)) {
+    close();
+    return false;
+  }
+  size_ = static_cast<size_t>(size.QuadPart);
+
+  // An empty file can't be mapped, but it is still a valid (empty) content.
+  if (size_ > 0) {
+    hMapping_ = ::CreateFileMappingA(hFile_, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (hMapping_ == NULL) {
+      close();
+      return false;
+    }
+
+    addr_ = ::MapViewOfFile(hMapping_, FILE_MAP_READ, 0, 0, 0);
+    if (addr_ == nullptr) {
+      close();
+      return false;
+    }
+  }
+#else
+  fd_ = ::open(path, O_RDONLY);
+  if (fd_ == -1) { return false; }
+
+  struct stat st;
+  if (fstat(fd_, &st) == -1 || !S_ISREG(st.st_mode)) {
+    close();
+    return false;
+  }
+  size_ = static_cast<size_t>(st.st_size);
+#endif
+
+  is_open_ = true;
+  return true;
+}
+
+inline void static_file::close() {
+#ifdef _WIN32
+  if (addr_) {
+    ::UnmapViewOfFile(addr_);
+    addr_ = nullptr;
+  }
+
+  if (hMapping_) {
+    ::CloseHandle(hMapping_);
+    hMapping_ = NULL;
+  }
+
+  if (hFile_ != INVALID_HANDLE_VALUE) {
+    ::CloseHandle(hFile_);
+    hFile_ = INVALID_HANDLE_VALUE;
+  }
+#else
+  if (fd_ != -1) {
+    ::close(fd_);
+    fd_ = -1;
+  }
+#endif
+  size_ = 0;
+  is_open_ = false;
+}
+
+inline bool static_file::is_open() const { return is_open_; }
+
+inline size_t static_file::size() const { return size_; }
+
+inline bool static_file::read(size_t offset, char *buf, size_t n) const {
+  if (offset > size_ || n > size_ - offset) { return false; }
+#ifdef _WIN32
+  if (n > 0) { std::memcpy(buf, static_cast<const char *>(addr_) + offset, n); }
+#else
+  while (n > 0) {
+    auto r = ::pread(fd_, buf, n, static_cast<off_t>(offset));
+    if (r < 0 && errno == EINTR) { continue; }
+    if (r <= 0) { return false; }
+    buf += r;
+    offset += static_cast<size_t>(r);
+    n -= static_cast<size_t>(r);
+  }
+#endif
+  return true;
+}
+
+#ifndef _WIN32
+inline int static_file::fd() const { return fd_; }
+#endif
+
 inline std::string file_extension(const std::string &path) {
   std::smatch m;
   static auto re = std::regex("\\.([a-zA-Z0-9]+)$");
@@ -1780,14 +2457,26 @@ public:
     fixed_buffer_used_size_ = 0;
     glowable_buffer_.clear();
 
-    for (size_t i = 0;; i++) {
+    for (;;) {
+      // Scan what the stream has already buffered, if anything, in place.
+      size_t avail = 0;
+      auto p = strm_.peek(avail);
+      if (avail > 0) {
+        auto nl = static_cast<const char *>(memchr(p, '\n', avail));
+        auto n = nl ? static_cast<size_t>(nl - p) + 1 : avail;
+        append(p, n);
+        strm_.consume(n);
+        if (nl) { break; }
+        continue;
+      }
+
       char byte;
       auto n = strm_.read(&byte, 1);
 
       if (n < 0) {
         return false;
       } else if (n == 0) {
-        if (i == 0) {
+        if (size() == 0) {
           return false;
         } else {
           break;
@@ -1803,6 +2492,20 @@ public:
   }
 
 private:
+  void append(const char *p, size_t n) {
+    if (glowable_buffer_.empty() &&
+        fixed_buffer_used_size_ + n < fixed_buffer_size_) {
+      memcpy(fixed_buffer_ + fixed_buffer_used_size_, p, n);
+      fixed_buffer_used_size_ += n;
+      fixed_buffer_[fixed_buffer_used_size_] = '\0';
+    } else {
+      if (glowable_buffer_.empty()) {
+        glowable_buffer_.assign(fixed_buffer_, fixed_buffer_used_size_);
+      }
+      glowable_buffer_.append(p, n);
+    }
+  }
+
   void append(char c) {
     if (fixed_buffer_used_size_ < fixed_buffer_size_ - 1) {
       fixed_buffer_[fixed_buffer_used_size_++] = c;
@@ -1958,13 +2661,25 @@ public:
   ssize_t write(const char *ptr, size_t size) override;
   void get_remote_ip_and_port(std::string &ip, int &port) const override;
   socket_t socket() const override;
-
+#ifdef __linux__
+  ssize_t send_file(int fd, size_t offset, size_t size) override;
+#endif
+  const char *peek(size_t &size) const override;
+  void consume(size_t size) override;
+
 private:
+  ssize_t read_socket(char *ptr, size_t size);
+
   socket_t sock_;
   time_t read_timeout_sec_;
   time_t read_timeout_usec_;
   time_t write_timeout_sec_;
   time_t write_timeout_usec_;
+
+  // Read-ahead buffer; [read_buff_off_, read_buff_content_size_) is unread.
+  std::vector<char> read_buff_;
+  size_t read_buff_off_ = 0;
+  size_t read_buff_content_size_ = 0;
 };
 
 #ifdef CPPHTTPLIB_OPENSSL_SUPPORT
@@ -2004,6 +2719,9 @@ public:
   void get_remote_ip_and_port(std::string &ip, int &port) const override;
   socket_t socket() const override;
 
+  const char *peek(size_t &size) const override;
+  void consume(size_t size) override;
+
   const std::string &get_buffer() const;
 
 private:
@@ -2011,7 +2729,14 @@ private:
   size_t position = 0;
 };
 
-inline bool keep_alive(socket_t sock, time_t keep_alive_timeout_sec) {
+inline bool keep_alive(Stream &strm, time_t keep_alive_timeout_sec) {
+  // A pipelined request may already be waiting in the stream's buffer.
+  size_t buffered = 0;
+  strm.peek(buffered);
+  if (buffered > 0) { return true; }
+
+  auto sock = strm.socket();
+
   using namespace std::chrono;
   auto start = steady_clock::now();
   while (true) {
@@ -2032,15 +2757,15 @@ inline bool keep_alive(socket_t sock, time_t keep_alive_timeout_sec) {
 
 template <typename T>
 inline bool
-process_server_socket_core(socket_t sock, size_t keep_alive_max_count,
+process_server_socket_core(Stream &strm, size_t keep_alive_max_count,
                            time_t keep_alive_timeout_sec, T callback) {
   assert(keep_alive_max_count > 0);
   auto ret = false;
   auto count = keep_alive_max_count;
-  while (count > 0 && keep_alive(sock, keep_alive_timeout_sec)) {
+  while (count > 0 && keep_alive(strm, keep_alive_timeout_sec)) {
     auto close_connection = count == 1;
     auto connection_closed = false;
-    ret = callback(close_connection, connection_closed);
+    ret = callback(strm, close_connection, connection_closed);
     if (!ret || connection_closed) { break; }
     count--;
   }
@@ -2053,13 +2778,12 @@ process_server_socket(socket_t sock, size_t keep_alive_max_count,
                       time_t keep_alive_timeout_sec, time_t read_timeout_sec,
                       time_t read_timeout_usec, time_t write_timeout_sec,
                       time_t write_timeout_usec, T callback) {
-  return process_server_socket_core(
-      sock, keep_alive_max_count, keep_alive_timeout_sec,
-      [&](bool close_connection, bool &connection_closed) {
-        SocketStream strm(sock, read_timeout_sec, read_timeout_usec,
-                          write_timeout_sec, write_timeout_usec);
-        return callback(strm, close_connection, connection_closed);
-      });
+  // The stream outlives each request so that bytes read ahead of one
+  // request (pipelining) are still there for the next.
+  SocketStream strm(sock, read_timeout_sec, read_timeout_usec,
+                    write_timeout_sec, write_timeout_usec);
+  return process_server_socket_core(strm, keep_alive_max_count,
+                                    keep_alive_timeout_sec, callback);
 }
 
 template <typename T>
@@ -2080,6 +2804,238 @@ inline int shutdown_socket(socket_t sock) {
 #endif
 }
 
+#ifdef __linux__
+struct ReactorConnection {
+  socket_t sock = INVALID_SOCKET;
+  std::string buffer; // bytes received but not yet consumed by a request
+  size_t keep_alive_count = 0;
+  std::chrono::steady_clock::time_point last_active;
+  bool in_flight = false;
+  // The peer shut down its side, only the buffered requests are left to serve.
+  bool peer_closed = false;
+  // Position in the reactor's idle list while the connection isn't in flight.
+  std::list<std::shared_ptr<ReactorConnection>>::iterator idle_pos;
+};
+
+// NOTE: Reads serve the bytes prefetched by the reactor first, then fall back
+// to the socket. Whatever the request didn't consume, including anything the
+// socket stream read ahead, goes back to the connection buffer for the next
+// (pipelined) request.
+class ReactorSocketStream : public SocketStream {
+public:
+  ReactorSocketStream(ReactorConnection &conn, time_t read_timeout_sec,
+                      time_t read_timeout_usec, time_t write_timeout_sec,
+                      time_t write_timeout_usec)
+      : SocketStream(conn.sock, read_timeout_sec, read_timeout_usec,
+                     write_timeout_sec, write_timeout_usec),
+        conn_(conn) {}
+
+  ~ReactorSocketStream() override {
+    conn_.buffer.erase(0, pos_);
+    size_t n = 0;
+    auto p = SocketStream::peek(n);
+    conn_.buffer.append(p, n);
+  }
+
+  bool is_readable() const override {
+    return pos_ < conn_.buffer.size() || SocketStream::is_readable();
+  }
+
+  ssize_t read(char *ptr, size_t size) override {
+    if (pos_ < conn_.buffer.size()) {
+      auto n = (std::min)(size, conn_.buffer.size() - pos_);
+      std::memcpy(ptr, conn_.buffer.data() + pos_, n);
+      pos_ += n;
+      return static_cast<ssize_t>(n);
+    }
+    return SocketStream::read(ptr, size);
+  }
+
+  const char *peek(size_t &size) const override {
+    if (pos_ < conn_.buffer.size()) {
+      size = conn_.buffer.size() - pos_;
+      return conn_.buffer.data() + pos_;
+    }
+    return SocketStream::peek(size);
+  }
+
+  void consume(size_t size) override {
+    if (pos_ < conn_.buffer.size()) {
+      pos_ += (std::min)(size, conn_.buffer.size() - pos_);
+    } else {
+      SocketStream::consume(size);
+    }
+  }
+
+private:
+  ReactorConnection &conn_;
+  size_t pos_ = 0;
+};
+
+inline bool has_complete_header(const std::string &buffer, size_t from) {
+  from = from > 3 ? from - 3 : 0;
+  return buffer.find("\r\n\r\n", from) != std::string::npos;
+}
+
+// Owns the epoll set and every connection the server has accepted. An idle
+// connection is armed with EPOLLONESHOT, so at most one thread (the reactor
+// or a single worker) touches it at any time. Idle connections are also kept
+// in the order they became idle, so the expired ones are always at the front.
+class EpollReactor {
+public:
+  EpollReactor() : epfd_(epoll_create1(EPOLL_CLOEXEC)) {}
+
+  ~EpollReactor() {
+    for (auto &x : conns_) {
+      shutdown_socket(x.first);
+      close_socket(x.first);
+    }
+    if (epfd_ != -1) { close(epfd_); }
+  }
+
+  EpollReactor(const EpollReactor &) = delete;
+  EpollReactor &operator=(const EpollReactor &) = delete;
+
+  bool is_valid() const { return epfd_ != -1; }
+
+  bool add_listener(socket_t sock) {
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = sock;
+    return epoll_ctl(epfd_, EPOLL_CTL_ADD, sock, &ev) == 0;
+  }
+
+  bool add(socket_t sock, size_t keep_alive_count) {
+    auto conn = std::make_shared<ReactorConnection>();
+    conn->sock = sock;
+    conn->keep_alive_count = keep_alive_count;
+
+    std::lock_guard<std::mutex> guard(mutex_);
+    conns_[sock] = conn;
+    park_locked(conn);
+    auto ev = make_event(sock);
+    if (epoll_ctl(epfd_, EPOLL_CTL_ADD, sock, &ev) != 0) {
+      remove_locked(sock);
+      return false;
+    }
+    return true;
+  }
+
+  // Takes an idle connection out of the reactor for processing.
+  std::shared_ptr<ReactorConnection> acquire(socket_t sock) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    auto it = conns_.find(sock);
+    if (it == conns_.end() || it->second->in_flight) { return nullptr; }
+    it->second->in_flight = true;
+    idle_.erase(it->second->idle_pos);
+    return it->second;
+  }
+
+  // Parks a connection again until more data arrives.
+  void release(const std::shared_ptr<ReactorConnection> &conn) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    conn->in_flight = false;
+    park_locked(conn);
+    auto ev = make_event(conn->sock);
+    if (epoll_ctl(epfd_, EPOLL_CTL_MOD, conn->sock, &ev) != 0) {
+      remove_locked(conn->sock);
+    }
+  }
+
+  void remove(const std::shared_ptr<ReactorConnection> &conn) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    remove_locked(conn->sock);
+  }
+
+  // Gives up a connection in flight without closing its socket.
+  void detach(const std::shared_ptr<ReactorConnection> &conn) {
+    std::lock_guard<std::mutex> guard(mutex_);
+    conns_.erase(conn->sock);
+    epoll_ctl(epfd_, EPOLL_CTL_DEL, conn->sock, nullptr);
+  }
+
+  template <typename T> int wait(int timeout_msec, T callback) {
+    std::array<epoll_event, 64> events;
+    auto n = static_cast<int>(handle_EINTR([&]() {
+      return epoll_wait(epfd_, events.data(), static_cast<int>(events.size()),
+                        timeout_msec);
+    }));
+    for (auto i = 0; i < n; i++) {
+      callback(static_cast<socket_t>(events[static_cast<size_t>(i)].data.fd));
+    }
+    return n;
+  }
+
+  void close_idle_connections(time_t timeout_sec) {
+    auto now = std::chrono::steady_clock::now();
+    auto timeout = std::chrono::seconds(timeout_sec);
+
+    std::lock_guard<std::mutex> guard(mutex_);
+    while (!idle_.empty() && now - idle_.front()->last_active > timeout) {
+      remove_locked(idle_.front()->sock);
+    }
+  }
+
+private:
+  static epoll_event make_event(socket_t sock) {
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+    ev.data.fd = sock;
+    return ev;
+  }
+
+  // The timestamp is taken under the lock, so the idle list stays sorted.
+  void park_locked(const std::shared_ptr<ReactorConnection> &conn) {
+    conn->last_active = std::chrono::steady_clock::now();
+    conn->idle_pos = idle_.insert(idle_.end(), conn);
+  }
+
+  void remove_locked(socket_t sock) {
+    auto it = conns_.find(sock);
+    if (it == conns_.end()) { return; }
+    if (!it->second->in_flight) { idle_.erase(it->second->idle_pos); }
+    conns_.erase(it);
+    epoll_ctl(epfd_, EPOLL_CTL_DEL, sock, nullptr);
+    shutdown_socket(sock);
+    close_socket(sock);
+  }
+
+  int epfd_;
+  std::mutex mutex_;
+  std::map<socket_t, std::shared_ptr<ReactorConnection>> conns_;
+  std::list<std::shared_ptr<ReactorConnection>> idle_;
+};
+
+// Drains whatever the peer has sent so far without blocking. Returns -1 when
+// the connection is gone, 1 when a request header (or more than the reactor
+// is willing to buffer) is ready, and 0 when more data is needed. A peer that
+// shuts down its side right after sending a request still gets the response.
+inline int read_request_header(ReactorConnection &conn) {
+  char buf[CPPHTTPLIB_RECV_BUFSIZ];
+  auto from = conn.buffer.size();
+  for (;;) {
+    auto n = handle_EINTR([&]() {
+      return recv(conn.sock, buf, sizeof(buf),
+                  CPPHTTPLIB_RECV_FLAGS | MSG_DONTWAIT);
+    });
+    if (n == 0) {
+      conn.peer_closed = true;
+      return has_complete_header(conn.buffer, from) ? 1 : -1;
+    }
+    if (n < 0) {
+      if (errno == EAGAIN || errno == EWOULDBLOCK) { break; }
+      return -1;
+    }
+    conn.buffer.append(buf, static_cast<size_t>(n));
+    if (conn.buffer.size() >
+        CPPHTTPLIB_REQUEST_URI_MAX_LENGTH + CPPHTTPLIB_HEADER_MAX_LENGTH) {
+      return 1;
+    }
+  }
+  return has_complete_header(conn.buffer, from) ? 1 : 0;
+}
+#endif
+
 template <typename BindOrConnect>
 socket_t create_socket(const char *host, int port, int address_family,
                        int socket_flags, bool tcp_nodelay,
@@ -2182,6 +3138,76 @@ inline bool is_connection_error() {
 #endif
 }
 
+inline LingeringSockets::~LingeringSockets() { close_all(); }
+
+inline void LingeringSockets::add(socket_t sock) {
+#ifdef _WIN32
+  shutdown(sock, SD_SEND);
+#else
+  shutdown(sock, SHUT_WR);
+#endif
+  set_nonblocking(sock, true);
+
+  {
+    std::lock_guard<std::mutex> guard(mutex_);
+    if (entries_.size() < CPPHTTPLIB_LINGERING_CLOSE_MAX_COUNT) {
+      entries_.push_back(
+          {sock, std::chrono::steady_clock::now() +
+                     std::chrono::milliseconds(
+                         CPPHTTPLIB_LINGERING_CLOSE_MSECOND)});
+      return;
+    }
+  }
+  close_socket(sock);
+}
+
+inline bool LingeringSockets::poll() {
+  std::lock_guard<std::mutex> guard(mutex_);
+  if (entries_.empty()) { return false; }
+
+  auto now = std::chrono::steady_clock::now();
+  char buf[CPPHTTPLIB_RECV_BUFSIZ];
+  auto is_done = [&](const Entry &x) {
+    if (now >= x.deadline) { return true; }
+    // A peer that keeps sending is only drained a bit at a time, its deadline
+    // ends it anyway.
+    for (auto i = 0; i < 16; i++) {
+#ifdef _WIN32
+      auto n = recv(x.sock, buf, static_cast<int>(sizeof(buf)),
+                    CPPHTTPLIB_RECV_FLAGS);
+      if (n < 0) { return WSAGetLastError() != WSAEWOULDBLOCK; }
+#else
+      auto n = handle_EINTR([&]() {
+        return recv(x.sock, buf, sizeof(buf), CPPHTTPLIB_RECV_FLAGS);
+      });
+      if (n < 0) { return errno != EAGAIN && errno != EWOULDBLOCK; }
+#endif
+      if (n == 0) { return true; }
+    }
+    return false;
+  };
+
+  auto it = entries_.begin();
+  while (it != entries_.end()) {
+    if (is_done(*it)) {
+      close_socket(it->sock);
+      *it = entries_.back();
+      entries_.pop_back();
+    } else {
+      ++it;
+    }
+  }
+  return !entries_.empty();
+}
+
+inline void LingeringSockets::close_all() {
+  std::lock_guard<std::mutex> guard(mutex_);
+  for (const auto &x : entries_) {
+    close_socket(x.sock);
+  }
+  entries_.clear();
+}
+
 inline bool bind_ip_address(socket_t sock, const char *host) {
   struct addrinfo hints;
   struct addrinfo *result;
@@ -2483,6 +3509,48 @@ inline bool can_compress_content_type(const std::string &content_type) {
          content_type == "application/xhtml+xml";
 }
 
+// Returns the quality (0 to 1000) that an Accept-Encoding value gives to
+// `coding`, 0 when the coding is refused (`;q=0`) or not listed. `*` stands for
+// every coding that isn't listed.
+inline int accept_encoding_quality(const std::string &s, const char *coding) {
+  auto coding_len = strlen(coding);
+  auto quality = -1;
+  auto wildcard = 0;
+
+  split(s.data(), s.data() + s.size(), ',', [&](const char *b, const char *e) {
+    auto name_end = std::find(b, e, ';');
+    auto name = trim(b, name_end, 0, static_cast<size_t>(name_end - b));
+
+    // q=1 unless a `q` parameter says otherwise, e.g. "gzip;q=0.5".
+    auto q = 1000;
+    split(name_end, e, ';', [&](const char *pb, const char *pe) {
+      if (pe - pb < 2 || (pb[0] != 'q' && pb[0] != 'Q') || pb[1] != '=') {
+        return;
+      }
+      auto p = pb + 2;
+      q = 0;
+      if (p < pe && (*p == '0' || *p == '1')) { q = (*p++ - '0') * 1000; }
+      if (p < pe && *p == '.') {
+        p++;
+        for (auto scale = 100; scale > 0 && p < pe && '0' <= *p && *p <= '9';
+             scale /= 10) {
+          q += (*p++ - '0') * scale;
+        }
+      }
+      q = (std::min)(q, 1000);
+    });
+
+    auto name_len = name.second - name.first;
+    if (name_len == 1 && b[name.first] == '*') {
+      wildcard = q;
+    } else if (ci_equal(b + name.first, name_len, coding, coding_len)) {
+      quality = q;
+    }
+  });
+
+  return quality >= 0 ? quality : wildcard;
+}
+
 enum class EncodingType { None = 0, Gzip, Brotli };
 
 inline EncodingType encoding_type(const Request &req, const Response &res) {
@@ -2493,19 +3561,28 @@ inline EncodingType encoding_type(const Request &req, const Response &res) {
   const auto &s = req.get_header_value("Accept-Encoding");
   (void)(s);
 
+  // The coding with the highest quality wins, br on a tie.
+  auto type = EncodingType::None;
+  auto quality = 0;
+  (void)(quality);
+
 #ifdef CPPHTTPLIB_BROTLI_SUPPORT
-  // TODO: 'Accept-Encoding' has br, not br;q=0
-  ret = s.find("br") != std::string::npos;
-  if (ret) { return EncodingType::Brotli; }
+  auto br = accept_encoding_quality(s, "br");
+  if (br > quality) {
+    type = EncodingType::Brotli;
+    quality = br;
+  }
 #endif
 
 #ifdef CPPHTTPLIB_ZLIB_SUPPORT
-  // TODO: 'Accept-Encoding' has gzip, not gzip;q=0
-  ret = s.find("gzip") != std::string::npos;
-  if (ret) { return EncodingType::Gzip; }
+  auto gzip = accept_encoding_quality(s, "gzip");
+  if (gzip > quality) {
+    type = EncodingType::Gzip;
+    quality = gzip;
+  }
 #endif
 
-  return EncodingType::None;
+  return type;
 }
 
 class compressor {
@@ -2540,96 +3617,156 @@ public:
 };
 
 #ifdef CPPHTTPLIB_ZLIB_SUPPORT
-class gzip_compressor : public compressor {
+// NOTE: deflateInit2 allocates a few hundred KB of state, which costs more
+// than compressing a small body. Each thread keeps up to
+// CPPHTTPLIB_COMPRESSION_POOL_SIZE streams of each kind around and resets
+// them between uses instead.
+template <typename T> class thread_local_pool {
 public:
-  gzip_compressor() {
-    std::memset(&strm_, 0, sizeof(strm_));
-    strm_.zalloc = Z_NULL;
-    strm_.zfree = Z_NULL;
-    strm_.opaque = Z_NULL;
+  static std::unique_ptr<T> acquire() {
+    auto &items = pool();
+    if (items.empty()) { return detail::make_unique<T>(); }
+    auto item = std::move(items.back());
+    items.pop_back();
+    return item;
+  }
+
+  static void release(std::unique_ptr<T> item) {
+    auto &items = pool();
+    if (item->reset() && items.size() < CPPHTTPLIB_COMPRESSION_POOL_SIZE) {
+      items.push_back(std::move(item));
+    }
+  }
+
+private:
+  static std::vector<std::unique_ptr<T>> &pool() {
+    static thread_local std::vector<std::unique_ptr<T>> items;
+    return items;
+  }
+};
+
+struct deflate_stream {
+  deflate_stream() {
+    std::memset(&strm, 0, sizeof(strm));
+    strm.zalloc = Z_NULL;
+    strm.zfree = Z_NULL;
+    strm.opaque = Z_NULL;
+
+    is_valid = deflateInit2(&strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 31, 8,
+                            Z_DEFAULT_STRATEGY) == Z_OK;
+  }
+
+  ~deflate_stream() {
+    if (is_valid) { deflateEnd(&strm); }
+  }
+
+  bool reset() { return is_valid && deflateReset(&strm) == Z_OK; }
+
+  z_stream strm;
+  bool is_valid = false;
+};
+
+struct inflate_stream {
+  inflate_stream() {
+    std::memset(&strm, 0, sizeof(strm));
+    strm.zalloc = Z_NULL;
+    strm.zfree = Z_NULL;
+    strm.opaque = Z_NULL;
+
+    // 15 is the value of wbits, which should be at the maximum possible value
+    // to ensure that any gzip stream can be decoded. The offset of 32 specifies
+    // that the stream type should be automatically detected either gzip or
+    // deflate.
+    is_valid = inflateInit2(&strm, 32 + 15) == Z_OK;
+  }
 
-    is_valid_ = deflateInit2(&strm_, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 31, 8,
-                             Z_DEFAULT_STRATEGY) == Z_OK;
+  ~inflate_stream() {
+    if (is_valid) { inflateEnd(&strm); }
   }
 
-  ~gzip_compressor() { deflateEnd(&strm_); }
+  bool reset() { return is_valid && inflateReset(&strm) == Z_OK; }
+
+  z_stream strm;
+  bool is_valid = false;
+};
+
+class gzip_compressor : public compressor {
+public:
+  gzip_compressor() : stream_(thread_local_pool<deflate_stream>::acquire()) {}
+
+  ~gzip_compressor() {
+    thread_local_pool<deflate_stream>::release(std::move(stream_));
+  }
 
   bool compress(const char *data, size_t data_length, bool last,
                 Callback callback) override {
-    assert(is_valid_);
+    assert(stream_->is_valid);
+    auto &strm = stream_->strm;
 
     auto flush = last ? Z_FINISH : Z_NO_FLUSH;
 
-    strm_.avail_in = static_cast<decltype(strm_.avail_in)>(data_length);
-    strm_.next_in = const_cast<Bytef *>(reinterpret_cast<const Bytef *>(data));
+    strm.avail_in = static_cast<decltype(strm.avail_in)>(data_length);
+    strm.next_in = const_cast<Bytef *>(reinterpret_cast<const Bytef *>(data));
 
     int ret = Z_OK;
 
-    std::array<char, CPPHTTPLIB_COMPRESSION_BUFSIZ> buff{};
+    std::array<char, CPPHTTPLIB_COMPRESSION_BUFSIZ> buff;
     do {
-      strm_.avail_out = static_cast<uInt>(buff.size());
-      strm_.next_out = reinterpret_cast<Bytef *>(buff.data());
+      strm.avail_out = static_cast<uInt>(buff.size());
+      strm.next_out = reinterpret_cast<Bytef *>(buff.data());
 
-      ret = deflate(&strm_, flush);
+      ret = deflate(&strm, flush);
       if (ret == Z_STREAM_ERROR) { return false; }
 
-      if (!callback(buff.data(), buff.size() - strm_.avail_out)) {
+      if (!callback(buff.data(), buff.size() - strm.avail_out)) {
         return false;
       }
-    } while (strm_.avail_out == 0);
+    } while (strm.avail_out == 0);
 
     assert((last && ret == Z_STREAM_END) || (!last && ret == Z_OK));
-    assert(strm_.avail_in == 0);
+    assert(strm.avail_in == 0);
     return true;
   }
 
 private:
-  bool is_valid_ = false;
-  z_stream strm_;
+  std::unique_ptr<deflate_stream> stream_;
 };
 
 class gzip_decompressor : public decompressor {
 public:
-  gzip_decompressor() {
-    std::memset(&strm_, 0, sizeof(strm_));
-    strm_.zalloc = Z_NULL;
-    strm_.zfree = Z_NULL;
-    strm_.opaque = Z_NULL;
+  gzip_decompressor()
+      : stream_(thread_local_pool<inflate_stream>::acquire()) {}
 
-    // 15 is the value of wbits, which should be at the maximum possible value
-    // to ensure that any gzip stream can be decoded. The offset of 32 specifies
-    // that the stream type should be automatically detected either gzip or
-    // deflate.
-    is_valid_ = inflateInit2(&strm_, 32 + 15) == Z_OK;
+  ~gzip_decompressor() {
+    thread_local_pool<inflate_stream>::release(std::move(stream_));
   }
 
-  ~gzip_decompressor() { inflateEnd(&strm_); }
-
-  bool is_valid() const override { return is_valid_; }
+  bool is_valid() const override { return stream_->is_valid; }
 
   bool decompress(const char *data, size_t data_length,
                   Callback callback) override {
-    assert(is_valid_);
+    assert(stream_->is_valid);
+    auto &strm = stream_->strm;
 
     int ret = Z_OK;
 
-    strm_.avail_in = static_cast<decltype(strm_.avail_in)>(data_length);
-    strm_.next_in = const_cast<Bytef *>(reinterpret_cast<const Bytef *>(data));
+    strm.avail_in = static_cast<decltype(strm.avail_in)>(data_length);
+    strm.next_in = const_cast<Bytef *>(reinterpret_cast<const Bytef *>(data));
 
-    std::array<char, CPPHTTPLIB_COMPRESSION_BUFSIZ> buff{};
-    while (strm_.avail_in > 0) {
-      strm_.avail_out = static_cast<uInt>(buff.size());
-      strm_.next_out = reinterpret_cast<Bytef *>(buff.data());
+    std::array<char, CPPHTTPLIB_COMPRESSION_BUFSIZ> buff;
+    while (strm.avail_in > 0) {
+      strm.avail_out = static_cast<uInt>(buff.size());
+      strm.next_out = reinterpret_cast<Bytef *>(buff.data());
 
-      ret = inflate(&strm_, Z_NO_FLUSH);
+      ret = inflate(&strm, Z_NO_FLUSH);
       assert(ret != Z_STREAM_ERROR);
       switch (ret) {
       case Z_NEED_DICT:
       case Z_DATA_ERROR:
-      case Z_MEM_ERROR: inflateEnd(&strm_); return false;
+      case Z_MEM_ERROR: return false;
       }
 
-      if (!callback(buff.data(), buff.size() - strm_.avail_out)) {
+      if (!callback(buff.data(), buff.size() - strm.avail_out)) {
         return false;
       }
     }
@@ -2638,8 +3775,7 @@ public:
   }
 
 private:
-  bool is_valid_ = false;
-  z_stream strm_;
+  std::unique_ptr<inflate_stream> stream_;
 };
 #endif
 
@@ -2654,7 +3790,7 @@ public:
 
   bool compress(const char *data, size_t data_length, bool last,
                 Callback callback) override {
-    std::array<uint8_t, CPPHTTPLIB_COMPRESSION_BUFSIZ> buff{};
+    std::array<uint8_t, CPPHTTPLIB_COMPRESSION_BUFSIZ> buff;
 
     auto operation = last ? BROTLI_OPERATION_FINISH : BROTLI_OPERATION_PROCESS;
     auto available_in = data_length;
@@ -2716,7 +3852,7 @@ public:
 
     decoder_r = BROTLI_DECODER_RESULT_NEEDS_MORE_OUTPUT;
 
-    std::array<char, CPPHTTPLIB_COMPRESSION_BUFSIZ> buff{};
+    std::array<char, CPPHTTPLIB_COMPRESSION_BUFSIZ> buff;
     while (decoder_r == BROTLI_DECODER_RESULT_NEEDS_MORE_OUTPUT) {
       char *next_out = buff.data();
       size_t avail_out = buff.size();
@@ -2793,7 +3929,10 @@ inline bool parse_header(const char *beg, const char *end, T fn) {
   }
 
   if (p < end) {
-    fn(std::string(beg, key_end), decode_url(std::string(p, end), false));
+    // Most values have nothing to decode, so keep the copy we already have.
+    std::string val(p, end);
+    if (val.find('%') != std::string::npos) { val = decode_url(val, false); }
+    fn(std::string(beg, key_end), std::move(val));
     return true;
   }
 
@@ -2805,6 +3944,8 @@ inline bool read_headers(Stream &strm, Headers &headers) {
   char buf[bufsiz];
   stream_line_reader line_reader(strm, buf, bufsiz);
 
+  headers.reserve(CPPHTTPLIB_HEADER_RESERVE_COUNT);
+
   for (;;) {
     if (!line_reader.getline()) { return false; }
 
@@ -3271,39 +4412,113 @@ inline bool parse_multipart_boundary(const std::string &content_type,
   return !boundary.empty();
 }
 
-inline bool parse_range_header(const std::string &s, Ranges &ranges) try {
-  static auto re_first_range = std::regex(R"(bytes=(\d*-\d*(?:,\s*\d*-\d*)*))");
-  std::smatch m;
-  if (std::regex_match(s, m, re_first_range)) {
-    auto pos = static_cast<size_t>(m.position(1));
-    auto len = static_cast<size_t>(m.length(1));
-    bool all_valid_ranges = true;
-    split(&s[pos], &s[pos + len], ',', [&](const char *b, const char *e) {
-      if (!all_valid_ranges) return;
-      static auto re_another_range = std::regex(R"(\s*(\d*)-(\d*))");
-      std::cmatch cm;
-      if (std::regex_match(b, e, cm, re_another_range)) {
-        ssize_t first = -1;
-        if (!cm.str(1).empty()) {
-          first = static_cast<ssize_t>(std::stoll(cm.str(1)));
-        }
+inline bool is_regex_space(char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\f' ||
+         c == '\v';
+}
 
-        ssize_t last = -1;
-        if (!cm.str(2).empty()) {
-          last = static_cast<ssize_t>(std::stoll(cm.str(2)));
-        }
+// Parses an optional run of decimal digits. `val` is -1 when there are none.
+inline bool parse_range_pos(const char *&p, const char *end, ssize_t &val) {
+  val = -1;
+  for (; p < end && '0' <= *p && *p <= '9'; p++) {
+    auto d = *p - '0';
+    if (val == -1) { val = 0; }
+    if (val > ((std::numeric_limits<ssize_t>::max)() - d) / 10) {
+      return false;
+    }
+    val = val * 10 + d;
+  }
+  return true;
+}
 
-        if (first != -1 && last != -1 && first > last) {
-          all_valid_ranges = false;
-          return;
-        }
-        ranges.emplace_back(std::make_pair(first, last));
-      }
-    });
-    return all_valid_ranges;
+// bytes=\d*-\d*(,\s*\d*-\d*)*
+inline bool parse_range_header(const std::string &s, Ranges &ranges) {
+  static const char prefix[] = "bytes=";
+  if (s.compare(0, sizeof(prefix) - 1, prefix) != 0) { return false; }
+
+  auto p = s.data() + sizeof(prefix) - 1;
+  auto end = s.data() + s.size();
+
+  for (;;) {
+    ssize_t first, last;
+    if (!parse_range_pos(p, end, first)) { return false; }
+    if (p == end || *p++ != '-') { return false; }
+    if (!parse_range_pos(p, end, last)) { return false; }
+
+    if (first != -1 && last != -1 && first > last) { return false; }
+    ranges.emplace_back(std::make_pair(first, last));
+
+    if (p == end) { return true; }
+    if (*p++ != ',') { return false; }
+    while (p < end && is_regex_space(*p)) {
+      p++;
+    }
+  }
+}
+
+inline bool start_with_case_ignore(const std::string &s, size_t off,
+                                   const char *prefix) {
+  for (; *prefix; off++, prefix++) {
+    if (off >= s.size() || ::tolower(static_cast<unsigned char>(s[off])) !=
+                               ::tolower(static_cast<unsigned char>(*prefix))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Content-Disposition:\s*form-data;\s*name="(.*?)"(?:;\s*filename="(.*?)")?
+inline bool parse_content_disposition(const std::string &header,
+                                      std::string &name,
+                                      std::string &filename) {
+  size_t p = 0;
+  auto skip_spaces = [&]() {
+    while (p < header.size() && is_regex_space(header[p])) {
+      p++;
+    }
+  };
+  auto skip = [&](const char *prefix) {
+    if (!start_with_case_ignore(header, p, prefix)) { return false; }
+    p += strlen(prefix);
+    return true;
+  };
+
+  if (!skip("content-disposition:")) { return false; }
+  skip_spaces();
+  if (!skip("form-data;")) { return false; }
+  skip_spaces();
+  if (!skip("name=\"")) { return false; }
+
+  auto end = header.size();
+  while (end > p && is_regex_space(header[end - 1])) {
+    end--;
+  }
+  if (header.find_first_of("\r\n", p) < end) { return false; }
+
+  // The name ends at the first quote after which the rest still parses.
+  for (auto q = header.find('"', p); q < end; q = header.find('"', q + 1)) {
+    if (q + 1 == end) {
+      name = header.substr(p, q - p);
+      filename.clear();
+      return true;
+    }
+
+    auto r = q + 1;
+    if (header[r++] != ';') { continue; }
+    while (r < end && is_regex_space(header[r])) {
+      r++;
+    }
+    if (!start_with_case_ignore(header, r, "filename=\"")) { continue; }
+    r += 10;
+
+    if (r < end && header[end - 1] == '"') {
+      name = header.substr(p, q - p);
+      filename = header.substr(r, end - 1 - r);
+      return true;
+    }
   }
   return false;
-} catch (...) { return false; }
+}
 
 class MultipartFormDataParser {
 public:
@@ -3316,10 +4531,6 @@ public:
   bool parse(const char *buf, size_t n, const ContentReceiver &content_callback,
              const MultipartContentHeader &header_callback) {
 
-    static const std::regex re_content_disposition(
-        "^Content-Disposition:\\s*form-data;\\s*name=\"(.*?)\"(?:;\\s*filename="
-        "\"(.*?)\")?\\s*$",
-        std::regex_constants::icase);
     static const std::string dash_ = "--";
     static const std::string crlf_ = "\r\n";
 
@@ -3362,11 +4573,7 @@ public:
           if (start_with_case_ignore(header, header_name)) {
             file_.content_type = trim_copy(header.substr(header_name.size()));
           } else {
-            std::smatch m;
-            if (std::regex_match(header, m, re_content_disposition)) {
-              file_.name = m[1];
-              file_.filename = m[2];
-            }
+            parse_content_disposition(header, file_.name, file_.filename);
           }
 
           buf_.erase(0, pos + crlf_.size());
@@ -3547,10 +4754,23 @@ get_range_offset_and_length(const Request &req, size_t content_length,
     r.second = slen - 1;
   }
 
-  if (r.second == -1) { r.second = slen - 1; }
+  if (r.second == -1 || r.second >= slen) { r.second = slen - 1; }
+  if (r.first > r.second) {
+    return std::make_pair(static_cast<size_t>(r.first), 0);
+  }
   return std::make_pair(r.first, static_cast<size_t>(r.second - r.first) + 1);
 }
 
+inline bool is_satisfiable_ranges(const Request &req, size_t content_length) {
+  for (size_t i = 0; i < req.ranges.size(); i++) {
+    auto offsets = get_range_offset_and_length(req, content_length, i);
+    if (offsets.first >= content_length || offsets.second == 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
 inline std::string make_content_range_header_field(size_t offset, size_t length,
                                                    size_t content_length) {
   std::string field = "bytes ";
@@ -3563,7 +4783,7 @@ inline std::string make_content_range_header_field(size_t offset, size_t length,
 }
 
 template <typename SToken, typename CToken, typename Content>
-bool process_multipart_ranges_data(const Request &req, Response &res,
+bool process_multipart_ranges_data(const Request &req, size_t content_length,
                                    const std::string &boundary,
                                    const std::string &content_type,
                                    SToken stoken, CToken ctoken,
@@ -3578,12 +4798,12 @@ bool process_multipart_ranges_data(const Request &req, Response &res,
       ctoken("\r\n");
     }
 
-    auto offsets = get_range_offset_and_length(req, res.body.size(), i);
+    auto offsets = get_range_offset_and_length(req, content_length, i);
     auto offset = offsets.first;
     auto length = offsets.second;
 
     ctoken("Content-Range: ");
-    stoken(make_content_range_header_field(offset, length, res.body.size()));
+    stoken(make_content_range_header_field(offset, length, content_length));
     ctoken("\r\n");
     ctoken("\r\n");
     if (!content(offset, length)) { return false; }
@@ -3602,7 +4822,7 @@ inline bool make_multipart_ranges_data(const Request &req, Response &res,
                                        const std::string &content_type,
                                        std::string &data) {
   return process_multipart_ranges_data(
-      req, res, boundary, content_type,
+      req, res.body.size(), boundary, content_type,
       [&](const std::string &token) { data += token; },
       [&](const char *token) { data += token; },
       [&](size_t offset, size_t length) {
@@ -3621,7 +4841,7 @@ get_multipart_ranges_data_length(const Request &req, Response &res,
   size_t data_length = 0;
 
   process_multipart_ranges_data(
-      req, res, boundary, content_type,
+      req, res.content_length_, boundary, content_type,
       [&](const std::string &token) { data_length += token.size(); },
       [&](const char *token) { data_length += strlen(token); },
       [&](size_t /*offset*/, size_t length) {
@@ -3632,6 +4852,48 @@ get_multipart_ranges_data_length(const Request &req, Response &res,
   return data_length;
 }
 
+template <typename T>
+inline bool write_file_content(Stream &strm, const static_file &file,
+                               size_t offset, size_t length,
+                               const T &is_shutting_down) {
+  auto end_offset = offset + length;
+  if (end_offset > file.size()) { return false; }
+
+#ifndef _WIN32
+  // Let the kernel copy straight from the page cache when the stream can.
+  while (offset < end_offset && !is_shutting_down()) {
+    auto n = strm.send_file(file.fd(), offset, end_offset - offset);
+    if (n <= 0) { break; }
+    offset += static_cast<size_t>(n);
+  }
+#endif
+
+  // Streams that can't send a file (e.g. SSL) get it through a buffer.
+  if (offset < end_offset) {
+    std::vector<char> buf(
+        (std::min)(end_offset - offset, CPPHTTPLIB_SEND_FILE_BUFSIZ));
+    while (offset < end_offset && !is_shutting_down()) {
+      auto n = (std::min)(end_offset - offset, buf.size());
+      if (!file.read(offset, buf.data(), n)) { return false; }
+      if (!write_data(strm, buf.data(), n)) { return false; }
+      offset += n;
+    }
+  }
+
+  return offset == end_offset;
+}
+
+template <typename T>
+inline bool write_content_range(Stream &strm, Response &res, size_t offset,
+                                size_t length, const T &is_shutting_down) {
+  if (res.content_file_) {
+    return write_file_content(strm, *res.content_file_, offset, length,
+                              is_shutting_down);
+  }
+  return write_content(strm, res.content_provider_, offset, length,
+                       is_shutting_down);
+}
+
 template <typename T>
 inline bool write_multipart_ranges_data(Stream &strm, const Request &req,
                                         Response &res,
@@ -3639,12 +4901,12 @@ inline bool write_multipart_ranges_data(Stream &strm, const Request &req,
                                         const std::string &content_type,
                                         const T &is_shutting_down) {
   return process_multipart_ranges_data(
-      req, res, boundary, content_type,
+      req, res.content_length_, boundary, content_type,
       [&](const std::string &token) { strm.write(token); },
       [&](const char *token) { strm.write(token); },
       [&](size_t offset, size_t length) {
-        return write_content(strm, res.content_provider_, offset, length,
-                             is_shutting_down);
+        return write_content_range(strm, res, offset, length,
+                                   is_shutting_down);
       });
 }
 
@@ -3811,7 +5073,6 @@ inline bool parse_www_authenticate(const Response &res,
                                    bool is_proxy) {
   auto auth_key = is_proxy ? "Proxy-Authenticate" : "WWW-Authenticate";
   if (res.has_header(auth_key)) {
-    static auto re = std::regex(R"~((?:(?:,\s*)?(.+?)=(?:"(.*?)"|([^,]*))))~");
     auto s = res.get_header_value(auth_key);
     auto pos = s.find(' ');
     if (pos != std::string::npos) {
@@ -3819,17 +5080,28 @@ inline bool parse_www_authenticate(const Response &res,
       if (type == "Basic") {
         return false;
       } else if (type == "Digest") {
-        s = s.substr(pos + 1);
-        auto beg = std::sregex_iterator(s.begin(), s.end(), re);
-        for (auto i = beg; i != std::sregex_iterator(); ++i) {
-          auto m = *i;
-          auto key = s.substr(static_cast<size_t>(m.position(1)),
-                              static_cast<size_t>(m.length(1)));
-          auto val = m.length(2) > 0
-                         ? s.substr(static_cast<size_t>(m.position(2)),
-                                    static_cast<size_t>(m.length(2)))
-                         : s.substr(static_cast<size_t>(m.position(3)),
-                                    static_cast<size_t>(m.length(3)));
+        // key=value or key="value", separated by commas.
+        pos++;
+        while (pos < s.size()) {
+          while (pos < s.size() && (s[pos] == ',' || is_regex_space(s[pos]))) {
+            pos++;
+          }
+          auto eq = s.find('=', pos);
+          if (eq == std::string::npos || eq == pos) { break; }
+          auto key = s.substr(pos, eq - pos);
+
+          std::string val;
+          pos = eq + 1;
+          auto quote = pos < s.size() && s[pos] == '"' ? s.find('"', pos + 1)
+                                                       : std::string::npos;
+          if (quote != std::string::npos) {
+            val = s.substr(pos + 1, quote - pos - 1);
+            pos = quote + 1;
+          } else {
+            auto comma = (std::min)(s.find(',', pos), s.size());
+            val = s.substr(pos, comma - pos);
+            pos = comma;
+          }
           auth[key] = val;
         }
         return true;
@@ -3909,6 +5181,135 @@ make_bearer_token_authentication_header(const std::string &token,
   return std::make_pair(key, std::move(field));
 }
 
+// Headers implementation
+inline Headers::iterator Headers::insert(value_type &&field) {
+  const auto &key = field.first;
+  auto hash = detail::ci_hash(key.data(), key.size());
+
+  auto pos = fields_.size();
+  auto first = find_first(key.data(), key.size());
+  if (first != npos) { pos = range_end(first); }
+
+  fields_.insert(fields_.begin() + static_cast<ssize_t>(pos),
+                 std::move(field));
+  hashes_.insert(hashes_.begin() + static_cast<ssize_t>(pos), hash);
+  return fields_.begin() + static_cast<ssize_t>(pos);
+}
+
+inline Headers::size_type Headers::find_first(const char *key,
+                                              size_type len) const {
+  auto hash = detail::ci_hash(key, len);
+  for (size_type i = 0; i < hashes_.size(); i++) {
+    if (hashes_[i] == hash) {
+      const auto &name = fields_[i].first;
+      if (detail::ci_equal(name.data(), name.size(), key, len)) { return i; }
+    }
+  }
+  return npos;
+}
+
+inline Headers::size_type Headers::range_end(size_type first) const {
+  const auto &name = fields_[first].first;
+  auto i = first + 1;
+  while (i < fields_.size() && hashes_[i] == hashes_[first] &&
+         detail::ci_equal(fields_[i].first.data(), fields_[i].first.size(),
+                          name.data(), name.size())) {
+    i++;
+  }
+  return i;
+}
+
+inline std::pair<Headers::size_type, Headers::size_type>
+Headers::index_range(const char *key, size_type len) const {
+  auto first = find_first(key, len);
+  if (first == npos) { return std::make_pair(size(), size()); }
+  return std::make_pair(first, range_end(first));
+}
+
+inline Headers::iterator Headers::find(const char *key) {
+  auto i = find_first(key, strlen(key));
+  return i == npos ? end() : begin() + static_cast<ssize_t>(i);
+}
+
+inline Headers::iterator Headers::find(const std::string &key) {
+  auto i = find_first(key.data(), key.size());
+  return i == npos ? end() : begin() + static_cast<ssize_t>(i);
+}
+
+inline Headers::const_iterator Headers::find(const char *key) const {
+  auto i = find_first(key, strlen(key));
+  return i == npos ? end() : begin() + static_cast<ssize_t>(i);
+}
+
+inline Headers::const_iterator Headers::find(const std::string &key) const {
+  auto i = find_first(key.data(), key.size());
+  return i == npos ? end() : begin() + static_cast<ssize_t>(i);
+}
+
+inline Headers::size_type Headers::count(const char *key) const {
+  auto r = index_range(key, strlen(key));
+  return r.second - r.first;
+}
+
+inline Headers::size_type Headers::count(const std::string &key) const {
+  auto r = index_range(key.data(), key.size());
+  return r.second - r.first;
+}
+
+inline std::pair<Headers::iterator, Headers::iterator>
+Headers::equal_range(const char *key) {
+  auto r = index_range(key, strlen(key));
+  return std::make_pair(begin() + static_cast<ssize_t>(r.first),
+                        begin() + static_cast<ssize_t>(r.second));
+}
+
+inline std::pair<Headers::iterator, Headers::iterator>
+Headers::equal_range(const std::string &key) {
+  auto r = index_range(key.data(), key.size());
+  return std::make_pair(begin() + static_cast<ssize_t>(r.first),
+                        begin() + static_cast<ssize_t>(r.second));
+}
+
+inline std::pair<Headers::const_iterator, Headers::const_iterator>
+Headers::equal_range(const char *key) const {
+  auto r = index_range(key, strlen(key));
+  return std::make_pair(begin() + static_cast<ssize_t>(r.first),
+                        begin() + static_cast<ssize_t>(r.second));
+}
+
+inline std::pair<Headers::const_iterator, Headers::const_iterator>
+Headers::equal_range(const std::string &key) const {
+  auto r = index_range(key.data(), key.size());
+  return std::make_pair(begin() + static_cast<ssize_t>(r.first),
+                        begin() + static_cast<ssize_t>(r.second));
+}
+
+inline Headers::iterator Headers::erase(const_iterator pos) {
+  return erase(pos, pos + 1);
+}
+
+inline Headers::iterator Headers::erase(const_iterator first,
+                                        const_iterator last) {
+  auto b = first - fields_.cbegin();
+  auto e = last - fields_.cbegin();
+  hashes_.erase(hashes_.begin() + b, hashes_.begin() + e);
+  return fields_.erase(fields_.begin() + b, fields_.begin() + e);
+}
+
+inline Headers::size_type Headers::erase(const char *key) {
+  auto r = equal_range(key);
+  auto n = static_cast<size_type>(r.second - r.first);
+  erase(r.first, r.second);
+  return n;
+}
+
+inline Headers::size_type Headers::erase(const std::string &key) {
+  auto r = equal_range(key);
+  auto n = static_cast<size_type>(r.second - r.first);
+  erase(r.first, r.second);
+  return n;
+}
+
 // Request implementation
 inline bool Request::has_header(const char *key) const {
   return detail::has_header(headers, key);
@@ -4042,6 +5443,7 @@ inline void Response::set_content_provider(
   content_provider_ = std::move(provider);
   content_provider_resource_releaser_ = resource_releaser;
   is_chunked_content_provider_ = false;
+  content_file_.reset();
 }
 
 inline void Response::set_content_provider(
@@ -4052,6 +5454,7 @@ inline void Response::set_content_provider(
   content_provider_ = detail::ContentProviderAdapter(std::move(provider));
   content_provider_resource_releaser_ = resource_releaser;
   is_chunked_content_provider_ = false;
+  content_file_.reset();
 }
 
 inline void Response::set_chunked_content_provider(
@@ -4062,6 +5465,7 @@ inline void Response::set_chunked_content_provider(
   content_provider_ = detail::ContentProviderAdapter(std::move(provider));
   content_provider_resource_releaser_ = resource_releaser;
   is_chunked_content_provider_ = true;
+  content_file_.reset();
 }
 
 // Result implementation
@@ -4093,6 +5497,18 @@ inline ssize_t Stream::write(const std::string &s) {
   return write(s.data(), s.size());
 }
 
+inline ssize_t Stream::send_file(int /*fd*/, size_t /*offset*/,
+                                 size_t /*size*/) {
+  return -1;
+}
+
+inline const char *Stream::peek(size_t &size) const {
+  size = 0;
+  return nullptr;
+}
+
+inline void Stream::consume(size_t /*size*/) {}
+
 template <typename... Args>
 inline ssize_t Stream::write_format(const char *fmt, const Args &...args) {
   const auto bufsiz = 2048;
@@ -4142,6 +5558,7 @@ inline SocketStream::SocketStream(socket_t sock, time_t read_timeout_sec,
 inline SocketStream::~SocketStream() {}
 
 inline bool SocketStream::is_readable() const {
+  if (read_buff_off_ < read_buff_content_size_) { return true; }
   return select_read(sock_, read_timeout_sec_, read_timeout_usec_) > 0;
 }
 
@@ -4150,8 +5567,36 @@ inline bool SocketStream::is_writable() const {
 }
 
 inline ssize_t SocketStream::read(char *ptr, size_t size) {
+  if (read_buff_off_ < read_buff_content_size_) {
+    auto n = (std::min)(size, read_buff_content_size_ - read_buff_off_);
+    memcpy(ptr, read_buff_.data() + read_buff_off_, n);
+    read_buff_off_ += n;
+    return static_cast<ssize_t>(n);
+  }
+
   if (!is_readable()) { return -1; }
 
+  read_buff_off_ = 0;
+  read_buff_content_size_ = 0;
+
+  // Large reads go straight to the caller. Small ones (the header parser)
+  // fill the read-ahead buffer, so a whole request head usually arrives with
+  // a single recv().
+  if (size >= CPPHTTPLIB_RECV_BUFSIZ) { return read_socket(ptr, size); }
+
+  if (read_buff_.empty()) { read_buff_.resize(CPPHTTPLIB_RECV_BUFSIZ); }
+
+  auto n = read_socket(read_buff_.data(), read_buff_.size());
+  if (n <= 0) { return n; }
+
+  auto len = (std::min)(size, static_cast<size_t>(n));
+  memcpy(ptr, read_buff_.data(), len);
+  read_buff_off_ = len;
+  read_buff_content_size_ = static_cast<size_t>(n);
+  return static_cast<ssize_t>(len);
+}
+
+inline ssize_t SocketStream::read_socket(char *ptr, size_t size) {
 #ifdef _WIN32
   if (size > static_cast<size_t>((std::numeric_limits<int>::max)())) {
     return -1;
@@ -4163,6 +5608,15 @@ inline ssize_t SocketStream::read(char *ptr, size_t size) {
 #endif
 }
 
+inline const char *SocketStream::peek(size_t &size) const {
+  size = read_buff_content_size_ - read_buff_off_;
+  return read_buff_.data() + read_buff_off_;
+}
+
+inline void SocketStream::consume(size_t size) {
+  read_buff_off_ += (std::min)(size, read_buff_content_size_ - read_buff_off_);
+}
+
 inline ssize_t SocketStream::write(const char *ptr, size_t size) {
   if (!is_writable()) { return -1; }
 
@@ -4184,6 +5638,15 @@ inline void SocketStream::get_remote_ip_and_port(std::string &ip,
 
 inline socket_t SocketStream::socket() const { return sock_; }
 
+#ifdef __linux__
+inline ssize_t SocketStream::send_file(int fd, size_t offset, size_t size) {
+  if (!is_writable()) { return -1; }
+
+  auto off = static_cast<off_t>(offset);
+  return handle_EINTR([&]() { return ::sendfile(sock_, fd, &off, size); });
+}
+#endif
+
 // Buffer stream implementation
 inline bool BufferStream::is_readable() const { return true; }
 
@@ -4209,8 +5672,323 @@ inline void BufferStream::get_remote_ip_and_port(std::string & /*ip*/,
 
 inline socket_t BufferStream::socket() const { return 0; }
 
+inline const char *BufferStream::peek(size_t &size) const {
+  size = buffer.size() - position;
+  return buffer.data() + position;
+}
+
+inline void BufferStream::consume(size_t size) {
+  position += (std::min)(size, buffer.size() - position);
+}
+
 inline const std::string &BufferStream::get_buffer() const { return buffer; }
 
+// Route table implementation
+template <typename T> const size_t RouteTable<T>::npos;
+
+template <typename T>
+inline bool RouteTable<T>::to_literal(const char *b, const char *e,
+                                      std::string &literal) {
+  literal.clear();
+  for (auto p = b; p != e; p++) {
+    auto c = *p;
+    if (c == '\\') {
+      // `\.` and friends are literals, `\d`, `\w`, `\1`... are not.
+      if (++p == e || std::isalnum(static_cast<unsigned char>(*p))) {
+        return false;
+      }
+      literal += *p;
+    } else if (strchr("^$.*+?()[]{}|", c)) {
+      return false;
+    } else {
+      literal += c;
+    }
+  }
+  return true;
+}
+
+template <typename T>
+inline bool RouteTable<T>::to_groups(const std::string &s,
+                                     PatternRoute &route) {
+  static const struct {
+    const char *text;
+    Group group;
+  } known[] = {
+      {"(\\d+)", {CharClass::Digit, false}},
+      {"(\\d*)", {CharClass::Digit, true}},
+      {"([0-9]+)", {CharClass::Digit, false}},
+      {"([0-9]*)", {CharClass::Digit, true}},
+      {"([^/]+)", {CharClass::NotSlash, false}},
+      {"([^/]*)", {CharClass::NotSlash, true}},
+      {"(.+)", {CharClass::Any, false}},
+      {"(.*)", {CharClass::Any, true}},
+  };
+
+  std::string literal;
+  size_t pos = 0;
+  for (;;) {
+    auto open = pos;
+    while (open < s.size() && s[open] != '(') {
+      open += s[open] == '\\' ? 2 : 1;
+    }
+    if (open > s.size() ||
+        !to_literal(s.data() + pos, s.data() + open, literal)) {
+      return false;
+    }
+    route.fragments.push_back(literal);
+    if (open == s.size()) { break; }
+
+    auto found = false;
+    for (const auto &x : known) {
+      auto len = strlen(x.text);
+      if (!s.compare(open, len, x.text)) {
+        route.groups.push_back(x.group);
+        pos = open + len;
+        found = true;
+        break;
+      }
+    }
+    if (!found) { return false; }
+  }
+
+  // A group has to end where the next literal starts, which it only does
+  // when the literal's first character can't be repeated by the group.
+  // Otherwise the regex could backtrack into a match the scan won't find.
+  for (size_t i = 0; i < route.groups.size(); i++) {
+    const auto &next = route.fragments[i + 1];
+    if (next.empty() ? i + 1 != route.groups.size()
+                     : in_class(route.groups[i].chars, next[0])) {
+      return false;
+    }
+  }
+  return !route.groups.empty();
+}
+
+template <typename T>
+inline bool RouteTable<T>::to_segments(const std::string &s,
+                                       PatternRoute &route,
+                                       std::string &regex) {
+  std::string literal;
+  size_t pos = 0;
+  for (;;) {
+    auto marker = s.find("/:", pos);
+    auto fragment_end = marker == std::string::npos ? s.size() : marker + 1;
+    if (!to_literal(s.data() + pos, s.data() + fragment_end, literal)) {
+      return false;
+    }
+    route.fragments.push_back(literal);
+    for (auto c : literal) {
+      if (c && strchr("^$\\.*+?()[]{}|", c)) { regex += '\\'; }
+      regex += c;
+    }
+    if (marker == std::string::npos) { break; }
+
+    auto name_end = s.find('/', marker + 2);
+    if (name_end == std::string::npos) { name_end = s.size(); }
+    if (name_end == marker + 2) { return false; }
+    for (auto i = marker + 2; i < name_end; i++) {
+      if (!std::isalnum(static_cast<unsigned char>(s[i])) && s[i] != '_') {
+        return false;
+      }
+    }
+    route.groups.push_back({CharClass::NotSlash, false});
+    route.param_names.push_back(s.substr(marker + 2, name_end - (marker + 2)));
+    regex += "([^/]+)";
+    pos = name_end;
+  }
+  return true;
+}
+
+template <typename T>
+inline bool RouteTable<T>::in_class(CharClass chars, char c) {
+  switch (chars) {
+  case CharClass::Digit: return '0' <= c && c <= '9';
+  case CharClass::NotSlash: return c != '/';
+  default: return c != '\n' && c != '\r'; // what `.` matches
+  }
+}
+
+template <typename T>
+inline void RouteTable<T>::insert(const std::string &key, size_t index,
+                                  size_t Node::*slot) {
+  auto node = &root_;
+  size_t pos = 0;
+
+  while (pos < key.size()) {
+    Node *child = nullptr;
+    for (auto &x : node->children) {
+      if (x->label[0] == key[pos]) {
+        child = x.get();
+        break;
+      }
+    }
+
+    if (!child) {
+      auto leaf = detail::make_unique<Node>();
+      leaf->label = key.substr(pos);
+      child = leaf.get();
+      node->children.push_back(std::move(leaf));
+      pos = key.size();
+      node = child;
+      break;
+    }
+
+    size_t n = 0;
+    while (n < child->label.size() && pos + n < key.size() &&
+           child->label[n] == key[pos + n]) {
+      n++;
+    }
+
+    if (n < child->label.size()) {
+      // Split the edge at the first differing character.
+      auto rest = detail::make_unique<Node>();
+      rest->label = child->label.substr(n);
+      rest->children = std::move(child->children);
+      rest->exact = child->exact;
+      rest->any_suffix = child->any_suffix;
+      rest->non_empty_suffix = child->non_empty_suffix;
+
+      child->label.resize(n);
+      child->children.clear();
+      child->children.push_back(std::move(rest));
+      child->exact = npos;
+      child->any_suffix = npos;
+      child->non_empty_suffix = npos;
+    }
+
+    node = child;
+    pos += n;
+  }
+
+  // An earlier registration of the same pattern keeps priority.
+  if (node->*slot == npos) { node->*slot = index; }
+}
+
+template <typename T>
+inline void RouteTable<T>::add(const char *pattern, size_t pattern_len,
+                               T handler, bool path_params) {
+  auto index = handlers_.size();
+  auto b = pattern;
+  auto e = pattern + pattern_len;
+
+  std::string s(pattern, pattern_len);
+  std::string literal;
+  std::string regex;
+  PatternRoute route;
+  route.index = index;
+  if (path_params && s.find("/:") != std::string::npos &&
+      to_segments(s, route, regex)) {
+    regexes_.emplace_back(regex);
+    pattern_routes_.push_back(std::move(route));
+  } else {
+    regexes_.emplace_back(s);
+    if (to_literal(b, e, literal)) {
+      insert(literal, index, &Node::exact);
+    } else if (pattern_len >= 2 && e[-2] == '.' &&
+               (e[-1] == '*' || e[-1] == '+') &&
+               to_literal(b, e - 2, literal)) {
+      insert(literal, index,
+             e[-1] == '*' ? &Node::any_suffix : &Node::non_empty_suffix);
+    } else {
+      route.fragments.clear();
+      route.groups.clear();
+      route.param_names.clear();
+      if (!to_groups(s, route)) {
+        route.fragments.clear();
+        route.groups.clear();
+      }
+      pattern_routes_.push_back(std::move(route));
+    }
+  }
+
+  handlers_.push_back(std::move(handler));
+}
+
+template <typename T>
+inline size_t RouteTable<T>::find_in_tree(const std::string &path) const {
+  // `.` doesn't match line terminators, so neither do the suffix routes.
+  auto line_terminator = path.find_first_of("\r\n");
+
+  auto best = npos;
+  auto node = &root_;
+  size_t pos = 0;
+
+  for (;;) {
+    if (line_terminator == std::string::npos || line_terminator < pos) {
+      best = (std::min)(best, node->any_suffix);
+      if (pos < path.size()) {
+        best = (std::min)(best, node->non_empty_suffix);
+      }
+    }
+
+    if (pos == path.size()) {
+      best = (std::min)(best, node->exact);
+      break;
+    }
+
+    const Node *child = nullptr;
+    for (const auto &x : node->children) {
+      if (x->label[0] == path[pos]) {
+        child = x.get();
+        break;
+      }
+    }
+
+    if (!child || path.compare(pos, child->label.size(), child->label)) {
+      break;
+    }
+
+    pos += child->label.size();
+    node = child;
+  }
+
+  return best;
+}
+
+template <typename T>
+inline bool
+RouteTable<T>::PatternRoute::match(const std::string &path) const {
+  size_t pos = 0;
+  for (size_t i = 0; i < groups.size(); i++) {
+    const auto &fragment = fragments[i];
+    if (path.compare(pos, fragment.size(), fragment)) { return false; }
+    pos += fragment.size();
+
+    auto end = pos;
+    while (end < path.size() && in_class(groups[i].chars, path[end])) {
+      end++;
+    }
+    if (end == pos && !groups[i].may_be_empty) { return false; }
+    pos = end;
+  }
+
+  const auto &last = fragments.back();
+  return path.size() - pos == last.size() &&
+         !path.compare(pos, last.size(), last);
+}
+
+template <typename T> inline const T *RouteTable<T>::find(Request &req) const {
+  req.path_params.clear();
+  auto best = find_in_tree(req.path);
+
+  for (const auto &route : pattern_routes_) {
+    if (route.index >= best) { break; }
+    if (!route.fragments.empty() && !route.match(req.path)) { continue; }
+    if (std::regex_match(req.path, req.matches, regexes_[route.index])) {
+      for (size_t i = 0; i < route.param_names.size(); i++) {
+        req.path_params.emplace(route.param_names[i], req.matches[i + 1]);
+      }
+      return &handlers_[route.index];
+    }
+  }
+
+  if (best != npos) {
+    std::regex_match(req.path, req.matches, regexes_[best]);
+    return &handlers_[best];
+  }
+  return nullptr;
+}
+
 } // namespace detail
 
 // HTTP server implementation
@@ -4231,8 +6009,7 @@ inline Server &Server::Get(const char *pattern, Handler handler) {
 
 inline Server &Server::Get(const char *pattern, size_t pattern_len,
                            Handler handler) {
-  get_handlers_.push_back(
-      std::make_pair(std::regex(pattern, pattern_len), std::move(handler)));
+  get_handlers_.add(pattern, pattern_len, std::move(handler), path_params_);
   return *this;
 }
 
@@ -4242,8 +6019,7 @@ inline Server &Server::Post(const char *pattern, Handler handler) {
 
 inline Server &Server::Post(const char *pattern, size_t pattern_len,
                             Handler handler) {
-  post_handlers_.push_back(
-      std::make_pair(std::regex(pattern, pattern_len), std::move(handler)));
+  post_handlers_.add(pattern, pattern_len, std::move(handler), path_params_);
   return *this;
 }
 
@@ -4254,8 +6030,8 @@ inline Server &Server::Post(const char *pattern,
 
 inline Server &Server::Post(const char *pattern, size_t pattern_len,
                             HandlerWithContentReader handler) {
-  post_handlers_for_content_reader_.push_back(
-      std::make_pair(std::regex(pattern, pattern_len), std::move(handler)));
+  post_handlers_for_content_reader_.add(pattern, pattern_len,
+                                        std::move(handler), path_params_);
   return *this;
 }
 
@@ -4265,8 +6041,7 @@ inline Server &Server::Put(const char *pattern, Handler handler) {
 
 inline Server &Server::Put(const char *pattern, size_t pattern_len,
                            Handler handler) {
-  put_handlers_.push_back(
-      std::make_pair(std::regex(pattern, pattern_len), std::move(handler)));
+  put_handlers_.add(pattern, pattern_len, std::move(handler), path_params_);
   return *this;
 }
 
@@ -4277,8 +6052,8 @@ inline Server &Server::Put(const char *pattern,
 
 inline Server &Server::Put(const char *pattern, size_t pattern_len,
                            HandlerWithContentReader handler) {
-  put_handlers_for_content_reader_.push_back(
-      std::make_pair(std::regex(pattern, pattern_len), std::move(handler)));
+  put_handlers_for_content_reader_.add(pattern, pattern_len,
+                                       std::move(handler), path_params_);
   return *this;
 }
 
@@ -4288,8 +6063,7 @@ inline Server &Server::Patch(const char *pattern, Handler handler) {
 
 inline Server &Server::Patch(const char *pattern, size_t pattern_len,
                              Handler handler) {
-  patch_handlers_.push_back(
-      std::make_pair(std::regex(pattern, pattern_len), std::move(handler)));
+  patch_handlers_.add(pattern, pattern_len, std::move(handler), path_params_);
   return *this;
 }
 
@@ -4300,8 +6074,8 @@ inline Server &Server::Patch(const char *pattern,
 
 inline Server &Server::Patch(const char *pattern, size_t pattern_len,
                              HandlerWithContentReader handler) {
-  patch_handlers_for_content_reader_.push_back(
-      std::make_pair(std::regex(pattern, pattern_len), std::move(handler)));
+  patch_handlers_for_content_reader_.add(pattern, pattern_len,
+                                         std::move(handler), path_params_);
   return *this;
 }
 
@@ -4311,8 +6085,7 @@ inline Server &Server::Delete(const char *pattern, Handler handler) {
 
 inline Server &Server::Delete(const char *pattern, size_t pattern_len,
                               Handler handler) {
-  delete_handlers_.push_back(
-      std::make_pair(std::regex(pattern, pattern_len), std::move(handler)));
+  delete_handlers_.add(pattern, pattern_len, std::move(handler), path_params_);
   return *this;
 }
 
@@ -4323,8 +6096,8 @@ inline Server &Server::Delete(const char *pattern,
 
 inline Server &Server::Delete(const char *pattern, size_t pattern_len,
                               HandlerWithContentReader handler) {
-  delete_handlers_for_content_reader_.push_back(
-      std::make_pair(std::regex(pattern, pattern_len), std::move(handler)));
+  delete_handlers_for_content_reader_.add(pattern, pattern_len,
+                                          std::move(handler), path_params_);
   return *this;
 }
 
@@ -4334,8 +6107,7 @@ inline Server &Server::Options(const char *pattern, Handler handler) {
 
 inline Server &Server::Options(const char *pattern, size_t pattern_len,
                                Handler handler) {
-  options_handlers_.push_back(
-      std::make_pair(std::regex(pattern, pattern_len), std::move(handler)));
+  options_handlers_.add(pattern, pattern_len, std::move(handler), path_params_);
   return *this;
 }
 
@@ -4489,11 +6261,31 @@ Server::set_idle_interval(const std::chrono::duration<Rep, Period> &duration) {
   return *this;
 }
 
+inline Server &Server::set_compression_min_length(size_t length) {
+  compression_min_length_ = length;
+  return *this;
+}
+
+inline Server &Server::set_serve_precompressed_files(bool on) {
+  serve_precompressed_files_ = on;
+  return *this;
+}
+
 inline Server &Server::set_payload_max_length(size_t length) {
   payload_max_length_ = length;
   return *this;
 }
 
+inline Server &Server::set_reactor_mode(bool on) {
+  reactor_mode_ = on;
+  return *this;
+}
+
+inline Server &Server::set_path_params(bool on) {
+  path_params_ = on;
+  return *this;
+}
+
 inline bool Server::bind_to_port(const char *host, int port, int socket_flags) {
   if (bind_internal(host, port, socket_flags) < 0) return false;
   return true;
@@ -4520,25 +6312,68 @@ inline void Server::stop() {
 }
 
 inline bool Server::parse_request_line(const char *s, Request &req) {
-  const static std::regex re(
-      "(GET|HEAD|POST|PUT|DELETE|CONNECT|OPTIONS|TRACE|PATCH|PRI) "
-      "(([^? ]+)(?:\\?([^ ]*?))?) (HTTP/1\\.[01])\r\n");
+  static const char *methods[] = {"GET",     "HEAD",    "POST",
+                                  "PUT",     "DELETE",  "CONNECT",
+                                  "OPTIONS", "TRACE",   "PATCH",
+                                  "PRI"};
 
-  std::cmatch m;
-  if (std::regex_match(s, m, re)) {
-    req.version = std::string(m[5]);
-    req.method = std::string(m[1]);
-    req.target = std::string(m[2]);
-    req.path = detail::decode_url(m[3], false);
+  // METHOD SP path[?query] SP HTTP/1.[01] CRLF
+  auto end = s + strlen(s);
+  if (end - s < 2 || end[-2] != '\r' || end[-1] != '\n') { return false; }
+  end -= 2;
+
+  auto method_end = static_cast<const char *>(
+      memchr(s, ' ', static_cast<size_t>(end - s)));
+  if (!method_end) { return false; }
 
-    // Parse query text
-    auto len = std::distance(m[4].first, m[4].second);
-    if (len > 0) { detail::parse_query_text(m[4], req.params); }
+  auto version_beg = method_end + 1;
+  while (version_beg < end && *version_beg != ' ') {
+    version_beg++;
+  }
+  if (version_beg == end) { return false; }
+
+  auto target_beg = method_end + 1;
+  auto target_end = version_beg++;
+
+  auto version_len = static_cast<size_t>(end - version_beg);
+  if (version_len != 8 || strncmp(version_beg, "HTTP/1.", 7) != 0 ||
+      (version_beg[7] != '0' && version_beg[7] != '1')) {
+    return false;
+  }
+
+  auto method_len = static_cast<size_t>(method_end - s);
+  auto known_method = false;
+  for (auto m : methods) {
+    if (strlen(m) == method_len && !strncmp(m, s, method_len)) {
+      known_method = true;
+      break;
+    }
+  }
+  if (!known_method) { return false; }
+
+  auto path_end = target_beg;
+  while (path_end < target_end && *path_end != '?') {
+    path_end++;
+  }
+  if (path_end == target_beg) { return false; }
+
+  req.version.assign(version_beg, version_len);
+  req.method.assign(s, method_len);
+  req.target.assign(target_beg, target_end);
+
+  std::string path(target_beg, path_end);
+  if (path.find('%') != std::string::npos) {
+    path = detail::decode_url(path, false);
+  }
+  req.path = std::move(path);
 
-    return true;
+  // Parse query text
+  if (path_end + 1 < target_end) {
+    detail::parse_query_text(std::string(path_end + 1, target_end),
+                             req.params);
   }
 
-  return false;
+  return true;
 }
 
 inline bool Server::write_response(Stream &strm, bool close_connection,
@@ -4640,15 +6475,15 @@ Server::write_content_with_provider(Stream &strm, const Request &req,
 
   if (res.content_length_ > 0) {
     if (req.ranges.empty()) {
-      return detail::write_content(strm, res.content_provider_, 0,
-                                   res.content_length_, is_shutting_down);
+      return detail::write_content_range(strm, res, 0, res.content_length_,
+                                         is_shutting_down);
     } else if (req.ranges.size() == 1) {
       auto offsets =
           detail::get_range_offset_and_length(req, res.content_length_, 0);
       auto offset = offsets.first;
       auto length = offsets.second;
-      return detail::write_content(strm, res.content_provider_, offset, length,
-                                   is_shutting_down);
+      return detail::write_content_range(strm, res, offset, length,
+                                         is_shutting_down);
     } else {
       return detail::write_multipart_ranges_data(
           strm, req, res, boundary, content_type, is_shutting_down);
@@ -4785,10 +6620,61 @@ inline bool Server::handle_file_request(const Request &req, Response &res,
         if (path.back() == '/') { path += "index.html"; }
 
         if (detail::is_file(path)) {
-          detail::read_file(path, res.body);
           auto type =
               detail::find_content_type(path, file_extension_and_mimetype_map_);
+
+          // Prefer a precompressed sibling that the client can decode.
+          auto file_path = path;
+          const char *content_encoding = nullptr;
+          if (serve_precompressed_files_) {
+            static const char *encodings[][2] = {{"br", ".br"},
+                                                 {"gzip", ".gz"}};
+            const auto &accept = req.get_header_value("Accept-Encoding");
+            // The coding with the highest quality wins, br on a tie.
+            auto quality = 0;
+            for (const auto &e : encodings) {
+              auto q = detail::accept_encoding_quality(accept, e[0]);
+              if (q > quality && detail::is_file(path + e[1])) {
+                file_path = path + e[1];
+                content_encoding = e[0];
+                quality = q;
+              }
+            }
+          }
+
+          // Unless it has to be compressed, the file is opened, not read: HEAD
+          // never touches its data and GET sends only the requested ranges,
+          // with sendfile(2) where possible.
+          auto file = std::make_shared<detail::static_file>(file_path.c_str());
+          if (!file->is_open()) { return false; }
+
           if (type) { res.set_header("Content-Type", type); }
+          if (serve_precompressed_files_) {
+            res.set_header("Vary", "Accept-Encoding");
+          }
+          if (content_encoding) {
+            res.set_header("Content-Encoding", content_encoding);
+          }
+          if (file->size() > 0) {
+            if (!content_encoding && file->size() >= compression_min_length_ &&
+                detail::encoding_type(req, res) != detail::EncodingType::None) {
+              // Compression works on the body, like for any other response.
+              res.body.resize(file->size());
+              if (!file->read(0, &res.body[0], file->size())) { return false; }
+            } else {
+              res.content_length_ = file->size();
+              res.content_provider_ = [file](size_t offset, size_t length,
+                                             DataSink &sink) {
+                std::vector<char> buf(
+                    (std::min)(length, CPPHTTPLIB_SEND_FILE_BUFSIZ));
+                if (!file->read(offset, buf.data(), buf.size())) {
+                  return false;
+                }
+                return sink.write(buf.data(), buf.size());
+              };
+              res.content_file_ = std::move(file);
+            }
+          }
           for (const auto &kv : entry.headers) {
             res.set_header(kv.first.c_str(), kv.second);
           }
@@ -4807,14 +6693,20 @@ inline bool Server::handle_file_request(const Request &req, Response &res,
 inline socket_t
 Server::create_server_socket(const char *host, int port, int socket_flags,
                              SocketOptions socket_options) const {
+  // The reactor accepts connections as fast as they arrive, so let the kernel
+  // queue as many as it allows instead of a thread-pool sized backlog.
+  auto backlog = reactor_mode_ && is_reactor_supported()
+                     ? (std::max)(CPPHTTPLIB_LISTEN_BACKLOG, SOMAXCONN)
+                     : CPPHTTPLIB_LISTEN_BACKLOG;
+
   return detail::create_socket(
       host, port, address_family_, socket_flags, tcp_nodelay_,
       std::move(socket_options),
-      [](socket_t sock, struct addrinfo &ai) -> bool {
+      [backlog](socket_t sock, struct addrinfo &ai) -> bool {
         if (::bind(sock, ai.ai_addr, static_cast<socklen_t>(ai.ai_addrlen))) {
           return false;
         }
-        if (::listen(sock, 5)) { // Listen through 5 channels
+        if (::listen(sock, backlog)) {
           return false;
         }
         return true;
@@ -4847,6 +6739,12 @@ inline int Server::bind_internal(const char *host, int port, int socket_flags) {
 }
 
 inline bool Server::listen_internal() {
+#ifdef __linux__
+  if (reactor_mode_ && is_reactor_supported()) {
+    return listen_internal_with_reactor();
+  }
+#endif
+
   auto ret = true;
   is_running_ = true;
 
@@ -4854,6 +6752,13 @@ inline bool Server::listen_internal() {
     std::unique_ptr<TaskQueue> task_queue(new_task_queue());
 
     while (svr_sock_ != INVALID_SOCKET) {
+      // Rejected connections have to be closed when their peers are done, so
+      // accept() mustn't block for long while any of them is left.
+      if (lingering_sockets_.poll() &&
+          detail::select_read(svr_sock_, 0, 100000) == 0) {
+        continue;
+      }
+
 #ifndef _WIN32
       if (idle_interval_sec_ > 0 || idle_interval_usec_ > 0) {
 #endif
@@ -4884,33 +6789,173 @@ inline bool Server::listen_internal() {
         break;
       }
 
-      {
-        timeval tv;
-        tv.tv_sec = static_cast<long>(read_timeout_sec_);
-        tv.tv_usec = static_cast<decltype(tv.tv_usec)>(read_timeout_usec_);
-        setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, (char *)&tv, sizeof(tv));
-      }
-      {
-        timeval tv;
-        tv.tv_sec = static_cast<long>(write_timeout_sec_);
-        tv.tv_usec = static_cast<decltype(tv.tv_usec)>(write_timeout_usec_);
-        setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, (char *)&tv, sizeof(tv));
-      }
+      set_socket_timeouts(sock);
 
 #if __cplusplus > 201703L
-      task_queue->enqueue([=, this]() { process_and_close_socket(sock); });
+      task_queue->enqueue_or_reject(
+          [=, this]() { process_and_close_socket(sock); },
+          [=, this]() { reject_and_close_socket(sock); });
 #else
-      task_queue->enqueue([=]() { process_and_close_socket(sock); });
+      task_queue->enqueue_or_reject(
+          [=]() { process_and_close_socket(sock); },
+          [=]() { reject_and_close_socket(sock); });
 #endif
     }
 
     task_queue->shutdown();
   }
 
+  lingering_sockets_.close_all();
+  is_running_ = false;
+  return ret;
+}
+
+inline bool Server::is_reactor_supported() const { return true; }
+
+inline void Server::set_socket_timeouts(socket_t sock) const {
+  {
+    timeval tv;
+    tv.tv_sec = static_cast<long>(read_timeout_sec_);
+    tv.tv_usec = static_cast<decltype(tv.tv_usec)>(read_timeout_usec_);
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, (char *)&tv, sizeof(tv));
+  }
+  {
+    timeval tv;
+    tv.tv_sec = static_cast<long>(write_timeout_sec_);
+    tv.tv_usec = static_cast<decltype(tv.tv_usec)>(write_timeout_usec_);
+    setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, (char *)&tv, sizeof(tv));
+  }
+}
+
+#ifdef __linux__
+inline bool Server::listen_internal_with_reactor() {
+  auto ret = true;
+  is_running_ = true;
+
+  {
+    std::unique_ptr<TaskQueue> task_queue(new_task_queue());
+    detail::EpollReactor reactor;
+
+    socket_t svr_sock = svr_sock_;
+    if (!reactor.is_valid() || !reactor.add_listener(svr_sock)) {
+      ret = false;
+    } else {
+      detail::set_nonblocking(svr_sock, true);
+    }
+
+    auto has_idle_interval = idle_interval_sec_ > 0 || idle_interval_usec_ > 0;
+    // Without an idle interval the timeout only bounds how long it takes to
+    // notice `stop()` and to close expired keep-alive connections.
+    auto timeout_msec =
+        has_idle_interval
+            ? static_cast<int>(idle_interval_sec_ * 1000 +
+                               idle_interval_usec_ / 1000)
+            : 100;
+
+    while (ret && svr_sock_ != INVALID_SOCKET) {
+      auto n = reactor.wait(timeout_msec, [&](socket_t sock) {
+        if (sock == svr_sock) {
+          for (;;) {
+            socket_t conn_sock = accept(svr_sock, nullptr, nullptr);
+            if (conn_sock == INVALID_SOCKET) {
+              if (errno == EAGAIN || errno == EWOULDBLOCK) { break; }
+              if (errno == EMFILE) {
+                // The per-process limit of open file descriptors has been
+                // reached. Try to accept new connections after a short sleep.
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                break;
+              }
+              if (svr_sock_ != INVALID_SOCKET) {
+                detail::close_socket(svr_sock_);
+                ret = false;
+              } else {
+                ; // The server socket was closed by user.
+              }
+              break;
+            }
+
+            set_socket_timeouts(conn_sock);
+            reactor.add(conn_sock, keep_alive_max_count_);
+          }
+          return;
+        }
+
+        auto conn = reactor.acquire(sock);
+        if (!conn) { return; }
+
+        auto state = detail::read_request_header(*conn);
+        if (state < 0) {
+          reactor.remove(conn);
+        } else if (state == 0) {
+          reactor.release(conn);
+        } else {
+          task_queue->enqueue_or_reject(
+              [this, &reactor, conn]() {
+                process_reactor_connection(reactor, conn);
+              },
+              [this, &reactor, conn]() {
+                write_service_unavailable(conn->sock);
+                reactor.detach(conn);
+                lingering_sockets_.add(conn->sock);
+              });
+        }
+      });
+
+      if (n < 0) {
+        ret = false;
+        break;
+      }
+      if (n == 0 && has_idle_interval) { task_queue->on_idle(); }
+
+      reactor.close_idle_connections(keep_alive_timeout_sec_);
+      lingering_sockets_.poll();
+    }
+
+    // Workers may still hand connections back to the reactor, so it has to
+    // outlive the task queue.
+    task_queue->shutdown();
+  }
+
+  lingering_sockets_.close_all();
   is_running_ = false;
   return ret;
 }
 
+inline void Server::process_reactor_connection(
+    detail::EpollReactor &reactor,
+    const std::shared_ptr<detail::ReactorConnection> &conn) {
+  for (;;) {
+    auto close_connection = conn->keep_alive_count <= 1;
+    auto connection_closed = false;
+    auto ret = false;
+    {
+      detail::ReactorSocketStream strm(*conn, read_timeout_sec_,
+                                       read_timeout_usec_, write_timeout_sec_,
+                                       write_timeout_usec_);
+      ret = process_request(strm, close_connection, connection_closed, nullptr);
+    }
+    conn->keep_alive_count--;
+
+    if (!ret || close_connection || connection_closed ||
+        svr_sock_ == INVALID_SOCKET) {
+      reactor.remove(conn);
+      return;
+    }
+
+    // A pipelined request that is already buffered won't raise another event.
+    if (!detail::has_complete_header(conn->buffer, 0)) {
+      if (conn->peer_closed) {
+        reactor.remove(conn);
+        return;
+      }
+      break;
+    }
+  }
+
+  reactor.release(conn);
+}
+#endif
+
 inline bool Server::routing(Request &req, Response &res, Stream &strm) {
   if (pre_routing_handler_ &&
       pre_routing_handler_(req, res) == HandlerResponse::Handled) {
@@ -4990,14 +7035,10 @@ inline bool Server::routing(Request &req, Response &res, Stream &strm) {
 
 inline bool Server::dispatch_request(Request &req, Response &res,
                                      const Handlers &handlers) {
-  for (const auto &x : handlers) {
-    const auto &pattern = x.first;
-    const auto &handler = x.second;
-
-    if (std::regex_match(req.path, req.matches, pattern)) {
-      handler(req, res);
-      return true;
-    }
+  auto handler = handlers.find(req);
+  if (handler) {
+    (*handler)(req, res);
+    return true;
   }
   return false;
 }
@@ -5021,7 +7062,16 @@ inline void Server::apply_ranges(const Request &req, Response &res,
   auto type = detail::encoding_type(req, res);
 
   if (res.body.empty()) {
-    if (res.content_length_ > 0) {
+    if (res.content_length_ > 0 &&
+        !detail::is_satisfiable_ranges(req, res.content_length_)) {
+      res.set_header("Content-Range",
+                     "bytes */" + std::to_string(res.content_length_));
+      res.set_header("Content-Length", "0");
+      res.content_length_ = 0;
+      res.content_provider_ = nullptr;
+      res.content_file_.reset();
+      res.status = 416;
+    } else if (res.content_length_ > 0) {
       size_t length = 0;
       if (req.ranges.empty()) {
         length = res.content_length_;
@@ -5078,7 +7128,8 @@ inline void Server::apply_ranges(const Request &req, Response &res,
       }
     }
 
-    if (type != detail::EncodingType::None) {
+    if (type != detail::EncodingType::None &&
+        res.body.size() >= compression_min_length_) {
       std::unique_ptr<detail::compressor> compressor;
       std::string content_encoding;
 
@@ -5115,14 +7166,10 @@ inline void Server::apply_ranges(const Request &req, Response &res,
 inline bool Server::dispatch_request_for_content_reader(
     Request &req, Response &res, ContentReader content_reader,
     const HandlersForContentReader &handlers) {
-  for (const auto &x : handlers) {
-    const auto &pattern = x.first;
-    const auto &handler = x.second;
-
-    if (std::regex_match(req.path, req.matches, pattern)) {
-      handler(req, res, content_reader);
-      return true;
-    }
+  auto handler = handlers.find(req);
+  if (handler) {
+    (*handler)(req, res, content_reader);
+    return true;
   }
   return false;
 }
@@ -5154,7 +7201,10 @@ Server::process_request(Stream &strm, bool close_connection,
 #else
 #ifndef CPPHTTPLIB_USE_POLL
   // Socket file descriptor exceeded FD_SETSIZE...
-  if (strm.socket() >= FD_SETSIZE) {
+  // (Reactor connections are blocking sockets with SO_RCVTIMEO/SO_SNDTIMEO,
+  // so they don't depend on select().)
+  if (!(reactor_mode_ && is_reactor_supported()) &&
+      strm.socket() >= FD_SETSIZE) {
     Headers dummy;
     detail::read_headers(strm, dummy);
     res.status = 500;
@@ -5258,6 +7308,23 @@ inline bool Server::process_and_close_socket(socket_t sock) {
   return ret;
 }
 
+inline void Server::reject_and_close_socket(socket_t sock) {
+  write_service_unavailable(sock);
+  lingering_sockets_.add(sock);
+}
+
+// NOTE: Sent without reading the request, so the connection can't be reused
+// and is closed through lingering_sockets_.
+inline void Server::write_service_unavailable(socket_t sock) const {
+  static const char response[] = "HTTP/1.1 503 Service Unavailable\r\n"
+                                 "Content-Length: 0\r\n"
+                                 "Connection: close\r\n\r\n";
+
+  detail::SocketStream strm(sock, read_timeout_sec_, read_timeout_usec_,
+                            write_timeout_sec_, write_timeout_usec_);
+  strm.write(response, sizeof(response) - 1);
+}
+
 // HTTP client implementation
 inline ClientImpl::ClientImpl(const std::string &host)
     : ClientImpl(host, 80, std::string(), std::string()) {}
@@ -5274,6 +7341,8 @@ inline ClientImpl::ClientImpl(const std::string &host, int port,
       client_cert_path_(client_cert_path), client_key_path_(client_key_path) {}
 
 inline ClientImpl::~ClientImpl() {
+  close_idle_pooled_sockets();
+
   std::lock_guard<std::mutex> guard(socket_mutex_);
   shutdown_socket(socket_);
   close_socket(socket_);
@@ -5303,6 +7372,7 @@ inline void ClientImpl::copy_settings(const ClientImpl &rhs) {
   tcp_nodelay_ = rhs.tcp_nodelay_;
   socket_options_ = rhs.socket_options_;
   compress_ = rhs.compress_;
+  compression_min_length_ = rhs.compression_min_length_;
   decompress_ = rhs.decompress_;
   interface_ = rhs.interface_;
   proxy_host_ = rhs.proxy_host_;
@@ -5408,6 +7478,14 @@ inline bool ClientImpl::read_response_line(Stream &strm, const Request &req,
 }
 
 inline bool ClientImpl::send(Request &req, Response &res, Error &error) {
+  for (const auto &header : default_headers_) {
+    if (req.headers.find(header.first) == req.headers.end()) {
+      req.headers.insert(header);
+    }
+  }
+
+  if (pool_max_size_ > 0) { return send_with_pool(req, res, error); }
+
   std::lock_guard<std::recursive_mutex> request_mutex_guard(request_mutex_);
 
   {
@@ -5432,22 +7510,8 @@ inline bool ClientImpl::send(Request &req, Response &res, Error &error) {
     }
 
     if (!is_alive) {
-      if (!create_and_connect_socket(socket_, error)) { return false; }
-
-#ifdef CPPHTTPLIB_OPENSSL_SUPPORT
-      // TODO: refactoring
-      if (is_ssl()) {
-        auto &scli = static_cast<SSLClient &>(*this);
-        if (!proxy_host_.empty() && proxy_port_ != -1) {
-          bool success = false;
-          if (!scli.connect_with_proxy(socket_, res, success, error)) {
-            return success;
-          }
-        }
-
-        if (!scli.initialize_ssl(socket_, error)) { return false; }
-      }
-#endif
+      auto ret = false;
+      if (!connect_socket(socket_, res, error, ret)) { return ret; }
     }
 
     // Mark the current socket as being in use so that it cannot be closed by
@@ -5460,12 +7524,6 @@ inline bool ClientImpl::send(Request &req, Response &res, Error &error) {
     socket_requests_are_from_thread_ = std::this_thread::get_id();
   }
 
-  for (const auto &header : default_headers_) {
-    if (req.headers.find(header.first) == req.headers.end()) {
-      req.headers.insert(header);
-    }
-  }
-
   auto close_connection = !keep_alive_;
   auto ret = process_socket(socket_, [&](Stream &strm) {
     return handle_request(strm, req, res, close_connection, error);
@@ -5500,6 +7558,243 @@ inline Result ClientImpl::send(const Request &req) {
   return send_(std::move(req2));
 }
 
+inline bool ClientImpl::connect_socket(Socket &socket, Response &res,
+                                       Error &error, bool &ret) {
+  ret = false;
+  if (!create_and_connect_socket(socket, error)) { return false; }
+
+#ifdef CPPHTTPLIB_OPENSSL_SUPPORT
+  // TODO: refactoring
+  if (is_ssl()) {
+    auto &scli = static_cast<SSLClient &>(*this);
+    if (!proxy_host_.empty() && proxy_port_ != -1) {
+      bool success = false;
+      if (!scli.connect_with_proxy(socket, res, success, error)) {
+        ret = success;
+        return false;
+      }
+    }
+
+    if (!scli.initialize_ssl(socket, error)) { return false; }
+  }
+#else
+  (void)res;
+#endif
+
+  return true;
+}
+
+inline bool ClientImpl::send_with_pool(Request &req, Response &res,
+                                       Error &error) {
+  for (;;) {
+    Socket socket;
+    auto reused = false;
+    auto ret = false;
+    if (!acquire_pooled_socket(socket, reused, res, error, ret)) {
+      return ret;
+    }
+
+    ret = process_socket(socket, [&](Stream &strm) {
+      return handle_request(strm, req, res, false, error);
+    });
+
+    // The server may have closed an idle connection just as we reused it.
+    // GET and HEAD requests that got no response at all are sent again.
+    auto retry = !ret && reused && res.status == -1 &&
+                 (error == Error::Read || error == Error::Write) &&
+                 (req.method == "GET" || req.method == "HEAD");
+
+    release_pooled_socket(socket, ret);
+
+    if (!retry) {
+      if (!ret && error == Error::Success) { error = Error::Unknown; }
+      return ret;
+    }
+    error = Error::Success;
+  }
+}
+
+inline bool ClientImpl::acquire_pooled_socket(Socket &socket, bool &reused,
+                                              Response &res, Error &error,
+                                              bool &ret) {
+  {
+    std::unique_lock<std::mutex> lock(pool_mutex_);
+    auto &held = pool_holders_[std::this_thread::get_id()];
+    auto start = std::chrono::steady_clock::now();
+    auto waited = false;
+
+    for (;;) {
+      while (!pool_idle_.empty()) {
+        socket = pool_idle_.back();
+        pool_idle_.pop_back();
+
+        // An idle connection only becomes readable when the server closes it.
+        if (detail::select_read(socket.sock, 0, 0) > 0) {
+          shutdown_ssl(socket, false);
+          shutdown_socket(socket);
+          close_socket(socket);
+          pool_stats_.stale_closes++;
+          pool_stats_.open--;
+          continue;
+        }
+
+        reused = true;
+        pool_stats_.hits++;
+        break;
+      }
+      if (reused) { break; }
+
+      // A thread that already holds a connection (a redirect or digest auth
+      // retry) must not wait for itself, so it may exceed the limit.
+      if (pool_stats_.open < pool_max_size_ || held > 0) {
+        pool_stats_.open++;
+        pool_stats_.connects++;
+        break;
+      }
+
+      if (!waited) {
+        waited = true;
+        pool_stats_.waits++;
+      }
+      pool_cond_.wait(lock);
+    }
+
+    if (waited) {
+      auto d = std::chrono::steady_clock::now() - start;
+      pool_stats_.wait_usec += static_cast<uint64_t>(
+          std::chrono::duration_cast<std::chrono::microseconds>(d).count());
+    }
+
+    held++;
+    if (reused) {
+      pool_in_use_.insert(socket.sock);
+      return true;
+    }
+  }
+
+  if (connect_socket(socket, res, error, ret)) {
+    std::lock_guard<std::mutex> guard(pool_mutex_);
+    pool_in_use_.insert(socket.sock);
+    return true;
+  }
+
+  std::lock_guard<std::mutex> guard(pool_mutex_);
+  shutdown_ssl(socket, false);
+  shutdown_socket(socket);
+  close_socket(socket);
+  pool_stats_.open--;
+  auto it = pool_holders_.find(std::this_thread::get_id());
+  if (--it->second == 0) { pool_holders_.erase(it); }
+  pool_cond_.notify_one();
+  return false;
+}
+
+inline void ClientImpl::release_pooled_socket(Socket &socket, bool reuse) {
+  std::lock_guard<std::mutex> guard(pool_mutex_);
+
+  auto it = pool_holders_.find(std::this_thread::get_id());
+  if (--it->second == 0) { pool_holders_.erase(it); }
+
+  pool_in_use_.erase(socket.sock);
+  if (pool_closing_.erase(socket.sock)) { reuse = false; }
+
+  if (reuse && pool_stats_.open <= pool_max_size_) {
+    pool_idle_.push_back(socket);
+  } else {
+    shutdown_ssl(socket, reuse);
+    shutdown_socket(socket);
+    close_socket(socket);
+    pool_stats_.open--;
+  }
+  pool_cond_.notify_one();
+}
+
+inline void ClientImpl::close_idle_pooled_sockets() {
+  std::lock_guard<std::mutex> guard(pool_mutex_);
+  for (auto &socket : pool_idle_) {
+    shutdown_ssl(socket, true);
+    shutdown_socket(socket);
+    close_socket(socket);
+    pool_stats_.open--;
+  }
+  pool_idle_.clear();
+}
+
+inline std::vector<Result>
+ClientImpl::send_pipelined(const std::vector<Request> &requests) {
+  std::vector<Result> results;
+  results.reserve(requests.size());
+
+  auto pipelined = pool_max_size_ > 0;
+  for (const auto &req : requests) {
+    if (req.method != "GET" && req.method != "HEAD") { pipelined = false; }
+  }
+
+  if (!pipelined) {
+    for (const auto &req : requests) {
+      results.push_back(send(req));
+    }
+    return results;
+  }
+
+  // Requests go out in batches so that neither side can block on a full
+  // socket buffer while the other one is still writing.
+  for (size_t i = 0; i < requests.size();) {
+    auto n = (std::min)(static_cast<size_t>(CPPHTTPLIB_CLIENT_PIPELINE_DEPTH),
+                        requests.size() - i);
+    std::vector<Request> batch(requests.begin() + static_cast<ssize_t>(i),
+                               requests.begin() + static_cast<ssize_t>(i + n));
+    std::vector<std::unique_ptr<Response>> responses;
+    std::vector<Error> errors(n, Error::Success);
+
+    for (auto &req : batch) {
+      for (const auto &header : default_headers_) {
+        if (req.headers.find(header.first) == req.headers.end()) {
+          req.headers.insert(header);
+        }
+      }
+    }
+
+    Socket socket;
+    auto reused = false;
+    auto ret = false;
+    Response dummy;
+    if (acquire_pooled_socket(socket, reused, dummy, errors[0], ret)) {
+      ret = process_socket(socket, [&](Stream &strm) {
+        for (size_t k = 0; k < n; k++) {
+          if (!write_request(strm, batch[k], false, errors[k])) {
+            return false;
+          }
+        }
+        for (size_t k = 0; k < n; k++) {
+          auto res = detail::make_unique<Response>();
+          if (!read_response(strm, batch[k], *res, errors[k])) {
+            return false;
+          }
+          responses.push_back(std::move(res));
+        }
+        return true;
+      });
+      release_pooled_socket(socket, ret);
+    }
+
+    for (size_t k = 0; k < n; k++) {
+      if (k < responses.size()) {
+        results.emplace_back(std::move(responses[k]), Error::Success,
+                             std::move(batch[k].headers));
+      } else {
+        auto error = errors[k];
+        if (error == Error::Success) { error = errors[0]; }
+        if (error == Error::Success) { error = Error::Unknown; }
+        results.emplace_back(nullptr, error, std::move(batch[k].headers));
+      }
+    }
+    i += n;
+  }
+
+  return results;
+}
+
 inline Result ClientImpl::send_(Request &&req) {
   auto res = detail::make_unique<Response>();
   auto error = Error::Success;
@@ -5770,11 +8065,10 @@ inline std::unique_ptr<Response> ClientImpl::send_with_content_provider(
   if (content_type) { req.headers.emplace("Content-Type", content_type); }
 
 #ifdef CPPHTTPLIB_ZLIB_SUPPORT
-  if (compress_) { req.headers.emplace("Content-Encoding", "gzip"); }
-#endif
+  if (compress_ && !content_provider_without_length &&
+      content_length >= compression_min_length_) {
+    req.headers.emplace("Content-Encoding", "gzip");
 
-#ifdef CPPHTTPLIB_ZLIB_SUPPORT
-  if (compress_ && !content_provider_without_length) {
     // TODO: Brotli support
     detail::gzip_compressor compressor;
 
@@ -5870,6 +8164,11 @@ inline bool ClientImpl::process_request(Stream &strm, Request &req,
   // Send request
   if (!write_request(strm, req, close_connection, error)) { return false; }
 
+  return read_response(strm, req, res, error);
+}
+
+inline bool ClientImpl::read_response(Stream &strm, Request &req,
+                                      Response &res, Error &error) {
   // Receive response and headers
   if (!read_response_line(strm, req, res) ||
       !detail::read_headers(strm, res.headers)) {
@@ -5935,10 +8234,16 @@ inline bool ClientImpl::process_request(Stream &strm, Request &req,
     // mutex during the process. It would be a bug to call it from a different
     // thread since it's a thread-safety issue to do these things to the socket
     // if another thread is using the socket.
-    std::lock_guard<std::mutex> guard(socket_mutex_);
-    shutdown_ssl(socket_, true);
-    shutdown_socket(socket_);
-    close_socket(socket_);
+    if (pool_max_size_ > 0) {
+      // Pooled sockets are closed when they are handed back.
+      std::lock_guard<std::mutex> guard(pool_mutex_);
+      pool_closing_.insert(strm.socket());
+    } else {
+      std::lock_guard<std::mutex> guard(socket_mutex_);
+      shutdown_ssl(socket_, true);
+      shutdown_socket(socket_);
+      close_socket(socket_);
+    }
   }
 
   // Log
@@ -6383,6 +8688,17 @@ inline size_t ClientImpl::is_socket_open() const {
 }
 
 inline void ClientImpl::stop() {
+  {
+    // Pooled connections in use are shut down like socket_ below, and closed
+    // when they are handed back.
+    std::lock_guard<std::mutex> guard(pool_mutex_);
+    for (auto sock : pool_in_use_) {
+      detail::shutdown_socket(sock);
+      pool_closing_.insert(sock);
+    }
+  }
+  close_idle_pooled_sockets();
+
   std::lock_guard<std::mutex> guard(socket_mutex_);
 
   // If there is anything ongoing right now, the ONLY thread-safe thing we can
@@ -6462,6 +8778,18 @@ inline void ClientImpl::set_digest_auth(const char *username,
 
 inline void ClientImpl::set_keep_alive(bool on) { keep_alive_ = on; }
 
+inline void ClientImpl::set_connection_pool_size(size_t max_connections) {
+  pool_max_size_ = max_connections;
+  if (max_connections == 0) { close_idle_pooled_sockets(); }
+}
+
+inline ConnectionPoolStats ClientImpl::get_connection_pool_stats() const {
+  std::lock_guard<std::mutex> guard(pool_mutex_);
+  auto stats = pool_stats_;
+  stats.idle = pool_idle_.size();
+  return stats;
+}
+
 inline void ClientImpl::set_follow_location(bool on) { follow_location_ = on; }
 
 inline void ClientImpl::set_url_encode(bool on) { url_encode_ = on; }
@@ -6482,6 +8810,10 @@ inline void ClientImpl::set_socket_options(SocketOptions socket_options) {
 
 inline void ClientImpl::set_compress(bool on) { compress_ = on; }
 
+inline void ClientImpl::set_compression_min_length(size_t length) {
+  compression_min_length_ = length;
+}
+
 inline void ClientImpl::set_decompress(bool on) { decompress_ = on; }
 
 inline void ClientImpl::set_interface(const char *intf) { interface_ = intf; }
@@ -6597,13 +8929,10 @@ process_server_socket_ssl(SSL *ssl, socket_t sock, size_t keep_alive_max_count,
                           time_t read_timeout_sec, time_t read_timeout_usec,
                           time_t write_timeout_sec, time_t write_timeout_usec,
                           T callback) {
-  return process_server_socket_core(
-      sock, keep_alive_max_count, keep_alive_timeout_sec,
-      [&](bool close_connection, bool &connection_closed) {
-        SSLSocketStream strm(sock, ssl, read_timeout_sec, read_timeout_usec,
-                             write_timeout_sec, write_timeout_usec);
-        return callback(strm, close_connection, connection_closed);
-      });
+  SSLSocketStream strm(sock, ssl, read_timeout_sec, read_timeout_usec,
+                       write_timeout_sec, write_timeout_usec);
+  return process_server_socket_core(strm, keep_alive_max_count,
+                                    keep_alive_timeout_sec, callback);
 }
 
 template <typename T>
@@ -6811,6 +9140,17 @@ inline SSLServer::~SSLServer() {
 
 inline bool SSLServer::is_valid() const { return ctx_; }
 
+// TLS records can't be pre-read by the reactor without the SSL session, so
+// SSL servers always use the thread-per-connection loop.
+inline bool SSLServer::is_reactor_supported() const { return false; }
+
+// Answering with 503 would take a full handshake, which is exactly the work an
+// overloaded server should avoid, so rejected TLS connections are just closed.
+inline void SSLServer::reject_and_close_socket(socket_t sock) {
+  detail::shutdown_socket(sock);
+  detail::close_socket(sock);
+}
+
 inline bool SSLServer::process_and_close_socket(socket_t sock) {
   auto ssl = detail::ssl_new(
       sock, ctx_, ctx_mutex_,
@@ -6890,6 +9230,8 @@ inline SSLClient::SSLClient(const std::string &host, int port,
 }
 
 inline SSLClient::~SSLClient() {
+  // Pooled connections need SSLClient::shutdown_ssl, too.
+  close_idle_pooled_sockets();
   if (ctx_) { SSL_CTX_free(ctx_); }
   // Make sure to shut down SSL since shutdown_ssl will resolve to the
   // base function rather than the derived function once we get to the
@@ -7541,6 +9883,11 @@ inline bool Client::send(Request &req, Response &res, Error &error) {
 
 inline Result Client::send(const Request &req) { return cli_->send(req); }
 
+inline std::vector<Result>
+Client::send_pipelined(const std::vector<Request> &requests) {
+  return cli_->send_pipelined(requests);
+}
+
 inline size_t Client::is_socket_open() const { return cli_->is_socket_open(); }
 
 inline void Client::stop() { cli_->stop(); }
@@ -7603,6 +9950,14 @@ inline void Client::set_digest_auth(const char *username,
 #endif
 
 inline void Client::set_keep_alive(bool on) { cli_->set_keep_alive(on); }
+
+inline void Client::set_connection_pool_size(size_t max_connections) {
+  cli_->set_connection_pool_size(max_connections);
+}
+
+inline ConnectionPoolStats Client::get_connection_pool_stats() const {
+  return cli_->get_connection_pool_stats();
+}
 inline void Client::set_follow_location(bool on) {
   cli_->set_follow_location(on);
 }
@@ -7611,6 +9966,10 @@ inline void Client::set_url_encode(bool on) { cli_->set_url_encode(on); }
 
 inline void Client::set_compress(bool on) { cli_->set_compress(on); }
 
+inline void Client::set_compression_min_length(size_t length) {
+  cli_->set_compression_min_length(length);
+}
+
 inline void Client::set_decompress(bool on) { cli_->set_decompress(on); }
 
 inline void Client::set_interface(const char *intf) {
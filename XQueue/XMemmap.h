@@ -26,6 +26,41 @@ to maintain a single distribution point for the source code.
 #ifndef XMEMMAP_H
 #define XMEMMAP_H
 
+#ifndef _WIN32
+///////////////////////////////////////////////////////////////////////////////
+// POSIX build - named memory is a shm_open() object (see XMemmapPosix.cpp),
+// and the few Win32 types used by the XQueue headers are mapped to their
+// native equivalents.  There is no stdafx.h / windows.h here.
+#include <assert.h>
+#include <stdint.h>
+#include <string.h>
+
+typedef int             BOOL;
+typedef uint8_t         BYTE;
+typedef uint32_t        DWORD;
+typedef int32_t         LONG;
+typedef BYTE *          LPBYTE;
+typedef void *          LPVOID;
+typedef void *          HANDLE;
+typedef void *          HWND;
+typedef char            TCHAR;
+typedef TCHAR *         LPTSTR;
+typedef const TCHAR *   LPCTSTR;
+typedef void *          LPSECURITY_ATTRIBUTES;
+
+#ifndef TRUE
+#define TRUE            1
+#define FALSE           0
+#endif
+#define INFINITE        0xFFFFFFFF
+#define _MAX_PATH       260
+#define MAX_PATH        _MAX_PATH
+#define _T(x)           x
+#define _ASSERTE(expr)  assert(expr)
+#define ZeroMemory(p, n) memset((p), 0, (n))
+#define INVALID_HANDLE_VALUE ((HANDLE)(intptr_t)-1)
+#endif // _WIN32
+
 
 
 /////////////////////////// Classes /////////////////////////////////
@@ -78,6 +113,11 @@ protected:
                               BOOL    bNamed);
     //CString CreateMutexName() const;
 
+#ifndef _WIN32
+    int     m_nFd;                  // shm_open() or open() descriptor
+    BOOL    m_bCreated;             // TRUE = MapMemory() created the shm
+                                    // object, so UnMap() unlinks it
+#endif
     HANDLE  m_hFile;
     HANDLE  m_hMapping;
     BOOL    m_bReadOnly;
@@ -0,0 +1,304 @@
+/*
+Module : XMEMMAPPOSIX.CPP
+Purpose: POSIX implementation of CXMemMapFile.  Named memory is a shm_open()
+         object and files are mapped with mmap(), so the same interface that
+         XMemmap.cpp provides on Windows is available to CXQueue on Linux
+         and other POSIX systems.  Build this file instead of XMemmap.cpp
+         on those platforms.
+
+Copyright (c) 1997 - 2003 by PJ Naughter.  (Web: www.naughter.com, Email: pjna@naughter.com)
+
+All rights reserved.
+
+Copyright / Usage Details:
+
+You are allowed to include the source code in any product (commercial, shareware, freeware or otherwise)
+when your product is released in binary form. You are allowed to modify the source code in any way you want
+except you cannot modify the copyright details at the top of each module. If you want to distribute source
+code with your application, then you are only allowed to distribute versions released by the author. This is
+to maintain a single distribution point for the source code.
+
+*/
+
+#ifndef _WIN32
+
+/////////////////////////////////  Includes  / Defines ////////////////////////
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "XMemmap.h"
+
+#define XMM_MAPPING_FILENAME    _T("_MapFile")
+
+///////////////////////////////// Implementation //////////////////////////////
+
+CXMemMapFile::CXMemMapFile()
+{
+    //Initialise variables to sane values
+    m_nFd         = -1;
+    m_bCreated    = FALSE;
+    m_hFile       = INVALID_HANDLE_VALUE;
+    m_hMapping    = NULL;
+    m_bReadOnly   = TRUE;
+    m_bAppendNull = FALSE;
+    m_lpData      = NULL;
+    m_bOpen       = FALSE;
+    m_nLength     = 0;
+    m_szMappingName[0] = _T('\0');
+}
+
+CXMemMapFile::~CXMemMapFile()
+{
+    UnMap();
+}
+
+BOOL CXMemMapFile::MapFile(LPCTSTR lpszFilename,
+                           BOOL bReadOnly,
+                           DWORD /*dwShareMode*/,
+                           BOOL bAppendNull,
+                           BOOL bNamed,
+                           BOOL /*bGrowable*/,
+                           DWORD dwStartOffset,
+                           DWORD dwNumberOfBytesToMap,
+                           LPSECURITY_ATTRIBUTES lpSecurityAttributes)
+{
+    m_bReadOnly   = bReadOnly;
+    m_bAppendNull = bAppendNull;
+
+    //Open the real file on the file system
+    m_nFd = open(lpszFilename, m_bReadOnly ? O_RDONLY : O_RDWR);
+    if (m_nFd < 0) {
+        UnMap();
+        return FALSE;
+    }
+
+    struct stat st;
+    if (fstat(m_nFd, &st) != 0 || st.st_size == 0 || st.st_size > 0xFFFFFFFF) {
+        UnMap();
+        return FALSE;
+    }
+
+    //Now work out the size of the mapping we will be performing
+    if (dwNumberOfBytesToMap) {
+        m_nLength = dwNumberOfBytesToMap;
+    } else {
+        m_nLength = (DWORD)st.st_size;
+    }
+
+    CreateMappingName(lpszFilename, m_szMappingName, sizeof(m_szMappingName)/sizeof(TCHAR), bNamed);
+
+    return MapHandle(INVALID_HANDLE_VALUE, lpSecurityAttributes, dwStartOffset);
+}
+
+BOOL CXMemMapFile::MapMemory(LPCTSTR lpszName,
+                             DWORD  nBytes,
+                             BOOL bReadOnly,
+                             LPSECURITY_ATTRIBUTES lpSecurityAttributes)
+{
+    m_nLength     = nBytes;
+    m_bReadOnly   = bReadOnly;
+    m_bAppendNull = FALSE;
+    if (CreateMappingName(lpszName, m_szMappingName, sizeof(m_szMappingName)/sizeof(TCHAR), TRUE) == 0) {
+        return FALSE;
+    }
+
+    // like CreateFileMapping(), this opens the object if it already exists;
+    // any previous contents are discarded by the ftruncate() calls below
+    m_nFd = shm_open(m_szMappingName, O_RDWR | O_CREAT, 0666);
+    if (m_nFd < 0) {
+        UnMap();
+        return FALSE;
+    }
+    m_bCreated = TRUE;
+
+    // the umask may have stripped the permissions other processes need
+    fchmod(m_nFd, 0666);
+
+    if (ftruncate(m_nFd, 0) != 0 || ftruncate(m_nFd, m_nLength) != 0) {
+        UnMap();
+        return FALSE;
+    }
+
+    return MapHandle(INVALID_HANDLE_VALUE, lpSecurityAttributes, 0);
+}
+
+BOOL CXMemMapFile::MapExistingMemory(LPCTSTR lpszName, DWORD dwBytes, BOOL bReadOnly)
+{
+    m_nLength = dwBytes;
+    m_bReadOnly = bReadOnly;
+
+    if (CreateMappingName(lpszName, m_szMappingName, sizeof(m_szMappingName)/sizeof(TCHAR), TRUE) == 0) {
+        return FALSE;
+    }
+
+    m_nFd = shm_open(m_szMappingName, m_bReadOnly ? O_RDONLY : O_RDWR, 0);
+    if (m_nFd < 0) {
+        UnMap();
+        return FALSE;
+    }
+
+    // a length of 0 maps the whole object, as MapViewOfFile() does
+    if (m_nLength == 0) {
+        struct stat st;
+        if (fstat(m_nFd, &st) != 0 || st.st_size == 0 || st.st_size > 0xFFFFFFFF) {
+            UnMap();
+            return FALSE;
+        }
+        m_nLength = (DWORD)st.st_size;
+    }
+
+    return MapHandle(INVALID_HANDLE_VALUE, NULL, 0);
+}
+
+BOOL CXMemMapFile::MapHandle(HANDLE /*hHandle*/,
+                             LPSECURITY_ATTRIBUTES /*lpSecurityAttributes*/,
+                             DWORD dwStartOffset)
+{
+    //work out the length of the mapping to create
+    size_t nLength = m_nLength;
+    if (m_bAppendNull) {
+        nLength += 2;
+    }
+
+    int prot = m_bReadOnly ? PROT_READ : (PROT_READ | PROT_WRITE);
+    int flags = MAP_SHARED;
+    if (m_bAppendNull) {
+        // the terminating nulls must not be written back to the file
+        prot |= PROT_WRITE;
+        flags = MAP_PRIVATE;
+    }
+
+    void * p = mmap(NULL, nLength, prot, flags, m_nFd, dwStartOffset);
+    if (p == MAP_FAILED) {
+        UnMap();
+        return FALSE;
+    }
+    m_lpData = p;
+
+    //null terminate if asked to do so
+    if (m_bAppendNull) {
+        BYTE* lpData = (BYTE*) m_lpData;
+        lpData[m_nLength] = 0;
+        lpData[m_nLength+1] = 0;
+    }
+
+    m_bOpen = TRUE;
+
+    return TRUE;
+}
+
+BOOL CXMemMapFile::Close()
+{
+    //Release our interest in this MMF
+    if (!m_bOpen) {
+        return FALSE;
+    }
+
+    m_bOpen = FALSE;
+
+    return TRUE;
+}
+
+BOOL CXMemMapFile::Flush()
+{
+    if (m_lpData == NULL) {
+        return FALSE;
+    }
+
+    return msync(m_lpData, m_nLength, MS_SYNC) == 0;
+}
+
+void CXMemMapFile::UnMap()
+{
+    //Close any views which may be open
+    Close();
+
+    //unmap the view
+    if (m_lpData != NULL) {
+        munmap(m_lpData, m_bAppendNull ? m_nLength + 2 : m_nLength);
+        m_lpData = NULL;
+    }
+
+    if (m_nFd >= 0) {
+        close(m_nFd);
+        m_nFd = -1;
+    }
+
+    // a Win32 mapping goes away with its last handle;  a shm object lives
+    // until it is unlinked, so the creator removes the name (processes that
+    // already mapped it keep their view)
+    if (m_bCreated) {
+        shm_unlink(m_szMappingName);
+        m_bCreated = FALSE;
+    }
+
+    //Reset the remaining member variables
+    m_bReadOnly = TRUE;
+    m_bAppendNull = FALSE;
+    m_szMappingName[0] = _T('\0');
+    m_nLength = 0;
+}
+
+DWORD CXMemMapFile::CreateMappingName(LPCTSTR lpszName,
+                                      LPTSTR  lpszMappingName,
+                                      DWORD   nSize,
+                                      BOOL    bNamed)
+{
+    _ASSERTE(lpszName && (lpszName[0] != _T('\0')));
+    if (!lpszName || (lpszName[0] == _T('\0'))) {
+        return 0;
+    }
+
+    _ASSERTE(lpszMappingName);
+    _ASSERTE(nSize > 2);
+    if (!lpszMappingName || (nSize <= 2)) {
+        return 0;
+    }
+
+    ZeroMemory(lpszMappingName, nSize*sizeof(TCHAR));
+
+    if (bNamed) {
+        // shm names are "/name" with no other slashes
+        snprintf(lpszMappingName, nSize, "%s%s%s",
+                 lpszName[0] == '/' ? "" : "/", lpszName, XMM_MAPPING_FILENAME);
+        for (TCHAR * p = lpszMappingName + 1; *p; p++) {
+            if (*p == '/' || *p == '\\') {
+                *p = '_';
+            }
+        }
+    }
+
+    return (DWORD)(strlen(lpszMappingName));
+}
+
+DWORD CXMemMapFile::GetMappingName(LPTSTR lpszName, DWORD dwSize) const
+{
+    _ASSERTE(lpszName);
+    _ASSERTE(dwSize > 2);
+    if (!lpszName || (dwSize <= 2)) {
+        return 0;
+    }
+
+    ZeroMemory(lpszName, dwSize*sizeof(TCHAR));
+    strncpy(lpszName, m_szMappingName, dwSize-1);
+
+    return (DWORD)(strlen(lpszName));
+}
+
+void CXMemMapFile::Dump() const
+{
+#if _DEBUG_XMEMMAP
+    printf("CXMemMapFile dump:\n");
+    printf("    m_nFd=%d\n",            m_nFd);
+    printf("    m_lpData=%p\n",         m_lpData);
+    printf("    m_szMappingName=%s\n",  m_szMappingName);
+    printf("    m_bOpen=%d\n",          m_bOpen);
+    printf("    m_dwLength=%u\n",       m_nLength);
+#endif
+}
+
+#endif // _WIN32
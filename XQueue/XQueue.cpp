@@ -158,8 +158,14 @@
 //                 XQueue object.
 //     Read()      Read message from the queue.  Typically used only by
 //                 XQueue servers.
+//     ReadBatch() Read as many messages as fit in a buffer, under a single
+//                 lock.  Typically used only by XQueue servers.
 //     Write()     Write message to the queue.  Typically used only by
 //                 XQueue clients.
+//     WriteBatch() Write several messages with one lock and one server
+//                 notification.  Typically used only by XQueue clients.
+//     WriteGather() Write one message made up of several buffers.
+//                 Typically used only by XQueue clients.
 //
 // License:
 //     This software is released into the public domain.  You are free to use
@@ -721,6 +727,122 @@ LONG CXQueue::Read(LPBYTE   lpData,
     return lRet;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+//
+// ReadBatch()
+//
+// Purpose:     Read as many messages as will fit from the queue, under a
+//              single lock.  Typically used only by XQueue servers.
+//
+// Parameters:  lpData      - [out] Pointer to the buffer that receives the
+//                            messages, stored back to back
+//              cbSize      - [in] size in bytes of lpData
+//              pEntries    - [out] one entry per message read, giving its
+//                            offset in lpData, size, message id and the
+//                            thread id of the thread that queued it
+//              nMaxEntries - [in] number of entries in pEntries
+//              pnEntries   - [out] number of messages read
+//              dwTimeOut   - [in] specifies the time-out interval, in
+//                            milliseconds
+//
+// Returns:     LONG        - XQueue error code (see XQueue.h);
+//                            XQUEUE_ERROR_MORE_DATA if not even the first
+//                            message fits, in which case pEntries[0].DataSize
+//                            is the size it needs
+//
+LONG CXQueue::ReadBatch(LPBYTE         lpData,
+                        DWORD          cbSize,
+                        XQUEUE_ENTRY * pEntries,
+                        DWORD          nMaxEntries,
+                        DWORD        * pnEntries,
+                        DWORD          dwTimeOut /*= INFINITE*/)
+{
+    _ASSERTE(pnEntries);
+    if (!pnEntries)
+        return XQUEUE_ERROR_PARAMETER;
+
+    *pnEntries = 0;
+
+    _ASSERTE(lpData && pEntries && (nMaxEntries > 0));
+    if (!lpData || !pEntries || (nMaxEntries == 0))
+        return XQUEUE_ERROR_PARAMETER;
+
+    _ASSERTE(m_pVariableBlock);
+    if (!m_pVariableBlock) {
+        return XQUEUE_ERROR_NOT_OPEN;
+    }
+
+    if (m_pVariableBlock->UsedListForwardLink == XQUEUE_INVALID_BLOCK) {
+        return XQUEUE_ERROR_NO_DATA;
+    }
+
+    // clients append to the used list while we walk it, so hold the lock
+    // for the whole batch rather than once per message
+    LONG lRet = Lock(dwTimeOut);    //===================================
+
+    if (lRet != XQUEUE_ERROR_SUCCESS) {
+        return lRet;
+    }
+
+    DWORD nEntries = 0;
+    DWORD nOffset = 0;
+    DWORD block_no = m_pVariableBlock->UsedListForwardLink;
+
+    while ((nEntries < nMaxEntries) && (block_no != XQUEUE_INVALID_BLOCK)) {
+        XQUEUE_DATA_BLOCK * pXDB =
+            (XQUEUE_DATA_BLOCK *) (m_pDataBlock + block_no * m_nBlockSize);
+
+        DWORD nSize = GetEntrySize(pXDB);
+        if (nSize > cbSize - nOffset) {
+            if (nEntries == 0) {
+                pEntries[0].DataSize = nSize;
+                lRet = XQUEUE_ERROR_MORE_DATA;
+            }
+            break;
+        }
+
+        XQUEUE_ENTRY &entry = pEntries[nEntries];
+        entry.Offset    = nOffset;
+        entry.DataSize  = nSize;
+        entry.MessageId = pXDB->MessageId;
+        entry.ThreadId  = pXDB->ThreadId;
+
+        // copy the message block by block;  the last block links to the
+        // first block of the next message
+        for (;;) {
+            DWORD nBytesToCopy = pXDB->DataSize & 0x7FFFFFFF;    // mask off continuation bit
+            memcpy(lpData + nOffset, pXDB->Data, nBytesToCopy);
+            nOffset += nBytesToCopy;
+
+            block_no = pXDB->ForwardLink;
+
+            if ((pXDB->DataSize & XQUEUE_CONTINUATION_FLAG) == 0) {
+                break;
+            }
+
+            pXDB = (XQUEUE_DATA_BLOCK *) (m_pDataBlock + block_no * m_nBlockSize);
+        }
+
+        nEntries++;
+    }
+
+    for (DWORD i = 0; i < nEntries; i++) {
+        ReleaseEntry();
+    }
+
+    m_pVariableBlock->NoReads += nEntries;
+
+    Unlock();                //===================================
+
+    *pnEntries = nEntries;
+
+#if _DEBUG_XQUEUE
+    TRACE(_T("ReadBatch returning %d messages, %d bytes -----\n"), nEntries, nOffset);
+#endif 
+
+    return lRet;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 //
 // Write()
@@ -771,13 +893,54 @@ LONG CXQueue::Write(LPBYTE lpData,
                     DWORD nDataSize,
                     DWORD dwTimeOut /*= INFINITE*/)
 {
+    _ASSERTE(lpData);
+    _ASSERTE(nDataSize > 0);
+    if (!lpData || (nDataSize == 0))
+        return XQUEUE_ERROR_PARAMETER;
+
+    XQUEUE_BUFFER buf = { lpData, nDataSize };
+
+    return WriteGather(&buf, 1, dwTimeOut);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// WriteGather()
+//
+// Purpose:     Write one message that is made up of several buffers to the
+//              queue, without first concatenating them.  Typically used
+//              only by XQueue clients.
+//
+// Parameters:  pBuffers  - [in] Pointer to the buffers that contain the
+//                          data to queue, in order
+//              nBuffers  - [in] number of buffers in pBuffers
+//              dwTimeOut - [in] specifies the time-out interval, in
+//                          milliseconds
+//
+// Returns:     LONG      - XQueue error code (see XQueue.h)
+//
+LONG CXQueue::WriteGather(const XQUEUE_BUFFER * pBuffers,
+                          DWORD nBuffers,
+                          DWORD dwTimeOut /*= INFINITE*/)
+{
+    _ASSERTE(pBuffers);
+    _ASSERTE(nBuffers > 0);
+    if (!pBuffers || (nBuffers == 0))
+        return XQUEUE_ERROR_PARAMETER;
+
+    DWORD nDataSize = 0;
+    for (DWORD i = 0; i < nBuffers; i++) {
+        if (pBuffers[i].nDataSize > (DWORD)(0x7FFFFFFF - nDataSize))
+            return XQUEUE_ERROR_PARAMETER;
+        nDataSize += pBuffers[i].nDataSize;
+    }
+
 #if _DEBUG_XQUEUE
-    TRACE(_T("in CXQueue::Write:  %d bytes -----\n"), nDataSize);
+    TRACE(_T("in CXQueue::WriteGather:  %d bytes -----\n"), nDataSize);
 #endif    
 
-    _ASSERTE(lpData);
     _ASSERTE(nDataSize > 0);
-    if (!lpData || (nDataSize == 0))
+    if (nDataSize == 0)
         return XQUEUE_ERROR_PARAMETER;
 
     // check size of write
@@ -870,7 +1033,7 @@ LONG CXQueue::Write(LPBYTE lpData,
         lRet = Lock(dwTimeOut);    //===================================
 
         if (lRet == XQUEUE_ERROR_SUCCESS) {
-            lRet = WriteToMMF(lpData, nDataSize);
+            lRet = WriteToMMF(pBuffers, nBuffers, nDataSize);
 
             if (lRet == XQUEUE_ERROR_SUCCESS) {
                 // update some XQueue statistics
@@ -900,6 +1063,128 @@ LONG CXQueue::Write(LPBYTE lpData,
     return lRet;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+//
+// WriteBatch()
+//
+// Purpose:     Write several messages to the queue, taking the write mutex
+//              and notifying the server once for as many of them as there
+//              are free blocks for.  Typically used only by XQueue clients.
+//
+// Parameters:  pMessages - [in] Pointer to the messages to queue;  each
+//                          buffer is one message
+//              nMessages - [in] number of messages in pMessages
+//              pnWritten - [out] number of messages queued (optional);  on
+//                          error, the messages before this one were queued
+//              dwTimeOut - [in] specifies the time-out interval, in
+//                          milliseconds, for each wait for free blocks
+//
+// Returns:     LONG      - XQueue error code (see XQueue.h)
+//
+LONG CXQueue::WriteBatch(const XQUEUE_BUFFER * pMessages,
+                         DWORD nMessages,
+                         DWORD * pnWritten,
+                         DWORD dwTimeOut /*= INFINITE*/)
+{
+#if _DEBUG_XQUEUE
+    TRACE(_T("in CXQueue::WriteBatch:  %d messages -----\n"), nMessages);
+#endif    
+
+    if (pnWritten) {
+        *pnWritten = 0;
+    }
+
+    _ASSERTE(pMessages);
+    _ASSERTE(nMessages > 0);
+    if (!pMessages || (nMessages == 0))
+        return XQUEUE_ERROR_PARAMETER;
+
+    _ASSERTE(m_pVariableBlock);
+    if (!m_pVariableBlock) {
+        return XQUEUE_ERROR_NOT_OPEN;
+    }
+
+    // check size of writes
+    for (DWORD i = 0; i < nMessages; i++) {
+        if (!pMessages[i].lpData ||
+            (pMessages[i].nDataSize == 0) ||
+            (pMessages[i].nDataSize >= (m_nBlockSize * (m_nQueueSize-1))))
+        {
+            _ASSERTE(FALSE);
+            return XQUEUE_ERROR_PARAMETER;
+        }
+    }
+
+    // see Write() - keep new client writes out while we wait for blocks
+    LONG lRet = WaitForQueueIdle(INFINITE);
+
+    if (lRet != XQUEUE_ERROR_SUCCESS) {
+        _ASSERTE(FALSE);
+        return lRet;
+    }
+
+    DWORD nWritten = 0;
+
+    while (nWritten < nMessages) {
+        // wait until at least the next message fits
+        lRet = WaitForFreeBlocks(CalculateNoBlocks(pMessages[nWritten].nDataSize), dwTimeOut);
+        if (lRet != XQUEUE_ERROR_SUCCESS) {
+            break;
+        }
+
+        lRet = Lock(dwTimeOut);    //===================================
+
+        if (lRet != XQUEUE_ERROR_SUCCESS) {
+            break;
+        }
+
+        // write everything there are free blocks for
+        DWORD nQueued = 0;
+        while ((nWritten < nMessages) &&
+               (CalculateNoBlocks(pMessages[nWritten].nDataSize) <= m_pVariableBlock->FreeDataBlocks))
+        {
+            DWORD nDataSize = pMessages[nWritten].nDataSize;
+
+            lRet = WriteToMMF(&pMessages[nWritten], 1, nDataSize);
+            if (lRet != XQUEUE_ERROR_SUCCESS) {
+                break;
+            }
+
+            // update some XQueue statistics
+            m_pVariableBlock->NoWrites++;
+
+            if (nDataSize > m_pVariableBlock->MaxDataSize)
+                m_pVariableBlock->MaxDataSize = nDataSize;
+
+            m_pVariableBlock->MessageId++;
+
+            nWritten++;
+            nQueued++;
+        }
+
+        Unlock();            //===================================
+
+        if (nQueued > 0) {
+            // tell server something has been queued
+            if (m_hServerNotifyEvent)
+                SetEvent(m_hServerNotifyEvent);
+        }
+
+        if (lRet != XQUEUE_ERROR_SUCCESS) {
+            break;
+        }
+    }
+
+    // allow other clients to write
+    SetEvent(m_hClientWriteEvent);
+
+    if (pnWritten) {
+        *pnWritten = nWritten;
+    }
+
+    return lRet;
+}
+
 
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -1282,24 +1567,30 @@ LONG CXQueue::ReadMMF(LPBYTE  lpData,
 //
 // Purpose:     Write memory-mapped file
 //
-// Parameters:  lpData    - [out] Pointer to the buffer that contains the
-//                          data to write
-//              nDataSize - [in] number of bytes of data in lpData
+// Parameters:  pBuffers  - [in] Pointer to the buffers that contain the
+//                          data to write;  they are written as one message
+//              nBuffers  - [in] number of buffers in pBuffers
+//              nDataSize - [in] total number of bytes in pBuffers
 //
 // Returns:     LONG      - XQueue error code (see XQueue.h)
 //
 // Notes:       Does not lock access to MMF.
 //
-LONG CXQueue::WriteToMMF(LPBYTE lpData, DWORD nDataSize)
+LONG CXQueue::WriteToMMF(const XQUEUE_BUFFER * pBuffers, DWORD nBuffers, DWORD nDataSize)
 {
 #if _DEBUG_XQUEUE
     TRACE(_T("in CXQueue::WriteToMMF\n"));
 #endif
 
     // verify parameters
-    if ((lpData == NULL) ||
-        (nDataSize == 0) ||
-        IsBadReadPtr(lpData, nDataSize))
+    BOOL bBadBuffer = (pBuffers == NULL) || (nBuffers == 0);
+    for (DWORD i = 0; !bBadBuffer && (i < nBuffers); i++) {
+        bBadBuffer = (pBuffers[i].nDataSize != 0) &&
+                     ((pBuffers[i].lpData == NULL) ||
+                      IsBadReadPtr(pBuffers[i].lpData, pBuffers[i].nDataSize));
+    }
+
+    if (bBadBuffer || (nDataSize == 0))
     {        
 #if _DEBUG_XQUEUE
         TRACE(_T("ERROR: bad parameters\n"));
@@ -1314,6 +1605,10 @@ LONG CXQueue::WriteToMMF(LPBYTE lpData, DWORD nDataSize)
     DWORD nBlockNo = XQUEUE_INVALID_BLOCK;
     XQUEUE_DATA_BLOCK * pPrevious = NULL;
 
+    // position in the source buffers
+    DWORD nBuffer = 0;
+    DWORD nBufferOffset = 0;
+
     while (nDataSize > 0) {
         XQUEUE_DATA_BLOCK * pXDB = GetFreeBlock();
         if (!pXDB) {
@@ -1326,7 +1621,25 @@ LONG CXQueue::WriteToMMF(LPBYTE lpData, DWORD nDataSize)
         DWORD nBytesToCopy = (nDataSize > m_nDataSize) ?
                                 m_nDataSize : nDataSize;
 
-        memcpy(pXDB->Data, lpData, nBytesToCopy);
+        // fill the block from as many source buffers as it takes
+        DWORD nCopied = 0;
+        while (nCopied < nBytesToCopy) {
+            const XQUEUE_BUFFER &buf = pBuffers[nBuffer];
+            DWORD nChunk = buf.nDataSize - nBufferOffset;
+            if (nChunk > nBytesToCopy - nCopied) {
+                nChunk = nBytesToCopy - nCopied;
+            }
+
+            memcpy(pXDB->Data + nCopied, buf.lpData + nBufferOffset, nChunk);
+            nCopied += nChunk;
+            nBufferOffset += nChunk;
+
+            if (nBufferOffset == buf.nDataSize) {
+                nBuffer++;
+                nBufferOffset = 0;
+            }
+        }
+
         pXDB->DataSize = nBytesToCopy;
         pXDB->MessageId = message_id;
 
@@ -1334,7 +1647,6 @@ LONG CXQueue::WriteToMMF(LPBYTE lpData, DWORD nDataSize)
 
         pXDB->Dump();
 
-        lpData += nBytesToCopy;
         nDataSize -= nBytesToCopy;
 
         // if more bytes to copy, set continuation flag in this block
@@ -1475,6 +1787,56 @@ LONG CXQueue::SetQueueAvailable()
     return XQUEUE_ERROR_SUCCESS;
 }
 
+///////////////////////////////////////////////////////////////////////////////
+//
+// WaitForFreeBlocks() - private function
+//
+// Purpose:     Wait until the server has freed enough blocks for a write.
+//
+// Parameters:  nBlocks   - [in] number of free blocks needed
+//              dwTimeOut - [in] specifies the time-out interval, in
+//                          milliseconds
+//
+// Returns:     LONG      - XQueue error code (see XQueue.h)
+//
+LONG CXQueue::WaitForFreeBlocks(DWORD nBlocks, DWORD dwTimeOut)
+{
+    if (m_pVariableBlock->FreeDataBlocks >= nBlocks) {
+        return XQUEUE_ERROR_SUCCESS;
+    }
+
+    if (dwTimeOut == 0) {
+#if _DEBUG_XQUEUE
+        TRACE(_T("ERROR:  not enough free blocks\n"));
+#endif 
+        return XQUEUE_ERROR_NO_FREE;
+    }
+
+    DWORD dwFreeTimeOut = dwTimeOut;
+    DWORD dwSpinTime = 1;
+
+    // loop until server frees some blocks
+    do
+    {
+        Sleep(dwSpinTime);
+
+        if (m_pVariableBlock->FreeDataBlocks >= nBlocks) {
+            return XQUEUE_ERROR_SUCCESS;
+        }
+
+        if (dwFreeTimeOut > dwSpinTime)
+            dwFreeTimeOut -= dwSpinTime;
+        else
+            dwFreeTimeOut = 0;
+
+    } while (dwFreeTimeOut > 0);
+
+#if _DEBUG_XQUEUE
+    TRACE(_T("ERROR:  timeout waiting for enough free blocks\n"));
+#endif 
+    return XQUEUE_ERROR_TIMEOUT;
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 //
 // WaitForQueueIdle() - private function
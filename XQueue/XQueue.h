@@ -198,6 +198,29 @@ struct XQUEUE_DATA_BLOCK
 };
 
 
+///////////////////////////////////////////////////////////////////////////////
+// XQUEUE_BUFFER - one message for WriteBatch(), or one piece of a message
+// for WriteGather()
+struct XQUEUE_BUFFER
+{
+    LPBYTE  lpData;                 // data to queue
+    DWORD   nDataSize;              // no. of bytes in lpData
+};
+
+
+///////////////////////////////////////////////////////////////////////////////
+// XQUEUE_ENTRY - describes one message returned by ReadBatch()
+struct XQUEUE_ENTRY
+{
+    DWORD   Offset;                 // offset of the message in the buffer
+                                    // passed to ReadBatch()
+    DWORD   DataSize;               // no. of bytes in the message
+    DWORD   MessageId;              // message id
+    DWORD   ThreadId;               // thread id of the thread that queued
+                                    // the message
+};
+
+
 ///////////////////////////////////////////////////////////////////////////////
 // CXQueue - definition of CXQueue object
 class CXQueue
@@ -220,9 +243,12 @@ public:
     void    Dump();
     LONG    Open(LPCTSTR lpszQueueName);
     LONG    Read(LPBYTE lpBuf, DWORD * lpcbSize, DWORD * lpnMsgId, DWORD * pdwTID, DWORD dwTimeout = INFINITE);
+    LONG    ReadBatch(LPBYTE lpBuf, DWORD cbSize, XQUEUE_ENTRY * pEntries, DWORD nMaxEntries, DWORD * pnEntries, DWORD dwTimeout = INFINITE);
     LONG    WaitForQueueWrite(DWORD dwTimeOut);
     LONG    Write(LPBYTE lpData, DWORD nDataSize, DWORD dwTimeOut = INFINITE);
     LONG    Write(LPCTSTR lpszString, DWORD dwTimeout = INFINITE);
+    LONG    WriteBatch(const XQUEUE_BUFFER * pMessages, DWORD nMessages, DWORD * pnWritten = NULL, DWORD dwTimeOut = INFINITE);
+    LONG    WriteGather(const XQUEUE_BUFFER * pBuffers, DWORD nBuffers, DWORD dwTimeOut = INFINITE);
 
 // Implementation
 private:
@@ -238,15 +264,29 @@ private:
     LONG    ReleaseEntry();
     LONG    SetQueueAvailable();
     LONG    Unlock();
+    LONG    WaitForFreeBlocks(DWORD nBlocks, DWORD dwTimeOut);
     LONG    WaitForQueueIdle(DWORD dwTimeOut);
-    LONG    WriteToMMF(LPBYTE lpData, DWORD nDataSize);
+    LONG    WriteToMMF(const XQUEUE_BUFFER * pBuffers, DWORD nBuffers, DWORD nDataSize);
     XQUEUE_DATA_BLOCK * GetBlock(DWORD &ForwardLink, DWORD &BackLink, DWORD &BlockCount);
     XQUEUE_DATA_BLOCK * GetFreeBlock();
     XQUEUE_DATA_BLOCK * GetUsedBlock();
+#ifndef _WIN32
+    DWORD   GetMaxMessageSize();
+    LONG    ReserveRecord(DWORD nRecordSize, DWORD dwTimeOut, uint64_t * pPos);
+    void    UpdateWriteStats(DWORD nMessages, DWORD nMaxDataSize);
+    void    WakeConsumer();
+    void    WakeProducers();
+#endif
     ///////////////////////////////////////////////////////////////////////////
     // data members
 
     CXMemMapFile m_MMF;                         // memory mapped file object
+#ifndef _WIN32
+    struct XQUEUE_RING * m_pRing;               // ring control block - see
+                                                // XQueuePosix.cpp
+    LPBYTE    m_pRingData;                      // first byte of the ring
+    uint64_t  m_nRingMask;                      // ring size in bytes - 1
+#endif
     HANDLE    m_hWriteMutex;                    // handle for global write mutex -
                                                 // set to nonsignaled when a
                                                 // client or server is writing
@@ -261,7 +301,8 @@ private:
     BOOL      m_bClient;                        // TRUE = queue client
     TCHAR     m_szQueueName[_MAX_PATH*2];       // queue name
     LPBYTE    m_pQueue;                         // pointer to queue mapped memory
-                                                // (returned by MapViewOfFile)
+                                                // (returned by MapViewOfFile
+                                                // or mmap)
     XQUEUE_VARIABLE_BLOCK * m_pVariableBlock;   // pointer to XQueue variable block
     LPBYTE   m_pDataBlock;                      // pointer to first data block
     DWORD    m_nQueueSize;                      // no. of data blocks in queue
@@ -271,8 +312,10 @@ private:
                                                 // for the client & server
     DWORD    m_nDataSize;                       // m_nBlockSize - XQUEUE_DATA_VARIABLE_SIZE
 
+#ifdef _WIN32
     SECURITY_ATTRIBUTES m_tDefSecAttr;
     SECURITY_DESCRIPTOR m_tDefSecDesc;
+#endif
 };
 
 
@@ -0,0 +1,1114 @@
+// XQueuePosix.cpp
+//
+// Description:
+//     XQueuePosix.cpp implements CXQueue for Linux and other POSIX systems.
+//     Build it (together with XMemmapPosix.cpp) instead of XQueue.cpp and
+//     XMemmap.cpp on those platforms.  The public API and error codes are
+//     the same as on Windows;  only the shared memory layout differs, so a
+//     queue can only be shared between processes built for the same
+//     platform.
+//
+// Concept & Facilities:
+//     The shared memory is a shm_open() object.  As on Windows, the first
+//     block holds the XQUEUE_VARIABLE_BLOCK.  It is followed by the ring
+//     control block (XQUEUE_RING) and then by the ring itself, a
+//     power-of-two sized byte array that holds variable-length records.
+//
+//     Clients (multiple producers) claim space for a record by advancing
+//     the ring tail with a compare-and-swap, copy the message into the
+//     claimed space, and then publish it by storing the record size.  No
+//     lock is taken and, unless the server is asleep, no system call is
+//     made.  A record that would run past the end of the ring is preceded
+//     by a padding record, so every message is contiguous and is copied
+//     with a single memcpy.
+//
+//     The server (single consumer) reads records in order at the ring
+//     head.  A size of zero means the record at the head has not been
+//     published yet.  After consuming a record the server zeroes it, so
+//     that unpublished space always reads as zero, and then advances the
+//     head.
+//
+//     The server sleeps in WaitForQueueWrite() on a futex, and clients
+//     only call futex(FUTEX_WAKE) when they see that it is sleeping.
+//     Clients that find the ring full sleep on a second futex, which the
+//     server only wakes when somebody is waiting.  Both futexes are
+//     process-shared, since the ring lives in shared memory.
+//
+//     Message ids are assigned by the server in the order messages are
+//     read, so they are sequential just like on Windows.  The free and
+//     used block counters in the variable block are not maintained;  the
+//     ring has no blocks.
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#ifndef _WIN32
+
+#include <atomic>
+#include <errno.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <new>
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "XQueue.h"
+
+///////////////////////////////////////////////////////////////////////////////
+// prefixes for named objects
+#define XQUEUE_NAME                 _T("XQueue_")
+
+///////////////////////////////////////////////////////////////////////////////
+// ring layout
+#define XQUEUE_RING_MAGIC           0x52515858    // "XXQR"
+#define XQUEUE_RING_ALIGN           8             // record alignment
+#define XQUEUE_RECORD_PADDING       0x80000000    // high bit of Size - TRUE =
+                                                  // skip to the start of the ring
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2 && ATOMIC_INT_LOCK_FREE == 2,
+              "XQueue needs lock-free atomics to share them between processes");
+
+///////////////////////////////////////////////////////////////////////////////
+// XQUEUE_RING - ring control block, follows the variable block in the mmf;
+// the members that producers and the consumer write are kept on separate
+// cache lines
+struct XQUEUE_RING
+{
+    DWORD    Magic;                         // XQUEUE_RING_MAGIC once the server
+                                            // has set up the ring
+    DWORD    Reserved;
+    uint64_t Size;                          // ring size in bytes (power of two)
+
+    alignas(64) std::atomic<uint64_t> Tail; // next byte a client may claim
+    std::atomic<uint32_t> SpaceSeq;         // futex - bumped by the server when
+                                            // it frees space for a waiting client
+    std::atomic<uint32_t> SpaceWaiters;     // no. of clients waiting for space
+
+    alignas(64) std::atomic<uint64_t> Head; // next byte the server will read
+    std::atomic<uint32_t> ServerWaiting;    // futex - 1 = server is asleep in
+                                            // WaitForQueueWrite()
+};
+
+///////////////////////////////////////////////////////////////////////////////
+// XQUEUE_RECORD - header of a record in the ring;  the message follows it
+struct XQUEUE_RECORD
+{
+    std::atomic<DWORD> Size;                // message size in bytes, or the
+                                            // size of the padding if
+                                            // XQUEUE_RECORD_PADDING is set;
+                                            // 0 = not yet published
+    DWORD    ThreadId;                      // thread id of client
+};
+
+#define XQUEUE_RECORD_HEADER_SIZE   sizeof(XQUEUE_RECORD)
+
+static DWORD AlignRecord(DWORD nSize)
+{
+    return (nSize + XQUEUE_RING_ALIGN - 1) & ~(DWORD)(XQUEUE_RING_ALIGN - 1);
+}
+
+static DWORD GetCurrentThreadId()
+{
+    // gettid() is a system call, so only make it once per thread
+    static thread_local DWORD tid = (DWORD)syscall(SYS_gettid);
+    return tid;
+}
+
+static int FutexWait(std::atomic<uint32_t> * pWord, uint32_t nExpected, DWORD dwTimeOut)
+{
+    struct timespec ts;
+    ts.tv_sec  = dwTimeOut / 1000;
+    ts.tv_nsec = (long)(dwTimeOut % 1000) * 1000000;
+
+    return (int)syscall(SYS_futex, (uint32_t *)pWord, FUTEX_WAIT, nExpected,
+                        (dwTimeOut == INFINITE) ? NULL : &ts, NULL, 0);
+}
+
+static void FutexWake(std::atomic<uint32_t> * pWord, int nCount)
+{
+    syscall(SYS_futex, (uint32_t *)pWord, FUTEX_WAKE, nCount, NULL, NULL, 0);
+}
+
+// milliseconds left until dwStart + dwTimeOut;  INFINITE stays INFINITE
+static DWORD GetRemainingTime(const struct timespec &tStart, DWORD dwTimeOut)
+{
+    if (dwTimeOut == INFINITE) {
+        return INFINITE;
+    }
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    int64_t elapsed = (int64_t)(now.tv_sec - tStart.tv_sec) * 1000 +
+                      (now.tv_nsec - tStart.tv_nsec) / 1000000;
+
+    return (elapsed >= (int64_t)dwTimeOut) ? 0 : (DWORD)(dwTimeOut - elapsed);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// CXQueue()
+//
+// Purpose:     Construct CXQueue object.
+//
+// Parameters:  None
+//
+// Returns:     None
+//
+CXQueue::CXQueue() :
+    m_pRing(NULL),
+    m_pRingData(NULL),
+    m_nRingMask(0),
+    m_hWriteMutex(NULL),
+    m_hClientWriteEvent(NULL),
+    m_hServerNotifyEvent(NULL),
+    m_bClient(TRUE),
+    m_pQueue(NULL),
+    m_pVariableBlock(NULL),
+    m_pDataBlock(NULL),
+    m_nQueueSize(0),
+    m_nTotalBlocks(0),
+    m_nBlockSize(XQUEUE_DEFAULT_BLOCK_SIZE),
+    m_nDataSize(XQUEUE_DEFAULT_DATA_SIZE)
+{
+    ZeroMemory(m_szQueueName, sizeof(m_szQueueName));
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// ~CXQueue()
+//
+// Purpose:     Destroy CXQueue object.
+//
+// Parameters:  None
+//
+// Returns:     None
+//
+CXQueue::~CXQueue()
+{
+    Close();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Close()
+//
+// Purpose:     Close XQueue object and clean up.
+//
+// Parameters:  None
+//
+// Returns:     LONG - XQueue error code (see XQueue.h)
+//
+LONG CXQueue::Close()
+{
+    if (IsOpen() && m_pVariableBlock) {
+        if (m_bClient) {
+            __atomic_fetch_sub(&m_pVariableBlock->NoClients, 1, __ATOMIC_RELAXED);
+        }
+        else if (m_pVariableBlock->NoServers > 0) {
+            m_pVariableBlock->NoServers--;
+        }
+    }
+
+    m_MMF.UnMap();
+
+    m_nQueueSize        = 0;
+    m_pQueue            = NULL;
+    m_pVariableBlock    = NULL;
+    m_pDataBlock        = NULL;
+    m_pRing             = NULL;
+    m_pRingData         = NULL;
+    m_nRingMask         = 0;
+
+    ZeroMemory(m_szQueueName, sizeof(m_szQueueName));
+
+    return XQUEUE_ERROR_SUCCESS;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Create()
+//
+// Purpose:     Create() is called by the XQueue server to create the
+//              system-wide named XQueue object.
+//
+// Parameters:  lpszQueueName - [in] name of XQueue object (must be specified)
+//              nQueueSize    - [in] size of queue in blocks
+//              nBlockSize    - [in] size of a block in bytes
+//
+// Returns:     LONG          - XQueue error code (see XQueue.h)
+//
+// Notes:       The largest message is the same as on Windows, one byte less
+//              than nBlockSize * (nQueueSize - 1).  A record may need padding
+//              in front of it, so it can use at most half of the ring, and
+//              the ring is twice that size, rounded up to a power of two.
+//
+LONG CXQueue::Create(LPCTSTR lpszQueueName /*= NULL*/,
+                     DWORD   nQueueSize    /*= XQUEUE_DEFAULT_QUEUE_SIZE*/,
+                     DWORD   nBlockSize    /*= XQUEUE_DEFAULT_BLOCK_SIZE*/)
+{
+    if (IsOpen()) {
+        _ASSERTE(FALSE);
+        return XQUEUE_ERROR_CREATE_FAILED;
+    }
+
+    _ASSERTE(lpszQueueName && (lpszQueueName[0] != _T('\0')));
+    if (!lpszQueueName || (lpszQueueName[0] == _T('\0')))
+        return XQUEUE_ERROR_PARAMETER;
+
+    snprintf(m_szQueueName, sizeof(m_szQueueName), "%s%s", XQUEUE_NAME, lpszQueueName);
+
+    m_nQueueSize = nQueueSize;
+    if (m_nQueueSize == 0) {
+        m_nQueueSize = XQUEUE_DEFAULT_QUEUE_SIZE;
+    }
+
+    _ASSERTE(m_nQueueSize <= XQUEUE_MAX_QUEUE_SIZE);
+    if (m_nQueueSize > XQUEUE_MAX_QUEUE_SIZE)
+        return XQUEUE_ERROR_PARAMETER;
+
+    _ASSERTE(m_nQueueSize >= XQUEUE_MIN_QUEUE_SIZE);
+    if (m_nQueueSize < XQUEUE_MIN_QUEUE_SIZE)
+        return XQUEUE_ERROR_PARAMETER;
+
+    m_nBlockSize = nBlockSize;
+    if (m_nBlockSize < XQUEUE_MIN_BLOCK_SIZE) {
+        m_nBlockSize = XQUEUE_MIN_BLOCK_SIZE;
+    }
+
+    // round up to next multiple of XQUEUE_MIN_BLOCK_SIZE
+    m_nBlockSize = ((m_nBlockSize + (XQUEUE_MIN_BLOCK_SIZE-1)) / XQUEUE_MIN_BLOCK_SIZE) * XQUEUE_MIN_BLOCK_SIZE;
+
+    m_nDataSize = m_nBlockSize - XQUEUE_DATA_VARIABLE_SIZE;
+
+    m_bClient = FALSE;                    // only servers call Create()
+
+    // the ring control block must not share the variable block
+    static_assert(sizeof(XQUEUE_VARIABLE_BLOCK) <= XQUEUE_MIN_BLOCK_SIZE,
+                  "variable block does not fit in a queue block");
+    static_assert(sizeof(XQUEUE_RING) <= XQUEUE_MIN_BLOCK_SIZE * 2,
+                  "ring control block does not fit in two queue blocks");
+
+    // room for two of the largest records (see GetMaxMessageSize())
+    uint64_t nMaxRecordSize = (uint64_t)m_nBlockSize * (m_nQueueSize - 1) + XQUEUE_RECORD_HEADER_SIZE;
+    uint64_t nRingSize = XQUEUE_MIN_BLOCK_SIZE;
+    while (nRingSize < 2 * nMaxRecordSize) {
+        nRingSize <<= 1;
+    }
+
+    // variable block, ring control block, then the ring
+    DWORD nRingControl = (sizeof(XQUEUE_RING) + m_nBlockSize - 1) / m_nBlockSize;
+    uint64_t nBlocks = 1 + nRingControl + (nRingSize + m_nBlockSize - 1) / m_nBlockSize;
+    uint64_t nMappingSize = nBlocks * m_nBlockSize;
+
+    _ASSERTE(nMappingSize <= 0xFFFFFFFF);
+    if (nMappingSize > 0xFFFFFFFF)
+        return XQUEUE_ERROR_PARAMETER;
+
+    m_nTotalBlocks = (DWORD)nBlocks;
+
+    if (!m_MMF.MapMemory(m_szQueueName, (DWORD)nMappingSize, FALSE)) {
+        _ASSERTE(FALSE);
+        Close();
+        return XQUEUE_ERROR_CREATE_FAILED;
+    }
+
+    m_pQueue = (LPBYTE) m_MMF.GetMappedAddress();
+
+    // set up queue variable block (first block in mmf);  the mapping is
+    // freshly truncated, so everything else is already zero
+    m_pVariableBlock = (XQUEUE_VARIABLE_BLOCK *) m_pQueue;
+
+    m_pVariableBlock->BlockSize      = m_nBlockSize;
+    m_pVariableBlock->DataSize       = m_nDataSize;
+    m_pVariableBlock->NoBlocks       = m_nTotalBlocks;
+    m_pVariableBlock->NoDataBlocks   = m_nQueueSize;
+    m_pVariableBlock->FreeDataBlocks = m_nQueueSize;
+    m_pVariableBlock->ServerTID      = GetCurrentThreadId();
+    m_pVariableBlock->MessageId      = 1;
+
+    m_pRing     = new (m_pQueue + m_nBlockSize) XQUEUE_RING();
+    m_pRingData = m_pQueue + (1 + nRingControl) * m_nBlockSize;
+    m_pDataBlock = m_pRingData;
+    m_nRingMask = nRingSize - 1;
+
+    m_pRing->Size = nRingSize;
+    __atomic_store_n(&m_pRing->Magic, XQUEUE_RING_MAGIC, __ATOMIC_RELEASE);
+
+    // this server is ready
+    m_pVariableBlock->NoServers++;
+
+    return XQUEUE_ERROR_SUCCESS;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Dump()
+//
+// Purpose:     Dump info about the XQueue object.
+//
+// Parameters:  None
+//
+// Returns:     None
+//
+void CXQueue::Dump()
+{
+#if _DEBUG_XQUEUE
+    printf("CXQueue dump:\n");
+    printf("    m_szQueueName=<%s>\n", m_szQueueName);
+    printf("    m_nQueueSize=%u\n",    m_nQueueSize);
+    printf("    m_nTotalBlocks=%u\n",  m_nTotalBlocks);
+    printf("    m_nBlockSize=%u\n",    m_nBlockSize);
+    if (m_pRing) {
+        printf("    Ring Size=%llu Head=%llu Tail=%llu\n",
+               (unsigned long long)m_pRing->Size,
+               (unsigned long long)m_pRing->Head.load(),
+               (unsigned long long)m_pRing->Tail.load());
+    }
+#endif
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Open()
+//
+// Purpose:     Open() is called by XQueue clients to open an existing XQueue
+//              object.
+//
+// Parameters:  lpszQueueName - [in] name of XQueue object (must be specified)
+//
+// Returns:     LONG          - XQueue error code (see XQueue.h)
+//
+LONG CXQueue::Open(LPCTSTR lpszQueueName)
+{
+    if (IsOpen()) {
+        _ASSERTE(FALSE);
+        return XQUEUE_ERROR_OPEN_FAILED;
+    }
+
+    _ASSERTE(lpszQueueName && (lpszQueueName[0] != _T('\0')));
+    if (!lpszQueueName || (lpszQueueName[0] == _T('\0'))) {
+        return XQUEUE_ERROR_PARAMETER;
+    }
+
+    snprintf(m_szQueueName, sizeof(m_szQueueName), "%s%s", XQUEUE_NAME, lpszQueueName);
+
+    if (!m_MMF.MapExistingMemory(m_szQueueName)) {
+        Close();
+        return XQUEUE_ERROR_OPEN_FAILED;
+    }
+
+    m_bClient = TRUE;
+    m_pQueue = (LPBYTE) m_MMF.GetMappedAddress();
+    m_pVariableBlock = (XQUEUE_VARIABLE_BLOCK *) m_pQueue;
+
+    // set the client block sizes to the same size as the server
+    m_nBlockSize   = m_pVariableBlock->BlockSize;
+    m_nDataSize    = m_pVariableBlock->DataSize;
+    m_nQueueSize   = m_pVariableBlock->NoDataBlocks;
+    m_nTotalBlocks = m_pVariableBlock->NoBlocks;
+
+    DWORD nRingControl = m_nBlockSize ?
+        (DWORD)((sizeof(XQUEUE_RING) + m_nBlockSize - 1) / m_nBlockSize) : 0;
+
+    // the server may not have finished setting up the queue yet
+    if ((m_nBlockSize < XQUEUE_MIN_BLOCK_SIZE) ||
+        (m_MMF.GetLength() < (uint64_t)m_nTotalBlocks * m_nBlockSize) ||
+        (__atomic_load_n(&((XQUEUE_RING *)(m_pQueue + m_nBlockSize))->Magic,
+                         __ATOMIC_ACQUIRE) != XQUEUE_RING_MAGIC))
+    {
+        m_pVariableBlock = NULL;
+        Close();
+        return XQUEUE_ERROR_OPEN_FAILED;
+    }
+
+    m_pRing     = (XQUEUE_RING *)(m_pQueue + m_nBlockSize);
+    m_pRingData = m_pQueue + (1 + nRingControl) * m_nBlockSize;
+    m_pDataBlock = m_pRingData;
+    m_nRingMask = m_pRing->Size - 1;
+
+    __atomic_fetch_add(&m_pVariableBlock->NoClients, 1, __ATOMIC_RELAXED);
+
+    return XQUEUE_ERROR_SUCCESS;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Read()
+//
+// Purpose:     Read message from the queue.  Typically used only by XQueue
+//              servers.
+//
+// Parameters:  lpData       - [out] Pointer to the buffer that receives the
+//                             data read from the file
+//              lpcbSize     - [in/out] size in bytes of lpData;  if lpData
+//                             is NULL, the size of the required buffer will
+//                             returned in lpcbSize.
+//              lpnMessageId - [out] the message id contained in the queue block
+//              pdwThreadId  - [out] the thread id of the thread that queued
+//                             the message
+//              dwTimeOut    - [in] not used;  reading never blocks
+//
+// Returns:     LONG         - XQueue error code (see XQueue.h)
+//
+LONG CXQueue::Read(LPBYTE   lpData,
+                   DWORD  * lpcbSize,
+                   DWORD  * lpnMessageId,
+                   DWORD  * pdwThreadId,
+                   DWORD    /*dwTimeOut = INFINITE*/)
+{
+    _ASSERTE(lpcbSize);
+    if (!lpcbSize)
+        return XQUEUE_ERROR_PARAMETER;
+
+    _ASSERTE(lpnMessageId);
+    if (!lpnMessageId)
+        return XQUEUE_ERROR_PARAMETER;
+
+    _ASSERTE(m_pRing);
+    if (!m_pRing) {
+        return XQUEUE_ERROR_NOT_OPEN;
+    }
+
+    *lpnMessageId = 0;
+
+    // only the server advances the head
+    uint64_t head = m_pRing->Head.load(std::memory_order_relaxed);
+
+    for (;;) {
+        XQUEUE_RECORD * pRecord = (XQUEUE_RECORD *)(m_pRingData + (head & m_nRingMask));
+        DWORD nSize = pRecord->Size.load(std::memory_order_acquire);
+
+        if (nSize == 0) {
+            *lpcbSize = 0;
+            return XQUEUE_ERROR_NO_DATA;
+        }
+
+        if (nSize & XQUEUE_RECORD_PADDING) {
+            // skip to the start of the ring;  the rest of the padding was
+            // never written, so only the header has to be cleared
+            pRecord->Size.store(0, std::memory_order_relaxed);
+            head += nSize & ~XQUEUE_RECORD_PADDING;
+            m_pRing->Head.store(head, std::memory_order_release);
+            WakeProducers();
+            continue;
+        }
+
+        *lpnMessageId = m_pVariableBlock->MessageId;
+        if (pdwThreadId) {
+            *pdwThreadId = pRecord->ThreadId;
+        }
+
+        if (!lpData) {
+            // caller just wants the size
+            *lpcbSize = nSize;
+            return XQUEUE_ERROR_SUCCESS;
+        }
+
+        if (*lpcbSize < nSize) {
+            // too much data for buffer - copy what will fit and leave the
+            // message in the queue
+            memcpy(lpData, pRecord + 1, *lpcbSize);
+            *lpcbSize = nSize;
+            return XQUEUE_ERROR_MORE_DATA;
+        }
+
+        memcpy(lpData, pRecord + 1, nSize);
+
+        // if there's room left, append some zeros
+        DWORD nZeros = *lpcbSize - nSize;
+        memset(lpData + nSize, 0, (nZeros < 4) ? nZeros : 4);
+
+        *lpcbSize = nSize;
+
+        // unpublished space must read as zero for the next lap
+        DWORD nRecordSize = AlignRecord(XQUEUE_RECORD_HEADER_SIZE + nSize);
+        memset((void *)pRecord, 0, nRecordSize);
+
+        m_pRing->Head.store(head + nRecordSize, std::memory_order_release);
+
+        m_pVariableBlock->NoReads++;
+        m_pVariableBlock->MessageId++;
+
+        WakeProducers();
+
+        return XQUEUE_ERROR_SUCCESS;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// ReadBatch()
+//
+// Purpose:     Read as many messages as will fit from the queue.  The ring
+//              head is advanced, and waiting clients are woken, once for
+//              the whole batch.  Typically used only by XQueue servers.
+//
+// Parameters:  lpData      - [out] Pointer to the buffer that receives the
+//                            messages, stored back to back
+//              cbSize      - [in] size in bytes of lpData
+//              pEntries    - [out] one entry per message read, giving its
+//                            offset in lpData, size, message id and the
+//                            thread id of the thread that queued it
+//              nMaxEntries - [in] number of entries in pEntries
+//              pnEntries   - [out] number of messages read
+//              dwTimeOut   - [in] not used;  reading never blocks
+//
+// Returns:     LONG        - XQueue error code (see XQueue.h);
+//                            XQUEUE_ERROR_MORE_DATA if not even the first
+//                            message fits, in which case pEntries[0].DataSize
+//                            is the size it needs
+//
+LONG CXQueue::ReadBatch(LPBYTE         lpData,
+                        DWORD          cbSize,
+                        XQUEUE_ENTRY * pEntries,
+                        DWORD          nMaxEntries,
+                        DWORD        * pnEntries,
+                        DWORD          /*dwTimeOut = INFINITE*/)
+{
+    _ASSERTE(pnEntries);
+    if (!pnEntries)
+        return XQUEUE_ERROR_PARAMETER;
+
+    *pnEntries = 0;
+
+    _ASSERTE(lpData && pEntries && (nMaxEntries > 0));
+    if (!lpData || !pEntries || (nMaxEntries == 0))
+        return XQUEUE_ERROR_PARAMETER;
+
+    _ASSERTE(m_pRing);
+    if (!m_pRing) {
+        return XQUEUE_ERROR_NOT_OPEN;
+    }
+
+    LONG lRet = XQUEUE_ERROR_SUCCESS;
+
+    // only the server advances the head
+    const uint64_t head = m_pRing->Head.load(std::memory_order_relaxed);
+    uint64_t pos = head;
+
+    DWORD nEntries = 0;
+    DWORD nOffset = 0;
+
+    while (nEntries < nMaxEntries) {
+        XQUEUE_RECORD * pRecord = (XQUEUE_RECORD *)(m_pRingData + (pos & m_nRingMask));
+        DWORD nSize = pRecord->Size.load(std::memory_order_acquire);
+
+        if (nSize == 0) {
+            break;
+        }
+
+        if (nSize & XQUEUE_RECORD_PADDING) {
+            pRecord->Size.store(0, std::memory_order_relaxed);
+            pos += nSize & ~XQUEUE_RECORD_PADDING;
+            continue;
+        }
+
+        if (nSize > cbSize - nOffset) {
+            if (nEntries == 0) {
+                pEntries[0].DataSize = nSize;
+                lRet = XQUEUE_ERROR_MORE_DATA;
+            }
+            break;
+        }
+
+        memcpy(lpData + nOffset, pRecord + 1, nSize);
+
+        XQUEUE_ENTRY &entry = pEntries[nEntries];
+        entry.Offset    = nOffset;
+        entry.DataSize  = nSize;
+        entry.MessageId = m_pVariableBlock->MessageId++;
+        entry.ThreadId  = pRecord->ThreadId;
+
+        // unpublished space must read as zero for the next lap
+        DWORD nRecordSize = AlignRecord(XQUEUE_RECORD_HEADER_SIZE + nSize);
+        memset((void *)pRecord, 0, nRecordSize);
+
+        pos += nRecordSize;
+        nOffset += nSize;
+        nEntries++;
+    }
+
+    if (pos != head) {
+        m_pRing->Head.store(pos, std::memory_order_release);
+        m_pVariableBlock->NoReads += nEntries;
+        WakeProducers();
+    }
+
+    *pnEntries = nEntries;
+
+    if ((nEntries == 0) && (lRet == XQUEUE_ERROR_SUCCESS)) {
+        lRet = XQUEUE_ERROR_NO_DATA;
+    }
+
+    return lRet;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Write()
+//
+// Purpose:     Write string to the queue.  Typically used only by XQueue
+//              clients.
+//
+// Parameters:  lpszString - [in] Pointer to the buffer that contains the
+//                           nul-terminated string to queue
+//              dwTimeOut  - [in] specifies the time-out interval, in
+//                           milliseconds
+//
+// Returns:     LONG       - XQueue error code (see XQueue.h)
+//
+LONG CXQueue::Write(LPCTSTR lpszString,
+                    DWORD dwTimeOut /*= INFINITE*/)
+{
+    if (!IsOpen()) {
+        return XQUEUE_ERROR_NOT_OPEN;
+    }
+
+    _ASSERTE(lpszString);
+    if (!lpszString) {
+        return XQUEUE_ERROR_PARAMETER;
+    }
+
+    size_t nDataSize = (strlen(lpszString)+1) * sizeof(TCHAR);    // no. of bytes
+
+    return Write((LPBYTE) lpszString, (DWORD)nDataSize, dwTimeOut);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// Write()
+//
+// Purpose:     Write byte data to the queue.  Typically used only by XQueue
+//              clients.
+//
+// Parameters:  lpData    - [in] Pointer to the buffer that contains the
+//                          data to queue
+//              nDataSize - [in] number of bytes of data in lpData
+//              dwTimeOut - [in] specifies the time-out interval, in
+//                          milliseconds
+//
+// Returns:     LONG      - XQueue error code (see XQueue.h)
+//
+LONG CXQueue::Write(LPBYTE lpData,
+                    DWORD nDataSize,
+                    DWORD dwTimeOut /*= INFINITE*/)
+{
+    _ASSERTE(lpData);
+    _ASSERTE(nDataSize > 0);
+    if (!lpData || (nDataSize == 0))
+        return XQUEUE_ERROR_PARAMETER;
+
+    XQUEUE_BUFFER buf = { lpData, nDataSize };
+
+    return WriteGather(&buf, 1, dwTimeOut);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// WriteGather()
+//
+// Purpose:     Write one message that is made up of several buffers to the
+//              queue, without first concatenating them.  Typically used
+//              only by XQueue clients.
+//
+// Parameters:  pBuffers  - [in] Pointer to the buffers that contain the
+//                          data to queue, in order
+//              nBuffers  - [in] number of buffers in pBuffers
+//              dwTimeOut - [in] specifies the time-out interval, in
+//                          milliseconds
+//
+// Returns:     LONG      - XQueue error code (see XQueue.h)
+//
+LONG CXQueue::WriteGather(const XQUEUE_BUFFER * pBuffers,
+                          DWORD nBuffers,
+                          DWORD dwTimeOut /*= INFINITE*/)
+{
+    _ASSERTE(pBuffers);
+    _ASSERTE(nBuffers > 0);
+    if (!pBuffers || (nBuffers == 0))
+        return XQUEUE_ERROR_PARAMETER;
+
+    _ASSERTE(m_pRing);
+    if (!m_pRing) {
+        return XQUEUE_ERROR_NOT_OPEN;
+    }
+
+    uint64_t nDataSize = 0;
+    for (DWORD i = 0; i < nBuffers; i++) {
+        if ((pBuffers[i].nDataSize != 0) && !pBuffers[i].lpData)
+            return XQUEUE_ERROR_PARAMETER;
+        nDataSize += pBuffers[i].nDataSize;
+    }
+
+    if ((nDataSize == 0) || (nDataSize > GetMaxMessageSize())) {
+        return XQUEUE_ERROR_PARAMETER;
+    }
+
+    DWORD nRecordSize = AlignRecord(XQUEUE_RECORD_HEADER_SIZE + (DWORD)nDataSize);
+
+    uint64_t pos = 0;
+    LONG lRet = ReserveRecord(nRecordSize, dwTimeOut, &pos);
+    if (lRet != XQUEUE_ERROR_SUCCESS) {
+        return lRet;
+    }
+
+    XQUEUE_RECORD * pRecord = (XQUEUE_RECORD *)(m_pRingData + (pos & m_nRingMask));
+    pRecord->ThreadId = GetCurrentThreadId();
+
+    LPBYTE lpDest = (LPBYTE)(pRecord + 1);
+    for (DWORD i = 0; i < nBuffers; i++) {
+        memcpy(lpDest, pBuffers[i].lpData, pBuffers[i].nDataSize);
+        lpDest += pBuffers[i].nDataSize;
+    }
+
+    // publish the record
+    pRecord->Size.store((DWORD)nDataSize, std::memory_order_release);
+
+    UpdateWriteStats(1, (DWORD)nDataSize);
+
+    // tell server something has been queued
+    WakeConsumer();
+
+    return XQUEUE_ERROR_SUCCESS;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// WriteBatch()
+//
+// Purpose:     Write several messages to the queue.  Consecutive messages
+//              are queued with one reservation in the ring and one wakeup
+//              of the server.  Typically used only by XQueue clients.
+//
+// Parameters:  pMessages - [in] Pointer to the messages to queue;  each
+//                          buffer is one message
+//              nMessages - [in] number of messages in pMessages
+//              pnWritten - [out] number of messages queued (optional);  on
+//                          error, the messages before this one were queued
+//              dwTimeOut - [in] specifies the time-out interval, in
+//                          milliseconds, for each wait for free space
+//
+// Returns:     LONG      - XQueue error code (see XQueue.h)
+//
+LONG CXQueue::WriteBatch(const XQUEUE_BUFFER * pMessages,
+                         DWORD nMessages,
+                         DWORD * pnWritten,
+                         DWORD dwTimeOut /*= INFINITE*/)
+{
+    if (pnWritten) {
+        *pnWritten = 0;
+    }
+
+    _ASSERTE(pMessages);
+    _ASSERTE(nMessages > 0);
+    if (!pMessages || (nMessages == 0))
+        return XQUEUE_ERROR_PARAMETER;
+
+    _ASSERTE(m_pRing);
+    if (!m_pRing) {
+        return XQUEUE_ERROR_NOT_OPEN;
+    }
+
+    const uint64_t nMaxMessageSize = GetMaxMessageSize();
+
+    // check size of writes
+    for (DWORD i = 0; i < nMessages; i++) {
+        if (!pMessages[i].lpData ||
+            (pMessages[i].nDataSize == 0) ||
+            (pMessages[i].nDataSize > nMaxMessageSize))
+        {
+            _ASSERTE(FALSE);
+            return XQUEUE_ERROR_PARAMETER;
+        }
+    }
+
+    // a reservation is contiguous, so like a single record it may use at
+    // most half of the ring
+    const uint64_t nMaxReservation = (m_nRingMask + 1) / 2;
+
+    LONG lRet = XQUEUE_ERROR_SUCCESS;
+    DWORD nWritten = 0;
+
+    while (nWritten < nMessages) {
+        DWORD nChunk = 0;
+        uint64_t nChunkSize = 0;
+        while (nWritten + nChunk < nMessages) {
+            DWORD nRecordSize = AlignRecord(XQUEUE_RECORD_HEADER_SIZE + pMessages[nWritten + nChunk].nDataSize);
+            if ((nChunk > 0) && (nChunkSize + nRecordSize > nMaxReservation)) {
+                break;
+            }
+            nChunkSize += nRecordSize;
+            nChunk++;
+        }
+
+        uint64_t pos = 0;
+        lRet = ReserveRecord((DWORD)nChunkSize, dwTimeOut, &pos);
+        if (lRet != XQUEUE_ERROR_SUCCESS) {
+            break;
+        }
+
+        DWORD nMaxDataSize = 0;
+        DWORD dwThreadId = GetCurrentThreadId();
+
+        for (DWORD i = 0; i < nChunk; i++) {
+            const XQUEUE_BUFFER &msg = pMessages[nWritten + i];
+
+            XQUEUE_RECORD * pRecord = (XQUEUE_RECORD *)(m_pRingData + (pos & m_nRingMask));
+            pRecord->ThreadId = dwThreadId;
+            memcpy((LPBYTE)(pRecord + 1), msg.lpData, msg.nDataSize);
+
+            // publish each record as soon as it is complete;  the server
+            // may start reading before we are done
+            pRecord->Size.store(msg.nDataSize, std::memory_order_release);
+
+            pos += AlignRecord(XQUEUE_RECORD_HEADER_SIZE + msg.nDataSize);
+
+            if (msg.nDataSize > nMaxDataSize)
+                nMaxDataSize = msg.nDataSize;
+        }
+
+        UpdateWriteStats(nChunk, nMaxDataSize);
+
+        // tell server something has been queued
+        WakeConsumer();
+
+        nWritten += nChunk;
+    }
+
+    if (pnWritten) {
+        *pnWritten = nWritten;
+    }
+
+    return lRet;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// WaitForQueueWrite()
+//
+// Purpose:     Wait until there is something in the queue.
+//
+// Parameters:  dwTimeOut - [in] specifies the time-out interval, in
+//                          milliseconds
+//
+// Returns:     LONG      - XQueue error code (see XQueue.h)
+//
+LONG CXQueue::WaitForQueueWrite(DWORD dwTimeOut)
+{
+    _ASSERTE(m_pRing);
+    if (!m_pRing) {
+        return XQUEUE_ERROR_NOT_OPEN;
+    }
+
+    struct timespec tStart;
+    clock_gettime(CLOCK_MONOTONIC, &tStart);
+
+    for (;;) {
+        uint64_t head = m_pRing->Head.load(std::memory_order_relaxed);
+        XQUEUE_RECORD * pRecord = (XQUEUE_RECORD *)(m_pRingData + (head & m_nRingMask));
+
+        if (pRecord->Size.load(std::memory_order_acquire) != 0) {
+            m_pRing->ServerWaiting.store(0, std::memory_order_relaxed);
+            return XQUEUE_ERROR_SUCCESS;
+        }
+
+        DWORD dwRemaining = GetRemainingTime(tStart, dwTimeOut);
+        if (dwRemaining == 0) {
+            m_pRing->ServerWaiting.store(0, std::memory_order_relaxed);
+            return XQUEUE_ERROR_TIMEOUT;
+        }
+
+        // announce that we are going to sleep, then check once more before
+        // doing so;  a client publishes a record before it looks at the flag
+        if (m_pRing->ServerWaiting.load(std::memory_order_relaxed) == 0) {
+            m_pRing->ServerWaiting.store(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            continue;
+        }
+
+        FutexWait(&m_pRing->ServerWaiting, 1, dwRemaining);
+    }
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+//
+//  PRIVATE FUNCTIONS
+//
+///////////////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// ReserveRecord() - private function
+//
+// Purpose:     Claim space in the ring for a record, waiting for the server
+//              to free some if necessary.
+//
+// Parameters:  nRecordSize - [in] aligned size of the record, including its
+//                            header
+//              dwTimeOut   - [in] specifies the time-out interval, in
+//                            milliseconds
+//              pPos        - [out] ring position of the record
+//
+// Returns:     LONG        - XQueue error code (see XQueue.h)
+//
+LONG CXQueue::ReserveRecord(DWORD nRecordSize, DWORD dwTimeOut, uint64_t * pPos)
+{
+    const uint64_t nRingSize = m_nRingMask + 1;
+
+    struct timespec tStart = { 0, 0 };
+    BOOL bStarted = FALSE;
+
+    uint64_t tail = m_pRing->Tail.load(std::memory_order_relaxed);
+    uint64_t nPadding = 0;
+
+    for (;;) {
+        // a record that doesn't fit before the end of the ring is preceded
+        // by a padding record that fills the rest of it
+        uint64_t nContiguous = nRingSize - (tail & m_nRingMask);
+        nPadding = (nRecordSize <= nContiguous) ? 0 : nContiguous;
+        uint64_t nNeeded = nPadding + nRecordSize;
+
+        uint64_t head = m_pRing->Head.load(std::memory_order_acquire);
+
+        if (tail + nNeeded - head <= nRingSize) {
+            if (m_pRing->Tail.compare_exchange_weak(tail, tail + nNeeded,
+                                                    std::memory_order_relaxed))
+            {
+                break;
+            }
+            continue;    // tail was reloaded
+        }
+
+        // not enough free space, we must wait until server frees some
+        if (dwTimeOut == 0) {
+            return XQUEUE_ERROR_NO_FREE;
+        }
+
+        if (!bStarted) {
+            clock_gettime(CLOCK_MONOTONIC, &tStart);
+            bStarted = TRUE;
+        }
+
+        DWORD dwRemaining = GetRemainingTime(tStart, dwTimeOut);
+        if (dwRemaining == 0) {
+            return XQUEUE_ERROR_TIMEOUT;
+        }
+
+        uint32_t seq = m_pRing->SpaceSeq.load(std::memory_order_relaxed);
+        m_pRing->SpaceWaiters.fetch_add(1, std::memory_order_seq_cst);
+
+        // the server may have freed space before it could see us waiting
+        if (m_pRing->Head.load(std::memory_order_seq_cst) == head) {
+            FutexWait(&m_pRing->SpaceSeq, seq, dwRemaining);
+        }
+
+        m_pRing->SpaceWaiters.fetch_sub(1, std::memory_order_relaxed);
+
+        tail = m_pRing->Tail.load(std::memory_order_relaxed);
+    }
+
+    if (nPadding) {
+        XQUEUE_RECORD * pPadding = (XQUEUE_RECORD *)(m_pRingData + (tail & m_nRingMask));
+        pPadding->Size.store((DWORD)nPadding | XQUEUE_RECORD_PADDING, std::memory_order_release);
+        tail += nPadding;
+    }
+
+    *pPos = tail;
+    return XQUEUE_ERROR_SUCCESS;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// GetMaxMessageSize() - private function
+//
+// Purpose:     Get the size of the largest message that can be queued.
+//
+// Parameters:  None
+//
+// Returns:     DWORD - size in bytes
+//
+// Notes:       The limit is the one of the Windows implementation.  Create()
+//              sizes the ring so that a record of this size uses at most
+//              half of it, since it may need padding in front of it.
+//
+DWORD CXQueue::GetMaxMessageSize()
+{
+    return (DWORD)((uint64_t)m_nBlockSize * (m_nQueueSize - 1) - 1);
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// UpdateWriteStats() - private function
+//
+// Purpose:     Update the write statistics in the variable block.
+//
+// Parameters:  nMessages    - [in] number of messages written
+//              nMaxDataSize - [in] size of the largest of them
+//
+// Returns:     None
+//
+void CXQueue::UpdateWriteStats(DWORD nMessages, DWORD nMaxDataSize)
+{
+    // several clients may be writing at once
+    __atomic_fetch_add(&m_pVariableBlock->NoWrites, nMessages, __ATOMIC_RELAXED);
+
+    DWORD nMax = __atomic_load_n(&m_pVariableBlock->MaxDataSize, __ATOMIC_RELAXED);
+    while ((nMaxDataSize > nMax) &&
+           !__atomic_compare_exchange_n(&m_pVariableBlock->MaxDataSize, &nMax, nMaxDataSize,
+                                        true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    {
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// WakeConsumer() - private function
+//
+// Purpose:     Wake the server if it is asleep in WaitForQueueWrite().
+//
+// Parameters:  None
+//
+// Returns:     None
+//
+void CXQueue::WakeConsumer()
+{
+    // pairs with the store in WaitForQueueWrite():  either the server sees
+    // the record we just published, or we see that it is going to sleep
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if ((m_pRing->ServerWaiting.load(std::memory_order_relaxed) != 0) &&
+        (m_pRing->ServerWaiting.exchange(0, std::memory_order_relaxed) != 0))
+    {
+        FutexWake(&m_pRing->ServerWaiting, 1);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//
+// WakeProducers() - private function
+//
+// Purpose:     Wake the clients that are waiting for free space.
+//
+// Parameters:  None
+//
+// Returns:     None
+//
+void CXQueue::WakeProducers()
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (m_pRing->SpaceWaiters.load(std::memory_order_relaxed) != 0) {
+        m_pRing->SpaceSeq.fetch_add(1, std::memory_order_relaxed);
+        FutexWake(&m_pRing->SpaceSeq, INT_MAX);
+    }
+}
+
+#endif // _WIN32
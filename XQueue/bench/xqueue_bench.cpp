@@ -0,0 +1,238 @@
+// xqueue_bench.cpp
+//
+// Description:
+//     Throughput and latency of CXQueue between processes on POSIX systems.
+//
+//     The benchmark process creates the queue and is its server.  Every
+//     producer is a fork()ed child that opens the queue as a client.  Each
+//     message carries the producer number, a sequence number and the
+//     CLOCK_MONOTONIC time it was written, and is 8 to 207 bytes long.  The
+//     server checks the producer's order, the message ids and the payload of
+//     every message, and computes the latency from the time in the message.
+//
+//     throughput - every producer writes its messages as fast as it can, so
+//                  the latency includes the time spent in a full queue
+//     idle       - one producer writes a message every 50 us, so the server
+//                  is usually asleep in WaitForQueueWrite() and the latency
+//                  is mostly that of the wakeup
+//
+// Build (from this directory):
+//
+//     g++ -std=c++11 -O2 -DNDEBUG -I.. xqueue_bench.cpp ../XQueuePosix.cpp
+//         ../XMemmapPosix.cpp -o xqueue_bench
+//     ./xqueue_bench [messages per producer] [queue size in blocks]
+//
+///////////////////////////////////////////////////////////////////////////////
+
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+#include "XQueue.h"
+
+#define BENCH_QUEUE_NAME    _T("xqueue_bench")
+#define BENCH_BLOCK_SIZE    128
+#define BENCH_HEADER_SIZE   (2 * sizeof(DWORD) + sizeof(uint64_t))
+#define BENCH_MAX_MESSAGE   (BENCH_HEADER_SIZE + 200)
+
+struct BENCH_RESULT
+{
+    BOOL   bOk;
+    double dSeconds;
+    double dBytes;
+    double dMedianUs;
+    double dP99Us;
+    double dMaxUs;
+};
+
+static uint64_t NowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + (uint64_t)ts.tv_nsec;
+}
+
+static DWORD MessageSize(DWORD nSeq)
+{
+    return (DWORD)(BENCH_HEADER_SIZE + (nSeq * 37) % 200);
+}
+
+// runs in a child process:  writes nMessages messages, one every
+// nIntervalNs nanoseconds (0 = as fast as possible)
+static void Produce(DWORD nProducer, DWORD nMessages, uint64_t nIntervalNs)
+{
+    CXQueue queue;
+    if (queue.Open(BENCH_QUEUE_NAME) != XQUEUE_ERROR_SUCCESS) {
+        fprintf(stderr, "producer %u: Open() failed\n", nProducer);
+        _exit(1);
+    }
+
+    BYTE buf[BENCH_MAX_MESSAGE];
+    uint64_t nNext = NowNs();
+
+    for (DWORD nSeq = 0; nSeq < nMessages; nSeq++) {
+        if (nIntervalNs) {
+            nNext += nIntervalNs;
+            while (NowNs() < nNext) {
+                // spin, a sleep would be far longer than the interval
+            }
+        }
+
+        DWORD nSize = MessageSize(nSeq);
+        memset(buf, 'a' + nProducer % 26, nSize);
+        memcpy(buf, &nProducer, sizeof(DWORD));
+        memcpy(buf + sizeof(DWORD), &nSeq, sizeof(DWORD));
+
+        uint64_t nSent = NowNs();
+        memcpy(buf + 2 * sizeof(DWORD), &nSent, sizeof(uint64_t));
+
+        LONG lRet = queue.Write(buf, nSize);
+        if (lRet != XQUEUE_ERROR_SUCCESS) {
+            fprintf(stderr, "producer %u: Write() returned %d\n", nProducer, (int)lRet);
+            _exit(1);
+        }
+    }
+
+    queue.Close();
+    _exit(0);
+}
+
+static BENCH_RESULT Run(DWORD nProducers, DWORD nMessages, DWORD nQueueSize, uint64_t nIntervalNs)
+{
+    BENCH_RESULT result = { FALSE, 0, 0, 0, 0, 0 };
+
+    CXQueue server;
+    if (server.Create(BENCH_QUEUE_NAME, nQueueSize, BENCH_BLOCK_SIZE) != XQUEUE_ERROR_SUCCESS) {
+        fprintf(stderr, "Create() failed\n");
+        return result;
+    }
+
+    std::vector<uint64_t> latencies;
+    latencies.reserve((size_t)nProducers * nMessages);
+
+    uint64_t nStart = NowNs();
+    for (DWORD p = 0; p < nProducers; p++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            Produce(p, nMessages, nIntervalNs);
+        }
+        if (pid < 0) {
+            perror("fork");
+            return result;
+        }
+    }
+
+    std::vector<DWORD> next(nProducers, 0);
+    uint64_t nTotal = 0;
+    uint64_t nExpected = (uint64_t)nProducers * nMessages;
+    DWORD nLastId = 0;
+    BOOL bOk = TRUE;
+    BYTE buf[BENCH_MAX_MESSAGE];
+
+    while (bOk && (nTotal < nExpected)) {
+        if (server.WaitForQueueWrite(5000) != XQUEUE_ERROR_SUCCESS) {
+            fprintf(stderr, "timed out after %llu messages\n", (unsigned long long)nTotal);
+            bOk = FALSE;
+            break;
+        }
+
+        for (;;) {
+            DWORD nSize = sizeof(buf);
+            DWORD nId = 0;
+            DWORD nTid = 0;
+            LONG lRet = server.Read(buf, &nSize, &nId, &nTid);
+            if (lRet == XQUEUE_ERROR_NO_DATA) {
+                break;
+            }
+
+            uint64_t nReceived = NowNs();
+            DWORD nProducer = 0;
+            DWORD nSeq = 0;
+            uint64_t nSent = 0;
+            if (lRet == XQUEUE_ERROR_SUCCESS && nSize >= BENCH_HEADER_SIZE) {
+                memcpy(&nProducer, buf, sizeof(DWORD));
+                memcpy(&nSeq, buf + sizeof(DWORD), sizeof(DWORD));
+                memcpy(&nSent, buf + 2 * sizeof(DWORD), sizeof(uint64_t));
+            }
+
+            if ((lRet != XQUEUE_ERROR_SUCCESS) ||
+                (nProducer >= nProducers) ||
+                (nSeq != next[nProducer]) ||
+                (nSize != MessageSize(nSeq)) ||
+                (buf[nSize - 1] != (BYTE)('a' + nProducer % 26) && nSize > BENCH_HEADER_SIZE) ||
+                (nId != nLastId + 1))
+            {
+                fprintf(stderr, "bad message %llu: Read() returned %d, producer %u, seq %u, size %u, id %u\n",
+                        (unsigned long long)nTotal, (int)lRet, nProducer, nSeq, nSize, nId);
+                bOk = FALSE;
+                break;
+            }
+
+            next[nProducer]++;
+            nLastId = nId;
+            nTotal++;
+            result.dBytes += nSize;
+            latencies.push_back(nReceived - nSent);
+        }
+    }
+    result.dSeconds = (double)(NowNs() - nStart) / 1e9;
+
+    int nStatus = 0;
+    while (wait(&nStatus) > 0) {
+        if (!WIFEXITED(nStatus) || WEXITSTATUS(nStatus) != 0) {
+            bOk = FALSE;
+        }
+    }
+    server.Close();
+
+    if (!latencies.empty()) {
+        std::sort(latencies.begin(), latencies.end());
+        result.dMedianUs = latencies[latencies.size() / 2] / 1e3;
+        result.dP99Us    = latencies[latencies.size() * 99 / 100] / 1e3;
+        result.dMaxUs    = latencies.back() / 1e3;
+    }
+    result.bOk = bOk;
+    return result;
+}
+
+static void Print(const char * lpszMode, DWORD nProducers, DWORD nMessages, const BENCH_RESULT &r)
+{
+    double dMessages = (double)nProducers * nMessages;
+    printf("%-10s %9u %12.2f %9.1f %12.1f %10.1f %10.1f%s\n",
+           lpszMode, nProducers, dMessages / r.dSeconds / 1e6, r.dBytes / r.dSeconds / (1024 * 1024),
+           r.dMedianUs, r.dP99Us, r.dMaxUs, r.bOk ? "" : "  (failed)");
+}
+
+int main(int argc, char ** argv)
+{
+    DWORD nMessages  = (argc > 1) ? (DWORD)strtoul(argv[1], NULL, 10) : 1000000;
+    DWORD nQueueSize = (argc > 2) ? (DWORD)strtoul(argv[2], NULL, 10) : XQUEUE_DEFAULT_QUEUE_SIZE;
+
+    printf("%u messages per producer, %u-byte blocks, %u blocks\n", nMessages, BENCH_BLOCK_SIZE, nQueueSize);
+    printf("%-10s %9s %12s %9s %12s %10s %10s\n",
+           "mode", "producers", "Mmsg/s", "MiB/s", "median us", "p99 us", "max us");
+
+    BOOL bOk = TRUE;
+    const DWORD producers[] = { 1, 2, 4 };
+    for (DWORD nProducers : producers) {
+        BENCH_RESULT r = Run(nProducers, nMessages, nQueueSize, 0);
+        Print("throughput", nProducers, nMessages, r);
+        bOk = bOk && r.bOk;
+    }
+
+    DWORD nIdleMessages = std::min<DWORD>(nMessages, 20000);
+    BENCH_RESULT r = Run(1, nIdleMessages, nQueueSize, 50000);
+    Print("idle", 1, nIdleMessages, r);
+    bOk = bOk && r.bOk;
+
+    if (!bOk) {
+        fprintf(stderr, "a message was lost, reordered or corrupted\n");
+        return 1;
+    }
+    return 0;
+}
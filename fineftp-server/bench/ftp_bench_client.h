@@ -0,0 +1,215 @@
+#pragma once
+
+// A minimal blocking FTP client for the benchmarks and tests. It only knows
+// what they need (login, PASV, RETR, STOR, QUIT) and uses plain POSIX sockets,
+// so it does not share any code with the server it measures.
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cctype>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace fineftp
+{
+namespace bench
+{
+  inline double cpuSeconds()
+  {
+    rusage ru{};
+    getrusage(RUSAGE_SELF, &ru);
+    return static_cast<double>(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec)
+         + static_cast<double>(ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) / 1e6;
+  }
+
+  inline int connectTo(uint16_t port)
+  {
+    const int sock = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (sock < 0)
+      return -1;
+
+    sockaddr_in addr{};
+    addr.sin_family      = AF_INET;
+    addr.sin_port        = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(sock, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0)
+    {
+      ::close(sock);
+      return -1;
+    }
+
+    const int one = 1;
+    ::setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return sock;
+  }
+
+  class FtpBenchClient
+  {
+  public:
+    FtpBenchClient() = default;
+    FtpBenchClient(const FtpBenchClient&) = delete;
+    FtpBenchClient& operator=(const FtpBenchClient&) = delete;
+
+    ~FtpBenchClient()
+    {
+      if (sock_ >= 0)
+        ::close(sock_);
+    }
+
+    // Connects and logs in as anonymous. Returns false on any error.
+    bool login(uint16_t port)
+    {
+      sock_ = connectTo(port);
+      return (sock_ >= 0)
+          && (readReply() == 220)
+          && (command("USER anonymous") == 331)
+          && (command("PASS bench") == 230);
+    }
+
+    void quit()
+    {
+      command("QUIT");
+      ::close(sock_);
+      sock_ = -1;
+    }
+
+    // Sends a command and returns the code of the (last line of the) reply,
+    // or -1 if the connection failed.
+    int command(const std::string& cmd)
+    {
+      const std::string line = cmd + "\r\n";
+      if (::send(sock_, line.data(), line.size(), MSG_NOSIGNAL) != static_cast<ssize_t>(line.size()))
+        return -1;
+      return readReply();
+    }
+
+    // Downloads a file in the current TYPE and returns the number of bytes
+    // received, or -1 on error. The data is kept in content, if given.
+    long long retr(const std::string& path, std::string* content = nullptr)
+    {
+      const int data_sock = openDataConnection();
+      if (data_sock < 0)
+        return -1;
+
+      const int code = command("RETR " + path);
+      if ((code != 150) && (code != 125))
+      {
+        ::close(data_sock);
+        return -1;
+      }
+
+      data_buffer_.resize(1024 * 1024);
+      long long total = 0;
+      for (;;)
+      {
+        const ssize_t n = ::recv(data_sock, data_buffer_.data(), data_buffer_.size(), 0);
+        if (n <= 0)
+          break;
+        total += n;
+        if (content != nullptr)
+          content->append(data_buffer_.data(), static_cast<size_t>(n));
+      }
+      ::close(data_sock);
+
+      return (readReply() == 226) ? total : -1;
+    }
+
+    // Uploads data in the current TYPE. Returns the code of the final reply,
+    // or of the reply to STOR if that refused the upload, or -1 on error.
+    int stor(const std::string& path, const std::string& data)
+    {
+      const int data_sock = openDataConnection();
+      if (data_sock < 0)
+        return -1;
+
+      const int code = command("STOR " + path);
+      if ((code != 150) && (code != 125))
+      {
+        ::close(data_sock);
+        return code;
+      }
+
+      size_t sent = 0;
+      while (sent < data.size())
+      {
+        const ssize_t n = ::send(data_sock, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+        if (n <= 0)
+          break;
+        sent += static_cast<size_t>(n);
+      }
+      ::close(data_sock);
+
+      return (sent == data.size()) ? readReply() : -1;
+    }
+
+  private:
+    // Enters passive mode and connects to the data port
+    int openDataConnection()
+    {
+      if (command("PASV") != 227)
+        return -1;
+
+      // 227 Entering Passive Mode (h1,h2,h3,h4,p1,p2)
+      const auto paren = last_reply_.find('(');
+      unsigned int h[4], p[2];
+      if ((paren == std::string::npos)
+        || (std::sscanf(last_reply_.c_str() + paren, "(%u,%u,%u,%u,%u,%u)", &h[0], &h[1], &h[2], &h[3], &p[0], &p[1]) != 6))
+        return -1;
+
+      return connectTo(static_cast<uint16_t>(p[0] * 256 + p[1]));
+    }
+
+    int readReply()
+    {
+      for (;;)
+      {
+        std::string line;
+        if (!readLine(line))
+          return -1;
+
+        // The last line of a reply is "ddd text", all others are "ddd-text"
+        // or free text.
+        if ((line.size() >= 4) && (line[3] == ' ') && (std::isdigit(static_cast<unsigned char>(line[0])) != 0))
+        {
+          last_reply_ = line;
+          return std::atoi(line.c_str());
+        }
+      }
+    }
+
+    bool readLine(std::string& line)
+    {
+      for (;;)
+      {
+        const auto end = buffer_.find("\r\n");
+        if (end != std::string::npos)
+        {
+          line = buffer_.substr(0, end);
+          buffer_.erase(0, end + 2);
+          return true;
+        }
+
+        char chunk[4096];
+        const ssize_t n = ::recv(sock_, chunk, sizeof(chunk), 0);
+        if (n <= 0)
+          return false;
+        buffer_.append(chunk, static_cast<size_t>(n));
+      }
+    }
+
+    int               sock_ = -1;
+    std::string       buffer_;
+    std::string       last_reply_;
+    std::vector<char> data_buffer_;
+  };
+}
+}
@@ -0,0 +1,134 @@
+// Throughput and CPU cost of RETR over loopback.
+//
+// The server runs in the same process and serves one file from a temporary
+// directory that stays in the page cache. Downloads in TYPE I take the
+// sendfile() path on Linux, downloads in TYPE A take the buffered path that
+// reads the file into transfer buffers, which sends the same bytes on Linux.
+// CPU time is that of the whole process and includes the client, which only
+// receives into one buffer, the same for both modes. Building the same file
+// against the sources of an older server compares the server versions.
+//
+//   g++ -std=c++14 -O2 -DNDEBUG -I../include -I../src -I<asio>/include
+//       retr_bench.cpp ../src/*.cpp -lpthread -o retr_bench
+//   ./retr_bench [file_mib] [downloads] [parallel]
+
+#include <fineftp/server.h>
+
+#include "ftp_bench_client.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace
+{
+  struct Result
+  {
+    double mib_per_second   = 0;
+    double cpu_ms_per_gib   = 0;
+    bool   ok               = true;
+  };
+
+  // parallel clients each download the file `downloads` times
+  Result run(uint16_t port, const char* type, size_t file_size, int downloads, int parallel)
+  {
+    Result                   result;
+    std::atomic<bool>        ok(true);
+    std::vector<std::thread> clients;
+
+    const double cpu_start = fineftp::bench::cpuSeconds();
+    const auto   start     = std::chrono::steady_clock::now();
+    for (int c = 0; c < parallel; c++)
+    {
+      clients.emplace_back([&]()
+                           {
+                             fineftp::bench::FtpBenchClient client;
+                             if (!client.login(port) || (client.command(std::string("TYPE ") + type) != 200))
+                             {
+                               ok = false;
+                               return;
+                             }
+                             for (int i = 0; i < downloads; i++)
+                             {
+                               if (client.retr("/data.bin") != static_cast<long long>(file_size))
+                                 ok = false;
+                             }
+                             client.quit();
+                           });
+    }
+    for (auto& client : clients)
+      client.join();
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const double cpu     = fineftp::bench::cpuSeconds() - cpu_start;
+    const double gib     = static_cast<double>(file_size) * downloads * parallel / (1024.0 * 1024.0 * 1024.0);
+
+    result.ok             = ok;
+    result.mib_per_second = gib * 1024.0 / seconds;
+    result.cpu_ms_per_gib = cpu * 1000.0 / gib;
+    return result;
+  }
+}
+
+int main(int argc, char** argv)
+{
+  const size_t file_mib  = (argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 256);
+  const int    downloads = (argc > 2 ? std::atoi(argv[2]) : 4);
+  const int    parallel  = (argc > 3 ? std::atoi(argv[3]) : 1);
+
+  char dir[] = "/tmp/fineftp_bench_XXXXXX";
+  if (mkdtemp(dir) == nullptr)
+  {
+    std::perror("mkdtemp");
+    return 1;
+  }
+  const std::string file_path = std::string(dir) + "/data.bin";
+  const size_t      file_size = file_mib * 1024 * 1024;
+  {
+    std::ofstream     file(file_path, std::ios::binary);
+    const std::string chunk(1024 * 1024, 'x');
+    for (size_t i = 0; i < file_mib; i++)
+      file.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+  }
+
+  fineftp::FtpServer server("127.0.0.1", 0);
+  server.addUserAnonymous(dir, fineftp::Permission::All);
+  server.start(2);
+  const uint16_t port = server.getPort();
+
+  std::printf("%zu MiB file, %d downloads on each of %d connections, best of 3\n", file_mib, downloads, parallel);
+  std::printf("%-8s %10s %14s\n", "type", "MiB/s", "CPU ms/GiB");
+
+  bool ok = true;
+  for (const char* type : { "I", "A" })
+  {
+    Result best;
+    for (int round = 0; round < 3; round++)
+    {
+      const Result result = run(port, type, file_size, downloads, parallel);
+      ok = ok && result.ok;
+      if (result.mib_per_second > best.mib_per_second)
+        best = result;
+    }
+    std::printf("%-8s %10.0f %14.0f\n", (std::string("TYPE ") + type).c_str(), best.mib_per_second, best.cpu_ms_per_gib);
+  }
+
+  server.stop();
+  ::unlink(file_path.c_str());
+  ::rmdir(dir);
+
+  if (!ok)
+  {
+    std::fprintf(stderr, "a download failed or was incomplete\n");
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,159 @@
+// Connections per second and aggregate download throughput against the
+// number of server threads, for both threading models.
+//
+// The server runs in the same process. For the connection rate, client
+// threads log in and quit over and over, each time on a new control
+// connection. For the throughput, client threads download a file from the
+// page cache over loopback at the same time. CPU time is that of the whole
+// process, including the clients. The scaling can only show on a machine
+// with at least as many idle cores as server threads plus client threads.
+//
+//   g++ -std=c++14 -O2 -DNDEBUG -I../include -I../src -I<asio>/include
+//       scaling_bench.cpp ../src/*.cpp -lpthread -o scaling_bench
+//   ./scaling_bench [max_threads] [clients] [seconds] [file_mib]
+
+#include <fineftp/server.h>
+
+#include "ftp_bench_client.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace
+{
+  struct Rates
+  {
+    double per_second     = 0;
+    double cpu_us_per_op  = 0;
+    bool   ok             = true;
+  };
+
+  // Runs op on each client thread until the time is up. op returns the
+  // amount of work it has done (1 connection, n bytes), or -1 on error.
+  template <typename Op>
+  Rates measure(int clients, double seconds, Op op)
+  {
+    std::atomic<bool>      ok(true);
+    std::atomic<long long> total(0);
+    std::vector<std::thread> threads;
+
+    const double cpu_start = fineftp::bench::cpuSeconds();
+    const auto   start     = std::chrono::steady_clock::now();
+    const auto   end       = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds));
+    for (int c = 0; c < clients; c++)
+    {
+      threads.emplace_back([&]()
+                           {
+                             while (std::chrono::steady_clock::now() < end)
+                             {
+                               const long long done = op();
+                               if (done < 0)
+                               {
+                                 ok = false;
+                                 return;
+                               }
+                               total += done;
+                             }
+                           });
+    }
+    for (auto& thread : threads)
+      thread.join();
+
+    const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const double cpu     = fineftp::bench::cpuSeconds() - cpu_start;
+
+    Rates rates;
+    rates.ok            = ok;
+    rates.per_second    = static_cast<double>(total) / elapsed;
+    rates.cpu_us_per_op = (total > 0 ? cpu * 1e6 / static_cast<double>(total) : 0);
+    return rates;
+  }
+}
+
+int main(int argc, char** argv)
+{
+  const size_t max_threads = (argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 8);
+  const int    clients     = (argc > 2 ? std::atoi(argv[2]) : 8);
+  const double seconds     = (argc > 3 ? std::atof(argv[3]) : 2.0);
+  const size_t file_mib    = (argc > 4 ? std::strtoul(argv[4], nullptr, 10) : 16);
+
+  char dir[] = "/tmp/fineftp_bench_XXXXXX";
+  if (mkdtemp(dir) == nullptr)
+  {
+    std::perror("mkdtemp");
+    return 1;
+  }
+  const std::string file_path = std::string(dir) + "/data.bin";
+  const size_t      file_size = file_mib * 1024 * 1024;
+  {
+    std::ofstream     file(file_path, std::ios::binary);
+    const std::string chunk(1024 * 1024, 'x');
+    for (size_t i = 0; i < file_mib; i++)
+      file.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+  }
+
+  std::printf("%d clients, %.1f s per measurement, %zu MiB file, %u cores\n", clients, seconds, file_mib, std::thread::hardware_concurrency());
+  std::printf("%-10s %7s %10s %13s %10s %14s\n", "model", "threads", "conn/s", "CPU us/conn", "MiB/s", "CPU ms/GiB");
+
+  bool ok = true;
+  for (const auto model : { fineftp::ThreadingModel::SharedIoService, fineftp::ThreadingModel::IoServicePerThread })
+  {
+    for (size_t threads = 1; threads <= max_threads; threads *= 2)
+    {
+      fineftp::FtpServer server("127.0.0.1", 0);
+      server.addUserAnonymous(dir, fineftp::Permission::All);
+      server.setThreadingModel(model);
+      server.start(threads);
+      const uint16_t port = server.getPort();
+
+      const Rates connections = measure(clients, seconds, [port]() -> long long
+                                        {
+                                          fineftp::bench::FtpBenchClient client;
+                                          if (!client.login(port))
+                                            return -1;
+                                          client.quit();
+                                          return 1;
+                                        });
+
+      const Rates bytes = measure(clients, seconds, [port, file_size]() -> long long
+                                  {
+                                    fineftp::bench::FtpBenchClient client;
+                                    if (!client.login(port) || (client.command("TYPE I") != 200))
+                                      return -1;
+                                    const long long received = client.retr("/data.bin");
+                                    client.quit();
+                                    return (received == static_cast<long long>(file_size) ? received : -1);
+                                  });
+
+      server.stop();
+
+      ok = ok && connections.ok && bytes.ok;
+      std::printf("%-10s %7zu %10.0f %13.1f %10.0f %14.0f\n"
+                 , (model == fineftp::ThreadingModel::SharedIoService ? "shared" : "per-thread")
+                 , threads
+                 , connections.per_second
+                 , connections.cpu_us_per_op
+                 , bytes.per_second / (1024.0 * 1024.0)
+                 , bytes.cpu_us_per_op * 1024.0 * 1024.0 * 1024.0 / 1000.0);
+    }
+  }
+
+  ::unlink(file_path.c_str());
+  ::rmdir(dir);
+
+  if (!ok)
+  {
+    std::fprintf(stderr, "a connection or download failed\n");
+    return 1;
+  }
+  return 0;
+}
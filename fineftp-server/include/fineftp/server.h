@@ -1,7 +1,12 @@
 #pragma once
 
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
 #include <memory>
 #include <string>
+#include <vector>
 
 #include "permissions.h"
 
@@ -11,6 +16,105 @@ namespace fineftp
   /** Private implementation */
   class FtpServerImpl;
 
+  /**
+   * @brief Where file reads and writes of data transfers are executed
+   *
+   * File I/O never runs on the threads that serve the network connections,
+   * so a slow disk does not delay other sessions.
+   */
+  enum class FileIoBackend
+  {
+    Auto,       /**< io_uring if the system supports it, a thread pool otherwise */
+    ThreadPool, /**< Blocking I/O on a dedicated thread pool */
+    IoUring,    /**< Linux io_uring. Falls back to a thread pool if not available. */
+  };
+
+  /**
+   * @brief How the threads of the server are organized
+   */
+  enum class ThreadingModel
+  {
+    /**
+     * All threads run a single shared io_service and a single acceptor. The
+     * handlers of a session may run on any thread.
+     */
+    SharedIoService,
+
+    /**
+     * Each thread runs its own io_service. A session and its data
+     * connections stay on the io_service of the thread that accepted it, so
+     * threads never contend for a shared scheduler. On Linux, each thread
+     * has its own acceptor (SO_REUSEPORT) and the kernel distributes the
+     * connections. On other systems, a single acceptor hands the
+     * connections to the threads round robin.
+     */
+    IoServicePerThread,
+  };
+
+  /**
+   * @brief Statistics of the buffers that are used for file transfers
+   *
+   * All data connections of a server share one pool of buffers. A hit means
+   * that a recycled buffer was used, a miss means that a new buffer had to
+   * be allocated.
+   */
+  struct TransferBufferStats
+  {
+    size_t   buffer_size = 0;   /**< Size of each buffer in bytes */
+    uint64_t hits        = 0;   /**< Number of buffers taken from the pool */
+    uint64_t misses      = 0;   /**< Number of buffers that had to be allocated */
+    size_t   in_use      = 0;   /**< Number of buffers currently used by transfers */
+    size_t   peak_in_use = 0;   /**< Maximum number of buffers that were in use at the same time */
+    size_t   pooled      = 0;   /**< Number of idle buffers currently kept in the pool */
+  };
+
+  /**
+   * @brief Bandwidth limits of data transfers
+   *
+   * Limits are averaged over time, so short bursts above the limit are
+   * possible. A value of 0 means unlimited.
+   */
+  struct RateLimit
+  {
+    uint64_t download_bytes_per_second = 0;   /**< Data sent to clients (RETR, LIST, NLST, MLSD) */
+    uint64_t upload_bytes_per_second   = 0;   /**< Data received from clients (STOR, APPE) */
+  };
+
+  /**
+   * @brief Distribution of the time the server needed to process a command
+   *
+   * counts[i] is the number of commands that took at most upper_bounds[i]
+   * (and more than upper_bounds[i-1]). The last entry of counts holds all
+   * commands that took longer than the last upper bound, so counts has one
+   * more entry than upper_bounds.
+   */
+  struct LatencyHistogram
+  {
+    std::vector<std::chrono::microseconds> upper_bounds;
+    std::vector<uint64_t>                  counts;
+    uint64_t                               total_count = 0;
+    std::chrono::microseconds              total_time  {0};
+  };
+
+  /**
+   * @brief A snapshot of the server's transfer metrics
+   */
+  struct ServerMetrics
+  {
+    uint64_t bytes_sent                 = 0;  /**< Data bytes sent since the server was started */
+    uint64_t bytes_received             = 0;  /**< Data bytes received since the server was started */
+    double   sent_bytes_per_second      = 0;  /**< Average send rate of the last few seconds */
+    double   received_bytes_per_second  = 0;  /**< Average receive rate of the last few seconds */
+
+    size_t   active_downloads           = 0;  /**< Downloads and listings that have been started and have not finished yet */
+    size_t   active_uploads             = 0;  /**< Uploads that have been started and have not finished yet */
+
+    size_t   queued_send_buffers        = 0;  /**< Buffers that wait to be sent on a data connection */
+    size_t   pending_file_io_requests   = 0;  /**< File reads and writes that have not completed yet */
+
+    std::map<std::string, LatencyHistogram> command_latency;  /**< Processing time of each FTP command, e.g. "RETR" */
+  };
+
   /**
    * @brief The fineftp::FtpServer is a simple FTP server library.
    * 
@@ -103,6 +207,124 @@ namespace fineftp
      */
     bool addUserAnonymous(const std::string& local_root_path, const Permission permissions);
 
+    /**
+     * @brief Sets the size of the buffers used for file transfers
+     *
+     * Files are read and written in chunks of this size. Must be called
+     * before start(). Defaults to 1 MiB.
+     *
+     * @param buffer_size: The buffer size in bytes. Must not be 0.
+     */
+    void setTransferBufferSize(size_t buffer_size);
+
+    /**
+     * @brief Sets how many buffers a single download may have in flight
+     *
+     * While one buffer is being sent, the following ones are already read
+     * from the file. Must be called before start(). Defaults to 3.
+     *
+     * @param queue_depth: The number of buffers per transfer. Must not be 0.
+     */
+    void setTransferQueueDepth(size_t queue_depth);
+
+    /**
+     * @brief Selects how files are read and written during transfers
+     *
+     * Must be called before start(). Defaults to FileIoBackend::Auto with 2
+     * threads.
+     *
+     * @param backend:      The file I/O backend
+     * @param thread_count: The number of threads of the thread pool backend. Must not be 0.
+     */
+    void setFileIoBackend(FileIoBackend backend, size_t thread_count = 2);
+
+    /**
+     * @brief Selects whether directory listings are sorted by name
+     *
+     * Listings are always streamed to the client while they are created.
+     * Unsorted listings are sent in the order the filesystem returns the
+     * entries, so even the first bytes of a listing of a huge directory are
+     * sent immediately. Sorted listings have to read all names first.
+     * Must be called before start(). Defaults to true.
+     *
+     * @param sort: Whether LIST, NLST and MLSD output is sorted by name
+     */
+    void setSortDirectoryListings(bool sort);
+
+    /**
+     * @brief Enables a cache for directory listings
+     *
+     * Clients that repeatedly list the same large directories are served
+     * from the cache without reading the directory or stat'ing its entries.
+     * On Linux, cached listings are invalidated as soon as the directory
+     * changes. On other systems, changes that are not made through this
+     * server may only become visible after max_age.
+     * Must be called before start(). The cache is disabled by default.
+     *
+     * @param memory_budget: Maximum memory used by cached listings in bytes. 0 disables the cache.
+     * @param max_age:       Time after which a cached listing is read again
+     */
+    void setListingCache(size_t memory_budget, std::chrono::milliseconds max_age);
+
+    /**
+     * @brief Limits the bandwidth of all transfers of the server combined
+     *
+     * Can be changed while the server is running. Unlimited by default.
+     *
+     * @param rate_limit: The download and upload limits
+     */
+    void setGlobalRateLimit(const RateLimit& rate_limit);
+
+    /**
+     * @brief Limits the bandwidth of each individual session
+     *
+     * Only affects sessions that are opened afterwards. Unlimited by
+     * default.
+     *
+     * @param rate_limit: The download and upload limits
+     */
+    void setSessionRateLimit(const RateLimit& rate_limit);
+
+    /**
+     * @brief Limits the bandwidth of all sessions of a user combined
+     *
+     * Can be changed while the server is running. Users are unlimited by
+     * default.
+     *
+     * @param username:   The user, as given to addUser(). Use "anonymous" for the anonymous user.
+     * @param rate_limit: The download and upload limits
+     *
+     * @return False, if the user does not exist
+     */
+    bool setUserRateLimit(const std::string& username, const RateLimit& rate_limit);
+
+    /**
+     * @brief Returns a snapshot of the transfer metrics
+     *
+     * @return The metrics. All values are 0 until the server has been
+     *         started.
+     */
+    ServerMetrics getMetrics() const;
+
+    /**
+     * @brief Selects how the threads given to start() are organized
+     *
+     * IoServicePerThread scales better with many threads and high
+     * connection rates. Must be called before start(). Defaults to
+     * ThreadingModel::SharedIoService.
+     *
+     * @param threading_model: The threading model
+     */
+    void setThreadingModel(ThreadingModel threading_model);
+
+    /**
+     * @brief Returns the statistics of the transfer buffer pool
+     *
+     * @return The buffer pool statistics. All values are 0 until the server
+     *         has been started.
+     */
+    TransferBufferStats getTransferBufferStats() const;
+
     /**
      * @brief Starts the FTP Server
      * 
@@ -0,0 +1,82 @@
+#include "bandwidth_limiter.h"
+
+#include <algorithm>
+
+namespace fineftp
+{
+  ////////////////////////////////////////////////////////
+  // TokenBucket
+  ////////////////////////////////////////////////////////
+
+  TokenBucket::TokenBucket()
+    : bytes_per_second_(0)
+    , tokens_          (0.0)
+    , last_refill_     (Clock::now())
+  {}
+
+  void TokenBucket::setRate(uint64_t bytes_per_second)
+  {
+    std::lock_guard<std::mutex> bucket_lock(bucket_mutex_);
+    bytes_per_second_ = bytes_per_second;
+    tokens_           = capacity(bytes_per_second);
+    last_refill_      = Clock::now();
+  }
+
+  double TokenBucket::capacity(uint64_t bytes_per_second)
+  {
+    return std::max(static_cast<double>(bytes_per_second) / 8.0, 64.0 * 1024.0);
+  }
+
+  bool TokenBucket::isLimited() const
+  {
+    return (bytes_per_second_ != 0);
+  }
+
+  TokenBucket::Clock::time_point TokenBucket::consume(size_t bytes)
+  {
+    const auto now = Clock::now();
+
+    std::lock_guard<std::mutex> bucket_lock(bucket_mutex_);
+
+    const uint64_t bytes_per_second = bytes_per_second_;
+    if (bytes_per_second == 0)
+      return now;
+
+    const double rate    = static_cast<double>(bytes_per_second);
+    const double elapsed = std::chrono::duration<double>(now - last_refill_).count();
+
+    tokens_      = std::min(capacity(bytes_per_second), tokens_ + elapsed * rate);
+    last_refill_ = now;
+    tokens_     -= static_cast<double>(bytes);
+
+    if (tokens_ >= 0.0)
+      return now;
+
+    return now + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(-tokens_ / rate));
+  }
+
+  ////////////////////////////////////////////////////////
+  // BandwidthLimiter
+  ////////////////////////////////////////////////////////
+
+  BandwidthLimiter::BandwidthLimiter(const RateLimit& rate_limit)
+  {
+    setRateLimit(rate_limit);
+  }
+
+  void BandwidthLimiter::setRateLimit(const RateLimit& rate_limit)
+  {
+    download_bucket_.setRate(rate_limit.download_bytes_per_second);
+    upload_bucket_  .setRate(rate_limit.upload_bytes_per_second);
+  }
+
+  bool BandwidthLimiter::isLimited(TransferDirection direction) const
+  {
+    return (direction == TransferDirection::Download ? download_bucket_.isLimited() : upload_bucket_.isLimited());
+  }
+
+  BandwidthLimiter::Clock::time_point BandwidthLimiter::consume(TransferDirection direction, size_t bytes)
+  {
+    return (direction == TransferDirection::Download ? download_bucket_.consume(bytes) : upload_bucket_.consume(bytes));
+  }
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+#include "../include/fineftp/server.h"
+
+namespace fineftp
+{
+  enum class TransferDirection
+  {
+    Download,   /**< Data sent to the client: RETR and directory listings */
+    Upload,     /**< Data received from the client: STOR and APPE */
+  };
+
+  /**
+   * @brief A token bucket that limits the average data rate
+   *
+   * Transfers consume tokens after they have transferred data, so the bucket
+   * can go into debt. The transfer then has to pause until the debt has been
+   * paid off by the refill. That way, a transfer never has to ask for
+   * permission before it knows how many bytes the socket accepted.
+   *
+   * The bucket holds at most 1/8 s worth of tokens (at least 64 KiB), which
+   * is the burst a transfer may send after having been idle.
+   */
+  class TokenBucket
+  {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    TokenBucket();
+
+    TokenBucket(const TokenBucket&)            = delete;
+    TokenBucket& operator=(const TokenBucket&) = delete;
+
+    /** @param bytes_per_second: The rate limit. 0 means unlimited. */
+    void setRate(uint64_t bytes_per_second);
+
+    bool isLimited() const;
+
+    /**
+     * @brief Takes the given number of bytes from the bucket
+     *
+     * @return The time at which the next transfer may continue
+     */
+    Clock::time_point consume(size_t bytes);
+
+  private:
+    static double capacity(uint64_t bytes_per_second);
+
+    std::atomic<uint64_t> bytes_per_second_;
+
+    std::mutex            bucket_mutex_;
+    double                tokens_;
+    Clock::time_point     last_refill_;
+  };
+
+  /**
+   * @brief Download and upload rate limits of one scope (session, user or server)
+   */
+  class BandwidthLimiter
+  {
+  public:
+    using Clock = TokenBucket::Clock;
+
+    BandwidthLimiter() = default;
+    explicit BandwidthLimiter(const RateLimit& rate_limit);
+
+    void setRateLimit(const RateLimit& rate_limit);
+
+    bool isLimited(TransferDirection direction) const;
+
+    Clock::time_point consume(TransferDirection direction, size_t bytes);
+
+  private:
+    TokenBucket download_bucket_;
+    TokenBucket upload_bucket_;
+  };
+}
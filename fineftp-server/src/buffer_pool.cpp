@@ -0,0 +1,63 @@
+#include "buffer_pool.h"
+
+namespace fineftp
+{
+  BufferPool::BufferPool(size_t buffer_size, size_t max_pooled_buffers)
+    : buffer_size_       (buffer_size)
+    , max_pooled_buffers_(max_pooled_buffers)
+  {
+    free_buffers_.reserve(max_pooled_buffers_);
+  }
+
+  std::shared_ptr<TransferBuffer> BufferPool::acquire()
+  {
+    std::unique_ptr<char[]> data;
+
+    {
+      std::lock_guard<std::mutex> pool_lock(pool_mutex_);
+
+      if (!free_buffers_.empty())
+      {
+        data = std::move(free_buffers_.back());
+        free_buffers_.pop_back();
+        stats_.hits++;
+      }
+      else
+      {
+        stats_.misses++;
+      }
+
+      stats_.in_use++;
+      if (stats_.in_use > stats_.peak_in_use)
+        stats_.peak_in_use = stats_.in_use;
+    }
+
+    // Allocate outside of the lock. new char[] leaves the memory uninitialized.
+    if (!data)
+      data.reset(new char[buffer_size_]);
+
+    auto* buffer = new TransferBuffer(std::move(data), buffer_size_);
+    return std::shared_ptr<TransferBuffer>(buffer, [me = shared_from_this()](TransferBuffer* b) { me->release(b); });
+  }
+
+  void BufferPool::release(TransferBuffer* buffer)
+  {
+    std::unique_ptr<TransferBuffer> buffer_holder(buffer);
+
+    std::lock_guard<std::mutex> pool_lock(pool_mutex_);
+    stats_.in_use--;
+
+    if (free_buffers_.size() < max_pooled_buffers_)
+      free_buffers_.push_back(std::move(buffer_holder->data_));
+  }
+
+  TransferBufferStats BufferPool::stats() const
+  {
+    std::lock_guard<std::mutex> pool_lock(pool_mutex_);
+
+    TransferBufferStats stats = stats_;
+    stats.buffer_size = buffer_size_;
+    stats.pooled      = free_buffers_.size();
+    return stats;
+  }
+}
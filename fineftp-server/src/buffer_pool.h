@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "../include/fineftp/server.h"
+
+namespace fineftp
+{
+  /**
+   * @brief A fixed-capacity chunk of memory for file and socket I/O
+   *
+   * The memory is not initialized. size() is the number of valid bytes and
+   * may be reduced with resize() after a short read.
+   */
+  class TransferBuffer
+  {
+  public:
+    explicit TransferBuffer(size_t capacity)
+      : data_    (new char[capacity])
+      , capacity_(capacity)
+      , size_    (capacity)
+    {}
+
+    TransferBuffer(std::unique_ptr<char[]> data, size_t capacity)
+      : data_    (std::move(data))
+      , capacity_(capacity)
+      , size_    (capacity)
+    {}
+
+    TransferBuffer(const TransferBuffer&)            = delete;
+    TransferBuffer& operator=(const TransferBuffer&) = delete;
+
+    char*       data()           { return data_.get(); }
+    const char* data()     const { return data_.get(); }
+    size_t      size()     const { return size_; }
+    size_t      capacity() const { return capacity_; }
+
+    void resize(size_t size)     { size_ = (size < capacity_ ? size : capacity_); }
+
+  private:
+    friend class BufferPool;
+
+    std::unique_ptr<char[]> data_;
+    size_t                  capacity_;
+    size_t                  size_;
+  };
+
+  /**
+   * @brief A server-wide pool of equally sized TransferBuffers
+   *
+   * Buffers handed out by acquire() go back to the pool when the last
+   * shared_ptr to them is released, so the memory is recycled instead of
+   * being allocated (and zeroed) for every chunk of every transfer. At most
+   * max_pooled_buffers idle buffers are kept, the rest is freed.
+   *
+   * The pool is thread safe. Each buffer keeps the pool alive, so buffers
+   * may outlive the server that created them.
+   */
+  class BufferPool
+    : public std::enable_shared_from_this<BufferPool>
+  {
+  public:
+    BufferPool(size_t buffer_size, size_t max_pooled_buffers);
+
+    BufferPool(const BufferPool&)            = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    std::shared_ptr<TransferBuffer> acquire();
+
+    size_t bufferSize() const { return buffer_size_; }
+
+    TransferBufferStats stats() const;
+
+  private:
+    void release(TransferBuffer* buffer);
+
+    const size_t buffer_size_;
+    const size_t max_pooled_buffers_;
+
+    mutable std::mutex                   pool_mutex_;
+    std::vector<std::unique_ptr<char[]>> free_buffers_;
+    TransferBufferStats                  stats_;
+  };
+}
@@ -0,0 +1,229 @@
+#include "directory_listing.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace fineftp
+{
+  DirectoryListing::DirectoryListing(const std::string& local_path, ListingFormat format, bool sorted, Permission permissions)
+    : reader_           (std::make_unique<Filesystem::DirectoryReader>(local_path))
+    , format_           (format)
+    , sorted_           (sorted)
+    , permissions_      (permissions)
+    , rendered_offset_  (0)
+    , max_recorded_size_(0)
+    , names_read_       (false)
+    , next_sorted_name_ (0)
+    , line_offset_      (0)
+    , done_             (false)
+  {}
+
+  DirectoryListing::DirectoryListing(std::shared_ptr<const std::string> rendered_listing)
+    : format_           (ListingFormat::List)
+    , sorted_           (false)
+    , permissions_      (Permission::None)
+    , rendered_listing_ (std::move(rendered_listing))
+    , rendered_offset_  (0)
+    , max_recorded_size_(0)
+    , names_read_       (false)
+    , next_sorted_name_ (0)
+    , line_offset_      (0)
+    , done_             (false)
+  {}
+
+  bool DirectoryListing::isOk() const
+  {
+    return (rendered_listing_ || reader_->isOk());
+  }
+
+  void DirectoryListing::recordOutput(size_t max_size, std::function<void(std::shared_ptr<const std::string>)> handler)
+  {
+    recorded_listing_  = std::make_unique<std::string>();
+    max_recorded_size_ = max_size;
+    recorded_handler_  = std::move(handler);
+  }
+
+  bool DirectoryListing::done() const
+  {
+    return done_;
+  }
+
+  void DirectoryListing::render(TransferBuffer& buffer)
+  {
+    if (rendered_listing_)
+    {
+      const size_t bytes_to_copy = std::min(rendered_listing_->size() - rendered_offset_, buffer.capacity());
+      memcpy(buffer.data(), rendered_listing_->data() + rendered_offset_, bytes_to_copy);
+      buffer.resize(bytes_to_copy);
+      rendered_offset_ += bytes_to_copy;
+      done_             = (rendered_offset_ >= rendered_listing_->size());
+      return;
+    }
+
+    size_t bytes_used = 0;
+
+    while (bytes_used < buffer.capacity())
+    {
+      if (line_offset_ >= line_.size())
+      {
+        if (!nextEntry(name_))
+        {
+          done_ = true;
+          break;
+        }
+        formatLine(name_);
+      }
+
+      const size_t bytes_to_copy = std::min(line_.size() - line_offset_, buffer.capacity() - bytes_used);
+      memcpy(buffer.data() + bytes_used, line_.data() + line_offset_, bytes_to_copy);
+      bytes_used   += bytes_to_copy;
+      line_offset_ += bytes_to_copy;
+    }
+
+    buffer.resize(bytes_used);
+
+    if (recorded_listing_)
+    {
+      if (recorded_listing_->size() + bytes_used > max_recorded_size_)
+      {
+        recorded_listing_.reset();
+        recorded_handler_ = nullptr;
+      }
+      else
+      {
+        recorded_listing_->append(buffer.data(), bytes_used);
+        if (done_)
+        {
+          recorded_handler_(std::shared_ptr<const std::string>(std::move(recorded_listing_)));
+          recorded_handler_ = nullptr;
+        }
+      }
+    }
+  }
+
+  bool DirectoryListing::nextEntry(std::string& name)
+  {
+    if (!sorted_)
+      return reader_->next(name);
+
+    if (!names_read_)
+    {
+      std::string entry_name;
+      while (reader_->next(entry_name))
+      {
+        sorted_names_.push_back(entry_name);
+      }
+      std::sort(sorted_names_.begin(), sorted_names_.end());
+      names_read_ = true;
+    }
+
+    if (next_sorted_name_ >= sorted_names_.size())
+      return false;
+
+    name = std::move(sorted_names_[next_sorted_name_++]);
+    return true;
+  }
+
+  void DirectoryListing::formatLine(const std::string& name)
+  {
+    line_.clear();
+    line_offset_ = 0;
+
+    switch (format_)
+    {
+    case ListingFormat::NameList:
+    {
+      line_ += name;
+      break;
+    }
+    case ListingFormat::List:
+    {
+      const Filesystem::FileStatus file_status = reader_->status(name);
+
+      char prefix[128];
+      snprintf(prefix, sizeof(prefix), "%c%s   1 %10s %10s %10lld "
+              , ((file_status.type() == Filesystem::FileType::Dir) ? 'd' : '-')
+              , file_status.permissionString().c_str()
+              , file_status.ownerString().c_str()
+              , file_status.groupString().c_str()
+              , static_cast<long long>(file_status.fileSize()));
+
+      line_ += prefix;
+      line_ += file_status.timeString();
+      line_ += ' ';
+      line_ += name;
+      break;
+    }
+    case ListingFormat::MachineList:
+    {
+      const Filesystem::FileStatus file_status = reader_->status(name);
+
+      // The entry has been removed since we have read the directory
+      if (!file_status.isOk())
+        return;
+
+      line_ += machineListFacts(name, file_status, permissions_);
+      line_ += ' ';
+      line_ += name;
+      break;
+    }
+    }
+
+    line_ += "\r\n";
+  }
+
+  std::string DirectoryListing::machineListFacts(const std::string& name, const Filesystem::FileStatus& file_status, Permission permissions)
+  {
+    auto has_permission = [permissions](Permission permission) { return (permissions & permission) == permission; };
+
+    std::string facts;
+    facts.reserve(80);
+
+    const bool is_dir = (file_status.type() == Filesystem::FileType::Dir);
+
+    facts += "type=";
+    if (name == ".")
+      facts += "cdir";
+    else if (name == "..")
+      facts += "pdir";
+    else if (is_dir)
+      facts += "dir";
+    else
+      facts += "file";
+    facts += ';';
+
+    if (!is_dir)
+    {
+      facts += "size=";
+      facts += std::to_string(file_status.fileSize());
+      facts += ';';
+    }
+
+    facts += "modify=";
+    facts += file_status.modifyTimeString();
+    facts += ';';
+
+    facts += "perm=";
+    if (is_dir)
+    {
+      if (has_permission(Permission::DirList))    facts += "el";
+      if (has_permission(Permission::FileWrite))  facts += 'c';
+      if (has_permission(Permission::DirCreate))  facts += 'm';
+      if (has_permission(Permission::DirDelete))  facts += 'd';
+      if (has_permission(Permission::DirRename))  facts += 'f';
+      if (has_permission(Permission::FileDelete)) facts += 'p';
+    }
+    else
+    {
+      if (has_permission(Permission::FileRead))   facts += 'r';
+      if (has_permission(Permission::FileAppend)) facts += 'a';
+      if (has_permission(Permission::FileWrite))  facts += 'w';
+      if (has_permission(Permission::FileDelete)) facts += 'd';
+      if (has_permission(Permission::FileRename)) facts += 'f';
+    }
+    facts += ';';
+
+    return facts;
+  }
+}
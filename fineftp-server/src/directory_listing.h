@@ -0,0 +1,102 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../include/fineftp/permissions.h"
+#include "buffer_pool.h"
+#include "filesystem.h"
+
+namespace fineftp
+{
+  enum class ListingFormat
+  {
+    List,         /**< LIST: One "ls -l" style line per entry */
+    NameList,     /**< NLST: Only the names */
+    MachineList,  /**< MLSD: RFC 3659 facts, e.g. "type=file;size=42;... name" */
+  };
+
+  /**
+   * @brief Renders a directory listing piece by piece
+   *
+   * The lines are formatted directly into the transfer buffers, so a listing
+   * can be sent while the directory is still being read and the whole
+   * listing is never held in memory. NLST does not stat the entries at all.
+   *
+   * In sorted mode, only the names are read and sorted up front, the
+   * entries are stat'ed and formatted while sending. In unsorted mode, the
+   * entries are sent in the order the filesystem returns them.
+   *
+   * A listing can also replay a listing that has been rendered before,
+   * e.g. one that has been taken from the ListingCache.
+   */
+  class DirectoryListing
+  {
+  public:
+    DirectoryListing(const std::string& local_path, ListingFormat format, bool sorted, Permission permissions);
+
+    /** Creates a listing that sends the given, already rendered listing */
+    explicit DirectoryListing(std::shared_ptr<const std::string> rendered_listing);
+
+    DirectoryListing(const DirectoryListing&)            = delete;
+    DirectoryListing& operator=(const DirectoryListing&) = delete;
+
+    bool isOk() const;
+
+    /** True, if the entire listing has been rendered */
+    bool done() const;
+
+    /**
+     * @brief Renders the next part of the listing into the buffer
+     *
+     * The buffer is filled completely, unless the end of the listing is
+     * reached. Lines may be split between two buffers.
+     */
+    void render(TransferBuffer& buffer);
+
+    /**
+     * @brief Keeps a copy of the rendered listing
+     *
+     * When the listing is done, the handler is called with the entire
+     * listing. If the listing exceeds max_size, the copy is dropped and the
+     * handler is never called.
+     */
+    void recordOutput(size_t max_size, std::function<void(std::shared_ptr<const std::string>)> handler);
+
+    /**
+     * @brief Returns the RFC 3659 facts of an entry, e.g. "type=file;size=42;modify=20200101120000;perm=r;"
+     *
+     * @param name:        The name of the entry. "." and ".." are reported as cdir / pdir.
+     * @param file_status: The status of the entry
+     * @param permissions: The permissions of the logged in user
+     */
+    static std::string machineListFacts(const std::string& name, const Filesystem::FileStatus& file_status, Permission permissions);
+
+  private:
+    bool nextEntry(std::string& name);
+    void formatLine(const std::string& name);
+
+    std::unique_ptr<Filesystem::DirectoryReader>             reader_;           // nullptr for replayed listings
+    const ListingFormat                                      format_;
+    const bool                                               sorted_;
+    const Permission                                         permissions_;
+
+    std::shared_ptr<const std::string>                       rendered_listing_;
+    size_t                                                   rendered_offset_;
+
+    std::unique_ptr<std::string>                             recorded_listing_;
+    size_t                                                   max_recorded_size_;
+    std::function<void(std::shared_ptr<const std::string>)>  recorded_handler_;
+
+    bool                                                     names_read_;
+    std::vector<std::string>                                 sorted_names_;
+    size_t                                                   next_sorted_name_;
+
+    std::string                                              name_;
+    std::string                                              line_;             // The line that is currently being copied to the buffers
+    size_t                                                   line_offset_;      // How much of line_ has already been copied
+    bool                                                     done_;
+  };
+}
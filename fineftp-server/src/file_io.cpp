@@ -0,0 +1,340 @@
+#include "file_io.h"
+
+#include <iostream>
+
+#ifndef WIN32
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif // !WIN32
+
+#ifdef __linux__
+#include "file_io_uring.h"
+#endif // __linux__
+
+namespace fineftp
+{
+  ////////////////////////////////////////////////////////
+  // IoFile
+  ////////////////////////////////////////////////////////
+
+#ifdef WIN32
+  IoFile::IoFile(const std::string& filename, std::ios::openmode mode, asio::io_service& io_service, BufferPool& buffer_pool)
+    : file_stream_      (filename, mode)
+    , stream_buffer_    (buffer_pool.acquire())
+    , offset_           (0)
+    , end_of_file_      (false)
+    , completion_strand_(io_service)
+  {
+    file_stream_.rdbuf()->pubsetbuf(stream_buffer_->data(), static_cast<std::streamsize>(stream_buffer_->size()));
+  }
+
+  IoFile::~IoFile()
+  {
+    file_stream_.flush();
+    file_stream_.close();
+  }
+
+  bool IoFile::good() const
+  {
+    return file_stream_.good();
+  }
+
+  bool IoFile::seek(uint64_t offset)
+  {
+    file_stream_.seekg(static_cast<std::streamoff>(offset));
+    offset_ = offset;
+    return file_stream_.good();
+  }
+#else
+  IoFile::IoFile(const std::string& filename, std::ios::openmode mode, asio::io_service& io_service, BufferPool& /*buffer_pool*/)
+    : fd_               (-1)
+    , offset_           (0)
+    , end_of_file_      (false)
+    , completion_strand_(io_service)
+  {
+    // There is no text mode on POSIX systems, so std::ios::binary makes no difference
+    int flags = O_CLOEXEC;
+    if (mode & std::ios::in)
+      flags |= O_RDONLY;
+    else if (mode & std::ios::app)
+      flags |= O_WRONLY | O_CREAT | O_APPEND;
+    else
+      flags |= O_WRONLY | O_CREAT | O_TRUNC;
+
+    fd_ = ::open(filename.c_str(), flags, 0666);
+  }
+
+  IoFile::~IoFile()
+  {
+    if (fd_ >= 0)
+      ::close(fd_);
+  }
+
+  bool IoFile::good() const
+  {
+    return fd_ >= 0;
+  }
+
+  bool IoFile::seek(uint64_t offset)
+  {
+    // Reads always use pread() at offset_
+    offset_ = offset;
+    return true;
+  }
+#endif // WIN32
+
+  size_t IoFile::pendingRequests() const
+  {
+    std::lock_guard<std::mutex> queue_lock(queue_mutex_);
+    return queue_.size();
+  }
+
+  ////////////////////////////////////////////////////////
+  // FileIo
+  ////////////////////////////////////////////////////////
+
+  FileIo::FileIo()
+    : pending_requests_(0)
+  {}
+
+  FileIo::~FileIo()
+  {}
+
+  size_t FileIo::pendingRequests() const
+  {
+    return pending_requests_;
+  }
+
+  std::shared_ptr<FileIo> FileIo::create(FileIoBackend backend, size_t thread_count)
+  {
+#ifdef __linux__
+    if (backend != FileIoBackend::ThreadPool)
+    {
+      auto io_uring = IoUringFileIo::create(256);
+      if (io_uring)
+        return io_uring;
+
+      if (backend == FileIoBackend::IoUring)
+        std::cerr << "io_uring is not available. Using a thread pool for file I/O." << std::endl;
+    }
+#else
+    (void)backend;
+#endif // __linux__
+
+    return std::make_shared<ThreadPoolFileIo>(thread_count);
+  }
+
+  void FileIo::read(std::shared_ptr<IoFile> file, std::shared_ptr<TransferBuffer> buffer, Handler handler)
+  {
+    auto request = std::make_shared<FileIoRequest>();
+    request->type    = FileIoRequest::Type::Read;
+    request->file    = std::move(file);
+    request->buffer  = std::move(buffer);
+    request->handler = std::move(handler);
+    request->buffer->resize(request->buffer->capacity());
+    submit(std::move(request));
+  }
+
+  void FileIo::write(std::shared_ptr<IoFile> file, std::shared_ptr<TransferBuffer> buffer, Handler handler)
+  {
+    auto request = std::make_shared<FileIoRequest>();
+    request->type    = FileIoRequest::Type::Write;
+    request->file    = std::move(file);
+    request->buffer  = std::move(buffer);
+    request->handler = std::move(handler);
+    submit(std::move(request));
+  }
+
+  void FileIo::flush(std::shared_ptr<IoFile> file, Handler handler)
+  {
+    auto request = std::make_shared<FileIoRequest>();
+    request->type    = FileIoRequest::Type::Flush;
+    request->file    = std::move(file);
+    request->handler = std::move(handler);
+    submit(std::move(request));
+  }
+
+  void FileIo::submit(std::shared_ptr<FileIoRequest> request)
+  {
+    pending_requests_++;
+
+    bool idle = false;
+    {
+      std::lock_guard<std::mutex> queue_lock(request->file->queue_mutex_);
+      idle = request->file->queue_.empty();
+      request->file->queue_.push_back(request);
+    }
+
+    // Only the request at the front of the queue is being executed. The
+    // others are started one after another by complete().
+    if (idle)
+      start(std::move(request));
+  }
+
+  void FileIo::start(std::shared_ptr<FileIoRequest> request)
+  {
+    IoFile& file = *request->file;
+
+    if (file.error_)
+    {
+      complete(std::move(request), asio::error::operation_aborted);
+      return;
+    }
+
+    if ((request->type == FileIoRequest::Type::Read) && file.end_of_file_)
+    {
+      complete(std::move(request), asio::error::eof);
+      return;
+    }
+
+    if ((request->type == FileIoRequest::Type::Write) && (request->buffer->size() == 0))
+    {
+      complete(std::move(request), asio::error_code());
+      return;
+    }
+
+#ifndef WIN32
+    // Writes go straight to the file descriptor, so there is nothing to flush
+    if (request->type == FileIoRequest::Type::Flush)
+    {
+      complete(std::move(request), asio::error_code());
+      return;
+    }
+#endif // !WIN32
+
+    execute(std::move(request));
+  }
+
+  void FileIo::complete(std::shared_ptr<FileIoRequest> request, asio::error_code ec)
+  {
+    IoFile& file = *request->file;
+
+    if (ec && (ec != asio::error::eof) && (ec != asio::error::operation_aborted))
+    {
+      file.error_ = ec;
+    }
+    else if (!ec && (request->type == FileIoRequest::Type::Read))
+    {
+      request->buffer->resize(request->bytes_done);
+      if (request->bytes_done < request->buffer->capacity())
+        file.end_of_file_ = true;
+    }
+
+    // The handler usually keeps the session alive. Moving it out makes sure that
+    // the session is released on the io_service and never on a file I/O thread.
+    file.completion_strand_.post([handler = std::move(request->handler), ec]() { handler(ec); });
+    pending_requests_--;
+
+    std::shared_ptr<FileIoRequest> next_request;
+    {
+      std::lock_guard<std::mutex> queue_lock(file.queue_mutex_);
+      file.queue_.pop_front();
+      if (!file.queue_.empty())
+        next_request = file.queue_.front();
+    }
+
+    if (next_request)
+      start(std::move(next_request));
+  }
+
+  ////////////////////////////////////////////////////////
+  // ThreadPoolFileIo
+  ////////////////////////////////////////////////////////
+
+  ThreadPoolFileIo::ThreadPoolFileIo(size_t thread_count)
+    : work_(std::make_unique<asio::io_service::work>(io_service_))
+  {
+    for (size_t i = 0; i < thread_count; i++)
+    {
+      thread_pool_.emplace_back([this] { io_service_.run(); });
+    }
+  }
+
+  ThreadPoolFileIo::~ThreadPoolFileIo()
+  {
+    stop();
+  }
+
+  void ThreadPoolFileIo::stop()
+  {
+    // Let the threads finish all requests that are still queued
+    work_.reset();
+    for (std::thread& thread : thread_pool_)
+    {
+      thread.join();
+    }
+    thread_pool_.clear();
+  }
+
+  void ThreadPoolFileIo::execute(std::shared_ptr<FileIoRequest> request)
+  {
+    io_service_.post([this, request]()
+                    {
+                      IoFile&          file   = *request->file;
+                      TransferBuffer*  buffer = request->buffer.get(); // nullptr for flush requests
+                      asio::error_code ec;
+
+#ifdef WIN32
+                      switch (request->type)
+                      {
+                      case FileIoRequest::Type::Read:
+                        file.file_stream_.read(buffer->data(), static_cast<std::streamsize>(buffer->size()));
+                        request->bytes_done = static_cast<size_t>(file.file_stream_.gcount());
+                        if (file.file_stream_.bad())
+                          ec = asio::error::fault;
+                        break;
+                      case FileIoRequest::Type::Write:
+                        file.file_stream_.write(buffer->data(), static_cast<std::streamsize>(buffer->size()));
+                        request->bytes_done = buffer->size();
+                        if (!file.file_stream_.good())
+                          ec = asio::error::fault;
+                        break;
+                      case FileIoRequest::Type::Flush:
+                        file.file_stream_.flush();
+                        if (!file.file_stream_.good())
+                          ec = asio::error::fault;
+                        break;
+                      }
+#else
+                      if (request->type == FileIoRequest::Type::Read)
+                      {
+                        // Fill the whole buffer, unless we hit the end of the file
+                        while (request->bytes_done < buffer->size())
+                        {
+                          ssize_t result = ::pread(file.fd_, buffer->data() + request->bytes_done, buffer->size() - request->bytes_done, static_cast<off_t>(file.offset_));
+                          if (result < 0)
+                          {
+                            if (errno == EINTR) continue;
+                            ec = asio::error_code(errno, asio::error::get_system_category());
+                            break;
+                          }
+                          if (result == 0)
+                            break;
+
+                          request->bytes_done += static_cast<size_t>(result);
+                          file.offset_        += static_cast<uint64_t>(result);
+                        }
+                      }
+                      else if (request->type == FileIoRequest::Type::Write)
+                      {
+                        while (request->bytes_done < buffer->size())
+                        {
+                          ssize_t result = ::write(file.fd_, buffer->data() + request->bytes_done, buffer->size() - request->bytes_done);
+                          if (result < 0)
+                          {
+                            if (errno == EINTR) continue;
+                            ec = asio::error_code(errno, asio::error::get_system_category());
+                            break;
+                          }
+
+                          request->bytes_done += static_cast<size_t>(result);
+                          file.offset_        += static_cast<uint64_t>(result);
+                        }
+                      }
+#endif // WIN32
+
+                      complete(request, ec);
+                    });
+  }
+}
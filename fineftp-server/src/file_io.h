@@ -0,0 +1,168 @@
+#pragma once
+
+#include <asio.hpp>
+
+#include <atomic>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../include/fineftp/server.h"
+#include "buffer_pool.h"
+
+namespace fineftp
+{
+  class IoFile;
+
+  /**
+   * @brief A single read, write or flush that has been issued to a FileIo backend
+   */
+  struct FileIoRequest
+  {
+    enum class Type
+    {
+      Read,
+      Write,
+      Flush,
+    };
+
+    Type                                   type;
+    std::shared_ptr<IoFile>                file;
+    std::shared_ptr<TransferBuffer>        buffer;
+    std::function<void(asio::error_code)>  handler;
+    size_t                                 bytes_done = 0;
+  };
+
+  /**
+   * @brief A file that is read or written by a data transfer
+   *
+   * The file is only accessed through a FileIo backend, which executes all
+   * requests of one file in the order they were issued. The completion
+   * handlers are executed on the io_service that was given to the
+   * constructor, also in that order.
+   */
+  class IoFile
+  {
+  public:
+    IoFile(const std::string& filename, std::ios::openmode mode, asio::io_service& io_service, BufferPool& buffer_pool);
+    ~IoFile();
+
+    IoFile(const IoFile&)            = delete;
+    IoFile& operator=(const IoFile&) = delete;
+
+    /** True if the file has been opened successfully */
+    bool good() const;
+
+    /** Moves the position of the next read. Must be called before any request is issued. */
+    bool seek(uint64_t offset);
+
+    /** Number of requests that have been issued and not completed yet */
+    size_t pendingRequests() const;
+
+  private:
+    friend class FileIo;
+    friend class ThreadPoolFileIo;
+    friend class IoUringFileIo;
+
+#ifdef WIN32
+    std::fstream                    file_stream_;
+    std::shared_ptr<TransferBuffer> stream_buffer_;
+#else
+    int                             fd_;
+#endif // WIN32
+    uint64_t                        offset_;
+    bool                            end_of_file_;
+    asio::error_code                error_;
+
+    asio::io_service::strand        completion_strand_;
+
+    mutable std::mutex                         queue_mutex_;
+    std::deque<std::shared_ptr<FileIoRequest>> queue_;
+  };
+
+  /**
+   * @brief Executes file reads and writes away from the network threads
+   *
+   * Blocking disk I/O on the io_service threads would stall the control
+   * connection and all other sessions whenever a disk is slow. A FileIo
+   * backend runs the I/O elsewhere and posts the completion handlers back.
+   *
+   * A read fills the whole buffer unless the end of the file is reached, so
+   * a buffer that comes back shorter than its capacity is the last one.
+   * Reads after that complete with asio::error::eof. Once a request has
+   * failed, all further requests of that file fail with
+   * asio::error::operation_aborted.
+   */
+  class FileIo
+  {
+  public:
+    using Handler = std::function<void(asio::error_code)>;
+
+    FileIo();
+    virtual ~FileIo();
+
+    /**
+     * @brief Creates the requested backend
+     *
+     * If io_uring is requested but not available, a thread pool is
+     * created instead. Auto uses io_uring whenever possible.
+     *
+     * @param backend:      The backend to create
+     * @param thread_count: Number of threads of the thread pool backend
+     */
+    static std::shared_ptr<FileIo> create(FileIoBackend backend, size_t thread_count);
+
+    void read (std::shared_ptr<IoFile> file, std::shared_ptr<TransferBuffer> buffer, Handler handler);
+    void write(std::shared_ptr<IoFile> file, std::shared_ptr<TransferBuffer> buffer, Handler handler);
+
+    /** Completes after all requests that were issued before it */
+    void flush(std::shared_ptr<IoFile> file, Handler handler);
+
+    virtual FileIoBackend backend() const = 0;
+
+    /** Number of requests of all files that have been issued and not completed yet */
+    size_t pendingRequests() const;
+
+    /** Finishes all requests that are in flight and stops the backend's threads */
+    virtual void stop() = 0;
+
+  protected:
+    /** Executes the request and calls complete() when done */
+    virtual void execute(std::shared_ptr<FileIoRequest> request) = 0;
+
+    void complete(std::shared_ptr<FileIoRequest> request, asio::error_code ec);
+
+  private:
+    void submit(std::shared_ptr<FileIoRequest> request);
+    void start (std::shared_ptr<FileIoRequest> request);
+
+    std::atomic<size_t> pending_requests_;
+  };
+
+  /**
+   * @brief Executes blocking file I/O on a dedicated pool of threads
+   */
+  class ThreadPoolFileIo : public FileIo
+  {
+  public:
+    explicit ThreadPoolFileIo(size_t thread_count);
+    ~ThreadPoolFileIo() override;
+
+    FileIoBackend backend() const override { return FileIoBackend::ThreadPool; }
+
+    void stop() override;
+
+  protected:
+    void execute(std::shared_ptr<FileIoRequest> request) override;
+
+  private:
+    asio::io_service                        io_service_;
+    std::unique_ptr<asio::io_service::work> work_;
+    std::vector<std::thread>                thread_pool_;
+  };
+}
@@ -0,0 +1,312 @@
+#include "file_io_uring.h"
+
+#ifdef __linux__
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace fineftp
+{
+  namespace
+  {
+    int ioUringSetup(unsigned entries, io_uring_params* params)
+    {
+      return static_cast<int>(::syscall(__NR_io_uring_setup, entries, params));
+    }
+
+    int ioUringEnter(int ring_fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+    {
+      return static_cast<int>(::syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, nullptr, 0));
+    }
+  }
+
+  std::shared_ptr<IoUringFileIo> IoUringFileIo::create(unsigned entries)
+  {
+    std::shared_ptr<IoUringFileIo> io_uring(new IoUringFileIo());
+    if (!io_uring->setup(entries))
+      return nullptr;
+
+    io_uring->completion_thread_ = std::thread([raw = io_uring.get()] { raw->reapCompletions(); });
+    return io_uring;
+  }
+
+  IoUringFileIo::IoUringFileIo()
+    : ring_fd_     (-1)
+    , sq_ring_     (MAP_FAILED)
+    , sq_ring_size_(0)
+    , cq_ring_     (MAP_FAILED)
+    , cq_ring_size_(0)
+    , sqes_        (static_cast<io_uring_sqe*>(MAP_FAILED))
+    , sqes_size_   (0)
+    , sq_head_     (nullptr)
+    , sq_tail_     (nullptr)
+    , sq_mask_     (nullptr)
+    , sq_array_    (nullptr)
+    , sq_entries_  (0)
+    , cq_head_     (nullptr)
+    , cq_tail_     (nullptr)
+    , cq_mask_     (nullptr)
+    , cqes_        (nullptr)
+    , in_flight_   (0)
+    , stopping_    (false)
+  {}
+
+  IoUringFileIo::~IoUringFileIo()
+  {
+    stop();
+
+    if (sqes_ != MAP_FAILED)
+      ::munmap(sqes_, sqes_size_);
+    if ((cq_ring_ != MAP_FAILED) && (cq_ring_ != sq_ring_))
+      ::munmap(cq_ring_, cq_ring_size_);
+    if (sq_ring_ != MAP_FAILED)
+      ::munmap(sq_ring_, sq_ring_size_);
+    if (ring_fd_ >= 0)
+      ::close(ring_fd_);
+  }
+
+  bool IoUringFileIo::setup(unsigned entries)
+  {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    ring_fd_ = ioUringSetup(entries, &params);
+    if (ring_fd_ < 0)
+      return false;
+
+    sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cq_ring_size_ = params.cq_off.cqes  + params.cq_entries * sizeof(io_uring_cqe);
+
+    // Newer kernels map both rings with a single mmap() call
+    const bool single_mmap = ((params.features & IORING_FEAT_SINGLE_MMAP) != 0);
+    if (single_mmap)
+    {
+      sq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+      cq_ring_size_ = sq_ring_size_;
+    }
+
+    sq_ring_ = ::mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+    if (sq_ring_ == MAP_FAILED)
+      return false;
+
+    if (single_mmap)
+    {
+      cq_ring_ = sq_ring_;
+    }
+    else
+    {
+      cq_ring_ = ::mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+      if (cq_ring_ == MAP_FAILED)
+        return false;
+    }
+
+    sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+    sqes_      = static_cast<io_uring_sqe*>(::mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES));
+    if (sqes_ == MAP_FAILED)
+      return false;
+
+    char* sq_ring = static_cast<char*>(sq_ring_);
+    sq_head_    = reinterpret_cast<unsigned*>(sq_ring + params.sq_off.head);
+    sq_tail_    = reinterpret_cast<unsigned*>(sq_ring + params.sq_off.tail);
+    sq_mask_    = reinterpret_cast<unsigned*>(sq_ring + params.sq_off.ring_mask);
+    sq_array_   = reinterpret_cast<unsigned*>(sq_ring + params.sq_off.array);
+    sq_entries_ = params.sq_entries;
+
+    char* cq_ring = static_cast<char*>(cq_ring_);
+    cq_head_ = reinterpret_cast<unsigned*>(cq_ring + params.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned*>(cq_ring + params.cq_off.tail);
+    cq_mask_ = reinterpret_cast<unsigned*>(cq_ring + params.cq_off.ring_mask);
+    cqes_    = reinterpret_cast<io_uring_cqe*>(cq_ring + params.cq_off.cqes);
+
+    return true;
+  }
+
+  void IoUringFileIo::stop()
+  {
+    if (!completion_thread_.joinable())
+      return;
+
+    {
+      std::lock_guard<std::mutex> submit_lock(submit_mutex_);
+      stopping_ = true;
+    }
+
+    // Wake up the completion thread. It exits as soon as nothing is in flight anymore.
+    submitOperation(new Operation{ nullptr, {} });
+    completion_thread_.join();
+  }
+
+  void IoUringFileIo::execute(std::shared_ptr<FileIoRequest> request)
+  {
+    {
+      std::lock_guard<std::mutex> submit_lock(submit_mutex_);
+      in_flight_++;
+    }
+
+    submitOperation(new Operation{ std::move(request), {} });
+  }
+
+  void IoUringFileIo::submitOperation(Operation* operation)
+  {
+    std::lock_guard<std::mutex> submit_lock(submit_mutex_);
+
+    // Keep the order of operations that had to wait for a free slot
+    if (!overflow_.empty() || !pushToSubmissionQueue(operation))
+    {
+      overflow_.push_back(operation);
+      return;
+    }
+
+    enter();
+  }
+
+  bool IoUringFileIo::pushToSubmissionQueue(Operation* operation)
+  {
+    const unsigned head = __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    const unsigned tail = *sq_tail_;
+
+    if (tail - head >= sq_entries_)
+      return false;
+
+    const unsigned index = tail & *sq_mask_;
+    io_uring_sqe*  sqe   = &sqes_[index];
+    memset(sqe, 0, sizeof(*sqe));
+
+    if (operation->request)
+    {
+      FileIoRequest&  request = *operation->request;
+      TransferBuffer& buffer  = *request.buffer;
+
+      operation->iov.iov_base = buffer.data() + request.bytes_done;
+      operation->iov.iov_len  = buffer.size() - request.bytes_done;
+
+      sqe->opcode = (request.type == FileIoRequest::Type::Read ? IORING_OP_READV : IORING_OP_WRITEV);
+      sqe->fd     = request.file->fd_;
+      sqe->off    = request.file->offset_;
+      sqe->addr   = reinterpret_cast<uint64_t>(&operation->iov);
+      sqe->len    = 1;
+    }
+    else
+    {
+      sqe->opcode = IORING_OP_NOP;
+    }
+    sqe->user_data = reinterpret_cast<uint64_t>(operation);
+
+    sq_array_[index] = index;
+    __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+    return true;
+  }
+
+  void IoUringFileIo::enter()
+  {
+    // Submit everything the kernel has not consumed yet. Entries that are
+    // left over after an error are picked up by the next call.
+    const unsigned to_submit = *sq_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    if (to_submit == 0)
+      return;
+
+    if ((ioUringEnter(ring_fd_, to_submit, 0, 0) < 0) && (errno != EAGAIN) && (errno != EBUSY) && (errno != EINTR))
+    {
+      std::cerr << "io_uring_enter error: " << strerror(errno) << std::endl;
+    }
+  }
+
+  void IoUringFileIo::reapCompletions()
+  {
+    bool wakeup_received = false;
+
+    for (;;)
+    {
+      if ((ioUringEnter(ring_fd_, 0, 1, IORING_ENTER_GETEVENTS) < 0) && (errno != EINTR) && (errno != EAGAIN) && (errno != EBUSY))
+      {
+        std::cerr << "io_uring_enter error: " << strerror(errno) << std::endl;
+        return;
+      }
+
+      unsigned       head = *cq_head_;
+      const unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+
+      while (head != tail)
+      {
+        const io_uring_cqe& cqe       = cqes_[head & *cq_mask_];
+        Operation*          operation = reinterpret_cast<Operation*>(cqe.user_data);
+        const int           result    = cqe.res;
+
+        head++;
+        __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+
+        if (operation->request)
+        {
+          handleCompletion(operation, result);
+        }
+        else
+        {
+          wakeup_received = true;
+          delete operation;
+        }
+      }
+
+      std::lock_guard<std::mutex> submit_lock(submit_mutex_);
+
+      // Now that there is free space again, submit the operations that had to wait
+      while (!overflow_.empty() && pushToSubmissionQueue(overflow_.front()))
+      {
+        overflow_.pop_front();
+      }
+      enter();
+
+      if (stopping_ && wakeup_received && (in_flight_ == 0))
+        return;
+    }
+  }
+
+  void IoUringFileIo::handleCompletion(Operation* operation, int result)
+  {
+    FileIoRequest& request = *operation->request;
+    asio::error_code ec;
+
+    if ((result == -EINTR) || (result == -EAGAIN))
+    {
+      submitOperation(operation);
+      return;
+    }
+    else if (result < 0)
+    {
+      ec = asio::error_code(-result, asio::error::get_system_category());
+    }
+    else if (result > 0)
+    {
+      request.bytes_done    += static_cast<size_t>(result);
+      request.file->offset_ += static_cast<uint64_t>(result);
+
+      // Reads must fill the whole buffer unless the file ends, and writes
+      // must write everything. Continue where the kernel stopped.
+      if (request.bytes_done < request.buffer->size())
+      {
+        submitOperation(operation);
+        return;
+      }
+    }
+    else if (request.type == FileIoRequest::Type::Write)
+    {
+      ec = asio::error::broken_pipe;
+    }
+
+    std::shared_ptr<FileIoRequest> finished_request = std::move(operation->request);
+    delete operation;
+
+    {
+      std::lock_guard<std::mutex> submit_lock(submit_mutex_);
+      in_flight_--;
+    }
+
+    complete(std::move(finished_request), ec);
+  }
+}
+
+#endif // __linux__
@@ -0,0 +1,88 @@
+#pragma once
+
+#ifdef __linux__
+
+#include "file_io.h"
+
+#include <linux/io_uring.h>
+#include <sys/uio.h>
+
+namespace fineftp
+{
+  /**
+   * @brief Executes file I/O with the Linux io_uring interface
+   *
+   * Reads and writes are handed to the kernel and a single thread waits for
+   * their completion, so no thread is ever blocked by the disk itself. The
+   * ring is driven with the raw system calls and does not need liburing.
+   */
+  class IoUringFileIo : public FileIo
+  {
+  public:
+    /**
+     * @brief Creates the ring
+     *
+     * @param entries: Size of the submission queue
+     *
+     * @return The backend or nullptr, if the kernel does not support io_uring
+     */
+    static std::shared_ptr<IoUringFileIo> create(unsigned entries);
+
+    ~IoUringFileIo() override;
+
+    FileIoBackend backend() const override { return FileIoBackend::IoUring; }
+
+    void stop() override;
+
+  protected:
+    void execute(std::shared_ptr<FileIoRequest> request) override;
+
+  private:
+    /** One submission. A nullptr request wakes up the completion thread. */
+    struct Operation
+    {
+      std::shared_ptr<FileIoRequest> request;
+      struct iovec                   iov;
+    };
+
+    IoUringFileIo();
+
+    bool setup(unsigned entries);
+
+    void submitOperation(Operation* operation);
+    bool pushToSubmissionQueue(Operation* operation);
+    void enter();
+
+    void reapCompletions();
+    void handleCompletion(Operation* operation, int result);
+
+    int           ring_fd_;
+
+    void*         sq_ring_;
+    size_t        sq_ring_size_;
+    void*         cq_ring_;
+    size_t        cq_ring_size_;
+    io_uring_sqe* sqes_;
+    size_t        sqes_size_;
+
+    unsigned*     sq_head_;
+    unsigned*     sq_tail_;
+    unsigned*     sq_mask_;
+    unsigned*     sq_array_;
+    unsigned      sq_entries_;
+
+    unsigned*     cq_head_;
+    unsigned*     cq_tail_;
+    unsigned*     cq_mask_;
+    io_uring_cqe* cqes_;
+
+    std::mutex              submit_mutex_;
+    std::deque<Operation*>  overflow_;       // Operations that did not fit into the submission queue
+    size_t                  in_flight_;
+    bool                    stopping_;
+
+    std::thread             completion_thread_;
+  };
+}
+
+#endif // __linux__
@@ -1,5 +1,8 @@
 #include "filesystem.h"
 
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
 #include <list>
 #include <sstream>
 #include <mutex>
@@ -14,6 +17,7 @@
 #else // WIN32
 
 #include <dirent.h>
+#include <fcntl.h>
 
 #endif // WIN32
 
@@ -37,6 +41,12 @@ namespace Filesystem
     is_ok_ = (error_code == 0);
   }
 
+  FileStatus::FileStatus(const std::string& path, bool is_ok)
+    : path_(path)
+    , is_ok_(is_ok)
+    , file_status_{}
+  {}
+
   FileStatus::~FileStatus() {}
 
   bool FileStatus::isOk() const
@@ -210,24 +220,48 @@ namespace Filesystem
       "Dec"
     };
 
-    std::stringstream date;
+    // This is called for every entry of a directory listing, so we avoid
+    // the much slower std::stringstream here.
+    char date[32];
 
     if (file_year == current_year)
     {
       // We are allowed to return the time!
-      date << std::setw( 3 ) << file_timeinfo.tm_mday << " "
-           << std::setw( 2 ) << file_timeinfo.tm_hour << ":"
-           << std::setw( 2 ) << std::setfill( '0' ) << file_timeinfo.tm_min;
+      snprintf(date, sizeof(date), "%3d %2d:%02d", file_timeinfo.tm_mday, file_timeinfo.tm_hour, file_timeinfo.tm_min);
     }
     else
     {
       // We must not return the time, only the date :(
       static constexpr auto tm_year_base_year = 1900;
-      date << std::setw( 3 ) << file_timeinfo.tm_mday
-           << "  " << ( file_timeinfo.tm_year + tm_year_base_year );
+      snprintf(date, sizeof(date), "%3d  %d", file_timeinfo.tm_mday, file_timeinfo.tm_year + tm_year_base_year);
+    }
+
+    return month_names[file_timeinfo.tm_mon] + date;
+  }
+
+  std::string FileStatus::modifyTimeString() const
+  {
+    if (!is_ok_)
+      return "19700101000000";
+
+    std::tm file_timeinfo{};
+#if defined(__unix__)
+    gmtime_r(&file_status_.st_mtime, &file_timeinfo);
+#elif defined(_MSC_VER)
+    gmtime_s(&file_timeinfo, &file_status_.st_mtime);
+#else
+    static std::mutex mtx;
+    {
+      std::lock_guard<std::mutex> lock(mtx);
+      file_timeinfo = *std::gmtime(&file_status_.st_mtime);
     }
+#endif
 
-    return month_names[file_timeinfo.tm_mon] + date.str();
+    char time_string[32];
+    snprintf(time_string, sizeof(time_string), "%04d%02d%02d%02d%02d%02d"
+            , file_timeinfo.tm_year + 1900, file_timeinfo.tm_mon + 1, file_timeinfo.tm_mday
+            , file_timeinfo.tm_hour, file_timeinfo.tm_min, file_timeinfo.tm_sec);
+    return time_string;
   }
 
   bool FileStatus::canOpenDir() const
@@ -451,5 +485,107 @@ namespace Filesystem
 #endif // WIN32
     return cleanPath(path, windows_path, separator);
   }
+
+  ////////////////////////////////////////////////////////
+  // DirectoryReader
+  ////////////////////////////////////////////////////////
+
+#ifdef WIN32
+  DirectoryReader::DirectoryReader(const std::string& path)
+    : path_           (path)
+    , find_handle_    (INVALID_HANDLE_VALUE)
+    , has_first_entry_(false)
+  {
+    std::string find_file_path = path + "\\*";
+    std::replace(find_file_path.begin(), find_file_path.end(), '/', '\\');
+
+    WIN32_FIND_DATAA ffd;
+    find_handle_ = FindFirstFileA(find_file_path.c_str(), &ffd);
+    if (find_handle_ != INVALID_HANDLE_VALUE)
+    {
+      has_first_entry_ = true;
+      first_entry_     = ffd.cFileName;
+    }
+  }
+
+  DirectoryReader::~DirectoryReader()
+  {
+    if (find_handle_ != INVALID_HANDLE_VALUE)
+      FindClose(find_handle_);
+  }
+
+  bool DirectoryReader::isOk() const
+  {
+    return find_handle_ != INVALID_HANDLE_VALUE;
+  }
+
+  bool DirectoryReader::next(std::string& name)
+  {
+    if (find_handle_ == INVALID_HANDLE_VALUE)
+      return false;
+
+    // FindFirstFile() has already returned the first entry
+    if (has_first_entry_)
+    {
+      has_first_entry_ = false;
+      name = first_entry_;
+      return true;
+    }
+
+    WIN32_FIND_DATAA ffd;
+    if (FindNextFileA(find_handle_, &ffd) == 0)
+      return false;
+
+    name = ffd.cFileName;
+    return true;
+  }
+
+  FileStatus DirectoryReader::status(const std::string& name) const
+  {
+    return FileStatus(path_ + "\\" + name);
+  }
+#else // WIN32
+  DirectoryReader::DirectoryReader(const std::string& path)
+    : path_(path)
+    , dir_ (opendir(path.c_str()))
+  {
+    if (dir_ == nullptr)
+    {
+      std::cerr << "Error opening directory: " << strerror(errno) << std::endl;
+    }
+  }
+
+  DirectoryReader::~DirectoryReader()
+  {
+    if (dir_ != nullptr)
+      closedir(dir_);
+  }
+
+  bool DirectoryReader::isOk() const
+  {
+    return dir_ != nullptr;
+  }
+
+  bool DirectoryReader::next(std::string& name)
+  {
+    if (dir_ == nullptr)
+      return false;
+
+    // readdir() fetches the entries from the kernel in large batches (getdents)
+    struct dirent* dirp = readdir(dir_);
+    if (dirp == nullptr)
+      return false;
+
+    name = dirp->d_name;
+    return true;
+  }
+
+  FileStatus DirectoryReader::status(const std::string& name) const
+  {
+    FileStatus file_status(path_ + "/" + name, false);
+    file_status.is_ok_ = (fstatat(dirfd(dir_), name.c_str(), &file_status.file_status_, 0) == 0);
+    return file_status;
+  }
+#endif // WIN32
 }
 }
@@ -1,12 +1,17 @@
 #pragma once
 
 #include <chrono>
+#include <ctime>
 #include <regex>
 #include <iostream>
 #include <map>
 
 #include <sys/stat.h>
 
+#ifndef WIN32
+#include <dirent.h>
+#endif // !WIN32
+
 ////////////////////////////////////////////////////////////////////////////////
 /// Filesystem
 ////////////////////////////////////////////////////////////////////////////////
@@ -70,11 +75,19 @@ namespace fineftp
 
       std::string timeString() const;
 
+      /** The time of the last modification in UTC as YYYYMMDDHHMMSS (RFC 3659) */
+      std::string modifyTimeString() const;
+
       bool canOpenDir() const;
 
 
 
     private:
+      friend class DirectoryReader;
+
+      /** Creates a status that is filled in by the DirectoryReader */
+      FileStatus(const std::string& path, bool is_ok);
+
       std::string path_;
       bool is_ok_;
   #ifdef WIN32
@@ -86,6 +99,49 @@ namespace fineftp
 
     std::map<std::string, FileStatus> dirContent(const std::string& path);
 
+    /**
+     * @brief Reads the entries of a directory one after another
+     *
+     * In contrast to dirContent(), nothing is collected, sorted or stat'ed
+     * up front, so huge directories can be processed piece by piece. The
+     * operating system still reads the entries in large batches. On POSIX
+     * systems, status() uses fstatat() relative to the open directory
+     * instead of resolving the full path for every entry.
+     */
+    class DirectoryReader
+    {
+    public:
+      DirectoryReader(const std::string& path);
+      ~DirectoryReader();
+
+      DirectoryReader(const DirectoryReader&)            = delete;
+      DirectoryReader& operator=(const DirectoryReader&) = delete;
+
+      bool isOk() const;
+
+      /**
+       * @brief Reads the name of the next entry
+       *
+       * @param name: Is set to the name of the entry
+       *
+       * @return False, if there are no more entries
+       */
+      bool next(std::string& name);
+
+      /** Returns the status of an entry of this directory */
+      FileStatus status(const std::string& name) const;
+
+    private:
+      std::string path_;
+  #ifdef WIN32
+      void*       find_handle_;
+      bool        has_first_entry_;
+      std::string first_entry_;
+  #else // WIN32
+      DIR*        dir_;
+  #endif // WIN32
+    };
+
     std::string cleanPath(const std::string& path, bool windows_path, const char output_separator);
 
     std::string cleanPathNative(const std::string& path);
@@ -51,6 +51,11 @@ namespace fineftp
     ACTION_NOT_TAKEN_INSUFFICIENT_STORAGE_SPACE = 452,
     FILE_ACTION_ABORTED                         = 552,
     ACTION_NOT_TAKEN_FILENAME_NOT_ALLOWED       = 553,
+
+    // Reply codes from RFC 3659 (extensions to FTP)
+    // https://tools.ietf.org/html/rfc3659
+
+    ACTION_NOT_TAKEN_INVALID_REST_PARAMETER     = 554,
   };
 
   class FtpMessage
@@ -74,9 +79,25 @@ namespace fineftp
       return message_;
     }
 
+    /**
+     * @brief Returns the reply as it is sent to the client
+     *
+     * A message that contains line breaks ("\r\n") becomes a multi-line
+     * reply: "123-first line", the intermediate lines as they are and
+     * "123 last line".
+     */
     inline std::string str() const
     {
-      return std::to_string(static_cast<int>(code_)) + " " + message_ + "\r\n";
+      const std::string code_string = std::to_string(static_cast<int>(code_));
+
+      const size_t last_line_start = message_.rfind("\r\n");
+      if (last_line_start == std::string::npos)
+      {
+        return code_string + " " + message_ + "\r\n";
+      }
+
+      return code_string + "-" + message_.substr(0, last_line_start + 2)
+           + code_string + " " + message_.substr(last_line_start + 2) + "\r\n";
     }
 
   private:
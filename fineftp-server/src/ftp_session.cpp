@@ -14,20 +14,40 @@
 #include <direct.h>
 #endif // WIN32
 
+#ifdef __linux__
+#include <cerrno>
+#include <cstring>
+#include <sys/sendfile.h>
+#endif // __linux__
+
 namespace fineftp
 {
+  namespace
+  {
+    // Throttled transfers are split into slices of this size, so a low rate
+    // limit does not turn into long bursts of a whole transfer buffer.
+    const size_t throttled_slice_size = 64 * 1024;
+  }
 
-  FtpSession::FtpSession(asio::io_service& io_service, const UserDatabase& user_database, const std::function<void()>& completion_handler)
-    : completion_handler_   (completion_handler)
-    , user_database_        (user_database)
-    , io_service_           (io_service)
-    , command_socket_       (io_service)
-    , command_write_strand_ (io_service)
-    , data_type_binary_     (false)
-    , data_acceptor_        (io_service)
-    , data_buffer_strand_   (io_service)
-    , file_rw_strand_       (io_service)
-    , ftp_working_directory_("/")
+  FtpSession::FtpSession(asio::io_service& io_service, const UserDatabase& user_database, const std::shared_ptr<BufferPool>& buffer_pool, size_t transfer_queue_depth, const std::shared_ptr<FileIo>& file_io, bool sort_directory_listings, const std::shared_ptr<ListingCache>& listing_cache, const std::shared_ptr<BandwidthLimiter>& global_bandwidth_limiter, const RateLimit& session_rate_limit, const std::shared_ptr<MetricsCollector>& metrics, const std::function<void()>& completion_handler)
+    : completion_handler_       (completion_handler)
+    , user_database_            (user_database)
+    , io_service_               (io_service)
+    , buffer_pool_              (buffer_pool)
+    , transfer_queue_depth_     (transfer_queue_depth)
+    , file_io_                  (file_io)
+    , sort_directory_listings_  (sort_directory_listings)
+    , listing_cache_            (listing_cache)
+    , global_bandwidth_limiter_ (global_bandwidth_limiter)
+    , session_bandwidth_limiter_(session_rate_limit)
+    , metrics_                  (metrics)
+    , command_socket_           (io_service)
+    , command_write_strand_     (io_service)
+    , data_type_binary_         (false)
+    , restart_offset_           (0)
+    , data_acceptor_            (io_service)
+    , data_buffer_strand_       (io_service)
+    , ftp_working_directory_    ("/")
   {
   }
 
@@ -181,17 +201,23 @@ namespace fineftp
       { "PWD",  std::bind(&FtpSession::handleFtpCommandPWD,  this, std::placeholders::_1) },
       { "LIST", std::bind(&FtpSession::handleFtpCommandLIST, this, std::placeholders::_1) },
       { "NLST", std::bind(&FtpSession::handleFtpCommandNLST, this, std::placeholders::_1) },
+      { "MLSD", std::bind(&FtpSession::handleFtpCommandMLSD, this, std::placeholders::_1) },
+      { "MLST", std::bind(&FtpSession::handleFtpCommandMLST, this, std::placeholders::_1) },
+      { "SIZE", std::bind(&FtpSession::handleFtpCommandSIZE, this, std::placeholders::_1) },
       { "SITE", std::bind(&FtpSession::handleFtpCommandSITE, this, std::placeholders::_1) },
       { "SYST", std::bind(&FtpSession::handleFtpCommandSYST, this, std::placeholders::_1) },
       { "STAT", std::bind(&FtpSession::handleFtpCommandSTAT, this, std::placeholders::_1) },
       { "HELP", std::bind(&FtpSession::handleFtpCommandHELP, this, std::placeholders::_1) },
       { "NOOP", std::bind(&FtpSession::handleFtpCommandNOOP, this, std::placeholders::_1) },
+      { "FEAT", std::bind(&FtpSession::handleFtpCommandFEAT, this, std::placeholders::_1) },
     };
 
     auto command_it = command_map.find(ftp_command);
     if (command_it != command_map.end())
     {
+      const auto command_start = std::chrono::steady_clock::now();
       FtpMessage reply = command_it->second(parameters);
+      metrics_->addCommandLatency(ftp_command, std::chrono::steady_clock::now() - command_start);
       sendFtpMessage(reply);
       last_command_ = ftp_command;
     }
@@ -200,6 +226,11 @@ namespace fineftp
       sendFtpMessage(FtpReplyCode::SYNTAX_ERROR_UNRECOGNIZED_COMMAND, "Unrecognized command");
     }
 
+    // A REST offset is used by the next transfer command. Setting up the data
+    // connection in between keeps it, every other command drops it.
+    if ((ftp_command != "REST") && (ftp_command != "PASV") && (ftp_command != "PORT") && (ftp_command != "TYPE"))
+      restart_offset_ = 0;
+
     if (last_command_ == "QUIT")
     {
       // Close command socket
@@ -224,6 +255,7 @@ namespace fineftp
     logged_in_user_        = nullptr;
     username_for_login_    = param;
     ftp_working_directory_ = "/";
+    std::atomic_store(&user_bandwidth_limiter_, std::shared_ptr<BandwidthLimiter>());
 
     if (param.empty())
     {
@@ -247,6 +279,7 @@ namespace fineftp
       if (user)
       {
         logged_in_user_ = user;
+        std::atomic_store(&user_bandwidth_limiter_, user->bandwidth_limiter_);
         return FtpMessage(FtpReplyCode::USER_LOGGED_IN, "Login successful");
       }
       else
@@ -335,6 +368,7 @@ namespace fineftp
   FtpMessage FtpSession::handleFtpCommandQUIT(const std::string& /*param*/)
   {
     logged_in_user_ = nullptr;
+    std::atomic_store(&user_bandwidth_limiter_, std::shared_ptr<BandwidthLimiter>());
     return FtpMessage(FtpReplyCode::SERVICE_CLOSING_CONTROL_CONNECTION, "Connection shutting down");
   }
 
@@ -446,11 +480,27 @@ namespace fineftp
     if (!data_acceptor_.is_open())                                                   return FtpMessage(FtpReplyCode::ERROR_OPENING_DATA_CONNECTION, "Error opening data connection");
 
     std::string local_path = toLocalPath(param);
+
+    const uint64_t offset = restart_offset_;
+
+#ifdef __linux__
+    // Binary transfers of regular files are sent directly from the page cache
+    // to the data socket. ASCII mode and everything else use the stream below.
+    if (data_type_binary_)
+    {
+      auto zero_copy_file = std::make_shared<ZeroCopyFile>(local_path, static_cast<off_t>(offset));
+      if (zero_copy_file->isRegularFile())
+      {
+        sendFileZeroCopy(zero_copy_file);
+        return FtpMessage(FtpReplyCode::FILE_STATUS_OK_OPENING_DATA_CONNECTION, "Sending file");
+      }
+    }
+#endif // __linux__
     
     std::ios::openmode open_mode = (data_type_binary_ ? (std::ios::in | std::ios::binary) : (std::ios::in));
-    std::shared_ptr<IoFile> file = std::make_shared<IoFile>(local_path, open_mode);
+    std::shared_ptr<IoFile> file = std::make_shared<IoFile>(local_path, open_mode, io_service_, *buffer_pool_);
 
-    if (!file->file_stream_.good())
+    if (!file->good() || !file->seek(offset))
     {
       return FtpMessage(FtpReplyCode::ACTION_ABORTED_LOCAL_ERROR, "Error opening file for transfer");
     }
@@ -472,8 +522,25 @@ namespace fineftp
 
     std::string local_path = toLocalPath(param);
 
+    const uint64_t offset = restart_offset_;
+
     auto existing_file_filestatus = Filesystem::FileStatus(local_path);
-    if (existing_file_filestatus.isOk())
+    if (offset > 0)
+    {
+      // An upload is only resumed where the file ends. Writing from an earlier
+      // offset would leave the old end of the file behind the new data.
+      if (!existing_file_filestatus.isOk()
+        || (existing_file_filestatus.type() != Filesystem::FileType::RegularFile)
+        || (static_cast<uint64_t>(existing_file_filestatus.fileSize()) != offset))
+      {
+        return FtpMessage(FtpReplyCode::ACTION_NOT_TAKEN_INVALID_REST_PARAMETER, "Restart offset must be the size of the file");
+      }
+      if (static_cast<int>(logged_in_user_->permissions_ & Permission::FileAppend) == 0)
+      {
+        return FtpMessage(FtpReplyCode::ACTION_NOT_TAKEN, "Permission denied");
+      }
+    }
+    else if (existing_file_filestatus.isOk())
     {
       if ((existing_file_filestatus.type() == Filesystem::FileType::RegularFile)
         && (static_cast<int>(logged_in_user_->permissions_ & Permission::FileDelete) == 0))
@@ -486,14 +553,17 @@ namespace fineftp
       }
     }
 
-    std::ios::openmode open_mode = (data_type_binary_ ? (std::ios::out | std::ios::binary) : (std::ios::out));    
-    std::shared_ptr<IoFile> file = std::make_shared<IoFile>(local_path, open_mode);
+    std::ios::openmode open_mode = (data_type_binary_ ? (std::ios::out | std::ios::binary) : (std::ios::out));
+    if (offset > 0)
+      open_mode |= std::ios::app;
+    std::shared_ptr<IoFile> file = std::make_shared<IoFile>(local_path, open_mode, io_service_, *buffer_pool_);
 
-    if (!file->file_stream_.good())
+    if (!file->good())
     {
       return FtpMessage(FtpReplyCode::ACTION_ABORTED_LOCAL_ERROR, "Error opening file for transfer");
     }
 
+    invalidateCachedListing(local_path);
     receiveFile(file);
     return FtpMessage(FtpReplyCode::FILE_STATUS_OK_OPENING_DATA_CONNECTION, "Receiving file");
   }
@@ -519,13 +589,14 @@ namespace fineftp
     }
 
     std::ios::openmode open_mode = (data_type_binary_ ? (std::ios::out | std::ios::app | std::ios::binary) : (std::ios::out | std::ios::app));
-    std::shared_ptr<IoFile> file = std::make_shared<IoFile>(local_path, open_mode);
+    std::shared_ptr<IoFile> file = std::make_shared<IoFile>(local_path, open_mode, io_service_, *buffer_pool_);
 
-    if (!file->file_stream_.good())
+    if (!file->good())
     {
       return FtpMessage(FtpReplyCode::ACTION_ABORTED_LOCAL_ERROR, "Error opening file for transfer");
     }
 
+    invalidateCachedListing(local_path);
     receiveFile(file);
     return FtpMessage(FtpReplyCode::FILE_STATUS_OK_OPENING_DATA_CONNECTION, "Receiving file");
   }
@@ -535,9 +606,21 @@ namespace fineftp
     return FtpMessage(FtpReplyCode::SYNTAX_ERROR_UNRECOGNIZED_COMMAND, "Command not implemented");
   }
 
-  FtpMessage FtpSession::handleFtpCommandREST(const std::string& /*param*/)
+  // RFC 3659: The offset is a number of bytes, a following RETR starts sending
+  // the file there and a following STOR appends to a file of exactly that size
+  FtpMessage FtpSession::handleFtpCommandREST(const std::string& param)
   {
-    return FtpMessage(FtpReplyCode::COMMAND_NOT_IMPLEMENTED, "Command not implemented");
+    restart_offset_ = 0;
+
+    if (!logged_in_user_) return FtpMessage(FtpReplyCode::NOT_LOGGED_IN, "Not logged in");
+
+    if (param.empty() || (param.find_first_not_of("0123456789") != std::string::npos) || (param.size() > 18))
+    {
+      return FtpMessage(FtpReplyCode::SYNTAX_ERROR_PARAMETERS, "Invalid restart offset");
+    }
+
+    restart_offset_ = std::stoull(param);
+    return FtpMessage(FtpReplyCode::FILE_ACTION_NEEDS_FURTHER_INFO, "Restarting at " + param);
   }
 
   FtpMessage FtpSession::handleFtpCommandRNFR(const std::string& param)
@@ -594,6 +677,8 @@ namespace fineftp
 #ifdef WIN32
       if (MoveFileA(local_from_path.c_str(), local_to_path.c_str()) != 0)
       {
+        invalidateCachedListing(local_from_path);
+        invalidateCachedListing(local_to_path);
         return FtpMessage(FtpReplyCode::FILE_ACTION_COMPLETED, "OK");
       }
       else
@@ -603,6 +688,8 @@ namespace fineftp
 #else // WIN32
       if (rename(local_from_path.c_str(), local_to_path.c_str()) == 0)
       {
+        invalidateCachedListing(local_from_path);
+        invalidateCachedListing(local_to_path);
         return FtpMessage(FtpReplyCode::FILE_ACTION_COMPLETED, "OK");
       }
       else
@@ -648,6 +735,7 @@ namespace fineftp
 #ifdef WIN32
         if (DeleteFileA(local_path.c_str()) != 0)
         {
+          invalidateCachedListing(local_path);
           return FtpMessage(FtpReplyCode::FILE_ACTION_COMPLETED, "Successfully deleted file");
         }
         else
@@ -657,6 +745,7 @@ namespace fineftp
 #else
         if (unlink(local_path.c_str()) == 0)
         {
+          invalidateCachedListing(local_path);
           return FtpMessage(FtpReplyCode::FILE_ACTION_COMPLETED, "Successfully deleted file");
         }
         else
@@ -678,6 +767,7 @@ namespace fineftp
 #ifdef WIN32
     if (RemoveDirectoryA(local_path.c_str()) != 0)
     {
+      invalidateCachedListing(local_path);
       return FtpMessage(FtpReplyCode::FILE_ACTION_COMPLETED, "Successfully removed directory");
     }
     else
@@ -690,6 +780,7 @@ namespace fineftp
 #else
     if (rmdir(local_path.c_str()) == 0)
     {
+      invalidateCachedListing(local_path);
       return FtpMessage(FtpReplyCode::FILE_ACTION_COMPLETED, "Successfully removed directory");
     }
     else
@@ -714,6 +805,7 @@ namespace fineftp
     LPSECURITY_ATTRIBUTES security_attributes = NULL; // => Default security attributes
     if (CreateDirectoryA(local_path.c_str(), security_attributes) != 0)
     {
+      invalidateCachedListing(local_path);
       return FtpMessage(FtpReplyCode::PATHNAME_CREATED, createQuotedFtpPath(toAbsoluateFtpPath(param)) + " Successfully created");
     }
     else
@@ -727,6 +819,7 @@ namespace fineftp
     mode_t mode = 0755;
     if (mkdir(local_path.c_str(), mode) == 0)
     {
+      invalidateCachedListing(local_path);
       return FtpMessage(FtpReplyCode::PATHNAME_CREATED, createQuotedFtpPath(toAbsoluateFtpPath(param)) + " Successfully created");
     }
     else
@@ -749,74 +842,53 @@ namespace fineftp
 
   FtpMessage FtpSession::handleFtpCommandLIST(const std::string& param)
   {
-    if (!logged_in_user_)                                                           return FtpMessage(FtpReplyCode::NOT_LOGGED_IN,    "Not logged in");
-
-    // RFC 959 does not allow ACTION_NOT_TAKEN (-> permanent error), so we return a temporary error (FILE_ACTION_NOT_TAKEN).
-    if (static_cast<int>(logged_in_user_->permissions_ & Permission::DirList) == 0) return FtpMessage(FtpReplyCode::FILE_ACTION_NOT_TAKEN, "Permission denied");
+    return startDirectoryListing(param, ListingFormat::List);
+  }
 
-    std::string local_path = toLocalPath(param);
-    auto dir_status = Filesystem::FileStatus(local_path);
+  FtpMessage FtpSession::handleFtpCommandNLST(const std::string& param)
+  {
+    return startDirectoryListing(param, ListingFormat::NameList);
+  }
 
-    if (dir_status.isOk())
-    {
-      if (dir_status.type() == Filesystem::FileType::Dir)
-      {
-        if (dir_status.canOpenDir())
-        {
-          sendDirectoryListing(Filesystem::dirContent(local_path));
-          return FtpMessage(FtpReplyCode::FILE_STATUS_OK_OPENING_DATA_CONNECTION, "Sending directory listing");
-        }
-        else
-        {
-          return FtpMessage(FtpReplyCode::FILE_ACTION_NOT_TAKEN, "Permission denied");
-        }
-      }
-      else
-      {
-        // TODO: RFC959: If the pathname specifies a file then the server should send current information on the file.
-        return FtpMessage(FtpReplyCode::FILE_ACTION_NOT_TAKEN, "Path is not a directory");
-      }
-    }
-    else
-    {
-      return FtpMessage(FtpReplyCode::FILE_ACTION_NOT_TAKEN, "Path does not exist");
-    }
+  FtpMessage FtpSession::handleFtpCommandMLSD(const std::string& param)
+  {
+    return startDirectoryListing(param, ListingFormat::MachineList);
   }
 
-  FtpMessage FtpSession::handleFtpCommandNLST(const std::string& param)
+  FtpMessage FtpSession::handleFtpCommandMLST(const std::string& param)
   {
     if (!logged_in_user_)                                                           return FtpMessage(FtpReplyCode::NOT_LOGGED_IN,    "Not logged in");
+    if (static_cast<int>(logged_in_user_->permissions_ & Permission::DirList) == 0) return FtpMessage(FtpReplyCode::ACTION_NOT_TAKEN, "Permission denied");
 
-    // RFC 959 does not allow ACTION_NOT_TAKEN (-> permanent error), so we return a temporary error (FILE_ACTION_NOT_TAKEN).
-    if (static_cast<int>(logged_in_user_->permissions_ & Permission::DirList) == 0) return FtpMessage(FtpReplyCode::FILE_ACTION_NOT_TAKEN, "Permission denied");
-
-    std::string local_path = toLocalPath(param);
-    auto dir_status = Filesystem::FileStatus(local_path);
+    // Without a parameter, MLST describes the current working directory
+    std::string ftp_path = toAbsoluateFtpPath(param.empty() ? ftp_working_directory_ : param);
+    auto file_status = Filesystem::FileStatus(toLocalPath(ftp_path));
 
-    if (dir_status.isOk())
+    if (!file_status.isOk())
     {
-      if (dir_status.type() == Filesystem::FileType::Dir)
-      {
-        if (dir_status.canOpenDir())
-        {
-          sendNameList(Filesystem::dirContent(local_path));
-          return FtpMessage(FtpReplyCode::FILE_STATUS_OK_OPENING_DATA_CONNECTION, "Sending name list");
-        }
-        else
-        {
-          return FtpMessage(FtpReplyCode::FILE_ACTION_NOT_TAKEN, "Permission denied");
-        }
-      }
-      else
-      {
-        // TODO: RFC959: If the pathname specifies a file then the server should send current information on the file.
-        return FtpMessage(FtpReplyCode::FILE_ACTION_NOT_TAKEN, "Path is not a directory");
-      }
+      return FtpMessage(FtpReplyCode::ACTION_NOT_TAKEN, "Path does not exist");
     }
-    else
+
+    // RFC 3659: The facts are sent on the control connection, in a single line starting with a space
+    return FtpMessage(FtpReplyCode::FILE_ACTION_COMPLETED, "Listing " + ftp_path + "\r\n"
+                                                           + " " + DirectoryListing::machineListFacts(ftp_path, file_status, logged_in_user_->permissions_) + " " + ftp_path + "\r\n"
+                                                           + "End");
+  }
+
+  // RFC 3659: The size of a file in bytes, as it would be sent by RETR in TYPE I
+  FtpMessage FtpSession::handleFtpCommandSIZE(const std::string& param)
+  {
+    if (!logged_in_user_)                                                            return FtpMessage(FtpReplyCode::NOT_LOGGED_IN,    "Not logged in");
+    if (static_cast<int>(logged_in_user_->permissions_ & Permission::FileRead) == 0) return FtpMessage(FtpReplyCode::ACTION_NOT_TAKEN, "Permission denied");
+
+    auto file_status = Filesystem::FileStatus(toLocalPath(param));
+
+    if (!file_status.isOk() || (file_status.type() != Filesystem::FileType::RegularFile))
     {
-      return FtpMessage(FtpReplyCode::FILE_ACTION_NOT_TAKEN, "Path does not exist");
+      return FtpMessage(FtpReplyCode::ACTION_NOT_TAKEN, "Not a regular file");
     }
+
+    return FtpMessage(FtpReplyCode::FILE_STATUS, std::to_string(file_status.fileSize()));
   }
 
   FtpMessage FtpSession::handleFtpCommandSITE(const std::string& /*param*/)
@@ -860,57 +932,98 @@ namespace fineftp
     return FtpMessage(FtpReplyCode::COMMAND_OK, "OK");
   }
 
+  FtpMessage FtpSession::handleFtpCommandFEAT(const std::string& /*param*/)
+  {
+    return FtpMessage(FtpReplyCode::REPLY_SYSTEM_STATUS, std::string("Features:\r\n")
+                                                         + " MLST type*;size*;modify*;perm*;\r\n"
+                                                         + " REST STREAM\r\n"
+                                                         + " SIZE\r\n"
+                                                         + "End");
+  }
 
-  ////////////////////////////////////////////////////////
-  // FTP data-socket send
-  ////////////////////////////////////////////////////////
-
-  void FtpSession::sendDirectoryListing(const std::map<std::string, Filesystem::FileStatus>& directory_content)
+  FtpMessage FtpSession::startDirectoryListing(const std::string& param, ListingFormat format)
   {
-    auto data_socket = std::make_shared<asio::ip::tcp::socket>(io_service_);
+    if (!logged_in_user_)                                                           return FtpMessage(FtpReplyCode::NOT_LOGGED_IN,    "Not logged in");
 
-    data_acceptor_.async_accept(*data_socket
-                              , [data_socket, directory_content, me = shared_from_this()](auto ec)
-                                {
-                                  if (ec)
-                                  {
-                                    me->sendFtpMessage(FtpReplyCode::TRANSFER_ABORTED, "Data transfer aborted");
-                                    return;
-                                  }
-      // TODO: close acceptor after connect?
-                                  // Create a Unix-like file list
-                                  std::stringstream stream;
-                                  for (const auto& entry : directory_content)
+    // RFC 959 does not allow ACTION_NOT_TAKEN (-> permanent error), so we return a temporary error (FILE_ACTION_NOT_TAKEN).
+    if (static_cast<int>(logged_in_user_->permissions_ & Permission::DirList) == 0) return FtpMessage(FtpReplyCode::FILE_ACTION_NOT_TAKEN, "Permission denied");
+
+    const std::string local_path  = toLocalPath(param);
+    const Permission  permissions = logged_in_user_->permissions_;
+    const std::string reply_text  = (format == ListingFormat::NameList ? "Sending name list" : "Sending directory listing");
+
+    // A cached listing is sent without touching the filesystem at all
+    if (listing_cache_)
+    {
+      auto cached_listing = listing_cache_->lookup(local_path, format, permissions);
+      if (cached_listing)
+      {
+        sendDirectoryListing(std::make_shared<DirectoryListing>(cached_listing));
+        return FtpMessage(FtpReplyCode::FILE_STATUS_OK_OPENING_DATA_CONNECTION, reply_text);
+      }
+    }
+
+    auto dir_status = Filesystem::FileStatus(local_path);
+
+    if (dir_status.isOk())
+    {
+      if (dir_status.type() == Filesystem::FileType::Dir)
+      {
+        // Start watching the directory before reading it, so changes during the listing are not missed
+        const uint64_t cache_token = (listing_cache_ ? listing_cache_->prepareInsert(local_path) : 0);
+
+        auto listing = std::make_shared<DirectoryListing>(local_path, format, sort_directory_listings_, permissions);
+        if (listing->isOk())
+        {
+          if (listing_cache_)
+          {
+            listing->recordOutput(listing_cache_->maxListingSize()
+                                , [listing_cache = listing_cache_, local_path, format, permissions, cache_token](std::shared_ptr<const std::string> rendered_listing)
                                   {
-                                    const std::string& filename(entry.first);
-                                    const fineftp::Filesystem::FileStatus& file_status(entry.second);
-
-                                    stream << ((file_status.type() == fineftp::Filesystem::FileType::Dir) ? 'd' : '-') << file_status.permissionString() << "   1 ";
-                                    stream << std::setw(10) << file_status.ownerString() << " " << std::setw(10) << file_status.groupString() << " ";
-                                    stream << std::setw(10) << file_status.fileSize() << " ";
-                                    stream << file_status.timeString() << " ";
-                                    stream << filename;
-                                    stream << "\r\n";
-                                  }
+                                    listing_cache->insert(local_path, format, permissions, cache_token, std::move(rendered_listing));
+                                  });
+          }
 
-                                  // Copy the file list into a raw char vector
-                                  std::string dir_listing_string = stream.str();
-                                  std::shared_ptr<std::vector<char>> dir_listing_rawdata = std::make_shared<std::vector<char>>();
-                                  dir_listing_rawdata->reserve(dir_listing_string.size());
-                                  std::copy(dir_listing_string.begin(), dir_listing_string.end(), std::back_inserter(*dir_listing_rawdata));
+          sendDirectoryListing(listing);
+          return FtpMessage(FtpReplyCode::FILE_STATUS_OK_OPENING_DATA_CONNECTION, reply_text);
+        }
+        else
+        {
+          return FtpMessage(FtpReplyCode::FILE_ACTION_NOT_TAKEN, "Permission denied");
+        }
+      }
+      else
+      {
+        // TODO: RFC959: If the pathname specifies a file then the server should send current information on the file.
+        return FtpMessage(FtpReplyCode::FILE_ACTION_NOT_TAKEN, "Path is not a directory");
+      }
+    }
+    else
+    {
+      return FtpMessage(FtpReplyCode::FILE_ACTION_NOT_TAKEN, "Path does not exist");
+    }
+  }
 
-                                  // Send the string out
-                                  me->addDataToBufferAndSend(dir_listing_rawdata, data_socket);
-                                  me->addDataToBufferAndSend(std::shared_ptr<std::vector<char>>(), data_socket);// Nullpointer indicates end of transmission
-                                });
+  void FtpSession::invalidateCachedListing(const std::string& local_path)
+  {
+    if (listing_cache_)
+    {
+      // The path itself may be a directory that has been removed or renamed
+      listing_cache_->invalidate(local_path);
+      listing_cache_->invalidate(Filesystem::cleanPathNative(local_path + "/.."));
+    }
   }
 
-  void FtpSession::sendNameList(const std::map<std::string, Filesystem::FileStatus>& directory_content)
+  ////////////////////////////////////////////////////////
+  // FTP data-socket send
+  ////////////////////////////////////////////////////////
+
+  void FtpSession::sendDirectoryListing(std::shared_ptr<DirectoryListing> listing)
   {
-    auto data_socket = std::make_shared<asio::ip::tcp::socket>(io_service_);
+    auto data_socket = createDataSocket(TransferDirection::Download);
 
     data_acceptor_.async_accept(*data_socket
-                              , [data_socket, directory_content, me = shared_from_this()](auto ec)
+                              , [data_socket, listing, me = shared_from_this()](auto ec)
                                 {
                                   if (ec)
                                   {
@@ -918,29 +1031,40 @@ namespace fineftp
                                     return;
                                   }
 
-                                  // Create a file list
-                                  std::stringstream stream;
-                                  for (const auto& entry : directory_content)
+                                  // Start sending multiple buffers at once. The rest of
+                                  // the listing is rendered while those are being sent.
+                                  for (size_t i = 0; i < me->transfer_queue_depth_; i++)
                                   {
-                                    stream << entry.first;
-                                    stream << "\r\n";
+                                    me->renderDirectoryListingAndSend(listing, data_socket);
                                   }
+                                });
+  }
 
-                                  // Copy the file list into a raw char vector
-                                  std::string dir_listing_string = stream.str();
-                                  std::shared_ptr<std::vector<char>> dir_listing_rawdata = std::make_shared<std::vector<char>>();
-                                  dir_listing_rawdata->reserve(dir_listing_string.size());
-                                  std::copy(dir_listing_string.begin(), dir_listing_string.end(), std::back_inserter(*dir_listing_rawdata));
+  void FtpSession::renderDirectoryListingAndSend(std::shared_ptr<DirectoryListing> listing, std::shared_ptr<asio::ip::tcp::socket> data_socket)
+  {
+    // The strand keeps the rendered buffers in order
+    data_buffer_strand_.post([me = shared_from_this(), listing, data_socket]()
+                            {
+                              if (listing->done()) return;
 
-                                  // Send the string out
-                                  me->addDataToBufferAndSend(dir_listing_rawdata, data_socket);
-                                  me->addDataToBufferAndSend(std::shared_ptr<std::vector<char>>(), data_socket);// Nullpointer indicates end of transmission
-                                });
+                              std::shared_ptr<TransferBuffer> buffer = me->buffer_pool_->acquire();
+                              listing->render(*buffer);
+
+                              if (!listing->done())
+                              {
+                                me->addDataToBufferAndSend(buffer, data_socket, [me, listing, data_socket]() { me->renderDirectoryListingAndSend(listing, data_socket); });
+                              }
+                              else
+                              {
+                                me->addDataToBufferAndSend(buffer, data_socket);
+                                me->addDataToBufferAndSend(std::shared_ptr<TransferBuffer>(), data_socket);// Nullpointer indicates end of transmission
+                              }
+                            });
   }
 
   void FtpSession::sendFile(std::shared_ptr<IoFile> file)
   {
-    auto data_socket = std::make_shared<asio::ip::tcp::socket>(io_service_);
+    auto data_socket = createDataSocket(TransferDirection::Download);
 
     data_acceptor_.async_accept(*data_socket
                               , [data_socket, file, me = shared_from_this()](auto ec)
@@ -952,78 +1076,111 @@ namespace fineftp
                                   }
 
                                   // Start sending multiple buffers at once
-                                  me->readDataFromFileAndSend(file, data_socket);
-                                  me->readDataFromFileAndSend(file, data_socket);
-                                  me->readDataFromFileAndSend(file, data_socket);
+                                  for (size_t i = 0; i < me->transfer_queue_depth_; i++)
+                                  {
+                                    me->readDataFromFileAndSend(file, data_socket);
+                                  }
                                 });
 
   }
 
   void FtpSession::readDataFromFileAndSend(std::shared_ptr<IoFile> file, std::shared_ptr<asio::ip::tcp::socket> data_socket)
   {
-    file_rw_strand_.post([me = shared_from_this(), file, data_socket]()
-                        {
-                          if(file->file_stream_.eof()) return;
+    std::shared_ptr<TransferBuffer> buffer = buffer_pool_->acquire();
 
-                          std::shared_ptr<std::vector<char>>buffer = std::make_shared<std::vector<char>>(1024 * 1024 * 1);
-                          file->file_stream_.read(buffer->data(), static_cast<std::streamsize>(buffer->size()));
-                          auto bytes_read = file->file_stream_.gcount();
-                          buffer->resize(static_cast<size_t>(bytes_read));
+    file_io_->read(file, buffer, [me = shared_from_this(), file, data_socket, buffer](asio::error_code ec)
+                  {
+                    // An earlier read has already reached the end of the file or failed
+                    if ((ec == asio::error::eof) || (ec == asio::error::operation_aborted)) return;
 
-                          if (!file->file_stream_.eof())
-                          {
-                            me->addDataToBufferAndSend(buffer, data_socket, [me, file, data_socket]() {me->readDataFromFileAndSend(file, data_socket); });
-                          }
-                          else
-                          {
-                            me->addDataToBufferAndSend(buffer, data_socket);
-                            me->addDataToBufferAndSend(std::shared_ptr<std::vector<char>>(nullptr), data_socket);
-                          }
-                        });
+                    if (ec)
+                    {
+                      std::cerr << "File read error: " << ec.message() << std::endl;
+                      me->data_buffer_strand_.post([data_socket]()
+                                                  {
+                                                    asio::error_code close_ec;
+                                                    data_socket->close(close_ec);
+                                                  });
+                      me->sendFtpMessage(FtpReplyCode::ACTION_ABORTED_LOCAL_ERROR, "Error reading file");
+                      return;
+                    }
+
+                    // Only the last buffer of a file is not filled completely
+                    if (buffer->size() == buffer->capacity())
+                    {
+                      me->addDataToBufferAndSend(buffer, data_socket, [me, file, data_socket]() {me->readDataFromFileAndSend(file, data_socket); });
+                    }
+                    else
+                    {
+                      me->addDataToBufferAndSend(buffer, data_socket);
+                      me->addDataToBufferAndSend(std::shared_ptr<TransferBuffer>(nullptr), data_socket);
+                    }
+                  });
   }
 
-  void FtpSession::addDataToBufferAndSend(std::shared_ptr<std::vector<char>> data, std::shared_ptr<asio::ip::tcp::socket> data_socket, std::function<void(void)> fetch_more)
+  void FtpSession::addDataToBufferAndSend(std::shared_ptr<TransferBuffer> data, std::shared_ptr<asio::ip::tcp::socket> data_socket, std::function<void(void)> fetch_more)
   {
     data_buffer_strand_.post([me = shared_from_this(), data, data_socket, fetch_more]()
                             {
                               bool write_in_progress = (!me->data_buffer_.empty());
 
                               me->data_buffer_.push_back(data);
+                              if (data)
+                                me->metrics_->sendBufferQueued();
 
                               if (!write_in_progress)
                               {
-                                me->writeDataToSocket(data_socket, fetch_more);
+                                me->writeDataToSocket(data_socket, fetch_more, 0);
                               }
                             });
   }
 
-  void FtpSession::writeDataToSocket(std::shared_ptr<asio::ip::tcp::socket> data_socket, std::function<void(void)> fetch_more)
+  void FtpSession::writeDataToSocket(std::shared_ptr<asio::ip::tcp::socket> data_socket, std::function<void(void)> fetch_more, size_t offset)
   {
     data_buffer_strand_.post(
-                    [me = shared_from_this(), data_socket, fetch_more]()
+                    [me = shared_from_this(), data_socket, fetch_more, offset]()
                     {
                       auto data = me->data_buffer_.front();
 
                       if (data)
                       {
+                        // Throttled transfers are sent in small slices, so the data rate stays smooth
+                        size_t bytes_to_write = data->size() - offset;
+                        if (me->isThrottled(TransferDirection::Download))
+                          bytes_to_write = std::min(bytes_to_write, throttled_slice_size);
+
                         // Send out the buffer
                         asio::async_write(*data_socket
-                                          , asio::buffer(*data)
-                                          , me->data_buffer_strand_.wrap([me, data_socket, data, fetch_more](asio::error_code ec, std::size_t /*bytes_to_transfer*/)
+                                          , asio::buffer(data->data() + offset, bytes_to_write)
+                                          , me->data_buffer_strand_.wrap([me, data_socket, data, fetch_more, offset](asio::error_code ec, std::size_t bytes_written)
                                             {
-                                              me->data_buffer_.pop_front();
+                                              me->metrics_->addBytesTransferred(TransferDirection::Download, bytes_written);
 
                                               if (ec)
                                               {
+                                                me->data_buffer_.pop_front();
+                                                me->metrics_->sendBufferDequeued();
                                                 std::cerr << "Data write error: " << ec.message() << std::endl;
                                                 return;
                                               }
 
+                                              const auto resume_time = me->consumeBandwidth(TransferDirection::Download, bytes_written);
+
+                                              // Continue with the rest of a throttled buffer
+                                              if (offset + bytes_written < data->size())
+                                              {
+                                                me->waitForBandwidth(resume_time, [me, data_socket, fetch_more, next_offset = offset + bytes_written]() { me->writeDataToSocket(data_socket, fetch_more, next_offset); });
+                                                return;
+                                              }
+
+                                              me->data_buffer_.pop_front();
+                                              me->metrics_->sendBufferDequeued();
+
                                               fetch_more();
 
                                               if (!me->data_buffer_.empty())
                                               {
-                                                me->writeDataToSocket(data_socket, fetch_more);
+                                                me->waitForBandwidth(resume_time, [me, data_socket, fetch_more]() { me->writeDataToSocket(data_socket, fetch_more, 0); });
                                               }
                                             }
                                             ));
@@ -1038,13 +1195,141 @@ namespace fineftp
                     );
   }
 
+#ifdef __linux__
+  void FtpSession::sendFileZeroCopy(std::shared_ptr<ZeroCopyFile> file)
+  {
+    auto data_socket = createDataSocket(TransferDirection::Download);
+
+    data_acceptor_.async_accept(*data_socket
+                              , [data_socket, file, me = shared_from_this()](auto ec)
+                                {
+                                  if (ec)
+                                  {
+                                    me->sendFtpMessage(FtpReplyCode::TRANSFER_ABORTED, "Data transfer aborted");
+                                    return;
+                                  }
+
+                                  // sendfile() must never block an io_service thread. When the
+                                  // socket buffer is full we wait for the socket to become
+                                  // writable again.
+                                  data_socket->non_blocking(true, ec);
+                                  if (ec)
+                                  {
+                                    std::cerr << "Unable to set data socket non-blocking: " << ec.message() << std::endl;
+                                    me->sendFtpMessage(FtpReplyCode::TRANSFER_ABORTED, "Data transfer aborted");
+                                    return;
+                                  }
+
+                                  me->sendFileDataWithSendfile(file, data_socket);
+                                });
+  }
+
+  void FtpSession::sendFileDataWithSendfile(std::shared_ptr<ZeroCopyFile> file, std::shared_ptr<asio::ip::tcp::socket> data_socket)
+  {
+    // Don't keep the io_service thread busy with a single fast client forever.
+    // After this many bytes we yield and continue from the next writable notification.
+    const off_t max_bytes_per_turn = (isThrottled(TransferDirection::Download) ? static_cast<off_t>(throttled_slice_size) : 4 * 1024 * 1024);
+    off_t       bytes_this_turn    = 0;
+    bool        end_of_file        = false;
+    auto        resume_time        = BandwidthLimiter::Clock::time_point();
+
+    while (file->offset_ < file->size_)
+    {
+      if (bytes_this_turn >= max_bytes_per_turn)
+        break;
+
+      const size_t count   = static_cast<size_t>(std::min(file->size_ - file->offset_, max_bytes_per_turn - bytes_this_turn));
+      const ssize_t result = ::sendfile(data_socket->native_handle(), file->fd_, &file->offset_, count);
+
+      if (result > 0)
+      {
+        bytes_this_turn += result;
+      }
+      else if (result == 0)
+      {
+        // The file has been truncated while we were sending it
+        end_of_file = true;
+        break;
+      }
+      else if (errno == EINTR)
+      {
+        continue;
+      }
+      else if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+      {
+        break;
+      }
+      else if (((errno == EINVAL) || (errno == ENOSYS)) && (file->offset_ == file->begin_offset_))
+      {
+        // The filesystem does not support sendfile() (e.g. some FUSE
+        // filesystems). Nothing has been sent yet, so we fall back to the
+        // buffered path.
+        std::shared_ptr<IoFile> io_file = std::make_shared<IoFile>(file->filename_, std::ios::in | std::ios::binary, io_service_, *buffer_pool_);
+        if (!io_file->good() || !io_file->seek(static_cast<uint64_t>(file->begin_offset_)))
+        {
+          sendFtpMessage(FtpReplyCode::TRANSFER_ABORTED, "Data transfer aborted");
+          return;
+        }
+
+        asio::error_code ec;
+        data_socket->non_blocking(false, ec);
+
+        for (size_t i = 0; i < transfer_queue_depth_; i++)
+        {
+          readDataFromFileAndSend(io_file, data_socket);
+        }
+        return;
+      }
+      else
+      {
+        std::cerr << "Data write error: " << strerror(errno) << std::endl;
+        sendFtpMessage(FtpReplyCode::TRANSFER_ABORTED, "Data transfer aborted");
+        return;
+      }
+    }
+
+    if (bytes_this_turn > 0)
+    {
+      metrics_->addBytesTransferred(TransferDirection::Download, static_cast<size_t>(bytes_this_turn));
+      resume_time = consumeBandwidth(TransferDirection::Download, static_cast<size_t>(bytes_this_turn));
+    }
+
+    if (end_of_file || (file->offset_ >= file->size_))
+    {
+      // We got to the end of transmission. The data socket is closed when
+      // the last reference to it is dropped.
+      sendFtpMessage(FtpReplyCode::CLOSING_DATA_CONNECTION, "Done");
+      return;
+    }
+
+    if (resume_time > BandwidthLimiter::Clock::now())
+    {
+      waitForBandwidth(resume_time, [me = shared_from_this(), file, data_socket]() { me->sendFileDataWithSendfile(file, data_socket); });
+      return;
+    }
+
+    data_socket->async_wait(asio::ip::tcp::socket::wait_write
+                          , [me = shared_from_this(), file, data_socket](asio::error_code ec)
+                            {
+                              if (ec)
+                              {
+                                std::cerr << "Data write error: " << ec.message() << std::endl;
+                                me->sendFtpMessage(FtpReplyCode::TRANSFER_ABORTED, "Data transfer aborted");
+                                return;
+                              }
+
+                              me->sendFileDataWithSendfile(file, data_socket);
+                            });
+  }
+#endif // __linux__
+
   ////////////////////////////////////////////////////////
   // FTP data-socket receive
   ////////////////////////////////////////////////////////
 
   void FtpSession::receiveFile(std::shared_ptr<IoFile> file)
   {
-    auto data_socket = std::make_shared<asio::ip::tcp::socket>(io_service_);
+    auto data_socket = createDataSocket(TransferDirection::Upload);
 
     data_acceptor_.async_accept(*data_socket
                               , [data_socket, file, me = shared_from_this()](auto ec)
@@ -1061,46 +1346,126 @@ namespace fineftp
 
   void FtpSession::receiveDataFromSocketAndWriteToFile(std::shared_ptr<IoFile> file, std::shared_ptr<asio::ip::tcp::socket> data_socket)
   {
-    std::shared_ptr<std::vector<char>> buffer = std::make_shared<std::vector<char>>(1024 * 1024 * 1);
-      
+    std::shared_ptr<TransferBuffer> buffer = buffer_pool_->acquire();
+
+    // Throttled transfers are received in small slices, so the data rate stays smooth
+    if (isThrottled(TransferDirection::Upload))
+      buffer->resize(std::min(buffer->capacity(), throttled_slice_size));
+
     asio::async_read(*data_socket
-                    , asio::buffer(*buffer)
+                    , asio::buffer(buffer->data(), buffer->size())
                     , asio::transfer_at_least(buffer->size())
                     , [me = shared_from_this(), file, data_socket, buffer](asio::error_code ec, std::size_t length)
                       {
                         buffer->resize(length);
+                        me->metrics_->addBytesTransferred(TransferDirection::Upload, length);
+
                         if (ec)
                         {
                           if (length > 0)
                           {
                             me->writeDataToFile(buffer, file);
                           }
-                          me->endDataReceiving();
+                          me->endDataReceiving(file);
                           return;
                         }
                         else if (length > 0)
                         {
-                          me->writeDataToFile(buffer, file, [me, file, data_socket]() { me->receiveDataFromSocketAndWriteToFile(file, data_socket); });
+                          const auto resume_time = me->consumeBandwidth(TransferDirection::Upload, length);
+                          me->writeDataToFile(buffer, file, [me, file, data_socket, resume_time]()
+                                                            {
+                                                              me->waitForBandwidth(resume_time, [me, file, data_socket]() { me->receiveDataFromSocketAndWriteToFile(file, data_socket); });
+                                                            });
                         }
                       });
   }
 
 
-  void FtpSession::writeDataToFile(std::shared_ptr<std::vector<char>> data, std::shared_ptr<IoFile> file, std::function<void(void)> fetch_more)
+  void FtpSession::writeDataToFile(std::shared_ptr<TransferBuffer> data, std::shared_ptr<IoFile> file, std::function<void(void)> fetch_more)
   {
-    file_rw_strand_.post([me = shared_from_this(), data, file, fetch_more]
-                        {
-                          fetch_more();
-                          file->file_stream_.write(data->data(), static_cast<std::streamsize>(data->size()));
-                        });
+    // Keep receiving while the disk is busy, but never let more than
+    // transfer_queue_depth_ buffers wait for it. Otherwise a fast client and a
+    // slow disk would queue up the whole file in memory.
+    const bool fetch_now = (file->pendingRequests() < transfer_queue_depth_);
+
+    file_io_->write(file, data, [data, fetch_later = !fetch_now, fetch_more](asio::error_code ec)
+                   {
+                     if (ec && (ec != asio::error::operation_aborted))
+                     {
+                       std::cerr << "File write error: " << ec.message() << std::endl;
+                     }
+
+                     if (fetch_later)
+                       fetch_more();
+                   });
+
+    if (fetch_now)
+      fetch_more();
   }
 
-  void FtpSession::endDataReceiving()
+  void FtpSession::endDataReceiving(std::shared_ptr<IoFile> file)
   {
-    file_rw_strand_.post([me = shared_from_this()]
-                        {
-                          me->sendFtpMessage(FtpReplyCode::CLOSING_DATA_CONNECTION, "Done");
-                        });
+    // The flush completes after all writes, so the reply reflects whether the file is complete
+    file_io_->flush(file, [me = shared_from_this()](asio::error_code ec)
+                   {
+                     if (ec)
+                     {
+                       me->sendFtpMessage(FtpReplyCode::ACTION_ABORTED_LOCAL_ERROR, "Error writing file");
+                       return;
+                     }
+
+                     me->sendFtpMessage(FtpReplyCode::CLOSING_DATA_CONNECTION, "Done");
+                   });
+  }
+
+  ////////////////////////////////////////////////////////
+  // Bandwidth limits & metrics
+  ////////////////////////////////////////////////////////
+
+  std::shared_ptr<asio::ip::tcp::socket> FtpSession::createDataSocket(TransferDirection direction)
+  {
+    // All handlers of a transfer hold a reference to its data socket, so the
+    // socket is destroyed exactly when the transfer has ended, no matter how.
+    metrics_->transferStarted(direction);
+    return std::shared_ptr<asio::ip::tcp::socket>(new asio::ip::tcp::socket(io_service_)
+                                                , [metrics = metrics_, direction](asio::ip::tcp::socket* data_socket)
+                                                  {
+                                                    metrics->transferFinished(direction);
+                                                    delete data_socket;
+                                                  });
+  }
+
+  bool FtpSession::isThrottled(TransferDirection direction) const
+  {
+    auto user_bandwidth_limiter = std::atomic_load(&user_bandwidth_limiter_);
+
+    return (session_bandwidth_limiter_.isLimited(direction)
+          || global_bandwidth_limiter_->isLimited(direction)
+          || (user_bandwidth_limiter && user_bandwidth_limiter->isLimited(direction)));
+  }
+
+  BandwidthLimiter::Clock::time_point FtpSession::consumeBandwidth(TransferDirection direction, size_t bytes)
+  {
+    // All limits have to be obeyed, so the transfer waits for the one that is exceeded the most
+    auto resume_time = std::max(session_bandwidth_limiter_.consume(direction, bytes), global_bandwidth_limiter_->consume(direction, bytes));
+
+    auto user_bandwidth_limiter = std::atomic_load(&user_bandwidth_limiter_);
+    if (user_bandwidth_limiter)
+      resume_time = std::max(resume_time, user_bandwidth_limiter->consume(direction, bytes));
+
+    return resume_time;
+  }
+
+  void FtpSession::waitForBandwidth(BandwidthLimiter::Clock::time_point resume_time, std::function<void(void)> handler)
+  {
+    if (resume_time <= BandwidthLimiter::Clock::now())
+    {
+      handler();
+      return;
+    }
+
+    auto timer = std::make_shared<asio::steady_timer>(io_service_, resume_time);
+    timer->async_wait([timer, handler](asio::error_code /*ec*/) { handler(); });
   }
 
   ////////////////////////////////////////////////////////
@@ -5,6 +5,18 @@
 #include <deque>
 #include <fstream>
 
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif // __linux__
+
+#include "bandwidth_limiter.h"
+#include "buffer_pool.h"
+#include "directory_listing.h"
+#include "file_io.h"
+#include "listing_cache.h"
+#include "metrics_collector.h"
 #include "ftp_message.h"
 
 #include "filesystem.h"
@@ -17,34 +29,59 @@ namespace fineftp
     : public std::enable_shared_from_this<FtpSession>
   {
   private:
-    struct IoFile
+#ifdef __linux__
+    /**
+     * @brief A plain file descriptor for sending a file with sendfile()
+     *
+     * The data never passes through a user-space buffer, so there is no
+     * FileIo backend and no TransferBuffer involved.
+     */
+    struct ZeroCopyFile
     {
-      IoFile(const char* filename, std::ios::openmode mode)
-        : file_stream_(filename, mode)
-        , stream_buffer_(1024 * 1024)
+      ZeroCopyFile(const std::string& filename, off_t offset = 0)
+        : filename_    (filename)
+        , fd_          (::open(filename.c_str(), O_RDONLY | O_CLOEXEC))
+        , begin_offset_(offset)
+        , offset_      (offset)
+        , size_        (0)
       {
-        file_stream_.rdbuf()->pubsetbuf(stream_buffer_.data(), static_cast<std::streamsize>(stream_buffer_.size()));
+        struct stat file_stat;
+        if ((fd_ >= 0) && (::fstat(fd_, &file_stat) == 0) && S_ISREG(file_stat.st_mode))
+        {
+          size_ = file_stat.st_size;
+        }
+        else if (fd_ >= 0)
+        {
+          ::close(fd_);
+          fd_ = -1;
+        }
       }
 
-      ~IoFile()
+      ~ZeroCopyFile()
       {
-        file_stream_.flush();
-        file_stream_.close();
+        if (fd_ >= 0)
+          ::close(fd_);
       }
 
-      IoFile(const std::string& filename, std::ios::openmode mode)
-        : IoFile(filename.c_str(), mode)
-      {}
+      ZeroCopyFile(const ZeroCopyFile&)            = delete;
+      ZeroCopyFile& operator=(const ZeroCopyFile&) = delete;
+
+      /** True if the file is open and is a regular file */
+      bool isRegularFile() const { return fd_ >= 0; }
 
-      std::fstream      file_stream_;
-      std::vector<char> stream_buffer_;
+      std::string filename_;
+      int         fd_;
+      const off_t begin_offset_;  // where the transfer starts (REST)
+      off_t       offset_;
+      off_t       size_;
     };
+#endif // __linux__
 
   ////////////////////////////////////////////////////////
   // Public API
   ////////////////////////////////////////////////////////
   public:
-    FtpSession(asio::io_service& io_service, const UserDatabase& user_database, const std::function<void()>& completion_handler);
+    FtpSession(asio::io_service& io_service, const UserDatabase& user_database, const std::shared_ptr<BufferPool>& buffer_pool, size_t transfer_queue_depth, const std::shared_ptr<FileIo>& file_io, bool sort_directory_listings, const std::shared_ptr<ListingCache>& listing_cache, const std::shared_ptr<BandwidthLimiter>& global_bandwidth_limiter, const RateLimit& session_rate_limit, const std::shared_ptr<MetricsCollector>& metrics, const std::function<void()>& completion_handler);
 
     ~FtpSession();
 
@@ -99,31 +136,51 @@ namespace fineftp
     FtpMessage handleFtpCommandPWD(const std::string& param);
     FtpMessage handleFtpCommandLIST(const std::string& param);
     FtpMessage handleFtpCommandNLST(const std::string& param);
+    FtpMessage handleFtpCommandMLSD(const std::string& param);
+    FtpMessage handleFtpCommandMLST(const std::string& param);
+    FtpMessage handleFtpCommandSIZE(const std::string& param);
     FtpMessage handleFtpCommandSITE(const std::string& param);
     FtpMessage handleFtpCommandSYST(const std::string& param);
     FtpMessage handleFtpCommandSTAT(const std::string& param);
     FtpMessage handleFtpCommandHELP(const std::string& param);
     FtpMessage handleFtpCommandNOOP(const std::string& param);
+    FtpMessage handleFtpCommandFEAT(const std::string& param);
+
+    // LIST, NLST and MLSD only differ in the format of the listing
+    FtpMessage startDirectoryListing(const std::string& param, ListingFormat format);
+
+    // Called whenever this session changes the content of a directory
+    void invalidateCachedListing(const std::string& local_path);
 
   ////////////////////////////////////////////////////////
   // FTP data-socket send
   ////////////////////////////////////////////////////////
   private:
 
-    void sendDirectoryListing   (const std::map<std::string, Filesystem::FileStatus>& directory_content);
-    void sendNameList           (const std::map<std::string, Filesystem::FileStatus>& directory_content);
+    void sendDirectoryListing   (std::shared_ptr<DirectoryListing>      listing);
+
+    void renderDirectoryListingAndSend(std::shared_ptr<DirectoryListing>      listing
+                                     , std::shared_ptr<asio::ip::tcp::socket> data_socket);
 
     void sendFile               (std::shared_ptr<IoFile>                file);
 
     void readDataFromFileAndSend(std::shared_ptr<IoFile>                file
                                , std::shared_ptr<asio::ip::tcp::socket> data_socket);
 
-    void addDataToBufferAndSend (std::shared_ptr<std::vector<char>>     data
+    void addDataToBufferAndSend (std::shared_ptr<TransferBuffer>        data
                                , std::shared_ptr<asio::ip::tcp::socket> data_socket
                                , std::function<void(void)>              fetch_more = []() {return; });
 
     void writeDataToSocket      (std::shared_ptr<asio::ip::tcp::socket> data_socket
-                               , std::function<void(void)>              fetch_more);
+                               , std::function<void(void)>              fetch_more
+                               , size_t                                 offset);
+
+#ifdef __linux__
+    void sendFileZeroCopy       (std::shared_ptr<ZeroCopyFile>          file);
+
+    void sendFileDataWithSendfile(std::shared_ptr<ZeroCopyFile>          file
+                                , std::shared_ptr<asio::ip::tcp::socket> data_socket);
+#endif // __linux__
 
   ////////////////////////////////////////////////////////
   // FTP data-socket receive
@@ -134,11 +191,26 @@ namespace fineftp
     void receiveDataFromSocketAndWriteToFile(std::shared_ptr<IoFile>                file
                                            , std::shared_ptr<asio::ip::tcp::socket> data_socket);
 
-    void writeDataToFile(std::shared_ptr<std::vector<char>> data
-                       , std::shared_ptr<IoFile>            file
-                       , std::function<void(void)>          fetch_more = []() {return; });
+    void writeDataToFile(std::shared_ptr<TransferBuffer> data
+                       , std::shared_ptr<IoFile>         file
+                       , std::function<void(void)>       fetch_more = []() {return; });
 
-    void endDataReceiving();
+    void endDataReceiving(std::shared_ptr<IoFile> file);
+
+  ////////////////////////////////////////////////////////
+  // Bandwidth limits & metrics
+  ////////////////////////////////////////////////////////
+  private:
+    /** Creates the socket of a data transfer. The transfer counts as active until the socket is destroyed. */
+    std::shared_ptr<asio::ip::tcp::socket> createDataSocket(TransferDirection direction);
+
+    /** True if the session, the user or the server limit the bandwidth */
+    bool isThrottled(TransferDirection direction) const;
+
+    /** Accounts the transferred bytes and returns the time at which the transfer may continue */
+    BandwidthLimiter::Clock::time_point consumeBandwidth(TransferDirection direction, size_t bytes);
+
+    void waitForBandwidth(BandwidthLimiter::Clock::time_point resume_time, std::function<void(void)> handler);
 
   ////////////////////////////////////////////////////////
   // Helpers
@@ -182,6 +254,23 @@ namespace fineftp
     // "Global" io service
     asio::io_service&        io_service_;
 
+    // Transfer buffers, shared by all sessions of the server
+    const std::shared_ptr<BufferPool> buffer_pool_;
+    const size_t                      transfer_queue_depth_;
+
+    // File I/O, executed away from the io_service threads
+    const std::shared_ptr<FileIo>     file_io_;
+
+    // Directory listings
+    const bool                          sort_directory_listings_;
+    const std::shared_ptr<ListingCache> listing_cache_;             // nullptr if listings are not cached
+
+    // Bandwidth limits & metrics
+    const std::shared_ptr<BandwidthLimiter> global_bandwidth_limiter_;
+    BandwidthLimiter                        session_bandwidth_limiter_;
+    std::shared_ptr<BandwidthLimiter>       user_bandwidth_limiter_;      // Only accessed with std::atomic_load / std::atomic_store, as the transfers run on other threads
+    const std::shared_ptr<MetricsCollector> metrics_;
+
     // Command Socket
     asio::ip::tcp::socket    command_socket_;
     asio::io_service::strand command_write_strand_;
@@ -194,11 +283,11 @@ namespace fineftp
 
     // Data Socket (=> passive mode)
     bool                                           data_type_binary_;
+    uint64_t                                       restart_offset_;  // set by REST, used by the following RETR or STOR
     asio::ip::tcp::acceptor                        data_acceptor_;
     std::weak_ptr<asio::ip::tcp::socket>           data_socket_weakptr_; // TODO: use
-    std::deque<std::shared_ptr<std::vector<char>>> data_buffer_; // TODO: close data port when the control port closes
+    std::deque<std::shared_ptr<TransferBuffer>>    data_buffer_; // TODO: close data port when the control port closes
     asio::io_service::strand                       data_buffer_strand_;
-    asio::io_service::strand                       file_rw_strand_;
 
     // Current state
     std::string ftp_working_directory_;
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "../include/fineftp/permissions.h"
+#include "bandwidth_limiter.h"
+#include <memory>
 #include <string>
 
 namespace fineftp
@@ -8,13 +10,17 @@ namespace fineftp
   struct FtpUser
   {
     FtpUser(const std::string& password, const std::string& local_root_path, const Permission permissions)
-      : password_       (password)
-      , local_root_path_(local_root_path)
-      , permissions_    (permissions)
+      : password_         (password)
+      , local_root_path_  (local_root_path)
+      , permissions_      (permissions)
+      , bandwidth_limiter_(std::make_shared<BandwidthLimiter>())
     {}
 
     const std::string password_;
     const std::string local_root_path_;
     const Permission permissions_;
+
+    // Shared by all sessions of this user
+    const std::shared_ptr<BandwidthLimiter> bandwidth_limiter_;
   };
 }
\ No newline at end of file
@@ -0,0 +1,264 @@
+#include "listing_cache.h"
+
+#include <algorithm>
+#include <vector>
+
+#ifdef __linux__
+#include <cerrno>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif // __linux__
+
+namespace fineftp
+{
+  ListingCache::ListingCache(size_t memory_budget, Clock::duration max_age)
+    : memory_budget_(memory_budget)
+    , max_age_      (max_age)
+    , memory_used_  (0)
+    , next_token_   (1)
+#ifdef __linux__
+    , inotify_fd_   (inotify_init1(IN_NONBLOCK | IN_CLOEXEC))
+#endif // __linux__
+  {}
+
+  ListingCache::~ListingCache()
+  {
+#ifdef __linux__
+    if (inotify_fd_ >= 0)
+      ::close(inotify_fd_);
+#endif // __linux__
+  }
+
+  std::shared_ptr<const std::string> ListingCache::lookup(const std::string& local_path, ListingFormat format, Permission permissions)
+  {
+    std::lock_guard<std::mutex> cache_lock(cache_mutex_);
+    processEvents();
+
+    auto entry = entries_.find(makeKey(local_path, format, permissions));
+    if (entry == entries_.end())
+      return nullptr;
+
+    if (Clock::now() - entry->second->created > max_age_)
+    {
+      erase(entry->second);
+      return nullptr;
+    }
+
+    lru_list_.splice(lru_list_.begin(), lru_list_, entry->second);
+    return entry->second->listing;
+  }
+
+  uint64_t ListingCache::prepareInsert(const std::string& local_path)
+  {
+    std::lock_guard<std::mutex> cache_lock(cache_mutex_);
+    processEvents();
+
+    const auto now = Clock::now();
+
+    // Forget directories that have been prepared, but never got a listing
+    for (auto directory = directories_.begin(); directory != directories_.end();)
+    {
+      auto current_directory = directory++;
+      if (current_directory->second.entry_keys.empty() && (now - current_directory->second.last_prepared > max_age_))
+        removeDirectory(current_directory);
+    }
+
+    auto directory = directories_.find(local_path);
+    if (directory == directories_.end())
+    {
+      Directory new_directory;
+      new_directory.watch_descriptor = -1;
+      new_directory.token            = next_token_++;
+
+#ifdef __linux__
+      // If we run out of watches, the directory is only invalidated by its age
+      if (inotify_fd_ >= 0)
+      {
+        new_directory.watch_descriptor = inotify_add_watch(inotify_fd_, local_path.c_str(), IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_MODIFY | IN_ATTRIB
+                                                                                          | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR);
+        if (new_directory.watch_descriptor >= 0)
+          watched_paths_.emplace(new_directory.watch_descriptor, local_path);
+      }
+#endif // __linux__
+
+      directory = directories_.emplace(local_path, std::move(new_directory)).first;
+    }
+
+    directory->second.last_prepared = now;
+    return directory->second.token;
+  }
+
+  void ListingCache::insert(const std::string& local_path, ListingFormat format, Permission permissions, uint64_t token, std::shared_ptr<const std::string> listing)
+  {
+    if (!listing || (listing->size() > maxListingSize()))
+      return;
+
+    std::lock_guard<std::mutex> cache_lock(cache_mutex_);
+    processEvents();
+
+    // The directory has been invalidated while the listing was rendered
+    auto directory = directories_.find(local_path);
+    if ((directory == directories_.end()) || (directory->second.token != token))
+      return;
+
+    std::string key = makeKey(local_path, format, permissions);
+
+    auto existing_entry = entries_.find(key);
+    if (existing_entry != entries_.end())
+      erase(existing_entry->second);
+
+    Entry entry;
+    entry.key         = key;
+    entry.local_path  = local_path;
+    entry.listing     = std::move(listing);
+    entry.created     = Clock::now();
+    entry.memory_size = entry.listing->size() + 2 * key.size() + local_path.size() + sizeof(Entry);
+
+    memory_used_ += entry.memory_size;
+    lru_list_.push_front(std::move(entry));
+    entries_.emplace(key, lru_list_.begin());
+    directory->second.entry_keys.push_back(key);
+
+    // The new entry is at the front and is smaller than the budget, so it is never evicted itself
+    while (memory_used_ > memory_budget_)
+    {
+      erase(std::prev(lru_list_.end()));
+    }
+  }
+
+  void ListingCache::invalidate(const std::string& local_path)
+  {
+    std::lock_guard<std::mutex> cache_lock(cache_mutex_);
+
+    auto directory = directories_.find(local_path);
+    if (directory != directories_.end())
+      removeDirectory(directory);
+  }
+
+  size_t ListingCache::maxListingSize() const
+  {
+    return memory_budget_ / 4;
+  }
+
+  std::string ListingCache::makeKey(const std::string& local_path, ListingFormat format, Permission permissions)
+  {
+    std::string key = local_path;
+    key += '\0';
+    key += std::to_string(static_cast<int>(format));
+
+    // Only the MLSD facts contain the user's permissions
+    if (format == ListingFormat::MachineList)
+    {
+      key += '\0';
+      key += std::to_string(static_cast<int>(permissions));
+    }
+
+    return key;
+  }
+
+  void ListingCache::processEvents()
+  {
+#ifdef __linux__
+    if (inotify_fd_ < 0)
+      return;
+
+    alignas(struct inotify_event) char event_buffer[4096];
+
+    for (;;)
+    {
+      const ssize_t bytes_read = ::read(inotify_fd_, event_buffer, sizeof(event_buffer));
+      if (bytes_read <= 0)
+      {
+        if ((bytes_read < 0) && (errno == EINTR))
+          continue;
+        break; // EAGAIN: No more events
+      }
+
+      for (ssize_t offset = 0; offset < bytes_read;)
+      {
+        const auto* event = reinterpret_cast<const struct inotify_event*>(event_buffer + offset);
+        offset += static_cast<ssize_t>(sizeof(struct inotify_event) + event->len);
+
+        // Events have been lost, so we cannot tell which directories have changed
+        if (event->mask & IN_Q_OVERFLOW)
+        {
+          removeAll();
+          continue;
+        }
+
+        std::vector<std::string> changed_paths;
+        auto watched_range = watched_paths_.equal_range(event->wd);
+        for (auto watched_path = watched_range.first; watched_path != watched_range.second; ++watched_path)
+        {
+          changed_paths.push_back(watched_path->second);
+        }
+
+        for (const std::string& changed_path : changed_paths)
+        {
+          auto directory = directories_.find(changed_path);
+          if (directory != directories_.end())
+            removeDirectory(directory);
+        }
+      }
+    }
+#endif // __linux__
+  }
+
+  void ListingCache::erase(std::list<Entry>::iterator entry)
+  {
+    auto directory = directories_.find(entry->local_path);
+    if (directory != directories_.end())
+    {
+      auto& entry_keys = directory->second.entry_keys;
+      entry_keys.erase(std::remove(entry_keys.begin(), entry_keys.end(), entry->key), entry_keys.end());
+    }
+
+    memory_used_ -= entry->memory_size;
+    entries_.erase(entry->key);
+    lru_list_.erase(entry);
+  }
+
+  void ListingCache::removeDirectory(std::map<std::string, Directory>::iterator directory)
+  {
+    for (const std::string& key : directory->second.entry_keys)
+    {
+      auto entry = entries_.find(key);
+      if (entry != entries_.end())
+      {
+        memory_used_ -= entry->second->memory_size;
+        lru_list_.erase(entry->second);
+        entries_.erase(entry);
+      }
+    }
+
+#ifdef __linux__
+    const int watch_descriptor = directory->second.watch_descriptor;
+    if (watch_descriptor >= 0)
+    {
+      auto watched_range = watched_paths_.equal_range(watch_descriptor);
+      for (auto watched_path = watched_range.first; watched_path != watched_range.second; ++watched_path)
+      {
+        if (watched_path->second == directory->first)
+        {
+          watched_paths_.erase(watched_path);
+          break;
+        }
+      }
+
+      // The same directory may still be watched through another path
+      if (watched_paths_.count(watch_descriptor) == 0)
+        inotify_rm_watch(inotify_fd_, watch_descriptor);
+    }
+#endif // __linux__
+
+    directories_.erase(directory);
+  }
+
+  void ListingCache::removeAll()
+  {
+    while (!directories_.empty())
+    {
+      removeDirectory(directories_.begin());
+    }
+  }
+}
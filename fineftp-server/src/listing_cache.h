@@ -0,0 +1,112 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../include/fineftp/permissions.h"
+#include "directory_listing.h"
+
+namespace fineftp
+{
+  /**
+   * @brief Keeps rendered directory listings of recently listed directories
+   *
+   * A cached listing is sent as it is, without reading or stat'ing the
+   * directory again. Listings are keyed by the local path and the format.
+   * MLSD listings also depend on the permissions of the user.
+   *
+   * On Linux, every cached directory is watched with inotify and its
+   * listings are dropped as soon as an entry is created, removed, renamed or
+   * modified. The maximum age still applies, as changes inside of
+   * subdirectories (which alter their modification time) are not reported.
+   * On other systems, the maximum age is the only invalidation, except for
+   * changes made through this server, which invalidate() the directory.
+   *
+   * When the memory budget is exceeded, the least recently used listings
+   * are evicted. The cache is thread safe.
+   */
+  class ListingCache
+  {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @param memory_budget: Maximum number of bytes of all cached listings
+     * @param max_age:       Time after which a listing is not used anymore
+     */
+    ListingCache(size_t memory_budget, Clock::duration max_age);
+    ~ListingCache();
+
+    ListingCache(const ListingCache&)            = delete;
+    ListingCache& operator=(const ListingCache&) = delete;
+
+    /** Returns the cached listing or nullptr */
+    std::shared_ptr<const std::string> lookup(const std::string& local_path, ListingFormat format, Permission permissions);
+
+    /**
+     * @brief Must be called before a listing is rendered for insert()
+     *
+     * Starts watching the directory. Changes that happen while the listing
+     * is being rendered make insert() discard the listing.
+     *
+     * @return A token that has to be passed to insert()
+     */
+    uint64_t prepareInsert(const std::string& local_path);
+
+    void insert(const std::string& local_path, ListingFormat format, Permission permissions, uint64_t token, std::shared_ptr<const std::string> listing);
+
+    /** Drops all listings of the given directory */
+    void invalidate(const std::string& local_path);
+
+    /** Larger listings are not cached, so a single directory cannot flush the entire cache */
+    size_t maxListingSize() const;
+
+  private:
+    struct Entry
+    {
+      std::string                        key;
+      std::string                        local_path;
+      std::shared_ptr<const std::string> listing;
+      Clock::time_point                  created;
+      size_t                             memory_size;
+    };
+
+    struct Directory
+    {
+      int                      watch_descriptor;   // -1 if the directory is not watched
+      uint64_t                 token;              // Changes whenever the directory is invalidated
+      std::vector<std::string> entry_keys;
+      Clock::time_point        last_prepared;
+    };
+
+    static std::string makeKey(const std::string& local_path, ListingFormat format, Permission permissions);
+
+    void processEvents();
+    void erase(std::list<Entry>::iterator entry);
+    void removeDirectory(std::map<std::string, Directory>::iterator directory);
+    void removeAll();
+
+    const size_t          memory_budget_;
+    const Clock::duration max_age_;
+
+    std::mutex            cache_mutex_;
+    size_t                memory_used_;
+    uint64_t              next_token_;
+
+    std::list<Entry>                                             lru_list_;   // Most recently used entry first
+    std::unordered_map<std::string, std::list<Entry>::iterator>  entries_;
+    std::map<std::string, Directory>                             directories_;
+
+#ifdef __linux__
+    int                                                          inotify_fd_;
+    std::multimap<int, std::string>                              watched_paths_; // A directory may be reachable through multiple paths
+#endif // __linux__
+  };
+}
@@ -0,0 +1,150 @@
+#include "metrics_collector.h"
+
+#include <algorithm>
+
+namespace fineftp
+{
+  ////////////////////////////////////////////////////////
+  // RateWindow
+  ////////////////////////////////////////////////////////
+
+  MetricsCollector::RateWindow::RateWindow()
+  {
+    bytes_.fill(0);
+    seconds_.fill(-1);
+  }
+
+  void MetricsCollector::RateWindow::add(int64_t current_second, uint64_t bytes)
+  {
+    const size_t slot = static_cast<size_t>(current_second % static_cast<int64_t>(bytes_.size()));
+    if (seconds_[slot] != current_second)
+    {
+      seconds_[slot] = current_second;
+      bytes_[slot]   = 0;
+    }
+    bytes_[slot] += bytes;
+  }
+
+  double MetricsCollector::RateWindow::rate(int64_t current_second) const
+  {
+    // The current second is not complete yet, so it is not part of the average
+    uint64_t bytes_in_window = 0;
+    for (size_t slot = 0; slot < bytes_.size(); slot++)
+    {
+      if ((seconds_[slot] >= current_second - window_seconds) && (seconds_[slot] < current_second))
+        bytes_in_window += bytes_[slot];
+    }
+    return static_cast<double>(bytes_in_window) / static_cast<double>(window_seconds);
+  }
+
+  ////////////////////////////////////////////////////////
+  // MetricsCollector
+  ////////////////////////////////////////////////////////
+
+  MetricsCollector::MetricsCollector()
+    : bytes_sent_         (0)
+    , bytes_received_     (0)
+    , active_downloads_   (0)
+    , active_uploads_     (0)
+    , queued_send_buffers_(0)
+  {}
+
+  void MetricsCollector::addBytesTransferred(TransferDirection direction, size_t bytes)
+  {
+    const int64_t current_second = currentSecond();
+
+    if (direction == TransferDirection::Download)
+      bytes_sent_ += bytes;
+    else
+      bytes_received_ += bytes;
+
+    std::lock_guard<std::mutex> rate_lock(rate_mutex_);
+    (direction == TransferDirection::Download ? sent_rate_ : received_rate_).add(current_second, bytes);
+  }
+
+  void MetricsCollector::transferStarted(TransferDirection direction)
+  {
+    (direction == TransferDirection::Download ? active_downloads_ : active_uploads_)++;
+  }
+
+  void MetricsCollector::transferFinished(TransferDirection direction)
+  {
+    (direction == TransferDirection::Download ? active_downloads_ : active_uploads_)--;
+  }
+
+  void MetricsCollector::sendBufferQueued()
+  {
+    queued_send_buffers_++;
+  }
+
+  void MetricsCollector::sendBufferDequeued()
+  {
+    queued_send_buffers_--;
+  }
+
+  void MetricsCollector::addCommandLatency(const std::string& command, Clock::duration latency)
+  {
+    const auto& bounds = latencyBounds();
+    const size_t bucket = static_cast<size_t>(std::lower_bound(bounds.begin(), bounds.end(), latency) - bounds.begin());
+
+    std::lock_guard<std::mutex> latency_lock(latency_mutex_);
+
+    Histogram& histogram = command_latency_[command];
+    if (histogram.counts.empty())
+      histogram.counts.resize(bounds.size() + 1, 0);
+
+    histogram.counts[bucket]++;
+    histogram.total_count++;
+    histogram.total_time += latency;
+  }
+
+  ServerMetrics MetricsCollector::snapshot(size_t pending_file_io_requests) const
+  {
+    ServerMetrics metrics;
+
+    metrics.bytes_sent               = bytes_sent_;
+    metrics.bytes_received           = bytes_received_;
+    metrics.active_downloads         = active_downloads_;
+    metrics.active_uploads           = active_uploads_;
+    metrics.queued_send_buffers      = queued_send_buffers_;
+    metrics.pending_file_io_requests = pending_file_io_requests;
+
+    {
+      const int64_t current_second = currentSecond();
+
+      std::lock_guard<std::mutex> rate_lock(rate_mutex_);
+      metrics.sent_bytes_per_second     = sent_rate_    .rate(current_second);
+      metrics.received_bytes_per_second = received_rate_.rate(current_second);
+    }
+
+    {
+      std::lock_guard<std::mutex> latency_lock(latency_mutex_);
+      for (const auto& command_histogram : command_latency_)
+      {
+        LatencyHistogram& latency_histogram = metrics.command_latency[command_histogram.first];
+        latency_histogram.upper_bounds = latencyBounds();
+        latency_histogram.counts       = command_histogram.second.counts;
+        latency_histogram.total_count  = command_histogram.second.total_count;
+        latency_histogram.total_time   = std::chrono::duration_cast<std::chrono::microseconds>(command_histogram.second.total_time);
+      }
+    }
+
+    return metrics;
+  }
+
+  int64_t MetricsCollector::currentSecond()
+  {
+    return std::chrono::duration_cast<std::chrono::seconds>(Clock::now().time_since_epoch()).count();
+  }
+
+  const std::vector<std::chrono::microseconds>& MetricsCollector::latencyBounds()
+  {
+    static const std::vector<std::chrono::microseconds> bounds {
+      std::chrono::microseconds(50),   std::chrono::microseconds(100),   std::chrono::microseconds(250),   std::chrono::microseconds(500),
+      std::chrono::milliseconds(1),    std::chrono::milliseconds(2) + std::chrono::microseconds(500),      std::chrono::milliseconds(5),
+      std::chrono::milliseconds(10),   std::chrono::milliseconds(25),    std::chrono::milliseconds(50),    std::chrono::milliseconds(100),
+      std::chrono::milliseconds(250),  std::chrono::milliseconds(500),   std::chrono::seconds(1),          std::chrono::seconds(5),
+    };
+    return bounds;
+  }
+}
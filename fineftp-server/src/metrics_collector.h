@@ -0,0 +1,88 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "../include/fineftp/server.h"
+#include "bandwidth_limiter.h"
+
+namespace fineftp
+{
+  /**
+   * @brief Collects the metrics of all sessions of a server
+   *
+   * The counters are updated once per transferred buffer and once per
+   * command, never per byte, so the collector can be shared by all sessions
+   * without becoming a bottleneck.
+   */
+  class MetricsCollector
+  {
+  public:
+    using Clock = std::chrono::steady_clock;
+
+    MetricsCollector();
+
+    MetricsCollector(const MetricsCollector&)            = delete;
+    MetricsCollector& operator=(const MetricsCollector&) = delete;
+
+    void addBytesTransferred(TransferDirection direction, size_t bytes);
+
+    void transferStarted (TransferDirection direction);
+    void transferFinished(TransferDirection direction);
+
+    void sendBufferQueued();
+    void sendBufferDequeued();
+
+    void addCommandLatency(const std::string& command, Clock::duration latency);
+
+    /** @param pending_file_io_requests: Taken from the FileIo backend, which counts them itself */
+    ServerMetrics snapshot(size_t pending_file_io_requests) const;
+
+  private:
+    /** Bytes per second over the last few complete seconds */
+    class RateWindow
+    {
+    public:
+      RateWindow();
+
+      void   add (int64_t current_second, uint64_t bytes);
+      double rate(int64_t current_second) const;
+
+    private:
+      static constexpr int64_t window_seconds = 5;
+
+      std::array<uint64_t, window_seconds + 1> bytes_;
+      std::array<int64_t,  window_seconds + 1> seconds_;   // The second that each slot currently counts
+    };
+
+    struct Histogram
+    {
+      std::vector<uint64_t> counts;
+      uint64_t              total_count = 0;
+      Clock::duration       total_time  {0};
+    };
+
+    static int64_t currentSecond();
+
+    static const std::vector<std::chrono::microseconds>& latencyBounds();
+
+    std::atomic<uint64_t> bytes_sent_;
+    std::atomic<uint64_t> bytes_received_;
+    std::atomic<size_t>   active_downloads_;
+    std::atomic<size_t>   active_uploads_;
+    std::atomic<size_t>   queued_send_buffers_;
+
+    mutable std::mutex    rate_mutex_;
+    RateWindow            sent_rate_;
+    RateWindow            received_rate_;
+
+    mutable std::mutex                 latency_mutex_;
+    std::map<std::string, Histogram>   command_latency_;
+  };
+}
@@ -32,6 +32,64 @@ namespace fineftp
     return ftp_server_->addUserAnonymous(local_root_path, permissions);
   }
 
+  void FtpServer::setTransferBufferSize(size_t buffer_size)
+  {
+    assert(buffer_size > 0);
+    ftp_server_->setTransferBufferSize(buffer_size);
+  }
+
+  void FtpServer::setTransferQueueDepth(size_t queue_depth)
+  {
+    assert(queue_depth > 0);
+    ftp_server_->setTransferQueueDepth(queue_depth);
+  }
+
+  void FtpServer::setFileIoBackend(FileIoBackend backend, size_t thread_count)
+  {
+    assert(thread_count > 0);
+    ftp_server_->setFileIoBackend(backend, thread_count);
+  }
+
+  void FtpServer::setSortDirectoryListings(bool sort)
+  {
+    ftp_server_->setSortDirectoryListings(sort);
+  }
+
+  void FtpServer::setListingCache(size_t memory_budget, std::chrono::milliseconds max_age)
+  {
+    ftp_server_->setListingCache(memory_budget, max_age);
+  }
+
+  void FtpServer::setGlobalRateLimit(const RateLimit& rate_limit)
+  {
+    ftp_server_->setGlobalRateLimit(rate_limit);
+  }
+
+  void FtpServer::setSessionRateLimit(const RateLimit& rate_limit)
+  {
+    ftp_server_->setSessionRateLimit(rate_limit);
+  }
+
+  bool FtpServer::setUserRateLimit(const std::string& username, const RateLimit& rate_limit)
+  {
+    return ftp_server_->setUserRateLimit(username, rate_limit);
+  }
+
+  ServerMetrics FtpServer::getMetrics() const
+  {
+    return ftp_server_->getMetrics();
+  }
+
+  void FtpServer::setThreadingModel(ThreadingModel threading_model)
+  {
+    ftp_server_->setThreadingModel(threading_model);
+  }
+
+  TransferBufferStats FtpServer::getTransferBufferStats() const
+  {
+    return ftp_server_->getTransferBufferStats();
+  }
+
   bool FtpServer::start(size_t thread_count)
   {
     assert(thread_count > 0);
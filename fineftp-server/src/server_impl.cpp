@@ -9,11 +9,26 @@ namespace fineftp
 {
 
   FtpServerImpl::FtpServerImpl(const std::string& address, uint16_t port)
-    : port_                 (port)
-    , address_              (address)
-    , acceptor_             (io_service_)
-    , open_connection_count_(0)
-  {}
+    : port_                       (port)
+    , address_                    (address)
+    , transfer_buffer_size_       (1024 * 1024)
+    , transfer_queue_depth_       (3)
+    , file_io_backend_            (FileIoBackend::Auto)
+    , file_io_thread_count_       (2)
+    , sort_directory_listings_    (true)
+    , listing_cache_memory_budget_(0)
+    , listing_cache_max_age_      (0)
+    , global_bandwidth_limiter_   (std::make_shared<BandwidthLimiter>())
+    , metrics_                    (std::make_shared<MetricsCollector>())
+    , threading_model_            (ThreadingModel::SharedIoService)
+    , acceptor_per_io_context_    (false)
+    , next_session_io_context_    (0)
+    , open_connection_count_      (0)
+  {
+    // The first context also exists before start(), so getPort() and
+    // getAddress() behave the same in all threading models
+    io_contexts_.push_back(std::unique_ptr<IoContext>(new IoContext()));
+  }
 
   FtpServerImpl::~FtpServerImpl()
   {
@@ -36,9 +51,87 @@ namespace fineftp
     return ftp_users_.addUser("anonymous", "", local_root_path, permissions);
   }
 
+  void FtpServerImpl::setTransferBufferSize(size_t buffer_size)
+  {
+    transfer_buffer_size_ = buffer_size;
+  }
+
+  void FtpServerImpl::setTransferQueueDepth(size_t queue_depth)
+  {
+    transfer_queue_depth_ = queue_depth;
+  }
+
+  void FtpServerImpl::setFileIoBackend(FileIoBackend backend, size_t thread_count)
+  {
+    file_io_backend_      = backend;
+    file_io_thread_count_ = thread_count;
+  }
+
+  void FtpServerImpl::setSortDirectoryListings(bool sort)
+  {
+    sort_directory_listings_ = sort;
+  }
+
+  void FtpServerImpl::setListingCache(size_t memory_budget, std::chrono::milliseconds max_age)
+  {
+    listing_cache_memory_budget_ = memory_budget;
+    listing_cache_max_age_       = max_age;
+  }
+
+  void FtpServerImpl::setGlobalRateLimit(const RateLimit& rate_limit)
+  {
+    global_bandwidth_limiter_->setRateLimit(rate_limit);
+  }
+
+  void FtpServerImpl::setSessionRateLimit(const RateLimit& rate_limit)
+  {
+    session_rate_limit_ = rate_limit;
+  }
+
+  bool FtpServerImpl::setUserRateLimit(const std::string& username, const RateLimit& rate_limit)
+  {
+    return ftp_users_.setUserRateLimit(username, rate_limit);
+  }
+
+  ServerMetrics FtpServerImpl::getMetrics() const
+  {
+    return metrics_->snapshot(file_io_ ? file_io_->pendingRequests() : 0);
+  }
+
+  void FtpServerImpl::setThreadingModel(ThreadingModel threading_model)
+  {
+    threading_model_ = threading_model;
+  }
+
+  TransferBufferStats FtpServerImpl::getTransferBufferStats() const
+  {
+    if (!buffer_pool_)
+      return TransferBufferStats();
+
+    return buffer_pool_->stats();
+  }
+
   bool FtpServerImpl::start(size_t thread_count)
   {
-    auto ftp_session = std::make_shared<FtpSession>(io_service_, ftp_users_, [this]() { open_connection_count_--; });
+    // Keep enough idle buffers around for 16 concurrent full-speed transfers.
+    // Everything above that is given back to the system.
+    buffer_pool_ = std::make_shared<BufferPool>(transfer_buffer_size_, 16 * transfer_queue_depth_);
+    file_io_     = FileIo::create(file_io_backend_, file_io_thread_count_);
+
+    if ((listing_cache_memory_budget_ > 0) && (listing_cache_max_age_.count() > 0))
+      listing_cache_ = std::make_shared<ListingCache>(listing_cache_memory_budget_, listing_cache_max_age_);
+
+    const bool io_service_per_thread = (threading_model_ == ThreadingModel::IoServicePerThread);
+    while (io_service_per_thread && (io_contexts_.size() < thread_count))
+      io_contexts_.push_back(std::unique_ptr<IoContext>(new IoContext()));
+
+#ifdef __linux__
+    // The kernel distributes the connections between all acceptors that
+    // share the port with SO_REUSEPORT
+    acceptor_per_io_context_ = io_service_per_thread;
+#else
+    acceptor_per_io_context_ = false;
+#endif // __linux__
 
     // set up the acceptor to listen on the tcp port
     asio::error_code make_address_ec;
@@ -48,10 +141,52 @@ namespace fineftp
       std::cerr << "Error creating address from string \"" << address_<< "\": " << make_address_ec.message() << std::endl;
       return false;
     }
+
+    const size_t acceptor_count = (acceptor_per_io_context_ ? io_contexts_.size() : 1);
+    for (size_t i = 0; i < acceptor_count; i++)
+    {
+      if (!openAcceptor(io_contexts_[i]->acceptor, endpoint, acceptor_per_io_context_))
+        return false;
+
+      // If the port was chosen by the OS, all other acceptors have to use it as well
+      endpoint.port(io_contexts_[0]->acceptor.local_endpoint().port());
+    }
+
+#ifndef NDEBUG
+    std::cout << "FTP Server created." << std::endl << "Listening at address " << getAddress() << " on port " << getPort() << ":" << std::endl;
+#endif // NDEBUG
+
+    for (size_t i = 0; i < acceptor_count; i++)
+      waitForNextFtpSession(*io_contexts_[i]);
+
+    if (io_service_per_thread)
+    {
+      for (auto& io_context : io_contexts_)
+      {
+        // Contexts without an acceptor may be idle until they get their first session
+        io_context->work.reset(new asio::io_service::work(io_context->io_service));
+
+        IoContext* const context = io_context.get();
+        thread_pool_.emplace_back([context] { context->io_service.run(); });
+      }
+    }
+    else
+    {
+      for (size_t i = 0; i < thread_count; i++)
+      {
+        IoContext* const context = io_contexts_[0].get();
+        thread_pool_.emplace_back([context] { context->io_service.run(); });
+      }
+    }
     
+    return true;
+  }
+
+  bool FtpServerImpl::openAcceptor(asio::ip::tcp::acceptor& acceptor, const asio::ip::tcp::endpoint& endpoint, bool reuse_port)
+  {
     {
       asio::error_code ec;
-      acceptor_.open(endpoint.protocol(), ec);
+      acceptor.open(endpoint.protocol(), ec);
       if (ec)
       {
         std::cerr << "Error opening acceptor: " << ec.message() << std::endl;
@@ -61,17 +196,32 @@ namespace fineftp
     
     {
       asio::error_code ec;
-      acceptor_.set_option(asio::ip::tcp::acceptor::reuse_address(true), ec);
+      acceptor.set_option(asio::ip::tcp::acceptor::reuse_address(true), ec);
       if (ec)
       {
         std::cerr << "Error setting reuse_address option: " << ec.message() << std::endl;
         return false;
       }
     }
+
+#ifdef __linux__
+    if (reuse_port)
+    {
+      asio::error_code ec;
+      acceptor.set_option(asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>(true), ec);
+      if (ec)
+      {
+        std::cerr << "Error setting SO_REUSEPORT option: " << ec.message() << std::endl;
+        return false;
+      }
+    }
+#else
+    (void)reuse_port;
+#endif // __linux__
     
     {
       asio::error_code ec;
-      acceptor_.bind(endpoint, ec);
+      acceptor.bind(endpoint, ec);
       if (ec)
       {
         std::cerr << "Error binding acceptor: " << ec.message() << std::endl;
@@ -81,45 +231,58 @@ namespace fineftp
     
     {
       asio::error_code ec;
-      acceptor_.listen(asio::socket_base::max_listen_connections, ec);
+      acceptor.listen(asio::socket_base::max_listen_connections, ec);
       if (ec)
       {
         std::cerr << "Error listening on acceptor: " << ec.message() << std::endl;
         return false;
       }
     }
-    
-#ifndef NDEBUG
-    std::cout << "FTP Server created." << std::endl << "Listening at address " << acceptor_.local_endpoint().address() << " on port " << acceptor_.local_endpoint().port() << ":" << std::endl;
-#endif // NDEBUG
 
-    acceptor_.async_accept(ftp_session->getSocket()
-                          , [=](auto ec)
-                          {
-                            open_connection_count_++;
-
-                            this->acceptFtpSession(ftp_session, ec);
-                          });
-
-    for (size_t i = 0; i < thread_count; i++)
-    {
-      thread_pool_.emplace_back([=] {io_service_.run(); });
-    }
-    
     return true;
   }
 
   void FtpServerImpl::stop()
   {
-    io_service_.stop();
+    for (auto& io_context : io_contexts_)
+    {
+      io_context->work.reset();
+      io_context->io_service.stop();
+    }
     for (std::thread& thread : thread_pool_)
     {
       thread.join();
     }
     thread_pool_.clear();
+
+    // Nothing can issue new file requests anymore. Wait for the ones in flight,
+    // as their completion handlers are posted to the io_service.
+    if (file_io_)
+      file_io_->stop();
   }
 
-  void FtpServerImpl::acceptFtpSession(std::shared_ptr<FtpSession> ftp_session, asio::error_code const& error)
+  void FtpServerImpl::waitForNextFtpSession(IoContext& accepting_context)
+  {
+    // A session stays on the io_service of the context it has been created
+    // on, including its data connections and the PASV acceptor.
+    IoContext* session_context = &accepting_context;
+    if (!acceptor_per_io_context_ && (io_contexts_.size() > 1))
+    {
+      session_context = io_contexts_[next_session_io_context_].get();
+      next_session_io_context_ = (next_session_io_context_ + 1) % io_contexts_.size();
+    }
+
+    auto new_session = std::make_shared<FtpSession>(session_context->io_service, ftp_users_, buffer_pool_, transfer_queue_depth_, file_io_, sort_directory_listings_, listing_cache_, global_bandwidth_limiter_, session_rate_limit_, metrics_, [this]() { open_connection_count_--; });
+
+    accepting_context.acceptor.async_accept(new_session->getSocket()
+                                           , [this, &accepting_context, session_context, new_session](auto ec)
+                                           {
+                                             open_connection_count_++;
+                                             this->acceptFtpSession(accepting_context, *session_context, new_session, ec);
+                                           });
+  }
+
+  void FtpServerImpl::acceptFtpSession(IoContext& accepting_context, IoContext& session_context, std::shared_ptr<FtpSession> ftp_session, asio::error_code const& error)
   {
     if (error)
     {
@@ -133,16 +296,12 @@ namespace fineftp
     std::cout << "FTP Client connected: " << ftp_session->getSocket().remote_endpoint().address().to_string() << ":" << ftp_session->getSocket().remote_endpoint().port() << std::endl;
 #endif
 
-    ftp_session->start();
-
-    auto new_session = std::make_shared<FtpSession>(io_service_, ftp_users_, [this]() { open_connection_count_--; });
+    if (&session_context == &accepting_context)
+      ftp_session->start();
+    else
+      session_context.io_service.post([ftp_session]() { ftp_session->start(); });
 
-    acceptor_.async_accept(new_session->getSocket()
-                          , [=](auto ec)
-                          {
-                            open_connection_count_++;
-                            this->acceptFtpSession(new_session, ec);
-                          });
+    waitForNextFtpSession(accepting_context);
   }
 
   int FtpServerImpl::getOpenConnectionCount()
@@ -152,11 +311,11 @@ namespace fineftp
 
   uint16_t FtpServerImpl::getPort()
   {
-    return acceptor_.local_endpoint().port();
+    return io_contexts_[0]->acceptor.local_endpoint().port();
   }
 
   std::string FtpServerImpl::getAddress()
   {
-    return acceptor_.local_endpoint().address().to_string();
+    return io_contexts_[0]->acceptor.local_endpoint().address().to_string();
   }
 }
@@ -4,9 +4,16 @@
 #include <string>
 #include <thread>
 #include <atomic>
+#include <chrono>
+#include <memory>
 
 #include <asio.hpp>
 
+#include "bandwidth_limiter.h"
+#include "buffer_pool.h"
+#include "file_io.h"
+#include "listing_cache.h"
+#include "metrics_collector.h"
 #include "ftp_session.h"
 
 #include "ftp_user.h"
@@ -26,6 +33,22 @@ namespace fineftp
 
     bool addUserAnonymous(const std::string& local_root_path, const Permission permissions);
 
+    void setTransferBufferSize(size_t buffer_size);
+    void setTransferQueueDepth(size_t queue_depth);
+    void setFileIoBackend(FileIoBackend backend, size_t thread_count);
+    void setSortDirectoryListings(bool sort);
+    void setListingCache(size_t memory_budget, std::chrono::milliseconds max_age);
+
+    void setGlobalRateLimit(const RateLimit& rate_limit);
+    void setSessionRateLimit(const RateLimit& rate_limit);
+    bool setUserRateLimit(const std::string& username, const RateLimit& rate_limit);
+
+    ServerMetrics getMetrics() const;
+
+    void setThreadingModel(ThreadingModel threading_model);
+
+    TransferBufferStats getTransferBufferStats() const;
+
     bool start(size_t thread_count = 1);
 
     void stop();
@@ -37,7 +60,22 @@ namespace fineftp
     std::string getAddress();
 
   private:
-    void acceptFtpSession(std::shared_ptr<FtpSession> ftp_session, asio::error_code const& error);
+    /** An io_service and the acceptor that feeds it with sessions */
+    struct IoContext
+    {
+      IoContext()
+        : acceptor(io_service)
+      {}
+
+      asio::io_service                        io_service;
+      asio::ip::tcp::acceptor                 acceptor;    // Not opened, if the sessions are accepted by another context
+      std::unique_ptr<asio::io_service::work> work;
+    };
+
+    bool openAcceptor(asio::ip::tcp::acceptor& acceptor, const asio::ip::tcp::endpoint& endpoint, bool reuse_port);
+
+    void waitForNextFtpSession(IoContext& accepting_context);
+    void acceptFtpSession(IoContext& accepting_context, IoContext& session_context, std::shared_ptr<FtpSession> ftp_session, asio::error_code const& error);
 
   private:
     UserDatabase   ftp_users_;
@@ -45,9 +83,29 @@ namespace fineftp
     const uint16_t port_;
     const std::string address_;
 
-    std::vector<std::thread> thread_pool_;
-    asio::io_service         io_service_;
-    asio::ip::tcp::acceptor  acceptor_;
+    size_t                      transfer_buffer_size_;
+    size_t                      transfer_queue_depth_;
+    std::shared_ptr<BufferPool> buffer_pool_;
+
+    FileIoBackend               file_io_backend_;
+    size_t                      file_io_thread_count_;
+    std::shared_ptr<FileIo>     file_io_;
+
+    bool                          sort_directory_listings_;
+    size_t                        listing_cache_memory_budget_;
+    std::chrono::milliseconds     listing_cache_max_age_;
+    std::shared_ptr<ListingCache> listing_cache_;
+
+    const std::shared_ptr<BandwidthLimiter> global_bandwidth_limiter_;
+    RateLimit                               session_rate_limit_;
+    const std::shared_ptr<MetricsCollector> metrics_;
+
+    ThreadingModel                          threading_model_;
+    bool                                    acceptor_per_io_context_;
+    size_t                                  next_session_io_context_;   // Round robin, if a single acceptor feeds all contexts
+
+    std::vector<std::thread>                thread_pool_;
+    std::vector<std::unique_ptr<IoContext>> io_contexts_;               // A single one for ThreadingModel::SharedIoService
 
     std::atomic<int> open_connection_count_;
   };
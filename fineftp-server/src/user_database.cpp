@@ -110,6 +110,32 @@ namespace fineftp
     }
   }
 
+  bool UserDatabase::setUserRateLimit(const std::string& username, const RateLimit& rate_limit)
+  {
+    std::lock_guard<decltype(database_mutex_)> database_lock(database_mutex_);
+
+    std::shared_ptr<FtpUser> user;
+    if (isUsernameAnonymousUser(username))
+    {
+      user = anonymous_user_;
+    }
+    else
+    {
+      auto user_it = database_.find(username);
+      if (user_it != database_.end())
+        user = user_it->second;
+    }
+
+    if (!user)
+    {
+      std::cerr << "Error setting the rate limit of user \"" << username << "\". The user does not exist." << std::endl;
+      return false;
+    }
+
+    user->bandwidth_limiter_->setRateLimit(rate_limit);
+    return true;
+  }
+
   bool UserDatabase::isUsernameAnonymousUser(const std::string& username) const
   {
     return (username.empty()
@@ -21,6 +21,8 @@ namespace fineftp
 
     std::shared_ptr<FtpUser> getUser(const std::string& username, const std::string& password) const;
 
+    bool setUserRateLimit(const std::string& username, const RateLimit& rate_limit);
+
   private:
     bool isUsernameAnonymousUser(const std::string& username) const;
 
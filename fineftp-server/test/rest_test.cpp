@@ -0,0 +1,138 @@
+// REST followed by RETR or STOR.
+//
+// The server runs in the same process on a temporary directory, once with
+// each file I/O backend. A REST offset makes the next RETR send the tail of
+// the file, and the next STOR append to a file that has exactly that size.
+// Any other offset is refused before a byte is written, so resuming an upload
+// never leaves a file that only holds the uploaded tail. Exits with 1 if any
+// check fails.
+//
+//   g++ -std=c++14 -O2 -I../include -I../src -I<asio>/include
+//       rest_test.cpp ../src/*.cpp -lpthread -o rest_test
+//   ./rest_test
+
+#include <fineftp/server.h>
+
+#include "../bench/ftp_bench_client.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+
+#include <stdlib.h>
+#include <unistd.h>
+
+namespace
+{
+  int failures = 0;
+
+  void check(bool condition, const char* backend, const char* what)
+  {
+    std::printf("%-12s %-54s %s\n", backend, what, condition ? "ok" : "FAILED");
+    if (!condition)
+      failures++;
+  }
+
+  std::string readFile(const std::string& path)
+  {
+    std::ifstream file(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  }
+
+  void writeFile(const std::string& path, const std::string& content)
+  {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(content.data(), static_cast<std::streamsize>(content.size()));
+  }
+
+  void run(fineftp::FileIoBackend backend, const char* name, const std::string& dir, const std::string& data)
+  {
+    fineftp::FtpServer server("127.0.0.1", 0);
+    server.addUserAnonymous(dir, fineftp::Permission::All);
+    server.setFileIoBackend(backend);
+    server.start(1);
+
+    fineftp::bench::FtpBenchClient client;
+    if (!client.login(server.getPort()) || (client.command("TYPE I") != 200))
+    {
+      check(false, name, "login");
+      server.stop();
+      return;
+    }
+
+    const std::string path   = dir + "/upload.bin";
+    const size_t      offset = data.size() / 3;
+
+    std::string tail;
+    writeFile(path, data);
+    check((client.command("REST " + std::to_string(offset)) == 350)
+            && (client.retr("/upload.bin", &tail) == static_cast<long long>(data.size() - offset))
+            && (tail == data.substr(offset)),
+          name, "REST n + RETR sends the file from byte n");
+
+    writeFile(path, data.substr(0, offset));
+    check((client.command("REST " + std::to_string(offset)) == 350)
+            && (client.stor("/upload.bin", data.substr(offset)) == 226)
+            && (readFile(path) == data),
+          name, "REST n + STOR resumes a file of n bytes");
+
+    writeFile(path, data.substr(0, offset));
+    check((client.command("REST " + std::to_string(offset / 2)) == 350)
+            && (client.stor("/upload.bin", data.substr(offset / 2)) == 554)
+            && (readFile(path) == data.substr(0, offset)),
+          name, "REST n + STOR into a longer file is refused");
+
+    writeFile(path, data.substr(0, offset));
+    check((client.command("REST " + std::to_string(offset * 2)) == 350)
+            && (client.stor("/upload.bin", data.substr(offset * 2)) == 554)
+            && (readFile(path) == data.substr(0, offset)),
+          name, "REST n + STOR into a shorter file is refused");
+
+    ::unlink(path.c_str());
+    check((client.command("REST " + std::to_string(offset)) == 350)
+            && (client.stor("/upload.bin", data.substr(offset)) == 554)
+            && (::access(path.c_str(), F_OK) != 0),
+          name, "REST n + STOR of a missing file is refused");
+
+    writeFile(path, data.substr(0, offset));
+    check((client.command("REST 0") == 350)
+            && (client.stor("/upload.bin", data) == 226)
+            && (readFile(path) == data),
+          name, "REST 0 + STOR replaces the file");
+
+    writeFile(path, data.substr(0, offset));
+    check((client.command("REST " + std::to_string(offset)) == 350)
+            && (client.command("NOOP") == 200)
+            && (client.stor("/upload.bin", data.substr(offset)) == 226)
+            && (readFile(path) == data.substr(offset)),
+          name, "REST n + NOOP + STOR replaces the file");
+
+    client.quit();
+    server.stop();
+    ::unlink(path.c_str());
+  }
+}
+
+int main()
+{
+  char dir[] = "/tmp/fineftp_test_XXXXXX";
+  if (mkdtemp(dir) == nullptr)
+  {
+    std::perror("mkdtemp");
+    return 1;
+  }
+
+  // Several transfer buffers long, and no two buffers alike
+  std::string data;
+  for (int i = 0; data.size() < 3 * 1024 * 1024 + 12345; i++)
+    data += std::to_string(i) + ",";
+
+  run(fineftp::FileIoBackend::ThreadPool, "thread pool", dir, data);
+#ifdef __linux__
+  run(fineftp::FileIoBackend::IoUring, "io_uring", dir, data);
+#endif // __linux__
+
+  ::rmdir(dir);
+  return (failures == 0 ? 0 : 1);
+}
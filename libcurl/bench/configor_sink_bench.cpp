@@ -0,0 +1,122 @@
+// ߽ձ߽configor_sink᲻Ĵ
+//
+// ͬһеhttplibṩ/data.json(Լ30MBjson)/small(1KB)/data.jsonͬʱ
+// 8/small󲻶ϵ·ͳʱ/smallӳ١
+//   buffer_sink    buffer_sinkӦٽ
+//   configor_sink  ߽ձ߽
+// ӦУ˻Ͻ߳߳ͬһCPU
+// -Iָɵcurl_configor_sink.hڵĿ¼(-I..֮ǰ)ԱȽ汾
+//
+//   g++ -std=c++11 -O2 -DNDEBUG -I.. -I../../HttpLib -I<curl>/include configor_sink_bench.cpp
+//       ../curl_multi_engine.cpp ../curl_response_sink.cpp -lcurl -pthread -o configor_sink_bench
+//   ./configor_sink_bench [items] [rounds]
+
+#include "curl_configor_sink.h"
+#include "small_load.h"
+#include <httplib.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <string>
+#include <thread>
+
+using namespace libcurl;
+
+namespace {
+
+	const int small_concurrency = 8;
+
+	std::string make_document(size_t items)
+	{
+		std::string out = "[";
+		for (size_t i = 0; i < items; i++) {
+			if (i)
+				out += ",";
+			out += "{\"id\":" + std::to_string(i) + ",\"name\":\"item-" + std::to_string(i) +
+				"\",\"value\":" + std::to_string(i * 0.25) + ",\"tags\":[\"alpha\",\"beta\"],\"active\":true}";
+		}
+		out += "]";
+		return out;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	size_t items = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 320000;
+	int rounds = argc > 2 ? std::atoi(argv[2]) : 3;
+
+	httplib::Server svr;
+	//Ӧıͷݷд룬رNagle㷨ʱÿkeep-aliveҪȴӳȷ
+	svr.set_tcp_nodelay(true);
+	const std::string small_body(1024, 's');
+	const std::string document = make_document(items);
+	svr.Get("/small", [&](const httplib::Request&, httplib::Response& res) {
+		res.set_content(small_body, "application/octet-stream");
+	});
+	svr.Get("/data.json", [&](const httplib::Request&, httplib::Response& res) {
+		res.set_content(document, "application/json");
+	});
+
+	int port = svr.bind_to_any_port("127.0.0.1");
+	std::thread server([&] { svr.listen_after_bind(); });
+	while (!svr.is_running())
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+	const std::string base = "http://127.0.0.1:" + std::to_string(port);
+	curl_multi_engine engine;
+
+	printf("/data.json: %zu items, %.1f MB, %d concurrent /small requests, best of %d\n",
+		items, document.size() / 1e6, small_concurrency, rounds);
+	printf("%-14s %9s %8s %12s %16s\n", "mode", "seconds", "MB/s", "small req/s", "small max ms");
+
+	bool ok = true;
+	auto report = [&](const char* mode, bench::load_result best) {
+		ok = ok && best.ok;
+		printf("%-14s %9.2f %8.0f %12.0f %16.1f%s\n", mode, best.seconds, document.size() / 1e6 / best.seconds,
+			best.small_per_second, best.max_latency_ms, best.ok ? "" : "  (failed)");
+	};
+	auto best_of = [&](std::function<bool()> run) {
+		bench::load_result best;
+		for (int i = 0; i < rounds; i++) {
+			bench::load_result r = bench::measure(engine, base + "/small", small_concurrency, run);
+			if (i == 0 || r.seconds < best.seconds)
+				best = r;
+			best.ok = best.ok && r.ok;
+		}
+		return best;
+	};
+
+	report("buffer_sink", best_of([&] {
+		buffer_sink buffer;
+		http_request request;
+		request.url = base + "/data.json";
+		request.sink = &buffer;
+		if (engine.send(std::move(request)).result != CURLE_OK)
+			return false;
+
+		configor::json j;
+		configor::parse_config(j, buffer.str());
+		return j.size() == items;
+	}));
+
+	report("configor_sink", best_of([&] {
+		configor_sink<> sink;
+		http_request request;
+		request.url = base + "/data.json";
+
+		configor::json j;
+		if (sink.parse(engine, std::move(request), j).result != CURLE_OK)
+			return false;
+		return j.size() == items;
+	}));
+
+	svr.stop();
+	server.join();
+
+	if (!ok) {
+		fprintf(stderr, "a request failed\n");
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,146 @@
+// һ᲻Ĵ
+//
+// ͬһеhttplibṩ/small(1KB)/big(8MB)һΪ8MB/s/bigؽʱ
+// 8/small󲻶ϵ·ͳʱ/smallӳ١
+// /bigַʽ:
+//   none             ýȻص
+//   progress-engine  ȻصCURLOPT_XFERINFOFUNCTIONãִ߳Уÿ˯5ms
+//   progress-caller  Ȼصhttp_request::progressãڵsend()ִ߳Уÿ˯5ms
+//   nested-easy      ɻصcurl_easy_performִ󣬼ԭȵsend()
+//   nested-send      ɻصеsend()
+// ӦУ˻ĻصȻ߳CPU
+//
+//   g++ -std=c++11 -O2 -DNDEBUG -I.. -I../../HttpLib -I<curl>/include engine_stall_bench.cpp
+//       ../curl_multi_engine.cpp ../curl_response_sink.cpp -lcurl -pthread -o engine_stall_bench
+//   ./engine_stall_bench
+
+#include "curl_multi_engine.h"
+#include "small_load.h"
+#include <httplib.h>
+
+#include <chrono>
+#include <cstdio>
+#include <future>
+#include <string>
+#include <thread>
+
+using namespace libcurl;
+
+namespace {
+
+	const int small_concurrency = 8;
+	const curl_off_t big_speed = 8 * 1024 * 1024;
+	const auto callback_sleep = std::chrono::milliseconds(5);
+
+	int sleep_progress(void*, curl_off_t, curl_off_t, curl_off_t, curl_off_t)
+	{
+		std::this_thread::sleep_for(callback_sleep);
+		return 0;
+	}
+
+	http_request big_request(const std::string& base)
+	{
+		http_request request;
+		request.url = base + "/big";
+		request.timeout = 60;
+		request.configure = [](CURL* easy) {
+			curl_easy_setopt(easy, CURLOPT_MAX_RECV_SPEED_LARGE, big_speed);
+		};
+		return request;
+	}
+
+	// desc: ̵߳ɻصִrequestȴص
+	template <typename F>
+	bool run_in_handler(curl_multi_engine& engine, const std::string& base, F nested)
+	{
+		std::promise<bool> done;
+		http_request trigger;
+		trigger.url = base + "/small";
+		engine.async_send(std::move(trigger), [&done, nested](http_response&&) {
+			done.set_value(nested());
+		});
+		return done.get_future().get();
+	}
+}
+
+int main()
+{
+	httplib::Server svr;
+	//Ӧıͷݷд룬رNagle㷨ʱÿkeep-aliveҪȴӳȷ
+	svr.set_tcp_nodelay(true);
+	const std::string small_body(1024, 's');
+	const std::string big_body(8 * 1024 * 1024, 'b');
+	svr.Get("/small", [&](const httplib::Request&, httplib::Response& res) {
+		res.set_content(small_body, "application/octet-stream");
+	});
+	svr.Get("/big", [&](const httplib::Request&, httplib::Response& res) {
+		res.set_content(big_body, "application/octet-stream");
+	});
+
+	int port = svr.bind_to_any_port("127.0.0.1");
+	std::thread server([&] { svr.listen_after_bind(); });
+	while (!svr.is_running())
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+	const std::string base = "http://127.0.0.1:" + std::to_string(port);
+	curl_multi_engine engine;
+
+	printf("/big: 8MB at 8MB/s, %d concurrent /small requests, callbacks sleep 5ms\n", small_concurrency);
+	printf("%-16s %9s %12s %16s\n", "mode", "big s", "small req/s", "small max ms");
+
+	bool ok = true;
+	auto report = [&ok](const char* mode, const bench::load_result& r) {
+		ok = ok && r.ok;
+		printf("%-16s %9.2f %12.0f %16.1f%s\n", mode, r.seconds, r.small_per_second, r.max_latency_ms, r.ok ? "" : "  (failed)");
+	};
+
+	report("none", bench::measure(engine, base + "/small", small_concurrency, [&] {
+		return engine.send(big_request(base)).result == CURLE_OK;
+	}));
+
+	report("progress-engine", bench::measure(engine, base + "/small", small_concurrency, [&] {
+		http_request request = big_request(base);
+		request.configure = [](CURL* easy) {
+			curl_easy_setopt(easy, CURLOPT_MAX_RECV_SPEED_LARGE, big_speed);
+			curl_easy_setopt(easy, CURLOPT_NOPROGRESS, 0L);
+			curl_easy_setopt(easy, CURLOPT_XFERINFOFUNCTION, sleep_progress);
+		};
+		return engine.send(std::move(request)).result == CURLE_OK;
+	}));
+
+	report("progress-caller", bench::measure(engine, base + "/small", small_concurrency, [&] {
+		http_request request = big_request(base);
+		request.progress = [](curl_off_t, curl_off_t, curl_off_t, curl_off_t) {
+			std::this_thread::sleep_for(callback_sleep);
+			return true;
+		};
+		return engine.send(std::move(request)).result == CURLE_OK;
+	}));
+
+	report("nested-easy", bench::measure(engine, base + "/small", small_concurrency, [&] {
+		return run_in_handler(engine, base, [&] {
+			CURL* easy = curl_easy_init();
+			curl_easy_setopt(easy, CURLOPT_URL, (base + "/big").c_str());
+			curl_easy_setopt(easy, CURLOPT_MAX_RECV_SPEED_LARGE, big_speed);
+			curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, +[](char*, size_t size, size_t nmemb, void*) { return size * nmemb; });
+			CURLcode code = curl_easy_perform(easy);
+			curl_easy_cleanup(easy);
+			return code == CURLE_OK;
+		});
+	}));
+
+	report("nested-send", bench::measure(engine, base + "/small", small_concurrency, [&] {
+		return run_in_handler(engine, base, [&] {
+			return engine.send(big_request(base)).result == CURLE_OK;
+		});
+	}));
+
+	svr.stop();
+	server.join();
+
+	if (!ok) {
+		fprintf(stderr, "a request failed\n");
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,91 @@
+#pragma once
+// ׼Թõĸ: ڲһͬʱϵطСͳʱڵӦ
+
+#include "curl_multi_engine.h"
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+
+
+namespace libcurl {
+namespace bench {
+
+	typedef std::chrono::steady_clock clock_type;
+
+	// desc: ϵطGETֱstopΪtrue
+	struct small_load
+	{
+		curl_multi_engine& engine;
+		std::string url;
+		std::atomic<bool> stop{ false };
+		std::atomic<int> active{ 0 };
+		std::atomic<long> completed{ 0 };
+		std::atomic<long> failed{ 0 };
+		std::atomic<long long> max_latency_us{ 0 };
+
+		small_load(curl_multi_engine& e, const std::string& url) : engine(e), url(url) {}
+
+		void issue()
+		{
+			http_request request;
+			request.url = url;
+			clock_type::time_point start = clock_type::now();
+
+			active++;
+			engine.async_send(std::move(request), [this, start](http_response&& response) {
+				long long us = std::chrono::duration_cast<std::chrono::microseconds>(clock_type::now() - start).count();
+				long long seen = max_latency_us;
+				while (us > seen && !max_latency_us.compare_exchange_weak(seen, us)) {}
+
+				if (response.result == CURLE_OK && response.status_code == 200)
+					completed++;
+				else
+					failed++;
+
+				if (!stop)
+					issue();
+				active--;
+			});
+		}
+
+		void wait_idle()
+		{
+			while (active)
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	};
+
+	struct load_result
+	{
+		double seconds = 0;					//runʱ
+		double small_per_second = 0;
+		double max_latency_ms = 0;
+		bool ok = true;
+	};
+
+	// desc: concurrencysmall_urlĸִrunrunʱѾ
+	template <typename F>
+	load_result measure(curl_multi_engine& engine, const std::string& small_url, int concurrency, F run)
+	{
+		small_load load(engine, small_url);
+		for (int i = 0; i < concurrency; i++)
+			load.issue();
+
+		clock_type::time_point start = clock_type::now();
+		bool run_ok = run();
+		double seconds = std::chrono::duration<double>(clock_type::now() - start).count();
+
+		load.stop = true;
+		load.wait_idle();
+
+		load_result r;
+		r.seconds = seconds;
+		r.small_per_second = load.completed / seconds;
+		r.max_latency_ms = load.max_latency_us / 1000.0;
+		r.ok = run_ok && load.failed == 0;
+		return r;
+	}
+}
+}
@@ -0,0 +1,198 @@
+#pragma once
+#include "curl_multi_engine.h"
+#include "../Configor/json.hpp"
+
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <streambuf>
+#include <string>
+
+
+namespace libcurl {
+
+	// desc: ӦֱӽconfigorڴбӦ
+	// ڵparse߳нС߳writeаݸƵȴĻأ
+	// max_bufferedʱͣ(response_sink::ready)߳ȡݺټ
+	// ̴߳Ӳȴ黺ʹãڴá
+	//
+	// :
+	//     configor::json j;
+	//     libcurl::configor_sink<> sink;
+	//     http_request request;
+	//     request.url = "http://127.0.0.1/data.json";
+	//     http_response response = sink.parse(curl_multi_engine::instance(), std::move(request), j);
+	template <typename _ConfTy = configor::json>
+	class configor_sink : public response_sink
+	{
+		static_assert(std::is_same<typename _ConfTy::char_type, char>::value, "configor_sink only supports char based configs");
+
+	public:
+		// param: max_buffered/ȴݵޣʱͣ
+		explicit configor_sink(size_t max_buffered = 256 * 1024)
+			: buf(*this), max_buffered(max_buffered), finished(false), closed(false), paused(false) {
+		}
+
+		// desc: 󲢽Ӧconfig
+		// return: Ľʧʱconfigݲ
+		// ʧʱ׳configor쳣(ʧܵ´䱻жϵ)
+		http_response parse(curl_multi_engine& engine, http_request request, _ConfTy& config)
+		{
+			request.sink = this;
+			reset();
+
+			//ɻص̲߳ܵȴԼֻȽӦ
+			if (engine.in_engine_thread()) {
+				buffer_sink buffer;
+				request.sink = &buffer;
+				http_response response = engine.send(std::move(request));
+				if (response.result == CURLE_OK)
+					configor::parse_config(config, buffer.str());
+				return response;
+			}
+
+			std::future<http_response> result = engine.async_send(std::move(request));
+
+			std::exception_ptr parse_error;
+			try {
+				std::istream is(&buf);
+				configor::parse_config(config, is);
+			}
+			catch (...) {
+				parse_error = std::current_exception();
+			}
+
+			//ٶȡݣʱڽеĴᱻж
+			close();
+
+			//writefalseCURLE_WRITE_ERROR
+			http_response response = result.get();
+			if (parse_error && (response.result == CURLE_OK || response.result == CURLE_WRITE_ERROR))
+				std::rethrow_exception(parse_error);
+
+			return response;
+		}
+
+		virtual bool ready() override
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+
+			//Ѿʱwritefalseжϴ
+			if (closed || incoming.size() < max_buffered)
+				return true;
+
+			paused = true;
+			return false;
+		}
+
+		virtual bool write(const char* data, size_t size) override
+		{
+			if (size == 0)
+				return true;
+
+			std::lock_guard<std::mutex> lock(mutex);
+			if (closed)
+				return false;
+
+			//dataֻڵڼЧƺ
+			bool was_empty = incoming.empty();
+			incoming.append(data, size);
+			if (was_empty)
+				cv.notify_all();
+			return true;
+		}
+
+		virtual void end(CURLcode /*result*/) override
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			finished = true;
+			cv.notify_all();
+		}
+
+	private:
+		// desc: ֱӶȡǰݵstreambuf
+		class streambuf : public std::streambuf
+		{
+		public:
+			explicit streambuf(configor_sink& owner) : owner(owner) {
+			}
+
+			void clear() { setg(nullptr, nullptr, nullptr); }
+			void assign(const char* data, size_t size) { setg(const_cast<char*>(data), const_cast<char*>(data), const_cast<char*>(data) + size); }
+
+		protected:
+			virtual int_type underflow() override
+			{
+				return owner.next_chunk();
+			}
+
+		private:
+			configor_sink& owner;
+		};
+
+		void reset()
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			buf.clear();
+			incoming.clear();
+			parsing.clear();
+			finished = false;
+			closed = false;
+			paused = false;
+		}
+
+		void close()
+		{
+			bool resume_transfer = false;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				buf.clear();
+				closed = true;
+				resume_transfer = paused;
+				paused = false;
+			}
+
+			//ͣĴwritefalse䱻ж
+			if (resume_transfer)
+				resume();
+		}
+
+		std::streambuf::int_type next_chunk()
+		{
+			bool resume_transfer = false;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				cv.wait(lock, [this]() { return !incoming.empty() || finished; });
+				if (incoming.empty())
+					return std::char_traits<char>::eof();
+
+				//һѾ꣬ڴwrite
+				parsing.swap(incoming);
+				incoming.clear();
+
+				resume_transfer = paused;
+				paused = false;
+			}
+
+			//ѾգͣĴ
+			if (resume_transfer)
+				resume();
+
+			buf.assign(parsing.data(), parsing.size());
+			return std::char_traits<char>::to_int_type(parsing[0]);
+		}
+
+	private:
+		streambuf buf;
+
+		std::string parsing;		//ڱݣֻڽ߳з
+		const size_t max_buffered;
+
+		std::mutex mutex;
+		std::condition_variable cv;
+		std::string incoming;		//ȴ
+		bool finished;				//Ѿ
+		bool closed;				//Ѿ
+		bool paused;				//readyfalseѾͣ
+	};
+}
@@ -0,0 +1,513 @@
+#include "curl_multi_engine.h"
+
+namespace libcurl {
+
+	curl_multi_engine::curl_multi_engine(long max_host_connections, long max_total_connections)
+		: multi(nullptr), share(nullptr), stopping(false), performing(false)
+	{
+		curl_global_init(CURL_GLOBAL_ALL);
+
+		//DNSTLSỰӵĻ
+		share = curl_share_init();
+		curl_share_setopt(share, CURLSHOPT_LOCKFUNC, curl_multi_engine::lock_share);
+		curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, curl_multi_engine::unlock_share);
+		curl_share_setopt(share, CURLSHOPT_USERDATA, this);
+		curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+		curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+		curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+
+		multi = curl_multi_init();
+		//ÿܵĲlibcurlŶ
+		curl_multi_setopt(multi, CURLMOPT_MAX_HOST_CONNECTIONS, max_host_connections);
+		curl_multi_setopt(multi, CURLMOPT_MAX_TOTAL_CONNECTIONS, max_total_connections);
+		//HTTP/2ͬһ
+		curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+
+		worker = std::thread(&curl_multi_engine::run, this);
+	}
+
+	curl_multi_engine::~curl_multi_engine()
+	{
+		{
+			std::lock_guard<std::mutex> lock(queue_mutex);
+			stopping = true;
+		}
+		curl_multi_wakeup(multi);
+
+		if (worker.joinable())
+			worker.join();
+
+		curl_multi_cleanup(multi);
+		curl_share_cleanup(share);
+		curl_global_cleanup();
+	}
+
+	curl_multi_engine& curl_multi_engine::instance()
+	{
+		static curl_multi_engine engine;
+		return engine;
+	}
+
+	void curl_multi_engine::async_send(http_request request, completion_handler handler)
+	{
+		std::unique_ptr<transfer> t(new transfer());
+		t->request = std::move(request);
+		t->handler = std::move(handler);
+
+		//Ѿֹͣ
+		if (!enqueue(t)) {
+			t->response.result = CURLE_ABORTED_BY_CALLBACK;
+			finish(*t);
+		}
+	}
+
+	std::future<http_response> curl_multi_engine::async_send(http_request request)
+	{
+		auto promise = std::make_shared<std::promise<http_response>>();
+		std::future<http_response> result = promise->get_future();
+
+		async_send(std::move(request), [promise](http_response&& response) {
+			promise->set_value(std::move(response));
+		});
+
+		return result;
+	}
+
+	http_response curl_multi_engine::send(http_request request)
+	{
+		if (in_engine_thread())
+			return send_in_engine_thread(std::move(request));
+
+		if (!request.progress)
+			return async_send(std::move(request)).get();
+
+		//ֻ߳¼ȣprogressصڵǰִ߳
+		http_response response;
+		std::shared_ptr<progress_state> state = std::make_shared<progress_state>();
+		std::function<bool(curl_off_t, curl_off_t, curl_off_t, curl_off_t)> progress = request.progress;
+
+		std::unique_ptr<transfer> t(new transfer());
+		t->request = std::move(request);
+		t->progress = state;
+		t->handler = [state, &response](http_response&& r) {
+			std::lock_guard<std::mutex> lock(state->mutex);
+			response = std::move(r);
+			state->done = true;
+			state->changed.notify_one();
+		};
+
+		//Ѿֹͣ
+		if (!enqueue(t)) {
+			t->response.result = CURLE_ABORTED_BY_CALLBACK;
+			finish(*t);
+			return response;
+		}
+
+		std::unique_lock<std::mutex> lock(state->mutex);
+		for (;;) {
+			state->changed.wait(lock, [&state] { return state->updated || state->done; });
+			if (state->done)
+				break;
+			report_progress(*state, progress, lock);
+		}
+
+		return response;
+	}
+
+	http_response curl_multi_engine::send_in_engine_thread(http_request request)
+	{
+		http_response response;
+		bool done = false;
+		std::shared_ptr<progress_state> state;
+		std::function<bool(curl_off_t, curl_off_t, curl_off_t, curl_off_t)> progress = request.progress;
+
+		std::unique_ptr<transfer> t(new transfer());
+		t->request = std::move(request);
+		t->handler = [&response, &done](http_response&& r) {
+			response = std::move(r);
+			done = true;
+		};
+		if (progress) {
+			state = std::make_shared<progress_state>();
+			t->progress = state;
+		}
+
+		bool stopped = false;
+		{
+			std::lock_guard<std::mutex> lock(queue_mutex);
+			stopped = stopping;
+		}
+
+		//libcurlصвٵcurl_multi_performֹͣʱٽ
+		if (performing || stopped) {
+			t->response.result = performing ? CURLE_RECURSIVE_API_CALL : CURLE_ABORTED_BY_CALLBACK;
+			finish(*t);
+			return response;
+		}
+
+		//ɻص: ̲߳ܵȴԼճmultiɵǰ̼߳棬
+		//䲻ͣ
+		CURL* easy = start(std::move(t));
+		if (!easy)
+			return response;
+
+		while (!done) {
+			{
+				std::lock_guard<std::mutex> lock(queue_mutex);
+				stopped = stopping;
+			}
+
+			//ֹͣʱжɻص˵ǰջabort_all
+			if (stopped) {
+				auto it = running.find(easy);
+				if (it != running.end()) {
+					std::unique_ptr<transfer> aborted = std::move(it->second);
+					running.erase(it);
+					curl_multi_remove_handle(multi, easy);
+					aborted->response.result = CURLE_ABORTED_BY_CALLBACK;
+					finish(*aborted);
+				}
+				break;
+			}
+
+			perform();
+			if (done)
+				break;
+
+			if (state) {
+				std::unique_lock<std::mutex> lock(state->mutex);
+				if (state->updated)
+					report_progress(*state, progress, lock);
+			}
+
+			curl_multi_poll(multi, NULL, 0, 1000, NULL);
+		}
+
+		return response;
+	}
+
+	void curl_multi_engine::report_progress(progress_state& state, const std::function<bool(curl_off_t, curl_off_t, curl_off_t, curl_off_t)>& progress, std::unique_lock<std::mutex>& lock)
+	{
+		curl_off_t dltotal = state.dltotal;
+		curl_off_t dlnow = state.dlnow;
+		curl_off_t ultotal = state.ultotal;
+		curl_off_t ulnow = state.ulnow;
+		state.updated = false;
+
+		lock.unlock();
+		if (!progress(dltotal, dlnow, ultotal, ulnow))
+			state.abort = true;
+		lock.lock();
+	}
+
+	bool curl_multi_engine::enqueue(std::unique_ptr<transfer>& t)
+	{
+		{
+			std::lock_guard<std::mutex> lock(queue_mutex);
+			if (stopping)
+				return false;
+			pending.push_back(std::move(t));
+		}
+
+		//curl_multi_pollеȴ߳
+		curl_multi_wakeup(multi);
+		return true;
+	}
+
+	bool curl_multi_engine::in_engine_thread() const
+	{
+		return std::this_thread::get_id() == worker.get_id();
+	}
+
+	size_t curl_multi_engine::receive_body(void* contents, size_t size, size_t nmemb, void* ptransfer)
+	{
+		transfer* t = (transfer*)ptransfer;
+		response_sink* sink = t->request.sink;
+
+		if (!sink) {
+			t->response.body.append((char*)contents, size * nmemb);
+			return size * nmemb;
+		}
+
+		if (!t->sink_started) {
+			//յʱͷѾ
+			curl_off_t content_length = -1;
+			curl_easy_getinfo(t->easy, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &content_length);
+
+			t->sink_started = true;
+			if (!sink->begin(content_length))
+				return 0;
+		}
+
+		//sinkʱܽʱͣ䣬libcurl½
+		if (!sink->ready()) {
+			t->paused = true;
+			return CURL_WRITEFUNC_PAUSE;
+		}
+
+		//ֵݳȲͬʱlibcurlжϴ
+		return sink->write((char*)contents, size * nmemb) ? size * nmemb : 0;
+	}
+
+	int curl_multi_engine::record_progress(void* pstate, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow)
+	{
+		progress_state* state = (progress_state*)pstate;
+
+		{
+			std::lock_guard<std::mutex> lock(state->mutex);
+			//libcurlڴƵãûб仯ʱѵȴ߳
+			if ((state->dltotal != dltotal) || (state->dlnow != dlnow) || (state->ultotal != ultotal) || (state->ulnow != ulnow)) {
+				state->dltotal = dltotal;
+				state->dlnow = dlnow;
+				state->ultotal = ultotal;
+				state->ulnow = ulnow;
+				state->updated = true;
+				state->changed.notify_one();
+			}
+		}
+
+		//ط0ʱlibcurlжϴ
+		return state->abort ? 1 : 0;
+	}
+
+	void curl_multi_engine::lock_share(CURL* /*handle*/, curl_lock_data data, curl_lock_access /*access*/, void* pengine)
+	{
+		curl_multi_engine* engine = (curl_multi_engine*)pengine;
+		engine->share_mutex[data].lock();
+	}
+
+	void curl_multi_engine::unlock_share(CURL* /*handle*/, curl_lock_data data, void* pengine)
+	{
+		curl_multi_engine* engine = (curl_multi_engine*)pengine;
+		engine->share_mutex[data].unlock();
+	}
+
+	bool curl_multi_engine::prepare(transfer& t)
+	{
+		const http_request& request = t.request;
+
+		t.easy = curl_easy_init();
+		if (!t.easy) {
+			t.response.result = CURLE_FAILED_INIT;
+			return false;
+		}
+
+		//url
+		curl_easy_setopt(t.easy, CURLOPT_URL, request.url.c_str());
+		//òSIGPIPEź
+		curl_easy_setopt(t.easy, CURLOPT_NOSIGNAL, 1L);
+		//ʹ湲Ļ
+		curl_easy_setopt(t.easy, CURLOPT_SHARE, share);
+		//óʱ
+		curl_easy_setopt(t.easy, CURLOPT_TIMEOUT, request.timeout);
+		if (request.connect_timeout)
+			curl_easy_setopt(t.easy, CURLOPT_CONNECTTIMEOUT, request.connect_timeout);
+		//ĬϽյдresponse.body
+		curl_easy_setopt(t.easy, CURLOPT_WRITEFUNCTION, curl_multi_engine::receive_body);
+		curl_easy_setopt(t.easy, CURLOPT_WRITEDATA, &t);
+
+		if (request.post) {
+			//requestڴǰһֱЧظpost_data
+			curl_easy_setopt(t.easy, CURLOPT_POST, 1L);
+			curl_easy_setopt(t.easy, CURLOPT_POSTFIELDSIZE_LARGE, (curl_off_t)request.post_data.size());
+			curl_easy_setopt(t.easy, CURLOPT_POSTFIELDS, request.post_data.c_str());
+		}
+
+		for (const std::string& header : request.headers) {
+			curl_slist* header_list = curl_slist_append(t.header_list, header.c_str());
+			if (!header_list) {
+				t.response.result = CURLE_OUT_OF_MEMORY;
+				return false;
+			}
+			t.header_list = header_list;
+		}
+		if (t.header_list)
+			curl_easy_setopt(t.easy, CURLOPT_HTTPHEADER, t.header_list);
+
+		if (request.sink) {
+			CURL* easy = t.easy;
+			request.sink->resume_handler = [this, easy]() { resume(easy); };
+		}
+
+		if (t.progress) {
+			//ֻ¼ȣprogressصڵȴִ߳
+			curl_easy_setopt(t.easy, CURLOPT_NOPROGRESS, 0L);
+			curl_easy_setopt(t.easy, CURLOPT_XFERINFOFUNCTION, curl_multi_engine::record_progress);
+			curl_easy_setopt(t.easy, CURLOPT_XFERINFODATA, t.progress.get());
+		}
+
+		if (request.configure)
+			request.configure(t.easy);
+
+		return true;
+	}
+
+	void curl_multi_engine::finish(transfer& t)
+	{
+		if (t.easy) {
+			if (t.response.result == CURLE_OK) {
+				curl_easy_getinfo(t.easy, CURLINFO_RESPONSE_CODE, &t.response.status_code);
+
+				char* content_type = NULL;
+				if ((curl_easy_getinfo(t.easy, CURLINFO_CONTENT_TYPE, &content_type) == CURLE_OK) && content_type)
+					t.response.content_type = content_type;
+			}
+
+			curl_easy_cleanup(t.easy);
+			t.easy = nullptr;
+		}
+
+		if (t.header_list) {
+			curl_slist_free_all(t.header_list);
+			t.header_list = nullptr;
+		}
+
+		if (t.request.sink) {
+			//ûӦʱҲһbegin
+			if (!t.sink_started && (t.response.result == CURLE_OK))
+				t.request.sink->begin(0);
+			t.sink_started = true;
+			t.request.sink->end(t.response.result);
+		}
+
+		if (t.handler)
+			t.handler(std::move(t.response));
+	}
+
+	void curl_multi_engine::run()
+	{
+		for (;;) {
+			{
+				std::lock_guard<std::mutex> lock(queue_mutex);
+				if (stopping)
+					break;
+			}
+
+			perform();
+
+			//ûдʱҲڴ˵ȴֱµֹͣ
+			curl_multi_poll(multi, NULL, 0, 1000, NULL);
+		}
+
+		abort_all();
+	}
+
+	void curl_multi_engine::resume(CURL* easy)
+	{
+		{
+			std::lock_guard<std::mutex> lock(queue_mutex);
+			resumed.push_back(easy);
+		}
+
+		//curl_easy_pauseֻ߳е
+		curl_multi_wakeup(multi);
+	}
+
+	void curl_multi_engine::perform()
+	{
+		start_pending();
+		resume_paused();
+
+		int still_running = 0;
+		performing = true;
+		curl_multi_perform(multi, &still_running);
+		performing = false;
+
+		complete_finished();
+	}
+
+	void curl_multi_engine::start_pending()
+	{
+		std::deque<std::unique_ptr<transfer>> started;
+		{
+			std::lock_guard<std::mutex> lock(queue_mutex);
+			started.swap(pending);
+		}
+
+		for (std::unique_ptr<transfer>& t : started)
+			start(std::move(t));
+	}
+
+	void curl_multi_engine::resume_paused()
+	{
+		std::vector<CURL*> handles;
+		{
+			std::lock_guard<std::mutex> lock(queue_mutex);
+			handles.swap(resumed);
+		}
+
+		for (CURL* easy : handles) {
+			//ѾĵַҲܱµĴ: ֻͣĴ
+			//sinkȻܽʱreadyٴͣ
+			auto it = running.find(easy);
+			if (it == running.end() || !it->second->paused)
+				continue;
+
+			it->second->paused = false;
+
+			//curl_easy_pauseͣǰ
+			performing = true;
+			curl_easy_pause(easy, CURLPAUSE_CONT);
+			performing = false;
+		}
+	}
+
+	CURL* curl_multi_engine::start(std::unique_ptr<transfer> t)
+	{
+		if (!prepare(*t) || (curl_multi_add_handle(multi, t->easy) != CURLM_OK)) {
+			if (t->response.result == CURLE_OK)
+				t->response.result = CURLE_FAILED_INIT;
+			finish(*t);
+			return NULL;
+		}
+
+		CURL* easy = t->easy;
+		running[easy] = std::move(t);
+		return easy;
+	}
+
+	void curl_multi_engine::complete_finished()
+	{
+		CURLMsg* msg = NULL;
+		int msgs_left = 0;
+
+		while ((msg = curl_multi_info_read(multi, &msgs_left)) != NULL) {
+			if (msg->msg != CURLMSG_DONE)
+				continue;
+
+			auto it = running.find(msg->easy_handle);
+			if (it == running.end())
+				continue;
+
+			std::unique_ptr<transfer> t = std::move(it->second);
+			running.erase(it);
+
+			//msgcurl_multi_remove_handle֮ʧЧ
+			t->response.result = msg->data.result;
+			curl_multi_remove_handle(multi, t->easy);
+
+			finish(*t);
+		}
+	}
+
+	void curl_multi_engine::abort_all()
+	{
+		for (auto& entry : running) {
+			curl_multi_remove_handle(multi, entry.first);
+			entry.second->response.result = CURLE_ABORTED_BY_CALLBACK;
+			finish(*entry.second);
+		}
+		running.clear();
+
+		std::deque<std::unique_ptr<transfer>> aborted;
+		{
+			std::lock_guard<std::mutex> lock(queue_mutex);
+			aborted.swap(pending);
+		}
+
+		for (std::unique_ptr<transfer>& t : aborted) {
+			t->response.result = CURLE_ABORTED_BY_CALLBACK;
+			finish(*t);
+		}
+	}
+}
@@ -0,0 +1,161 @@
+#pragma once
+#define CURL_STATICLIB
+
+#include "curl/curl.h"
+#include "curl_response_sink.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+namespace libcurl {
+
+	// desc: һ
+	struct http_request
+	{
+		std::string url;
+		bool post = false;								//ΪtrueʱPOSTΪpost_data
+		std::string post_data;
+		std::vector<std::string> headers;				//ӵıͷ"content-type:application/json"
+		long timeout = 10;								//ʱʱ()0ʾʱ
+		long connect_timeout = 0;
+		response_sink* sink = nullptr;					//ΪʱӦдsinkresponse.bodyڴǰһֱЧ
+
+		// desc: 󷢳ǰeasyĶ(صmime)еĻص߳б
+		std::function<void(CURL*)> configure;
+
+		// desc: ȵĻصΪdltotaldlnowultotalulnowfalseʱжϴ
+		// ֻsend()ʹ: ֻ߳¼µĽȣصڵȴ߳бã
+		std::function<bool(curl_off_t, curl_off_t, curl_off_t, curl_off_t)> progress;
+	};
+
+	// desc: һĽ
+	struct http_response
+	{
+		CURLcode result = CURLE_OK;						//CURLE_OKʾɹ
+		long status_code = 0;							//HTTP״̬
+		std::string content_type;
+		std::string body;								//յ(sinkCURLOPT_WRITEFUNCTIONʱΪ)
+	};
+
+	// desc: curl_multiĲ
+	// һ߳curl_multi_pollӡDNSTLSỰĻͨcurl_share
+	// С˲ÿζ½ӡÿĲmax_host_connections
+	// libcurlŶӡ
+	// ɻص߳бãҲ׳쳣
+	class curl_multi_engine
+	{
+	public:
+		using completion_handler = std::function<void(http_response&&)>;
+
+		explicit curl_multi_engine(long max_host_connections = 6, long max_total_connections = 64);
+		~curl_multi_engine();
+
+		// desc: ڹ棬curl_http_sendӿڶͨ
+		static curl_multi_engine& instance();
+
+		// desc: ɺ߳еhandler
+		void async_send(http_request request, completion_handler handler);
+
+		// desc: ɺͨfutureؽ
+		std::future<http_response> async_send(http_request request);
+
+		// desc: 󲢵ȴ
+		// ɻصеʱͬmultiǰֱ̼߳ɣ䲻Ӱ죻
+		// sinklibcurlصеʱCURLE_RECURSIVE_API_CALL
+		http_response send(http_request request);
+
+		// desc: ǰ߳ǷΪ̣߳Ƿɻصsink
+		bool in_engine_thread() const;
+
+	private:
+		// desc: send()ȴĽȣ߳д룬ȴ̶߳ȡ
+		struct progress_state
+		{
+			std::mutex mutex;
+			std::condition_variable changed;
+			curl_off_t dltotal = 0;
+			curl_off_t dlnow = 0;
+			curl_off_t ultotal = 0;
+			curl_off_t ulnow = 0;
+			bool updated = false;						//δĽ
+			bool done = false;							//Ѿ
+			std::atomic<bool> abort{ false };			//progressصfalse
+		};
+
+		struct transfer
+		{
+			CURL* easy = nullptr;
+			curl_slist* header_list = nullptr;
+			http_request request;
+			completion_handler handler;
+			http_response response;
+			bool sink_started = false;
+			bool paused = false;						//receive_bodyCURL_WRITEFUNC_PAUSE
+			std::shared_ptr<progress_state> progress;	//Ϊʱ̼߳¼
+		};
+
+		curl_multi_engine(curl_multi_engine&&);
+		curl_multi_engine(const curl_multi_engine&);
+		curl_multi_engine& operator=(curl_multi_engine&&);
+		curl_multi_engine& operator=(const curl_multi_engine&);
+
+		static size_t receive_body(void* contents, size_t size, size_t nmemb, void* ptransfer);
+		static int record_progress(void* pstate, curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow);
+		static void lock_share(CURL* handle, curl_lock_data data, curl_lock_access access, void* pengine);
+		static void unlock_share(CURL* handle, curl_lock_data data, void* pengine);
+
+		// desc: 󴴽easy
+		// return: ʧʱfalseresponse.result
+		bool prepare(transfer& t);
+
+		// desc: ͷeasyɻص
+		static void finish(transfer& t);
+
+		// desc: ȴв߳
+		// return: Ѿֹͣʱfalseδ
+		bool enqueue(std::unique_ptr<transfer>& t);
+
+		// desc: ߳аmulti棬ֱ
+		http_response send_in_engine_thread(http_request request);
+
+		// desc: ڵǰ߳б¼Ľȣʱlockstate.mutexصڼͷ
+		static void report_progress(progress_state& state, const std::function<bool(curl_off_t, curl_off_t, curl_off_t, curl_off_t)>& progress, std::unique_lock<std::mutex>& lock);
+
+		// desc: multi
+		// return: ʧʱɻصNULL
+		CURL* start(std::unique_ptr<transfer> t);
+
+		// desc: ͣĴsink߳е
+		void resume(CURL* easy);
+
+		void run();
+		void perform();
+		void start_pending();
+		void resume_paused();
+		void complete_finished();
+		void abort_all();
+
+	private:
+		CURLM* multi;
+		CURLSH* share;
+		std::mutex share_mutex[CURL_LOCK_DATA_LAST];
+
+		std::mutex queue_mutex;
+		std::deque<std::unique_ptr<transfer>> pending;		//ȴmulti
+		std::vector<CURL*> resumed;							//sinkҪĴ
+		bool stopping;
+
+		std::map<CURL*, std::unique_ptr<transfer>> running;	//ֻ߳з
+		bool performing;									//߳curl_multi_performУlibcurlص
+		std::thread worker;
+	};
+}
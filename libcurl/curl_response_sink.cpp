@@ -0,0 +1,56 @@
+#include "curl_response_sink.h"
+#include <errno.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace libcurl {
+
+	callback_sink::callback_sink(callback cb) : cb(std::move(cb)) {
+	}
+
+	bool callback_sink::write(const char* data, size_t size)
+	{
+		return cb(data, size);
+	}
+
+	fd_sink::fd_sink(int fd) : fd(fd) {
+	}
+
+	bool fd_sink::write(const char* data, size_t size)
+	{
+		//writeֻдһ
+		while (size > 0) {
+#ifdef _WIN32
+			const int written = _write(fd, data, (unsigned int)size);
+#else
+			const ssize_t written = ::write(fd, data, size);
+#endif
+			if (written < 0) {
+				if (errno == EINTR)
+					continue;
+				return false;
+			}
+
+			data += written;
+			size -= (size_t)written;
+		}
+		return true;
+	}
+
+	bool buffer_sink::begin(curl_off_t content_length)
+	{
+		buffer.clear();
+		if (content_length > 0)
+			buffer.reserve((size_t)content_length);
+		return true;
+	}
+
+	bool buffer_sink::write(const char* data, size_t size)
+	{
+		buffer.append(data, size);
+		return true;
+	}
+}
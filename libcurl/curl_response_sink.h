@@ -0,0 +1,86 @@
+#pragma once
+#define CURL_STATICLIB
+
+#include "curl/curl.h"
+#include <functional>
+#include <string>
+
+
+namespace libcurl {
+
+	class curl_multi_engine;
+
+	// desc: ӦݵĿ꣬ݲstd::stringۻ
+	// endĺڴݵ߳(߳)б
+	class response_sink
+	{
+	public:
+		virtual ~response_sink() {}
+
+		// desc: յһǰ
+		// param: content_length/ӦͷеContent-Lengthδ֪ʱΪ-1
+		// return: falseжϴ
+		virtual bool begin(curl_off_t /*content_length*/) { return true; }
+
+		// desc: ÿյݡwriteǰ
+		// return: ʱܽʱfalseͣҲռֱ̣߳sinkresume
+		virtual bool ready() { return true; }
+
+		// desc: ÿյʱãdataֻڵڼЧ
+		// return: falseжϴ
+		virtual bool write(const char* data, size_t size) = 0;
+
+		// desc: (ɹʧܻж)һ
+		virtual void end(CURLcode /*result*/) {}
+
+	protected:
+		// desc: readyfalseͣĴ߳е
+		void resume() { if (resume_handler) resume_handler(); }
+
+	private:
+		friend class curl_multi_engine;
+		std::function<void()> resume_handler;			//ڴ俪ʼǰ
+	};
+
+	// desc: ݽߵĻص
+	class callback_sink : public response_sink
+	{
+	public:
+		using callback = std::function<bool(const char* data, size_t size)>;
+
+		explicit callback_sink(callback cb);
+
+		virtual bool write(const char* data, size_t size) override;
+
+	private:
+		callback cb;
+	};
+
+	// desc: дļ󲻹ر
+	class fd_sink : public response_sink
+	{
+	public:
+		explicit fd_sink(int fd);
+
+		virtual bool write(const char* data, size_t size) override;
+
+	private:
+		int fd;
+	};
+
+	// desc: д밴Content-LengthԤȷĻӦֻһڴ
+	class buffer_sink : public response_sink
+	{
+	public:
+		virtual bool begin(curl_off_t content_length) override;
+		virtual bool write(const char* data, size_t size) override;
+
+		const std::string& str() const { return buffer; }
+
+		// desc: ȡ߽յݣ
+		std::string take() { return std::move(buffer); }
+
+	private:
+		std::string buffer;
+	};
+}
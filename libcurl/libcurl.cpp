@@ -92,58 +92,36 @@ namespace libcurl {
 	std::string curl_http_send::HttpGet(const std::string& strUrl, const long nTimeout)
 	{
 		data.clear();
-		CURLcode res;
-		CURL* pCURL = curl_easy_init();
-
-		if (!pCURL) {
-			error("curl_easy_init error");
-			curl_easy_cleanup(pCURL);
-			return "";
-		}
 
+		http_request request;
 		//url
-		curl_easy_setopt(pCURL, CURLOPT_URL, strUrl.c_str());
-		//òSIGPIPEź
-		curl_easy_setopt(pCURL, CURLOPT_NOSIGNAL, 1L);
+		request.url = strUrl;
 		//óʱ
-		curl_easy_setopt(pCURL, CURLOPT_TIMEOUT, nTimeout);
-		//ÿ
-		curl_easy_setopt(pCURL, CURLOPT_NOPROGRESS, 0L);
-		//ڽݵĻص
-		curl_easy_setopt(pCURL, CURLOPT_WRITEFUNCTION, curl_http_send::receive_data);
-		//ôݸպԶָ
-		curl_easy_setopt(pCURL, CURLOPT_WRITEDATA, this);
-		//ڽʾĻص
-		curl_easy_setopt(pCURL, CURLOPT_PROGRESSFUNCTION, curl_http_send::progress_callback);
-		//ôݸʾԶָ
-		curl_easy_setopt(pCURL, CURLOPT_PROGRESSDATA, this);
-		//ڽձͷݵĻص
-		curl_easy_setopt(pCURL, CURLOPT_HEADERFUNCTION, curl_http_send::header_callback);
-		//ôݸձͷԶָ
-		curl_easy_setopt(pCURL, CURLOPT_HEADERDATA, this);
-
-		//
-		res = curl_easy_perform(pCURL);
+		request.timeout = nTimeout;
+		//ڽʾĻصڵȴĵǰ߳б
+		request.progress = [this](curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow) {
+			return curl_http_send::progress_callback(this, (double)dltotal, (double)dlnow, (double)ultotal, (double)ulnow) == 0;
+		};
+		request.configure = [this](CURL* pCURL) {
+			//ڽݵĻص
+			curl_easy_setopt(pCURL, CURLOPT_WRITEFUNCTION, curl_http_send::receive_data);
+			//ôݸպԶָ
+			curl_easy_setopt(pCURL, CURLOPT_WRITEDATA, this);
+			//ڽձͷݵĻص
+			curl_easy_setopt(pCURL, CURLOPT_HEADERFUNCTION, curl_http_send::header_callback);
+			//ôݸձͷԶָ
+			curl_easy_setopt(pCURL, CURLOPT_HEADERDATA, this);
+		};
+
+		//ݣɹִ
+		http_response response = curl_multi_engine::instance().send(std::move(request));
 
 		//res != CURLE_OKʧ
-		if (res != CURLE_OK) {
+		if (response.result != CURLE_OK) {
 			error("curl_easy_perform error");
 			data.clear();
 		}
-		else {
-			//ȡյStatus,Ϊ200ʾշ
-			long response_code;
-			curl_easy_getinfo(pCURL, CURLINFO_RESPONSE_CODE, &response_code);
-
-			if (response_code == 200) {
-				//printf("Data status normal\n");
-			}
-			else {
-				//printf("Data status abnormal\n");
-			}
-		}
 
-		curl_easy_cleanup(pCURL);
 		return data;
 	}
 
@@ -152,85 +130,54 @@ namespace libcurl {
 	
 		printf(file_path.c_str());
 		data.clear();
-		CURLcode res;
-		CURL* pCURL = curl_easy_init();
 
-		if (!pCURL) {
-			error("curl_easy_init error");
-			curl_easy_cleanup(pCURL);
-			return "";
-		}
+		curl_mime* form = NULL;
 
+		http_request request;
 		//url
-		curl_easy_setopt(pCURL, CURLOPT_URL, strUrl.c_str());
-		//òSIGPIPEź
-		curl_easy_setopt(pCURL, CURLOPT_NOSIGNAL, 1L);
+		request.url = strUrl;
 		//óʱ
-		curl_easy_setopt(pCURL, CURLOPT_CONNECTTIMEOUT, 5);
-		curl_easy_setopt(pCURL, CURLOPT_TIMEOUT, nTimeout);
-		//ÿ
-		curl_easy_setopt(pCURL, CURLOPT_NOPROGRESS, 0L);
-		//ڽݵĻص
-		curl_easy_setopt(pCURL, CURLOPT_WRITEFUNCTION, curl_http_send::receive_data);
-		//ôݸպԶָ
-		curl_easy_setopt(pCURL, CURLOPT_WRITEDATA, this);
-		//ڽʾĻص
-		curl_easy_setopt(pCURL, CURLOPT_PROGRESSFUNCTION, progress_callback);
-		//ôݸʾԶָ
-		curl_easy_setopt(pCURL, CURLOPT_PROGRESSDATA, progress_callback_ctx);
-		//ڽձͷݵĻص
-		curl_easy_setopt(pCURL, CURLOPT_HEADERFUNCTION, curl_http_send::header_callback);
-		//ôݸձͷԶָ
-		curl_easy_setopt(pCURL, CURLOPT_HEADERDATA, this);
-
-
-
-		// test_begin
-
-		struct curl_slist* header_list = NULL;
-		header_list = curl_slist_append(header_list, "Content-Type:multipart/form-data");
-		curl_easy_setopt(pCURL, CURLOPT_HTTPHEADER, header_list);
-
-		curl_mime* form = NULL;
-		form = curl_mime_init(pCURL);
-		curl_mimepart* file_field = NULL;
-		file_field = curl_mime_addpart(form);
-		curl_mime_name(file_field, "file");
-		curl_mime_filedata(file_field,file_path.c_str());
-		curl_easy_setopt(pCURL,CURLOPT_MIMEPOST,form);
-		// test_end
-
-		//
-		res = curl_easy_perform(pCURL);
+		request.connect_timeout = 5;
+		request.timeout = nTimeout;
+		request.headers.push_back("Content-Type:multipart/form-data");
+		//ڽʾĻصڵȴĵǰ߳б
+		if (progress_callback) {
+			request.progress = [progress_callback, progress_callback_ctx](curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow) {
+				return progress_callback(progress_callback_ctx, (double)dltotal, (double)dlnow, (double)ultotal, (double)ulnow) == 0;
+			};
+		}
+		request.configure = [&](CURL* pCURL) {
+			//ڽݵĻص
+			curl_easy_setopt(pCURL, CURLOPT_WRITEFUNCTION, curl_http_send::receive_data);
+			//ôݸպԶָ
+			curl_easy_setopt(pCURL, CURLOPT_WRITEDATA, this);
+			//ڽձͷݵĻص
+			curl_easy_setopt(pCURL, CURLOPT_HEADERFUNCTION, curl_http_send::header_callback);
+			//ôݸձͷԶָ
+			curl_easy_setopt(pCURL, CURLOPT_HEADERDATA, this);
+
+			form = curl_mime_init(pCURL);
+			curl_mimepart* file_field = NULL;
+			file_field = curl_mime_addpart(form);
+			curl_mime_name(file_field, "file");
+			curl_mime_filedata(file_field,file_path.c_str());
+			curl_easy_setopt(pCURL,CURLOPT_MIMEPOST,form);
+		};
+
+		//ݣɹִ
+		http_response response = curl_multi_engine::instance().send(std::move(request));
 
 		//res != CURLE_OKʧ
-		if (res != CURLE_OK) {
-			std::cout << res;
-		//	printf(res);
+		if (response.result != CURLE_OK) {
+			std::cout << response.result;
 			error("curl_easy_perform error");
 			data.clear();
 		}
-		else {
-			//ȡյStatus,Ϊ200ʾշ
-			long response_code;
-			curl_easy_getinfo(pCURL, CURLINFO_RESPONSE_CODE, &response_code);
-
-			if (response_code == 200) {
-				//printf("Data status normal\n");
-			}
-			else {
-				//printf("Data status abnormal\n");
-			}
-		}
-
-		if (header_list)
-			curl_slist_free_all(header_list);
 
+		//easyѾͷţmimeͷ
 		if (form)
 			curl_mime_free(form);
 
-		curl_easy_cleanup(pCURL);
-
 		return data;
 	}
 
@@ -239,65 +186,38 @@ namespace libcurl {
 
 		printf(file_path.c_str());
 		data.clear();
-		CURLcode res;
-		CURL* pCURL = curl_easy_init();
 
 		FILE* fp = NULL;
-
-		if (!pCURL) {
-			error("curl_easy_init error");
-			curl_easy_cleanup(pCURL);
-			return "";
-		}
-
 		fp = fopen(file_path.c_str(), "wb");
 
-
-
+		http_request request;
 		//url
-		curl_easy_setopt(pCURL, CURLOPT_URL, strUrl.c_str());
-		//òSIGPIPEź
-		curl_easy_setopt(pCURL, CURLOPT_NOSIGNAL, 1L);
+		request.url = strUrl;
 		//óʱ
-		curl_easy_setopt(pCURL, CURLOPT_CONNECTTIMEOUT, 5);
-		curl_easy_setopt(pCURL, CURLOPT_TIMEOUT, nTimeout);
-		//ÿ
-		curl_easy_setopt(pCURL, CURLOPT_NOPROGRESS, 0L);
-		//ڽݵĻص
-		curl_easy_setopt(pCURL, CURLOPT_WRITEFUNCTION, curl_http_send::download_data);
-		//ôݸպԶָ
-		curl_easy_setopt(pCURL, CURLOPT_WRITEDATA, fp);
-		//ڽʾĻص
-		curl_easy_setopt(pCURL, CURLOPT_PROGRESSFUNCTION, progress_callback);
-		//ôݸʾԶָ
-		curl_easy_setopt(pCURL, CURLOPT_PROGRESSDATA, progress_callback_ctx);
-
-
+		request.connect_timeout = 5;
+		request.timeout = nTimeout;
+		//ڽʾĻصڵȴĵǰ߳б
+		if (progress_callback) {
+			request.progress = [progress_callback, progress_callback_ctx](curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow) {
+				return progress_callback(progress_callback_ctx, (double)dltotal, (double)dlnow, (double)ultotal, (double)ulnow) == 0;
+			};
+		}
+		request.configure = [&](CURL* pCURL) {
+			//ڽݵĻص
+			curl_easy_setopt(pCURL, CURLOPT_WRITEFUNCTION, curl_http_send::download_data);
+			//ôݸպԶָ
+			curl_easy_setopt(pCURL, CURLOPT_WRITEDATA, fp);
+		};
 
-		//
-		res = curl_easy_perform(pCURL);
+		//ݣɹִ
+		http_response response = curl_multi_engine::instance().send(std::move(request));
 
 		//res != CURLE_OKʧ
-		if (res != CURLE_OK) {
-			std::cout << res;
-			//	printf(res);
+		if (response.result != CURLE_OK) {
+			std::cout << response.result;
 			error("curl_easy_perform error");
 			data.clear();
 		}
-		else {
-			//ȡյStatus,Ϊ200ʾշ
-			long response_code;
-			curl_easy_getinfo(pCURL, CURLINFO_RESPONSE_CODE, &response_code);
-
-			if (response_code == 200) {
-				//printf("Data status normal\n");
-			}
-			else {
-				//printf("Data status abnormal\n");
-			}
-		}
-
-		curl_easy_cleanup(pCURL);
 
 		if(fp)
 			fclose(fp);
@@ -308,82 +228,116 @@ namespace libcurl {
 	std::string curl_http_send::HttpPost(const std::string& strUrl, const char* send_data, const long nTimeout)
 	{
 		data.clear();
-		CURLcode res;
+		this->buf_size = 0;
 
-		CURL* pCURL = curl_easy_init();
-		struct curl_slist* headers = NULL;
+		http_request request;
+		//url
+		request.url = strUrl;
+		//Ҫ͵
+		request.post = true;
+		request.post_data = send_data ? send_data : "";
+		//÷͵Ϊjson
+		request.headers.push_back("content-type:application/json");
+		//óʱ
+		request.timeout = nTimeout;
+		//ڽʾĻصڵȴĵǰ߳б
+		request.progress = [this](curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow) {
+			return curl_http_send::progress_callback(this, (double)dltotal, (double)dlnow, (double)ultotal, (double)ulnow) == 0;
+		};
+		request.configure = [this](CURL* pCURL) {
+			//ڽݵĻص
+			curl_easy_setopt(pCURL, CURLOPT_WRITEFUNCTION, curl_http_send::receive_data);
+			//ôݸպݵԶָ
+			curl_easy_setopt(pCURL, CURLOPT_WRITEDATA, this);
+			//ڽձͷݵĻص
+			curl_easy_setopt(pCURL, CURLOPT_HEADERFUNCTION, curl_http_send::header_callback);
+			//ôݸձͷԶָ
+			curl_easy_setopt(pCURL, CURLOPT_HEADERDATA, this);
+		};
+
+		//ݣɹִ
+		http_response response = curl_multi_engine::instance().send(std::move(request));
 
-		if (!pCURL) {
-			error("curl_easy_init error");
-			curl_easy_cleanup(pCURL);
-			return "";
+		//res != CURLE_OKʧ
+		if (response.result != CURLE_OK) {
+			error("curl_easy_perform error");
+			data.clear();
+		}
+		else if (!response.content_type.empty()) {
+			std::cout << "ļ:" << response.content_type << std::endl;
 		}
 
-		this->buf_size = 0;
-		CURLcode ret;
-		ret = curl_easy_setopt(pCURL, CURLOPT_URL, strUrl.c_str());
-		curl_easy_setopt(pCURL, CURLOPT_TIMEOUT, 10);
-		ret = curl_easy_setopt(pCURL, CURLOPT_POST, 1L);
-		//÷͵Ϊjson
-		headers = curl_slist_append(headers, "content-type:application/json");
+		return data;
+	}
+
+	bool curl_http_send::HttpGet(const std::string& strUrl, response_sink& sink, const long nTimeout)
+	{
+		http_request request;
+		//url
+		request.url = strUrl;
+		//óʱ
+		request.timeout = nTimeout;
+		//ýݵĿ
+		request.sink = &sink;
+		//ڽʾĻصڵȴĵǰ߳б
+		request.progress = [this](curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow) {
+			return curl_http_send::progress_callback(this, (double)dltotal, (double)dlnow, (double)ultotal, (double)ulnow) == 0;
+		};
+		request.configure = [this](CURL* pCURL) {
+			//ڽձͷݵĻص
+			curl_easy_setopt(pCURL, CURLOPT_HEADERFUNCTION, curl_http_send::header_callback);
+			//ôݸձͷԶָ
+			curl_easy_setopt(pCURL, CURLOPT_HEADERDATA, this);
+		};
+
+		//ݣɹִ
+		http_response response = curl_multi_engine::instance().send(std::move(request));
 
-		if (headers == NULL) {
-			curl_slist_free_all(headers);
-			error("curl_slist_append error");
-			return "";
+		//res != CURLE_OKʧ
+		if (response.result != CURLE_OK) {
+			error("curl_easy_perform error");
+			return false;
 		}
 
-		//ҪhttpͷϢ
-		ret = curl_easy_setopt(pCURL, CURLOPT_HTTPHEADER, headers);
-		//òSIGPIPEź
-		curl_easy_setopt(pCURL, CURLOPT_NOSIGNAL, 1L);
-		//ÿ
-		curl_easy_setopt(pCURL, CURLOPT_NOPROGRESS, 0L);
+		return true;
+	}
+
+	bool curl_http_send::HttpPost(const std::string& strUrl, const char* send_data, response_sink& sink, const long nTimeout)
+	{
+		this->buf_size = 0;
+
+		http_request request;
+		//url
+		request.url = strUrl;
 		//Ҫ͵
-		ret = curl_easy_setopt(pCURL, CURLOPT_POSTFIELDS, send_data);
+		request.post = true;
+		request.post_data = send_data ? send_data : "";
+		//÷͵Ϊjson
+		request.headers.push_back("content-type:application/json");
 		//óʱ
-		ret = curl_easy_setopt(pCURL, CURLOPT_TIMEOUT, nTimeout);
-		//ڽݵĻص
-		ret = curl_easy_setopt(pCURL, CURLOPT_WRITEFUNCTION, curl_http_send::receive_data);
-		//ôݸպݵԶָ
-		ret = curl_easy_setopt(pCURL, CURLOPT_WRITEDATA, this);
-		//ڽʾĻص
-		ret = curl_easy_setopt(pCURL, CURLOPT_PROGRESSFUNCTION, curl_http_send::progress_callback);
-		//ôݸʾԶָ
-		ret = curl_easy_setopt(pCURL, CURLOPT_PROGRESSDATA, this);
-		//ڽձͷݵĻص
-		ret = curl_easy_setopt(pCURL, CURLOPT_HEADERFUNCTION, curl_http_send::header_callback);
-		//ôݸձͷԶָ
-		ret = curl_easy_setopt(pCURL, CURLOPT_HEADERDATA, this);
-
-
-		res = curl_easy_perform(pCURL);
-		curl_slist_free_all(headers);
+		request.timeout = nTimeout;
+		//ýݵĿ
+		request.sink = &sink;
+		//ڽʾĻصڵȴĵǰ߳б
+		request.progress = [this](curl_off_t dltotal, curl_off_t dlnow, curl_off_t ultotal, curl_off_t ulnow) {
+			return curl_http_send::progress_callback(this, (double)dltotal, (double)dlnow, (double)ultotal, (double)ulnow) == 0;
+		};
+		request.configure = [this](CURL* pCURL) {
+			//ڽձͷݵĻص
+			curl_easy_setopt(pCURL, CURLOPT_HEADERFUNCTION, curl_http_send::header_callback);
+			//ôݸձͷԶָ
+			curl_easy_setopt(pCURL, CURLOPT_HEADERDATA, this);
+		};
+
+		//ݣɹִ
+		http_response response = curl_multi_engine::instance().send(std::move(request));
 
 		//res != CURLE_OKʧ
-		if (res != CURLE_OK) {
+		if (response.result != CURLE_OK) {
 			error("curl_easy_perform error");
-			data.clear();
+			return false;
 		}
-		else {
-			//ȡյStatus,Ϊ200ʾշ
-			long response_code;
-			curl_easy_getinfo(pCURL, CURLINFO_RESPONSE_CODE, &response_code);
-
-			char* contentType = { 0 };
-			CURLcode return_code;
-			return_code = curl_easy_getinfo(pCURL, CURLINFO_CONTENT_TYPE, &contentType);
-			if ((CURLE_OK == return_code) && contentType)
-				std::cout << "ļ:" << contentType << std::endl;
-
-			if (response_code == 200) {
-				//printf("Data status normal\n");
-			}
-			else {
-				//printf("Data status abnormal\n");
-			}
-		}
-		curl_easy_cleanup(pCURL);
-		return data;
+
+		return true;
 	}
 }
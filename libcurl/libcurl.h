@@ -3,6 +3,8 @@
 #define CURL_STATICLIB
 
 #include "curl/curl.h"
+#include "curl_multi_engine.h"
+#include <atomic>
 #include <time.h>
 #include <stdio.h>
 #include <string>
@@ -34,6 +36,7 @@ namespace libcurl {
 		// desc: ϴؽȵĻص
 		// param: clientp/ΪûԶָ dltotal/ΪҪص dlnow/ǰص ultotal/ΪҪϴ ulnow/ǰϴ
 		// return: 0˺ط0ֵжϴ
+		// ӿеĽȻصڵýӿڵִ߳У߳
 
 		//ϴרõĻص
 		static int upload_progress_callback(void* clientp, double dltotal, double dlnow, double ultotal, double ulnow);
@@ -45,6 +48,8 @@ namespace libcurl {
 		// return: ձͷݵ
 		static size_t header_callback(char* buffer, size_t size, size_t nitems, void* userdata);
 
+		// ӿڶͨcurl_multi_engine::instance()ӵȻ乲
+
 		// desc: httpget
 		// param: strUrl/ݵĵַ nTimeout/ʱʱ
 		// return: 
@@ -57,6 +62,12 @@ namespace libcurl {
 		// return: 
 		std::string HttpPost(const std::string& strUrl, const char* send_data, const long nTimeout = 10);
 
+		// desc: Ӧдsinkdataۻhttpgethttppost
+		// param: sink/ݵĿ꣬curl_response_sink.hcurl_configor_sink.h
+		// return: ɹtrue
+		bool HttpGet(const std::string& strUrl, response_sink& sink, const long nTimeout = 10);
+		bool HttpPost(const std::string& strUrl, const char* send_data, response_sink& sink, const long nTimeout = 10);
+
 
 	private:
 		curl_http_send(curl_http_send&&);
@@ -65,7 +76,7 @@ namespace libcurl {
 		curl_http_send& operator=(const curl_http_send&);
 
 	private:
-		volatile double buf_size;				//յݵܴС
+		std::atomic<double> buf_size;			//յݵܴС߳д룬ڽȻصжȡ
 		std::string data;							//յ
 	};
 }